@@ -0,0 +1,100 @@
+/*
+ * Compact Binary Trees - exported functions for operations on 32bit nodes.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult cb32tree.h and cbtree.h for more details about those functions */
+
+#include "cb32tree.h"
+
+/* Return leftmost node in the tree, or NULL if none */
+struct cb32_node *cb32_first(struct cb_node **root)
+{
+	if (!*root)
+		return NULL;
+	return cb32_entry(__cb_walk_down(CB_KT_U32, *root, 0, 0, 0), struct cb32_node, node);
+}
+
+/* Return rightmost node in the tree, or NULL if none */
+struct cb32_node *cb32_last(struct cb_node **root)
+{
+	if (!*root)
+		return NULL;
+	return cb32_entry(__cb_walk_down(CB_KT_U32, *root, 0, 1, 0), struct cb32_node, node);
+}
+
+/* Return the node following <node> in the tree, or NULL if none. This
+ * requires a lookup from the root.
+ */
+struct cb32_node *cb32_next(struct cb_node **root, struct cb32_node *node)
+{
+	return cb32_entry(__cb_lookup(root, CB_KT_U32, __cb_nkey(CB_KT_U32, &node->node), 0, CB_WM_GT),
+			struct cb32_node, node);
+}
+
+/* Return the node preceding <node> in the tree, or NULL if none. This
+ * requires a lookup from the root.
+ */
+struct cb32_node *cb32_prev(struct cb_node **root, struct cb32_node *node)
+{
+	return cb32_entry(__cb_lookup(root, CB_KT_U32, __cb_nkey(CB_KT_U32, &node->node), 0, CB_WM_LT),
+			struct cb32_node, node);
+}
+
+struct cb32_node *cb32_lookup(struct cb_node **root, u32 x)
+{
+	return __cb32_lookup(root, x);
+}
+
+/* Find the node holding the highest key equal to or less than <x> in the
+ * tree <root>, or NULL if none.
+ */
+struct cb32_node *cb32_lookup_le(struct cb_node **root, u32 x)
+{
+	union cb_key k;
+
+	k.k32 = x;
+	return cb32_entry(__cb_lookup(root, CB_KT_U32, k, 0, CB_WM_LE), struct cb32_node, node);
+}
+
+/* Find the node holding the lowest key equal to or greater than <x> in the
+ * tree <root>, or NULL if none.
+ */
+struct cb32_node *cb32_lookup_ge(struct cb_node **root, u32 x)
+{
+	union cb_key k;
+
+	k.k32 = x;
+	return cb32_entry(__cb_lookup(root, CB_KT_U32, k, 0, CB_WM_GE), struct cb32_node, node);
+}
+
+struct cb32_node *cb32_insert(struct cb_node **root, struct cb32_node *node)
+{
+	return __cb32_insert(root, node);
+}
+
+struct cb32_node *cb32_delete(struct cb_node **root, struct cb32_node *node)
+{
+	return __cb32_delete(root, node);
+}
@@ -0,0 +1,86 @@
+/*
+ * Compact Binary Trees - macros and structures for operations on 64bit nodes.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _CB64TREE_H
+#define _CB64TREE_H
+
+#include "cbtree.h"
+
+/* Return the structure of type <type> whose member <member> points to <ptr> */
+#define cb64_entry(ptr, type, member) container_of_safe(ptr, type, member)
+
+#define CB64_ROOT	CB_ROOT
+
+/* This structure carries a compact node and a key. It must start with the
+ * cb_node, and the key must immediately follow it.
+ */
+struct cb64_node {
+	struct cb_node node; /* the tree node, must be at the beginning */
+	u64 key;
+};
+
+/*
+ * The following functions are not inlined by default. They are declared
+ * in cb64tree.c, which simply relies on the generic inline versions.
+ */
+struct cb64_node *cb64_first(struct cb_node **root);
+struct cb64_node *cb64_last(struct cb_node **root);
+struct cb64_node *cb64_next(struct cb_node **root, struct cb64_node *node);
+struct cb64_node *cb64_prev(struct cb_node **root, struct cb64_node *node);
+struct cb64_node *cb64_lookup(struct cb_node **root, u64 x);
+struct cb64_node *cb64_lookup_le(struct cb_node **root, u64 x);
+struct cb64_node *cb64_lookup_ge(struct cb_node **root, u64 x);
+struct cb64_node *cb64_insert(struct cb_node **root, struct cb64_node *node);
+struct cb64_node *cb64_delete(struct cb_node **root, struct cb64_node *node);
+
+/* Find the node holding key <x> in the tree <root>, or NULL if none */
+static forceinline struct cb64_node *__cb64_lookup(struct cb_node **root, u64 x)
+{
+	union cb_key k;
+
+	k.k64 = x;
+	return cb64_entry(__cb_lookup(root, CB_KT_U64, k, 0, CB_WM_EQ), struct cb64_node, node);
+}
+
+/* Insert node <node> into the tree <root>. Only node->key needs to be set.
+ * The node is returned, or the one already holding the same key if any, in
+ * which case <node> is not inserted.
+ */
+static forceinline struct cb64_node *__cb64_insert(struct cb_node **root, struct cb64_node *node)
+{
+	return cb64_entry(__cb_insert(root, CB_KT_U64, &node->node, 0), struct cb64_node, node);
+}
+
+/* Remove node <node> from the tree <root>. It is returned if it was found in
+ * the tree, otherwise NULL is returned. The cost is the same as a lookup.
+ */
+static forceinline struct cb64_node *__cb64_delete(struct cb_node **root, struct cb64_node *node)
+{
+	return cb64_entry(__cb_delete(root, CB_KT_U64, __cb_nkey(CB_KT_U64, &node->node), &node->node, 0),
+			  struct cb64_node, node);
+}
+
+#endif /* _CB64TREE_H */
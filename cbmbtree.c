@@ -0,0 +1,100 @@
+/*
+ * Compact Binary Trees - exported functions for operations on Multi-Byte data nodes.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult cbmbtree.h and cbtree.h for more details about those functions */
+
+#include "cbmbtree.h"
+
+/* Return leftmost node in the tree, or NULL if none */
+struct cbmb_node *cbmb_first(struct cb_node **root, unsigned int len)
+{
+	if (!*root)
+		return NULL;
+	return cbmb_entry(__cb_walk_down(CB_KT_MB, *root, 0, 0, len), struct cbmb_node, node);
+}
+
+/* Return rightmost node in the tree, or NULL if none */
+struct cbmb_node *cbmb_last(struct cb_node **root, unsigned int len)
+{
+	if (!*root)
+		return NULL;
+	return cbmb_entry(__cb_walk_down(CB_KT_MB, *root, 0, 1, len), struct cbmb_node, node);
+}
+
+/* Return the node following <node> in the tree, or NULL if none. This
+ * requires a lookup from the root.
+ */
+struct cbmb_node *cbmb_next(struct cb_node **root, struct cbmb_node *node, unsigned int len)
+{
+	return cbmb_entry(__cb_lookup(root, CB_KT_MB, __cb_nkey(CB_KT_MB, &node->node), len, CB_WM_GT),
+			struct cbmb_node, node);
+}
+
+/* Return the node preceding <node> in the tree, or NULL if none. This
+ * requires a lookup from the root.
+ */
+struct cbmb_node *cbmb_prev(struct cb_node **root, struct cbmb_node *node, unsigned int len)
+{
+	return cbmb_entry(__cb_lookup(root, CB_KT_MB, __cb_nkey(CB_KT_MB, &node->node), len, CB_WM_LT),
+			struct cbmb_node, node);
+}
+
+struct cbmb_node *cbmb_lookup(struct cb_node **root, const void * x, unsigned int len)
+{
+	return __cbmb_lookup(root, x, len);
+}
+
+/* Find the node holding the highest key equal to or less than <x> in the
+ * tree <root>, or NULL if none.
+ */
+struct cbmb_node *cbmb_lookup_le(struct cb_node **root, const void * x, unsigned int len)
+{
+	union cb_key k;
+
+	k.ptr = x;
+	return cbmb_entry(__cb_lookup(root, CB_KT_MB, k, len, CB_WM_LE), struct cbmb_node, node);
+}
+
+/* Find the node holding the lowest key equal to or greater than <x> in the
+ * tree <root>, or NULL if none.
+ */
+struct cbmb_node *cbmb_lookup_ge(struct cb_node **root, const void * x, unsigned int len)
+{
+	union cb_key k;
+
+	k.ptr = x;
+	return cbmb_entry(__cb_lookup(root, CB_KT_MB, k, len, CB_WM_GE), struct cbmb_node, node);
+}
+
+struct cbmb_node *cbmb_insert(struct cb_node **root, struct cbmb_node *node, unsigned int len)
+{
+	return __cbmb_insert(root, node, len);
+}
+
+struct cbmb_node *cbmb_delete(struct cb_node **root, struct cbmb_node *node, unsigned int len)
+{
+	return __cbmb_delete(root, node, len);
+}
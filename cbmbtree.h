@@ -0,0 +1,87 @@
+/*
+ * Compact Binary Trees - macros and structures for operations on Multi-Byte data nodes.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _CBMBTREE_H
+#define _CBMBTREE_H
+
+#include "cbtree.h"
+
+/* Return the structure of type <type> whose member <member> points to <ptr> */
+#define cbmb_entry(ptr, type, member) container_of_safe(ptr, type, member)
+
+#define CBMB_ROOT	CB_ROOT
+
+/* This structure carries a compact node and a key. It must start with the
+ * cb_node, and the key must immediately follow it. Its size depends on the
+ * application, and must be the same for all keys of a tree.
+ */
+struct cbmb_node {
+	struct cb_node node; /* the tree node, must be at the beginning */
+	unsigned char key[0]; /* the key, its size depends on the application */
+};
+
+/*
+ * The following functions are not inlined by default. They are declared
+ * in cbmbtree.c, which simply relies on the generic inline versions.
+ */
+struct cbmb_node *cbmb_first(struct cb_node **root, unsigned int len);
+struct cbmb_node *cbmb_last(struct cb_node **root, unsigned int len);
+struct cbmb_node *cbmb_next(struct cb_node **root, struct cbmb_node *node, unsigned int len);
+struct cbmb_node *cbmb_prev(struct cb_node **root, struct cbmb_node *node, unsigned int len);
+struct cbmb_node *cbmb_lookup(struct cb_node **root, const void * x, unsigned int len);
+struct cbmb_node *cbmb_lookup_le(struct cb_node **root, const void * x, unsigned int len);
+struct cbmb_node *cbmb_lookup_ge(struct cb_node **root, const void * x, unsigned int len);
+struct cbmb_node *cbmb_insert(struct cb_node **root, struct cbmb_node *node, unsigned int len);
+struct cbmb_node *cbmb_delete(struct cb_node **root, struct cbmb_node *node, unsigned int len);
+
+/* Find the node holding key <x> in the tree <root>, or NULL if none */
+static forceinline struct cbmb_node *__cbmb_lookup(struct cb_node **root, const void * x, unsigned int len)
+{
+	union cb_key k;
+
+	k.ptr = x;
+	return cbmb_entry(__cb_lookup(root, CB_KT_MB, k, len, CB_WM_EQ), struct cbmb_node, node);
+}
+
+/* Insert node <node> into the tree <root>. Only node->key needs to be set.
+ * The node is returned, or the one already holding the same key if any, in
+ * which case <node> is not inserted.
+ */
+static forceinline struct cbmb_node *__cbmb_insert(struct cb_node **root, struct cbmb_node *node, unsigned int len)
+{
+	return cbmb_entry(__cb_insert(root, CB_KT_MB, &node->node, len), struct cbmb_node, node);
+}
+
+/* Remove node <node> from the tree <root>. It is returned if it was found in
+ * the tree, otherwise NULL is returned. The cost is the same as a lookup.
+ */
+static forceinline struct cbmb_node *__cbmb_delete(struct cb_node **root, struct cbmb_node *node, unsigned int len)
+{
+	return cbmb_entry(__cb_delete(root, CB_KT_MB, __cb_nkey(CB_KT_MB, &node->node), &node->node, len),
+			  struct cbmb_node, node);
+}
+
+#endif /* _CBMBTREE_H */
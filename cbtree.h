@@ -0,0 +1,438 @@
+/*
+ * Compact Binary Trees - generic macros and structures.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+
+/*
+  General idea:
+  -------------
+  The compact binary tree (CB tree) is the "compact+indexing" variant described
+  in doc/design-notes.txt. Just like in an EB tree, each node carries both a
+  node part and a leaf part, but it only has the two branches. There are no
+  node_p/leaf_p upper pointers and no bit position :
+
+    - the split bit of a node part is deduced from the XOR between the keys
+      found below its two branches, since all keys in a subtree share the same
+      prefix above its split bit. XOR values strictly decrease while walking
+      down node parts ;
+
+    - a leaf is detected when the XOR of the two branches of the node we just
+      reached is not smaller than the previous one, which means that we reached
+      a node whose node part is above us, or when both branches point to the
+      node itself, which is how an unused node part is marked ;
+
+    - since there are no upper pointers, next/prev and delete need to descend
+      from the root, and are in O(log N).
+
+  The XOR above is generalized as a "distance" between two keys, which is
+  zero for equal keys and grows as their first difference moves towards the
+  most significant bits. For memory blocks and strings, it is derived from the
+  number of identical leading bits. The root is a simple pointer to the top
+  node, NULL when the tree is empty.
+
+  These trees do not support duplicate keys. Inserting an existing key returns
+  the node already holding it. A node is only 2 pointers followed by its key,
+  so that a cb32_node is 12 bytes on 32-bit and 24 bytes on 64-bit platforms,
+  compared to 24 and 40 for an eb32_node.
+ */
+
+#ifndef _CBTREE_H
+#define _CBTREE_H
+
+#include <string.h>
+#include "ebtree.h"
+#include "eb32tree.h"
+#include "eb64tree.h"
+
+/* Return the structure of type <type> whose member <member> points to <ptr> */
+#define cb_entry(ptr, type, member) container_of_safe(ptr, type, member)
+
+/* The root of a tree is a simple pointer to its top node, NULL when empty */
+#define CB_ROOT  NULL
+
+/* A compact node only carries its two branches. The key must immediately
+ * follow it in the type-specific node.
+ */
+struct cb_node {
+	struct cb_node *b[2]; /* left and right branches */
+};
+
+/* key types supported by the generic functions below */
+enum cb_key_type {
+	CB_KT_U32,  /* 32-bit unsigned integer */
+	CB_KT_U64,  /* 64-bit unsigned integer */
+	CB_KT_MB,   /* fixed-size memory block */
+	CB_KT_ST,   /* zero-terminated string */
+};
+
+/* lookup methods supported by __cb_lookup() */
+enum cb_method {
+	CB_WM_EQ,   /* exact match */
+	CB_WM_GE,   /* lowest key greater than or equal to the lookup key */
+	CB_WM_GT,   /* lowest key strictly greater than the lookup key */
+	CB_WM_LE,   /* highest key lower than or equal to the lookup key */
+	CB_WM_LT,   /* highest key strictly lower than the lookup key */
+};
+
+/* the lookup key, depending on the key type */
+union cb_key {
+	u32 k32;
+	u64 k64;
+	const void *ptr;
+};
+
+
+/***************************************\
+ * Private functions. Not for end-user *
+\***************************************/
+
+/* returns a pointer to the key stored after node <n> */
+static forceinline void *__cb_key(const struct cb_node *n)
+{
+	return (void *)(n + 1);
+}
+
+/* Returns the distance between lookup key <k> and the key of node <n>, which
+ * is zero for identical keys and grows as their first difference moves up.
+ * <len> is only used for memory blocks, and is in bytes.
+ */
+static forceinline u64 __cb_kdist(enum cb_key_type kt, union cb_key k,
+				  const struct cb_node *n, size_t len)
+{
+	size_t eq;
+
+	switch (kt) {
+	case CB_KT_U32:
+		return k.k32 ^ *(u32 *)__cb_key(n);
+	case CB_KT_U64:
+		return k.k64 ^ *(u64 *)__cb_key(n);
+	case CB_KT_MB:
+		return (len << 3) - equal_bits(k.ptr, __cb_key(n), 0, len << 3);
+	default:
+		eq = string_equal_bits(k.ptr, __cb_key(n), 0);
+		return (eq == (size_t)-1) ? 0 : ~0ULL - 1 - eq;
+	}
+}
+
+/* Returns the distance between the keys of nodes <a> and <b>, see above */
+static forceinline u64 __cb_dist(enum cb_key_type kt, const struct cb_node *a,
+				 const struct cb_node *b, size_t len)
+{
+	union cb_key k;
+
+	switch (kt) {
+	case CB_KT_U32:
+		k.k32 = *(u32 *)__cb_key(a);
+		break;
+	case CB_KT_U64:
+		k.k64 = *(u64 *)__cb_key(a);
+		break;
+	default:
+		k.ptr = __cb_key(a);
+		break;
+	}
+	return __cb_kdist(kt, k, b, len);
+}
+
+/* Compares lookup key <k> with the key of node <n>. Returns <0, 0 or >0 */
+static forceinline int __cb_kcmp(enum cb_key_type kt, union cb_key k,
+				 const struct cb_node *n, size_t len)
+{
+	switch (kt) {
+	case CB_KT_U32:
+		return (k.k32 > *(u32 *)__cb_key(n)) - (k.k32 < *(u32 *)__cb_key(n));
+	case CB_KT_U64:
+		return (k.k64 > *(u64 *)__cb_key(n)) - (k.k64 < *(u64 *)__cb_key(n));
+	case CB_KT_MB:
+		return memcmp(k.ptr, __cb_key(n), len);
+	default:
+		return strcmp(k.ptr, __cb_key(n));
+	}
+}
+
+/* Returns the key of node <n> as a lookup key */
+static forceinline union cb_key __cb_nkey(enum cb_key_type kt, const struct cb_node *n)
+{
+	union cb_key k;
+
+	switch (kt) {
+	case CB_KT_U32:
+		k.k32 = *(u32 *)__cb_key(n);
+		break;
+	case CB_KT_U64:
+		k.k64 = *(u64 *)__cb_key(n);
+		break;
+	default:
+		k.ptr = __cb_key(n);
+		break;
+	}
+	return k;
+}
+
+/* Returns non-zero if the node whose branches are at distance <xor> is a
+ * leaf, given the distance <pxor> of the branches of the node it was reached
+ * from, or 0 at the top of the tree. Node parts always have a non-zero
+ * distance, which is lower than their parent's, so 0 may not be confused with
+ * any real distance, while ~0ULL may be the distance between two cb64 keys.
+ */
+static forceinline int __cb_is_leaf(u64 xor, u64 pxor)
+{
+	return !xor || (pxor && xor >= pxor);
+}
+
+/* Walks down from node <p> reached with previous distance <pxor> (0 at the
+ * top), always taking branch <side>, and returns the first leaf found.
+ */
+static forceinline struct cb_node *__cb_walk_down(enum cb_key_type kt, struct cb_node *p,
+						  u64 pxor, int side, size_t len)
+{
+	u64 xor;
+
+	while (1) {
+		xor = __cb_dist(kt, p->b[0], p->b[1], len);
+		if (__cb_is_leaf(xor, pxor))
+			return p;
+		pxor = xor;
+		p = p->b[side];
+	}
+}
+
+/* Generic lookup function. Looks up key <k> in tree <root> according to
+ * method <meth>, and returns the matching node or NULL. The descent follows
+ * the key. For the ordered methods, the last branch that was not taken on the
+ * side of interest is remembered, so that it may be walked down if the key
+ * is not found below.
+ */
+static forceinline struct cb_node *__cb_lookup(struct cb_node **root, enum cb_key_type kt,
+					       union cb_key k, size_t len, enum cb_method meth)
+{
+	struct cb_node *p, *l, *r, *alt = NULL;
+	u64 pxor, xor, alt_xor = 0;
+	u64 kl, kr;
+	int cmp;
+
+	p = *root;
+	if (!p)
+		return NULL;
+
+	pxor = 0;
+	while (1) {
+		l = p->b[0];
+		r = p->b[1];
+		xor = __cb_dist(kt, l, r, len);
+
+		if (__cb_is_leaf(xor, pxor)) {
+			/* reached a leaf */
+			cmp = __cb_kcmp(kt, k, p, len);
+			if (cmp == 0) {
+				if (meth == CB_WM_EQ || meth == CB_WM_GE || meth == CB_WM_LE)
+					return p;
+			}
+			else if (meth == CB_WM_EQ)
+				return NULL;
+			else if (cmp < 0 && (meth == CB_WM_GE || meth == CB_WM_GT))
+				return p;
+			else if (cmp > 0 && (meth == CB_WM_LE || meth == CB_WM_LT))
+				return p;
+			break;
+		}
+
+		/* the node part's own key may match */
+		if ((meth == CB_WM_EQ || meth == CB_WM_GE || meth == CB_WM_LE) &&
+		    __cb_kcmp(kt, k, p, len) == 0)
+			return p;
+
+		kl = __cb_kdist(kt, k, l, len);
+		kr = __cb_kdist(kt, k, r, len);
+
+		if (kl > xor && kr > xor) {
+			/* the key differs from this whole subtree above its
+			 * split bit, so all of the subtree is either below or
+			 * above the key.
+			 */
+			if (meth == CB_WM_EQ)
+				return NULL;
+			cmp = __cb_kcmp(kt, k, l, len);
+			if (cmp < 0 && (meth == CB_WM_GE || meth == CB_WM_GT))
+				return __cb_walk_down(kt, p, pxor, 0, len);
+			if (cmp > 0 && (meth == CB_WM_LE || meth == CB_WM_LT))
+				return __cb_walk_down(kt, p, pxor, 1, len);
+			break;
+		}
+
+		pxor = xor;
+		if (kl <= kr) {
+			if (meth == CB_WM_GE || meth == CB_WM_GT) {
+				alt = r;
+				alt_xor = xor;
+			}
+			p = l;
+		} else {
+			if (meth == CB_WM_LE || meth == CB_WM_LT) {
+				alt = l;
+				alt_xor = xor;
+			}
+			p = r;
+		}
+	}
+
+	if (!alt)
+		return NULL;
+	return __cb_walk_down(kt, alt, alt_xor, (meth == CB_WM_GE || meth == CB_WM_GT) ? 0 : 1, len);
+}
+
+/* Inserts node <new> into tree <root>. Its key must already be set. Returns
+ * <new>, or the node already holding the same key, in which case <new> is not
+ * inserted.
+ */
+static forceinline struct cb_node *__cb_insert(struct cb_node **root, enum cb_key_type kt,
+					       struct cb_node *new, size_t len)
+{
+	struct cb_node **pp, *p, *l, *r;
+	u64 pxor, xor, kl, kr;
+	union cb_key k;
+
+	if (!*root) {
+		/* the node part is unused, this is marked by looping on itself */
+		new->b[0] = new->b[1] = new;
+		eb_publish(root, new);
+		return new;
+	}
+
+	k = __cb_nkey(kt, new);
+	pp = root;
+	p = *pp;
+	pxor = 0;
+	while (1) {
+		if (__cb_kcmp(kt, k, p, len) == 0)
+			return p;
+
+		l = p->b[0];
+		r = p->b[1];
+		xor = __cb_dist(kt, l, r, len);
+		if (__cb_is_leaf(xor, pxor))
+			break; /* leaf: insert above it */
+
+		kl = __cb_kdist(kt, k, l, len);
+		kr = __cb_kdist(kt, k, r, len);
+		if (kl > xor && kr > xor)
+			break; /* diverges above this node: insert above it */
+
+		pxor = xor;
+		pp = &p->b[kl > kr];
+		p = *pp;
+	}
+
+	/* <new>'s leaf goes on its own side below its node part, and <p> on
+	 * the other one.
+	 */
+	if (__cb_kcmp(kt, k, p, len) < 0) {
+		new->b[0] = new;
+		new->b[1] = p;
+	} else {
+		new->b[0] = p;
+		new->b[1] = new;
+	}
+	eb_publish(pp, new);
+	return new;
+}
+
+/* Removes from tree <root> the node holding key <k>. If <node> is not NULL,
+ * the node is only removed if it is this one. Returns the removed node, or
+ * NULL if none was found. This needs a full descent, hence is in O(log N).
+ */
+static forceinline struct cb_node *__cb_delete(struct cb_node **root, enum cb_key_type kt,
+					       union cb_key k, struct cb_node *node, size_t len)
+{
+	struct cb_node **pp, **ppp = NULL, **np = NULL;
+	struct cb_node *p, *l, *r, *parent = NULL;
+	u64 pxor, xor, kl, kr;
+	int side = 0;
+
+	if (!*root)
+		return NULL;
+
+	pp = root;
+	p = *pp;
+	pxor = 0;
+	while (1) {
+		l = p->b[0];
+		r = p->b[1];
+		xor = __cb_dist(kt, l, r, len);
+		if (__cb_is_leaf(xor, pxor))
+			break; /* reached a leaf */
+
+		kl = __cb_kdist(kt, k, l, len);
+		kr = __cb_kdist(kt, k, r, len);
+		if (kl > xor && kr > xor)
+			return NULL; /* not in this tree */
+
+		if (__cb_kcmp(kt, k, p, len) == 0)
+			np = pp; /* we've found our node part */
+
+		pxor = xor;
+		ppp = pp;
+		parent = p;
+		side = kl > kr;
+		pp = &p->b[side];
+		p = *pp;
+	}
+
+	if (__cb_kcmp(kt, k, p, len) != 0 || (node && p != node))
+		return NULL;
+
+	if (!parent) {
+		/* we were the only node */
+		eb_publish(root, NULL);
+		return p;
+	}
+
+	/* detach the leaf and its parent's node part */
+	eb_publish(ppp, parent->b[!side]);
+
+	if (parent != p) {
+		if (np) {
+			/* our node part is used, let the parent take it over */
+			parent->b[0] = p->b[0];
+			parent->b[1] = p->b[1];
+			eb_publish(np, parent);
+		}
+		else {
+			/* mark the parent's node part unused */
+			parent->b[0] = parent->b[1] = parent;
+		}
+	}
+	return p;
+}
+
+#endif /* _CBTREE_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
@@ -78,6 +78,76 @@
 #endif
 
 
+/* Gcc >= 3.1 can emit software prefetch instructions. These are only hints,
+ * so the fallback simply does nothing.
+ */
+#if !defined(eb_prefetch)
+#if (__GNUC__ > 3) || ((__GNUC__ == 3) && (__GNUC_MINOR__ >= 1))
+#define eb_prefetch(addr) __builtin_prefetch((addr), 0, 3)
+#else
+#define eb_prefetch(addr) do { } while (0)
+#endif
+#endif
+
+
+/* Stores value <val> into pointer location <ptr> with release semantics, so
+ * that all previous stores are visible to other threads before this one.
+ * This is used to publish fully initialized nodes into a tree which may be
+ * visited by concurrent lockless readers (see eb_delete_rcu()). Readers only
+ * rely on address dependencies, which all supported CPUs respect.
+ */
+#if !defined(eb_publish)
+#if (__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 7))
+#define eb_publish(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#else
+#define eb_publish(ptr, val) do { __asm__ __volatile__("" ::: "memory"); *(ptr) = (val); } while (0)
+#endif
+#endif
+
+
+/* The hot exported functions relying on bit scans are built in several
+ * versions, one of which is picked at load time depending on the CPU, so that
+ * a single build uses the best instructions available (eg: LZCNT instead of
+ * BSR on x86-64-v3 CPUs). This requires gcc >= 11 on x86-64 with ifunc
+ * support, is useless when the build already targets such CPUs, and may be
+ * disabled by defining EB_NO_MULTIVERSION. Other architectures already have
+ * a fast bit scan in their base instruction set (eg: CLZ on aarch64).
+ * EB_HAVE_MULTIVERSION is defined when it is in use.
+ */
+#if !defined(EB_MULTIVERSION)
+#if !defined(EB_NO_MULTIVERSION) && !defined(__LZCNT__) && !defined(__clang__) && \
+    defined(__x86_64__) && defined(__ELF__) && defined(__gnu_linux__) && (__GNUC__ >= 11)
+#define EB_MULTIVERSION __attribute__((target_clones("arch=x86-64-v3", "default")))
+#define EB_HAVE_MULTIVERSION
+#else
+#define EB_MULTIVERSION
+#endif
+#endif
+
+
+/* Byte string comparisons (equal_bits() and friends) use vector instructions
+ * when the build target supports them: SSE2 (always present on x86-64), AVX2
+ * when enabled at build time, and NEON on little-endian aarch64. Defining
+ * EB_NO_SIMD forces the portable word-based versions (eg: for address
+ * sanitizers, which may complain about the page-safe over-reads performed on
+ * strings). EB_SIMD_SSE2, EB_SIMD_AVX2 and EB_SIMD_NEON report what is used.
+ */
+#if !defined(EB_NO_SIMD) && defined(__GNUC__)
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define EB_SIMD_SSE2
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define EB_SIMD_AVX2
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON) && \
+      defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#include <arm_neon.h>
+#define EB_SIMD_NEON
+#endif
+#endif
+
+
 /* sets alignment for current field or variable */
 #ifndef ALIGNED
 #define ALIGNED(x) __attribute__((aligned(x)))
@@ -0,0 +1,672 @@
+/*
+ * Elastic Binary Trees - macros and structures for operations on 128bit nodes.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _EB128TREE_H
+#define _EB128TREE_H
+
+#include <string.h>
+#include "ebtree.h"
+
+/* 128-bit keys rely on the compiler's native 128-bit integers, which are
+ * available on 64-bit platforms. Nothing is defined otherwise.
+ */
+#if defined(__SIZEOF_INT128__)
+
+/* Return the structure of type <type> whose member <member> points to <ptr> */
+#define eb128_entry(ptr, type, member) container_of(ptr, type, member)
+
+#define EB128_ROOT	EB_ROOT
+#define EB128_TREE_HEAD	EB_TREE_HEAD
+
+/* This type may sometimes already be defined. */
+typedef unsigned __int128 u128;
+
+/* This structure carries a node, a leaf, and a key. It must start with the
+ * eb_node so that it can be cast into an eb_node. The key is a native 128-bit
+ * integer, use eb128_key_from_be() to build it from an IPv6 address.
+ */
+struct eb128_node {
+	struct eb_node node; /* the tree node, must be at the beginning */
+	MAYBE_ALIGN(sizeof(void*));
+	ALWAYS_ALIGN(sizeof(void*));
+	u128 key;
+} ALIGNED(sizeof(void*));
+
+/*
+ * Exported functions and macros.
+ * Many of them are always inlined because they are extremely small, and
+ * are generally called at most once or twice in a program.
+ */
+
+/* Return the 128-bit key made of the 16 bytes at <addr> in network byte order
+ * (eg: an IPv6 address), so that the keys are sorted like the addresses.
+ */
+static inline u128 eb128_key_from_be(const void *addr)
+{
+	unsigned long long hi, lo;
+
+	memcpy(&hi, addr, sizeof(hi));
+	memcpy(&lo, (const char *)addr + sizeof(hi), sizeof(lo));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	hi = __builtin_bswap64(hi);
+	lo = __builtin_bswap64(lo);
+#endif
+	return ((u128)hi << 64) | lo;
+}
+
+/* Store key <key> as 16 bytes in network byte order at <addr> */
+static inline void eb128_key_to_be(u128 key, void *addr)
+{
+	unsigned long long hi = key >> 64, lo = key;
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	hi = __builtin_bswap64(hi);
+	lo = __builtin_bswap64(lo);
+#endif
+	memcpy(addr, &hi, sizeof(hi));
+	memcpy((char *)addr + sizeof(hi), &lo, sizeof(lo));
+}
+
+/* Return leftmost node in the tree, or NULL if none */
+static inline struct eb128_node *eb128_first(struct eb_root *root)
+{
+	return eb128_entry(eb_first(root), struct eb128_node, node);
+}
+
+/* Return rightmost node in the tree, or NULL if none */
+static inline struct eb128_node *eb128_last(struct eb_root *root)
+{
+	return eb128_entry(eb_last(root), struct eb128_node, node);
+}
+
+/* Return next node in the tree, or NULL if none */
+static inline struct eb128_node *eb128_next(struct eb128_node *eb128)
+{
+	return eb128_entry(eb_next(&eb128->node), struct eb128_node, node);
+}
+
+/* Return previous node in the tree, or NULL if none */
+static inline struct eb128_node *eb128_prev(struct eb128_node *eb128)
+{
+	return eb128_entry(eb_prev(&eb128->node), struct eb128_node, node);
+}
+
+/* Return next leaf node within a duplicate sub-tree, or NULL if none. */
+static inline struct eb128_node *eb128_next_dup(struct eb128_node *eb128)
+{
+	return eb128_entry(eb_next_dup(&eb128->node), struct eb128_node, node);
+}
+
+/* Return previous leaf node within a duplicate sub-tree, or NULL if none. */
+static inline struct eb128_node *eb128_prev_dup(struct eb128_node *eb128)
+{
+	return eb128_entry(eb_prev_dup(&eb128->node), struct eb128_node, node);
+}
+
+/* Return next node in the tree, skipping duplicates, or NULL if none */
+static inline struct eb128_node *eb128_next_unique(struct eb128_node *eb128)
+{
+	return eb128_entry(eb_next_unique(&eb128->node), struct eb128_node, node);
+}
+
+/* Return previous node in the tree, skipping duplicates, or NULL if none */
+static inline struct eb128_node *eb128_prev_unique(struct eb128_node *eb128)
+{
+	return eb128_entry(eb_prev_unique(&eb128->node), struct eb128_node, node);
+}
+
+/* Delete node from the tree if it was linked in. Mark the node unused. Note
+ * that this function relies on a non-inlined generic function: eb_delete.
+ */
+static inline void eb128_delete(struct eb128_node *eb128)
+{
+	eb_delete(&eb128->node);
+}
+
+/* Remove the leftmost node from the tree and return it, or NULL if none */
+static inline struct eb128_node *eb128_pick_first(struct eb_root *root)
+{
+	return eb128_entry(eb_pick_first(root), struct eb128_node, node);
+}
+
+/* Remove the rightmost node from the tree and return it, or NULL if none */
+static inline struct eb128_node *eb128_pick_last(struct eb_root *root)
+{
+	return eb128_entry(eb_pick_last(root), struct eb128_node, node);
+}
+
+/*
+ * The following functions are not inlined by default. They are declared
+ * in eb128tree.c, which simply relies on their inline version.
+ */
+struct eb128_node *eb128_lookup(struct eb_root *root, u128 x);
+struct eb128_node *eb128_lookup_le(struct eb_root *root, u128 x);
+struct eb128_node *eb128_lookup_ge(struct eb_root *root, u128 x);
+struct eb128_node *eb128_pick(struct eb_root *root, u128 x);
+struct eb128_node *eb128_pick_le(struct eb_root *root, u128 x);
+struct eb128_node *eb128_pick_ge(struct eb_root *root, u128 x);
+struct eb128_node *eb128_insert(struct eb_root *root, struct eb128_node *new);
+struct eb128_node *eb128_lookup_longest(struct eb_root *root, u128 x);
+struct eb128_node *eb128_insert_prefix(struct eb_root *root, struct eb128_node *new);
+
+/*
+ * The following functions are less likely to be used directly, because their
+ * code is larger. The non-inlined version is preferred.
+ */
+
+/* Return the position of the highest bit set in non-zero <x>, from 1 to 128 */
+static forceinline unsigned int flsnz128(u128 x)
+{
+	unsigned long long hi = x >> 64;
+
+	if (hi)
+		return flsnz64(hi) + 64;
+	return flsnz64((unsigned long long)x);
+}
+
+/* Return the number of identical leading bits between <a> and <b>, from 0 to
+ * 128. Prefix trees number the bits from the highest one like ebmb does.
+ */
+static forceinline int __eb128_equal_bits(u128 a, u128 b)
+{
+	a ^= b;
+	if (!a)
+		return 128;
+	return 128 - flsnz128(a);
+}
+
+/* Return non-zero if the <len> leading bits of <a> and <b> differ */
+static forceinline int __eb128_check_bits(u128 a, u128 b, unsigned int len)
+{
+	return len && ((a ^ b) >> (128 - len)) != 0;
+}
+
+/* Return -1, 0 or 1 depending on bit <pos> counted from the highest one being
+ * lower in <a>, equal, or higher than in <b>.
+ */
+static forceinline int __eb128_cmp_bits(u128 a, u128 b, unsigned int pos)
+{
+	pos = 127 - pos;
+	return (int)((a >> pos) & 1) - (int)((b >> pos) & 1);
+}
+
+/* Delete node from the tree if it was linked in. Mark the node unused. */
+static forceinline void __eb128_delete(struct eb128_node *eb128)
+{
+	__eb_delete(&eb128->node);
+}
+
+/*
+ * Find the first occurence of a key in the tree <root>. If none can be
+ * found, return NULL.
+ */
+static forceinline struct eb128_node *__eb128_lookup(struct eb_root *root, u128 x)
+{
+	struct eb128_node *node;
+	eb_troot_t *troot;
+	u128 y;
+	int node_bit;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	while (1) {
+		if ((eb_gettag(troot) == EB_LEAF)) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct eb128_node, node.branches);
+			if (node->key == x)
+				return node;
+			else
+				return NULL;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct eb128_node, node.branches);
+		node_bit = node->node.bit;
+
+		y = node->key ^ x;
+		if (!y) {
+			/* Either we found the node which holds the key, or
+			 * we have a dup tree. In the later case, we have to
+			 * walk it down left to get the first entry.
+			 */
+			if (node_bit < 0) {
+				troot = node->node.branches.b[EB_LEFT];
+				while (eb_gettag(troot) != EB_LEAF)
+					troot = (eb_untag(troot, EB_NODE))->b[EB_LEFT];
+				node = container_of(eb_untag(troot, EB_LEAF),
+						    struct eb128_node, node.branches);
+			}
+			return node;
+		}
+
+		if ((y >> node_bit) >= EB_NODE_BRANCHES)
+			return NULL; /* no more common bits */
+
+		troot = node->node.branches.b[(x >> node_bit) & EB_NODE_BRANCH_MASK];
+	}
+}
+
+/*
+ * Find the first occurence of a key in the tree <root> and remove it from the
+ * tree. The node is returned, or NULL if none could be found.
+ */
+static forceinline struct eb128_node *__eb128_pick(struct eb_root *root, u128 x)
+{
+	struct eb128_node *node = __eb128_lookup(root, x);
+
+	if (node)
+		__eb_delete(&node->node);
+	return node;
+}
+
+/* Insert eb128_node <new> into subtree starting at node root <root>.
+ * Only new->key needs be set with the key. The eb128_node is returned.
+ * If root->b[EB_RGHT]==1, the tree may only contain unique keys.
+ */
+static forceinline struct eb128_node *
+__eb128_insert(struct eb_root *root, struct eb128_node *new) {
+	struct eb128_node *old;
+	unsigned int side;
+	eb_troot_t *troot, **up_ptr;
+	u128 newkey; /* caching the key saves approximately one cycle */
+	eb_troot_t *root_right;
+	eb_troot_t *new_left, *new_rght;
+	eb_troot_t *new_leaf;
+	int old_node_bit;
+
+	side = EB_LEFT;
+	troot = root->b[EB_LEFT];
+	root_right = root->b[EB_RGHT];
+	if (unlikely(troot == NULL)) {
+		/* Tree is empty, insert the leaf part below the left branch */
+		new->node.leaf_p = eb_dotag(root, EB_LEFT);
+		new->node.node_p = NULL; /* node part unused */
+		eb_publish(&root->b[EB_LEFT], eb_dotag(&new->node.branches, EB_LEAF));
+		return new;
+	}
+
+	/* The tree descent is the same as in __eb32_insert(). <newkey> carries
+	 * the key being inserted.
+	 */
+	newkey = new->key;
+
+	while (1) {
+		if (eb_gettag(troot) == EB_LEAF) {
+			/* insert above a leaf */
+			old = container_of(eb_untag(troot, EB_LEAF),
+					    struct eb128_node, node.branches);
+			new->node.node_p = old->node.leaf_p;
+			up_ptr = &old->node.leaf_p;
+			break;
+		}
+
+		/* OK we're walking down this link */
+		old = container_of(eb_untag(troot, EB_NODE),
+				    struct eb128_node, node.branches);
+		old_node_bit = old->node.bit;
+
+		/* Stop going down when we don't have common bits anymore. We
+		 * also stop in front of a duplicates tree because it means we
+		 * have to insert above.
+		 */
+
+		if ((old_node_bit < 0) || /* we're above a duplicate tree, stop here */
+		    (((newkey ^ old->key) >> old_node_bit) >= EB_NODE_BRANCHES)) {
+			/* The tree did not contain the key, so we insert <new> before the node
+			 * <old>, and set ->bit to designate the lowest bit position in <new>
+			 * which applies to ->branches.b[].
+			 */
+			new->node.node_p = old->node.node_p;
+			up_ptr = &old->node.node_p;
+			break;
+		}
+
+		/* walk down */
+		root = &old->node.branches;
+		side = (newkey >> old_node_bit) & EB_NODE_BRANCH_MASK;
+		troot = root->b[side];
+	}
+
+	new_left = eb_dotag(&new->node.branches, EB_LEFT);
+	new_rght = eb_dotag(&new->node.branches, EB_RGHT);
+	new_leaf = eb_dotag(&new->node.branches, EB_LEAF);
+
+	if (newkey == old->key) {
+		new->node.bit = -1; /* mark as new dup tree, just in case */
+
+		if (likely(eb_gettag(root_right))) {
+			/* we refuse to duplicate this key if the tree is
+			 * tagged as containing only unique keys.
+			 */
+			return old;
+		}
+
+		if (eb_gettag(troot) != EB_LEAF) {
+			/* there was already a dup tree below */
+			struct eb_node *ret;
+			ret = eb_insert_dup(&old->node, &new->node);
+			return container_of(ret, struct eb128_node, node);
+		}
+		/* otherwise fall through */
+	}
+	else {
+		/* note that if EB_NODE_BITS > 1, we should check that it's still >= 0 */
+		new->node.bit = flsnz128(newkey ^ old->key) - EB_NODE_BITS;
+	}
+
+	if (newkey >= old->key) {
+		new->node.branches.b[EB_LEFT] = troot;
+		new->node.branches.b[EB_RGHT] = new_leaf;
+		new->node.leaf_p = new_rght;
+		eb_publish(up_ptr, new_left);
+	}
+	else {
+		new->node.branches.b[EB_LEFT] = new_leaf;
+		new->node.branches.b[EB_RGHT] = troot;
+		new->node.leaf_p = new_left;
+		eb_publish(up_ptr, new_rght);
+	}
+
+	/* Ok, now we are inserting <new> between <root> and <old>. <old>'s
+	 * parent is already set to <new>, and the <root>'s branch is still in
+	 * <side>.
+	 */
+	eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+	__eb_count_update(new->node.leaf_p);
+	return new;
+}
+
+/* Find the first occurence of the longest prefix matching a key <x> in the
+ * tree <root>, which must only have been filled using eb128_insert_prefix().
+ * This is the same as __ebmb_lookup_longest() with 16-byte keys, but working
+ * on whole words. If none can be found, return NULL.
+ */
+static forceinline struct eb128_node *__eb128_lookup_longest(struct eb_root *root, u128 x)
+{
+	struct eb128_node *node;
+	eb_troot_t *troot, *cover;
+	int node_bit;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	cover = NULL;
+	while (1) {
+		if ((eb_gettag(troot) == EB_LEAF)) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct eb128_node, node.branches);
+			if (__eb128_check_bits(x, node->key, node->node.pfx))
+				goto not_found;
+
+			return node;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct eb128_node, node.branches);
+
+		node_bit = node->node.bit;
+		if (node_bit < 0) {
+			/* We have a dup tree now. Either it's for the same
+			 * value, and we walk down left, or it's a different
+			 * one and we don't have our key.
+			 */
+			if (__eb128_check_bits(x, node->key, node->node.pfx))
+				goto not_found;
+
+			troot = node->node.branches.b[EB_LEFT];
+			while (eb_gettag(troot) != EB_LEAF)
+				troot = (eb_untag(troot, EB_NODE))->b[EB_LEFT];
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct eb128_node, node.branches);
+			return node;
+		}
+
+		/* all the bits before this node's must match, or the data
+		 * does not match.
+		 */
+		node_bit >>= 1; /* strip cover bit */
+		if (__eb128_check_bits(x, node->key, node_bit))
+			goto not_found;
+
+		if (!(node->node.bit & 1)) {
+			/* This is a cover node, let's keep a reference to it
+			 * for later. The covering subtree is on the left, and
+			 * the covered subtree is on the right, so we have to
+			 * walk down right.
+			 */
+			cover = node->node.branches.b[EB_LEFT];
+			troot = node->node.branches.b[EB_RGHT];
+			continue;
+		}
+		troot = node->node.branches.b[(x >> (127 - node_bit)) & 1];
+	}
+
+ not_found:
+	/* Walk down last cover tree if it exists. It does not matter if cover is NULL */
+	return eb128_entry(eb_walk_down(cover, EB_LEFT), struct eb128_node, node);
+}
+
+/* Insert eb128_node <new> into a prefix subtree starting at node root <root>.
+ * Only new->key and new->node.pfx need be set with the key and its prefix
+ * length (0 to 128). Bits past the prefix length should be zero. The node is
+ * returned. If root->b[EB_RGHT]==1, the tree may only contain unique keys.
+ * This is the same as __ebmb_insert_prefix() with 16-byte keys, and the same
+ * bit encoding is used : bits are numbered from the highest one, and ->bit is
+ * 2N for a cover node for N bits, or 2N+1 for a normal node at bit N.
+ */
+static forceinline struct eb128_node *
+__eb128_insert_prefix(struct eb_root *root, struct eb128_node *new)
+{
+	struct eb128_node *old;
+	unsigned int side;
+	eb_troot_t *troot, **up_ptr;
+	eb_troot_t *root_right;
+	int diff;
+	int bit;
+	eb_troot_t *new_left, *new_rght;
+	eb_troot_t *new_leaf;
+	int old_node_bit;
+
+	side = EB_LEFT;
+	troot = root->b[EB_LEFT];
+	root_right = root->b[EB_RGHT];
+	if (unlikely(troot == NULL)) {
+		/* Tree is empty, insert the leaf part below the left branch */
+		new->node.leaf_p = eb_dotag(root, EB_LEFT);
+		new->node.node_p = NULL; /* node part unused */
+		eb_publish(&root->b[EB_LEFT], eb_dotag(&new->node.branches, EB_LEAF));
+		return new;
+	}
+
+	bit = 0;
+	while (1) {
+		if (unlikely(eb_gettag(troot) == EB_LEAF)) {
+			/* Insert above a leaf. Note that this leaf could very
+			 * well be part of a cover node.
+			 */
+			old = container_of(eb_untag(troot, EB_LEAF),
+					    struct eb128_node, node.branches);
+			new->node.node_p = old->node.leaf_p;
+			up_ptr = &old->node.leaf_p;
+			goto check_bit_and_break;
+		}
+
+		/* OK we're walking down this link */
+		old = container_of(eb_untag(troot, EB_NODE),
+				   struct eb128_node, node.branches);
+		old_node_bit = old->node.bit;
+		/* Note that old_node_bit can be :
+		 *   < 0    : dup tree
+		 *   = 2N   : cover node for N bits
+		 *   = 2N+1 : normal node at N bits
+		 */
+
+		if (unlikely(old_node_bit < 0)) {
+			/* We're above a duplicate tree, so we must compare the whole value */
+			new->node.node_p = old->node.node_p;
+			up_ptr = &old->node.node_p;
+		check_bit_and_break:
+			bit = __eb128_equal_bits(new->key, old->key);
+			break;
+		}
+
+		/* WARNING: for the two blocks below, <bit> is counted in half-bits */
+
+		bit = __eb128_equal_bits(new->key, old->key);
+		bit = (bit << 1) + 1; /* assume comparisons with normal nodes */
+
+		/* we must always check that our prefix is larger than the nodes
+		 * we visit, otherwise we have to stop going down. The following
+		 * test is able to stop before both normal and cover nodes.
+		 */
+		if (bit >= (new->node.pfx << 1) && (new->node.pfx << 1) < old_node_bit) {
+			/* insert cover node here on the left */
+			new->node.node_p = old->node.node_p;
+			up_ptr = &old->node.node_p;
+			new->node.bit = new->node.pfx << 1;
+			diff = -1;
+			goto insert_above;
+		}
+
+		if (unlikely(bit < old_node_bit)) {
+			/* The tree did not contain the key, so we insert <new> before the
+			 * node <old>, and set ->bit to designate the lowest bit position in
+			 * <new> which applies to ->branches.b[]. We know that the bit is not
+			 * greater than the prefix length thanks to the test above.
+			 */
+			new->node.node_p = old->node.node_p;
+			up_ptr = &old->node.node_p;
+			new->node.bit = bit;
+			diff = __eb128_cmp_bits(new->key, old->key, bit >> 1);
+			goto insert_above;
+		}
+
+		if (!(old_node_bit & 1)) {
+			/* if we encounter a cover node with our exact prefix length, it's
+			 * necessarily the same value, so we insert there as a duplicate on
+			 * the left. For that, we go down on the left and the leaf detection
+			 * code will finish the job.
+			 */
+			if ((new->node.pfx << 1) == old_node_bit) {
+				root = &old->node.branches;
+				side = EB_LEFT;
+				troot = root->b[side];
+				continue;
+			}
+
+			/* cover nodes are always walked through on the right */
+			side = EB_RGHT;
+			root = &old->node.branches;
+			troot = root->b[side];
+			continue;
+		}
+
+		/* walk down */
+		old_node_bit >>= 1;
+		root = &old->node.branches;
+		side = (new->key >> (127 - old_node_bit)) & 1;
+		troot = root->b[side];
+	}
+
+	/* Right here, we have the same 4 possibilities as in
+	 * __ebmb_insert_prefix(), which are handled the same way.
+	 */
+
+	/* first we want to ensure that we compare the correct bit, which means
+	 * the largest common to both nodes.
+	 */
+	if (bit > new->node.pfx)
+		bit = new->node.pfx;
+	if (bit > old->node.pfx)
+		bit = old->node.pfx;
+
+	new->node.bit = (bit << 1) + 1; /* assume normal node by default */
+
+	/* if one prefix is included in the second one, we don't compare bits
+	 * because they won't necessarily match, we just proceed with a cover
+	 * node insertion.
+	 */
+	diff = 0;
+	if (bit < old->node.pfx && bit < new->node.pfx)
+		diff = __eb128_cmp_bits(new->key, old->key, bit);
+
+	if (diff == 0) {
+		/* Both keys match. Either it's a duplicate entry or we have to
+		 * put the shortest prefix left and the largest one right below
+		 * a new cover node. By default, diff==0 means we'll be inserted
+		 * on the right.
+		 */
+		new->node.bit--; /* anticipate cover node insertion */
+		if (new->node.pfx == old->node.pfx) {
+			new->node.bit = -1; /* mark as new dup tree, just in case */
+
+			if (unlikely(eb_gettag(root_right))) {
+				/* we refuse to duplicate this key if the tree is
+				 * tagged as containing only unique keys.
+				 */
+				return old;
+			}
+
+			if (eb_gettag(troot) != EB_LEAF) {
+				/* there was already a dup tree below */
+				struct eb_node *ret;
+				ret = eb_insert_dup(&old->node, &new->node);
+				return container_of(ret, struct eb128_node, node);
+			}
+			/* otherwise fall through to insert first duplicate */
+		}
+		/* otherwise we just rely on the tests below to select the right side */
+		else if (new->node.pfx < old->node.pfx)
+			diff = -1; /* force insertion to left side */
+	}
+
+ insert_above:
+	new_left = eb_dotag(&new->node.branches, EB_LEFT);
+	new_rght = eb_dotag(&new->node.branches, EB_RGHT);
+	new_leaf = eb_dotag(&new->node.branches, EB_LEAF);
+
+	if (diff >= 0) {
+		new->node.branches.b[EB_LEFT] = troot;
+		new->node.branches.b[EB_RGHT] = new_leaf;
+		new->node.leaf_p = new_rght;
+		eb_publish(up_ptr, new_left);
+	}
+	else {
+		new->node.branches.b[EB_LEFT] = new_leaf;
+		new->node.branches.b[EB_RGHT] = troot;
+		new->node.leaf_p = new_left;
+		eb_publish(up_ptr, new_rght);
+	}
+
+	eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+	__eb_count_update(new->node.leaf_p);
+	return new;
+}
+
+#endif /* __SIZEOF_INT128__ */
+
+#endif /* _EB128TREE_H */
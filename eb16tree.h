@@ -0,0 +1,443 @@
+/*
+ * Elastic Binary Trees - macros and structures for operations on 16bit nodes.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* These trees are the 16-bit counterpart of the eb32 trees, for small key
+ * spaces such as ports, VLAN IDs or shard numbers. The API is the same as in
+ * eb32tree.h. Note that with absolute pointers the node part dominates, so an
+ * eb16_node is as large as an eb32_node on 64-bit platforms. Where memory is
+ * the concern, the relative layouts of ebr16tree.h store the same keys into
+ * 12-byte (ebsd16) or 24-byte (ebmd16) nodes.
+ */
+
+#ifndef _EB16TREE_H
+#define _EB16TREE_H
+
+#include "ebtree.h"
+
+
+/* Return the structure of type <type> whose member <member> points to <ptr> */
+#define eb16_entry(ptr, type, member) container_of(ptr, type, member)
+
+#define EB16_ROOT	EB_ROOT
+#define EB16_TREE_HEAD	EB_TREE_HEAD
+
+/* These types may sometimes already be defined */
+typedef unsigned short u16;
+typedef   signed short s16;
+
+/* This structure carries a node, a leaf, and a key. It must start with the
+ * eb_node so that it can be cast into an eb_node.
+ */
+struct eb16_node {
+	struct eb_node node; /* the tree node, must be at the beginning */
+	MAYBE_ALIGN(sizeof(u16));
+	u16 key;
+} ALIGNED(sizeof(void*));
+
+/*
+ * Exported functions and macros.
+ * Many of them are always inlined because they are extremely small, and
+ * are generally called at most once or twice in a program.
+ */
+
+/* Return leftmost node in the tree, or NULL if none */
+static inline struct eb16_node *eb16_first(struct eb_root *root)
+{
+	return eb16_entry(eb_first(root), struct eb16_node, node);
+}
+
+/* Return rightmost node in the tree, or NULL if none */
+static inline struct eb16_node *eb16_last(struct eb_root *root)
+{
+	return eb16_entry(eb_last(root), struct eb16_node, node);
+}
+
+/* Return next node in the tree, or NULL if none */
+static inline struct eb16_node *eb16_next(struct eb16_node *eb16)
+{
+	return eb16_entry(eb_next(&eb16->node), struct eb16_node, node);
+}
+
+/* Return previous node in the tree, or NULL if none */
+static inline struct eb16_node *eb16_prev(struct eb16_node *eb16)
+{
+	return eb16_entry(eb_prev(&eb16->node), struct eb16_node, node);
+}
+
+/* Return next leaf node within a duplicate sub-tree, or NULL if none. */
+static inline struct eb16_node *eb16_next_dup(struct eb16_node *eb16)
+{
+	return eb16_entry(eb_next_dup(&eb16->node), struct eb16_node, node);
+}
+
+/* Return previous leaf node within a duplicate sub-tree, or NULL if none. */
+static inline struct eb16_node *eb16_prev_dup(struct eb16_node *eb16)
+{
+	return eb16_entry(eb_prev_dup(&eb16->node), struct eb16_node, node);
+}
+
+/* Return next node in the tree, skipping duplicates, or NULL if none */
+static inline struct eb16_node *eb16_next_unique(struct eb16_node *eb16)
+{
+	return eb16_entry(eb_next_unique(&eb16->node), struct eb16_node, node);
+}
+
+/* Return previous node in the tree, skipping duplicates, or NULL if none */
+static inline struct eb16_node *eb16_prev_unique(struct eb16_node *eb16)
+{
+	return eb16_entry(eb_prev_unique(&eb16->node), struct eb16_node, node);
+}
+
+/* Delete node from the tree if it was linked in. Mark the node unused. Note
+ * that this function relies on a non-inlined generic function: eb_delete.
+ */
+static inline void eb16_delete(struct eb16_node *eb16)
+{
+	eb_delete(&eb16->node);
+}
+
+/* Detach and return the leftmost node of the tree, or NULL if none */
+static inline struct eb16_node *eb16_pick_first(struct eb_root *root)
+{
+	return eb16_entry(eb_pick_first(root), struct eb16_node, node);
+}
+
+/* Detach and return the rightmost node of the tree, or NULL if none */
+static inline struct eb16_node *eb16_pick_last(struct eb_root *root)
+{
+	return eb16_entry(eb_pick_last(root), struct eb16_node, node);
+}
+
+#ifdef EB_COUNT
+/* Return the node at position <rank> (starting at zero), or NULL if none */
+static inline struct eb16_node *eb16_select(struct eb_root *root, unsigned int rank)
+{
+	return eb16_entry(eb_select(root, rank), struct eb16_node, node);
+}
+#endif
+
+/*
+ * The following functions are not inlined by default. They are declared
+ * in eb16tree.c, which simply relies on their inline version.
+ */
+struct eb16_node *eb16_lookup(struct eb_root *root, u16 x);
+struct eb16_node *eb16i_lookup(struct eb_root *root, s16 x);
+struct eb16_node *eb16_lookup_le(struct eb_root *root, u16 x);
+struct eb16_node *eb16_lookup_ge(struct eb_root *root, u16 x);
+struct eb16_node *eb16_pick(struct eb_root *root, u16 x);
+struct eb16_node *eb16_pick_le(struct eb_root *root, u16 x);
+struct eb16_node *eb16_pick_ge(struct eb_root *root, u16 x);
+struct eb16_node *eb16_insert(struct eb_root *root, struct eb16_node *new);
+struct eb16_node *eb16i_insert(struct eb_root *root, struct eb16_node *new);
+
+/* Return the first node whose key is within [<min>, <max>], or NULL if none.
+ * Together with eb16_range_next(), this makes a cursor over a key interval.
+ */
+static inline struct eb16_node *eb16_range_first(struct eb_root *root, u16 min, u16 max)
+{
+	struct eb16_node *node = eb16_lookup_ge(root, min);
+
+	if (node && node->key > max)
+		return NULL;
+	return node;
+}
+
+/* Return the node following <node> if its key is not above <max>, or NULL */
+static inline struct eb16_node *eb16_range_next(struct eb16_node *node, u16 max)
+{
+	node = eb16_next(node);
+	if (node && node->key > max)
+		return NULL;
+	return node;
+}
+
+/*
+ * The following functions are less likely to be used directly, because their
+ * code is larger. The non-inlined version is preferred.
+ */
+
+/* Delete node from the tree if it was linked in. Mark the node unused. */
+static forceinline void __eb16_delete(struct eb16_node *eb16)
+{
+	__eb_delete(&eb16->node);
+}
+
+/*
+ * Find the first occurence of a key in the tree <root>. If none can be
+ * found, return NULL.
+ */
+static forceinline struct eb16_node *__eb16_lookup(struct eb_root *root, u16 x)
+{
+	struct eb16_node *node;
+	eb_troot_t *troot;
+	u16 y;
+	int node_bit;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	while (1) {
+		if ((eb_gettag(troot) == EB_LEAF)) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct eb16_node, node.branches);
+			if (node->key == x)
+				return node;
+			else
+				return NULL;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct eb16_node, node.branches);
+		node_bit = node->node.bit;
+
+		y = node->key ^ x;
+		if (!y) {
+			/* Either we found the node which holds the key, or
+			 * we have a dup tree. In the later case, we have to
+			 * walk it down left to get the first entry.
+			 */
+			if (node_bit < 0) {
+				troot = node->node.branches.b[EB_LEFT];
+				while (eb_gettag(troot) != EB_LEAF)
+					troot = (eb_untag(troot, EB_NODE))->b[EB_LEFT];
+				node = container_of(eb_untag(troot, EB_LEAF),
+						    struct eb16_node, node.branches);
+			}
+			return node;
+		}
+
+		if ((y >> node_bit) >= EB_NODE_BRANCHES)
+			return NULL; /* no more common bits */
+
+		troot = node->node.branches.b[(x >> node_bit) & EB_NODE_BRANCH_MASK];
+	}
+}
+
+/*
+ * Find the first occurence of a signed key in the tree <root>. If none can
+ * be found, return NULL.
+ */
+static forceinline struct eb16_node *__eb16i_lookup(struct eb_root *root, s16 x)
+{
+	struct eb16_node *node;
+	eb_troot_t *troot;
+	u16 key = (u16)x ^ 0x8000;
+	u16 y;
+	int node_bit;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	while (1) {
+		if ((eb_gettag(troot) == EB_LEAF)) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct eb16_node, node.branches);
+			if (node->key == (u16)x)
+				return node;
+			else
+				return NULL;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct eb16_node, node.branches);
+		node_bit = node->node.bit;
+
+		y = node->key ^ (u16)x;
+		if (!y) {
+			/* Either we found the node which holds the key, or
+			 * we have a dup tree. In the later case, we have to
+			 * walk it down left to get the first entry.
+			 */
+			if (node_bit < 0) {
+				troot = node->node.branches.b[EB_LEFT];
+				while (eb_gettag(troot) != EB_LEAF)
+					troot = (eb_untag(troot, EB_NODE))->b[EB_LEFT];
+				node = container_of(eb_untag(troot, EB_LEAF),
+						    struct eb16_node, node.branches);
+			}
+			return node;
+		}
+
+		if ((y >> node_bit) >= EB_NODE_BRANCHES)
+			return NULL; /* no more common bits */
+
+		troot = node->node.branches.b[(key >> node_bit) & EB_NODE_BRANCH_MASK];
+	}
+}
+
+/*
+ * Find the first occurence of a key in the tree <root> and remove it from the
+ * tree. The node is returned, or NULL if none could be found.
+ */
+static forceinline struct eb16_node *__eb16_pick(struct eb_root *root, u16 x)
+{
+	struct eb16_node *node = __eb16_lookup(root, x);
+
+	if (node)
+		__eb_delete(&node->node);
+	return node;
+}
+
+/* Insert eb16_node <new> into subtree starting at node root <root>. Only
+ * new->key needs be set with the key. The eb16_node is returned. If
+ * root->b[EB_RGHT]==1, the tree may only contain unique keys. The descent
+ * works on <new->key> xor'ed with <flip>, which is zero for unsigned keys and
+ * 0x8000 for signed ones, in order to have negative keys stored before
+ * positive ones. The final comparison relies on the same transformation so
+ * that both variants share a single branch-free ordering test.
+ */
+static forceinline struct eb16_node *
+__eb16_insert_flip(struct eb_root *root, struct eb16_node *new, const unsigned int flip) {
+	struct eb16_node *old;
+	unsigned int side;
+	eb_troot_t *troot, **up_ptr;
+	unsigned int newkey; /* caching the key saves approximately one cycle */
+	eb_troot_t *root_right;
+	eb_troot_t *new_left, *new_rght;
+	eb_troot_t *new_leaf;
+	int old_node_bit;
+
+	side = EB_LEFT;
+	troot = root->b[EB_LEFT];
+	root_right = root->b[EB_RGHT];
+	if (unlikely(troot == NULL)) {
+		/* Tree is empty, insert the leaf part below the left branch */
+		new->node.leaf_p = eb_dotag(root, EB_LEFT);
+		new->node.node_p = NULL; /* node part unused */
+		eb_publish(&root->b[EB_LEFT], eb_dotag(&new->node.branches, EB_LEAF));
+		return new;
+	}
+
+	/* The tree descent is the same as in __eb32_insert(), except that
+	 * <newkey> carries the key with its high bit flipped for signed keys.
+	 */
+	newkey = new->key ^ flip;
+
+	while (1) {
+		if (eb_gettag(troot) == EB_LEAF) {
+			/* insert above a leaf */
+			old = container_of(eb_untag(troot, EB_LEAF),
+					    struct eb16_node, node.branches);
+			new->node.node_p = old->node.leaf_p;
+			up_ptr = &old->node.leaf_p;
+			break;
+		}
+
+		/* OK we're walking down this link */
+		old = container_of(eb_untag(troot, EB_NODE),
+				    struct eb16_node, node.branches);
+		old_node_bit = old->node.bit;
+
+		/* Stop going down when we don't have common bits anymore. We
+		 * also stop in front of a duplicates tree because it means we
+		 * have to insert above.
+		 */
+
+		if ((old_node_bit < 0) || /* we're above a duplicate tree, stop here */
+		    (((new->key ^ old->key) >> old_node_bit) >= EB_NODE_BRANCHES)) {
+			/* The tree did not contain the key, so we insert <new> before the node
+			 * <old>, and set ->bit to designate the lowest bit position in <new>
+			 * which applies to ->branches.b[].
+			 */
+			new->node.node_p = old->node.node_p;
+			up_ptr = &old->node.node_p;
+			break;
+		}
+
+		/* walk down */
+		root = &old->node.branches;
+		side = (newkey >> old_node_bit) & EB_NODE_BRANCH_MASK;
+		troot = root->b[side];
+	}
+
+	new_left = eb_dotag(&new->node.branches, EB_LEFT);
+	new_rght = eb_dotag(&new->node.branches, EB_RGHT);
+	new_leaf = eb_dotag(&new->node.branches, EB_LEAF);
+
+	/* note that if EB_NODE_BITS > 1, we should check that it's still >= 0 */
+	new->node.bit = flsnz(new->key ^ old->key) - EB_NODE_BITS;
+
+	if (new->key == old->key) {
+		new->node.bit = -1; /* mark as new dup tree, just in case */
+
+		if (likely(eb_gettag(root_right))) {
+			/* we refuse to duplicate this key if the tree is
+			 * tagged as containing only unique keys.
+			 */
+			return old;
+		}
+
+		if (eb_gettag(troot) != EB_LEAF) {
+			/* there was already a dup tree below */
+			struct eb_node *ret;
+			ret = eb_insert_dup(&old->node, &new->node);
+			return container_of(ret, struct eb16_node, node);
+		}
+		/* otherwise fall through */
+	}
+
+	if (newkey >= (old->key ^ flip)) {
+		new->node.branches.b[EB_LEFT] = troot;
+		new->node.branches.b[EB_RGHT] = new_leaf;
+		new->node.leaf_p = new_rght;
+		eb_publish(up_ptr, new_left);
+	}
+	else {
+		new->node.branches.b[EB_LEFT] = new_leaf;
+		new->node.branches.b[EB_RGHT] = troot;
+		new->node.leaf_p = new_left;
+		eb_publish(up_ptr, new_rght);
+	}
+
+	/* Ok, now we are inserting <new> between <root> and <old>. <old>'s
+	 * parent is already set to <new>, and the <root>'s branch is still in
+	 * <side>.
+	 */
+
+	eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+	__eb_count_update(new->node.leaf_p);
+	return new;
+}
+
+/* Insert eb16_node <new> into subtree starting at node root <root>.
+ * Only new->key needs be set with the key. The eb16_node is returned.
+ * If root->b[EB_RGHT]==1, the tree may only contain unique keys.
+ */
+static forceinline struct eb16_node *
+__eb16_insert(struct eb_root *root, struct eb16_node *new) {
+	return __eb16_insert_flip(root, new, 0);
+}
+
+/* Insert eb16_node <new> into subtree starting at node root <root>, using
+ * signed keys. Only new->key needs be set with the key. The eb16_node
+ * is returned. If root->b[EB_RGHT]==1, the tree may only contain unique keys.
+ */
+static forceinline struct eb16_node *
+__eb16i_insert(struct eb_root *root, struct eb16_node *new) {
+	return __eb16_insert_flip(root, new, 0x8000);
+}
+
+#endif /* _EB16_TREE_H */
@@ -28,11 +28,54 @@
 
 #include "eb32tree.h"
 
+EB_MULTIVERSION
 struct eb32_node *eb32_insert(struct eb_root *root, struct eb32_node *new)
 {
 	return __eb32_insert(root, new);
 }
 
+EB_MULTIVERSION
+struct eb32_node *eb32_insert_from(struct eb_root *root, struct eb32_node *hint, struct eb32_node *new)
+{
+	return __eb32_insert_from(root, hint, new);
+}
+
+EB_MULTIVERSION
+struct eb32_node *eb32_requeue(struct eb_root *root, struct eb32_node *node, u32 x)
+{
+	return __eb32_requeue(root, node, x);
+}
+
+/* Build the tree <root>, which must be empty, from the <nb> nodes pointed to
+ * by <nodes>, whose keys must be sorted in ascending order. The result is the
+ * same tree as if the nodes had been inserted in this order, except for the
+ * node parts in use, but it is built in linear time without any descent. If
+ * root->b[EB_RGHT]==1, duplicates are left unlinked as an insertion would do.
+ * The number of nodes linked into the tree is returned.
+ */
+unsigned int eb32_build_sorted(struct eb_root *root, struct eb32_node **nodes, unsigned int nb)
+{
+	struct eb_root sub;
+	eb_troot_t *last = NULL;
+	unsigned int i, j, done = 0;
+
+	for (i = 0; i < nb; i = j) {
+		__eb_build_leaf(&sub, &nodes[i]->node);
+		for (j = i + 1; j < nb && nodes[i]->key == nodes[j]->key; j++) {
+			if (eb_gettag(root->b[EB_RGHT]))
+				continue;
+			__eb_build_dup(&sub, &nodes[j]->node);
+			done++;
+		}
+		last = __eb_build_append(root, last, &sub, &nodes[i]->node,
+					 i ? flsnz(nodes[i]->key ^ nodes[i - 1]->key) - EB_NODE_BITS : 0, 0);
+		done++;
+	}
+	__eb_build_finish(last);
+	return done;
+}
+
+EB_MULTIVERSION
 struct eb32_node *eb32i_insert(struct eb_root *root, struct eb32_node *new)
 {
 	return __eb32i_insert(root, new);
@@ -43,6 +86,16 @@ struct eb32_node *eb32_lookup(struct eb_root *root, u32 x)
 	return __eb32_lookup(root, x);
 }
 
+struct eb32_node *eb32_lookup_from(struct eb_root *root, struct eb32_node *hint, u32 x)
+{
+	return __eb32_lookup_from(root, hint, x);
+}
+
+struct eb32_node *eb32_pick(struct eb_root *root, u32 x)
+{
+	return __eb32_pick(root, x);
+}
+
 struct eb32_node *eb32i_lookup(struct eb_root *root, s32 x)
 {
 	return __eb32i_lookup(root, x);
@@ -222,3 +275,182 @@ struct eb32_node *eb32_lookup_ge(struct eb_root *root, u32 x)
 	node = eb32_entry(eb_walk_down(troot, EB_LEFT), struct eb32_node, node);
 	return node;
 }
+
+/*
+ * Find the last occurrence of the highest key in the tree <root>, which is
+ * equal to or less than <x>, and remove it from the tree. NULL is returned if
+ * no key matches.
+ */
+struct eb32_node *eb32_pick_le(struct eb_root *root, u32 x)
+{
+	struct eb32_node *node = eb32_lookup_le(root, x);
+
+	if (node)
+		__eb_delete(&node->node);
+	return node;
+}
+
+/*
+ * Find the first occurrence of the lowest key in the tree <root>, which is
+ * equal to or greater than <x>, and remove it from the tree. NULL is returned
+ * if no key matches.
+ */
+struct eb32_node *eb32_pick_ge(struct eb_root *root, u32 x)
+{
+	struct eb32_node *node = eb32_lookup_ge(root, x);
+
+	if (node)
+		__eb_delete(&node->node);
+	return node;
+}
+
+/*
+ * Detach all nodes whose keys are within [<min>, <max>] from the tree <root>
+ * and move them to the empty tree <out>, from which the caller may then walk
+ * or pick them. Whole subtrees holding only such keys are spliced at once, so
+ * that the cost depends on the number of subtrees moved and not on the number
+ * of nodes. The tree <out> is rebuilt in key order from these subtrees.
+ */
+void eb32_delete_range(struct eb_root *root, u32 min, u32 max, struct eb_root *out)
+{
+	struct eb32_node *first, *last, *next, *owner;
+	struct eb_node *spare;
+	struct eb_root *branches, sub;
+	eb_troot_t *troot, *up, *prev = NULL;
+	u32 prev_key = 0, mask;
+
+	first = eb32_range_first(root, min, max);
+	while (first) {
+		/* climb as long as the parent's subtree may only hold keys in
+		 * range, according to the bits it shares. Duplicates have the
+		 * same key as <first> and are always in range.
+		 */
+		troot = eb_dotag(&first->node.branches, EB_LEAF);
+		up = first->node.leaf_p;
+		while (1) {
+			branches = eb_clrtag(up);
+			if (eb_clrtag(branches->b[EB_RGHT]) == NULL)
+				break; /* reached the root */
+			owner = container_of(branches, struct eb32_node, node.branches);
+			if (owner->node.bit >= 0) {
+				mask = (2U << owner->node.bit) - 1;
+				if ((owner->key & ~mask) < min || (owner->key | mask) > max)
+					break;
+			}
+			troot = eb_dotag(branches, EB_NODE);
+			up = owner->node.node_p;
+		}
+
+		last = container_of(eb_walk_down(troot, EB_RGHT), struct eb32_node, node);
+		next = eb32_range_next(last, max);
+
+		spare = __eb_subtree_spare(troot);
+		__eb_unlink(up, spare);
+		if (!prev)
+			spare->node_p = NULL;
+
+		sub.b[EB_LEFT] = troot;
+		prev = __eb_build_append(out, prev, &sub, spare,
+					 prev ? flsnz(prev_key ^ first->key) - EB_NODE_BITS : 0, 0);
+		prev_key = last->key;
+		first = next;
+	}
+	__eb_build_finish(prev);
+}
+
+#ifdef EB_COUNT
+/* Return the number of keys lower than <x> in the tree <root>, which is also
+ * the position of the first key greater than or equal to <x>.
+ */
+unsigned int eb32_rank(struct eb_root *root, u32 x)
+{
+	return __eb32_rank(root, x, 0);
+}
+
+/* Return the number of keys between <min> and <max> inclusive in the tree
+ * <root>.
+ */
+unsigned int eb32_count_range(struct eb_root *root, u32 min, u32 max)
+{
+	if (min > max)
+		return 0;
+	return __eb32_rank(root, max, 1) - __eb32_rank(root, min, 0);
+}
+#endif
+
+/*
+ * Look up the <nb> keys from array <keys> in the tree <root>, and store into
+ * <res[i]> the same node that eb32_lookup(root, keys[i]) would return. Up to
+ * EB_BATCH_LANES descents are advanced in lockstep, and the next branch of
+ * each of them is prefetched before the other ones are visited, so that the
+ * cache misses of all these descents overlap instead of being serialized.
+ */
+void eb32_lookup_batch(struct eb_root *root, const u32 *keys, struct eb32_node **res, unsigned int nb)
+{
+	eb_troot_t *troot[EB_BATCH_LANES];
+	struct eb32_node *node;
+	unsigned int lanes, left, i;
+	u32 x, y;
+	int node_bit;
+
+	for (; nb; keys += lanes, res += lanes, nb -= lanes) {
+		lanes = nb < EB_BATCH_LANES ? nb : EB_BATCH_LANES;
+
+		for (i = 0; i < lanes; i++) {
+			troot[i] = root->b[EB_LEFT];
+			res[i] = NULL;
+		}
+
+		if (unlikely(root->b[EB_LEFT] == NULL))
+			continue;
+
+		/* <left> counts the descents still in progress. A finished
+		 * descent is marked with a NULL <troot>.
+		 */
+		left = lanes;
+		while (left) {
+			for (i = 0; i < lanes; i++) {
+				if (!troot[i])
+					continue;
+
+				x = keys[i];
+				if (eb_gettag(troot[i]) == EB_LEAF) {
+					node = container_of(eb_untag(troot[i], EB_LEAF),
+							    struct eb32_node, node.branches);
+					if (node->key == x)
+						res[i] = node;
+					goto done;
+				}
+				node = container_of(eb_untag(troot[i], EB_NODE),
+						    struct eb32_node, node.branches);
+				node_bit = node->node.bit;
+
+				y = node->key ^ x;
+				if (!y) {
+					/* same as __eb32_lookup(): return the first
+					 * entry of a possible dup tree.
+					 */
+					if (node_bit < 0) {
+						eb_troot_t *t = node->node.branches.b[EB_LEFT];
+						while (eb_gettag(t) != EB_LEAF)
+							t = (eb_untag(t, EB_NODE))->b[EB_LEFT];
+						node = container_of(eb_untag(t, EB_LEAF),
+								    struct eb32_node, node.branches);
+					}
+					res[i] = node;
+					goto done;
+				}
+
+				if ((y >> node_bit) >= EB_NODE_BRANCHES)
+					goto done; /* no more common bits */
+
+				troot[i] = node->node.branches.b[(x >> node_bit) & EB_NODE_BRANCH_MASK];
+				eb_prefetch(eb_clrtag(troot[i]));
+				continue;
+			done:
+				troot[i] = NULL;
+				left--;
+			}
+		}
+	}
+}
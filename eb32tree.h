@@ -113,16 +113,70 @@ static inline void eb32_delete(struct eb32_node *eb32)
 	eb_delete(&eb32->node);
 }
 
+/* Remove the leftmost node from the tree and return it, or NULL if none */
+static inline struct eb32_node *eb32_pick_first(struct eb_root *root)
+{
+	return eb32_entry(eb_pick_first(root), struct eb32_node, node);
+}
+
+/* Remove the rightmost node from the tree and return it, or NULL if none */
+static inline struct eb32_node *eb32_pick_last(struct eb_root *root)
+{
+	return eb32_entry(eb_pick_last(root), struct eb32_node, node);
+}
+
+#ifdef EB_COUNT
+/* Return the node at position <rank> (starting at zero), or NULL if none */
+static inline struct eb32_node *eb32_select(struct eb_root *root, unsigned int rank)
+{
+	return eb32_entry(eb_select(root, rank), struct eb32_node, node);
+}
+#endif
+
 /*
  * The following functions are not inlined by default. They are declared
  * in eb32tree.c, which simply relies on their inline version.
  */
 struct eb32_node *eb32_lookup(struct eb_root *root, u32 x);
+struct eb32_node *eb32_lookup_from(struct eb_root *root, struct eb32_node *hint, u32 x);
 struct eb32_node *eb32i_lookup(struct eb_root *root, s32 x);
 struct eb32_node *eb32_lookup_le(struct eb_root *root, u32 x);
 struct eb32_node *eb32_lookup_ge(struct eb_root *root, u32 x);
+struct eb32_node *eb32_pick(struct eb_root *root, u32 x);
+struct eb32_node *eb32_pick_le(struct eb_root *root, u32 x);
+struct eb32_node *eb32_pick_ge(struct eb_root *root, u32 x);
+void eb32_delete_range(struct eb_root *root, u32 min, u32 max, struct eb_root *out);
 struct eb32_node *eb32_insert(struct eb_root *root, struct eb32_node *new);
+struct eb32_node *eb32_insert_from(struct eb_root *root, struct eb32_node *hint, struct eb32_node *new);
+struct eb32_node *eb32_requeue(struct eb_root *root, struct eb32_node *node, u32 x);
+unsigned int eb32_build_sorted(struct eb_root *root, struct eb32_node **nodes, unsigned int nb);
 struct eb32_node *eb32i_insert(struct eb_root *root, struct eb32_node *new);
+void eb32_lookup_batch(struct eb_root *root, const u32 *keys, struct eb32_node **res, unsigned int nb);
+#ifdef EB_COUNT
+unsigned int eb32_rank(struct eb_root *root, u32 x);
+unsigned int eb32_count_range(struct eb_root *root, u32 min, u32 max);
+#endif
+
+/* Return the first node whose key is within [<min>, <max>], or NULL if none.
+ * Together with eb32_range_next(), this makes a cursor over a key interval.
+ */
+static inline struct eb32_node *eb32_range_first(struct eb_root *root, u32 min, u32 max)
+{
+	struct eb32_node *node = eb32_lookup_ge(root, min);
+
+	if (node && node->key > max)
+		return NULL;
+	return node;
+}
+
+/* Return the node following <node> if its key is not above <max>, or NULL */
+static inline struct eb32_node *eb32_range_next(struct eb32_node *node, u32 max)
+{
+	node = eb32_next(node);
+	if (node && node->key > max)
+		return NULL;
+	return node;
+}
 
 /*
  * The following functions are less likely to be used directly, because their
@@ -135,18 +189,41 @@ static forceinline void __eb32_delete(struct eb32_node *eb32)
 	__eb_delete(&eb32->node);
 }
 
+/* Climb from the tagged parent pointer <up> of a node of the tree <root> to the
+ * lowest node part whose subtree a descent for key <x> would enter, and return
+ * its branches with the branch to follow in <side>. <root> is returned with
+ * EB_LEFT if no node part covers <x>. Duplicate trees are climbed over since
+ * the descent stops above them.
+ */
+static forceinline struct eb_root *
+__eb32_climb(struct eb_root *root, eb_troot_t *up, u32 x, unsigned int *side)
+{
+	while (eb_clrtag(up) != root) {
+		struct eb32_node *sub = container_of(eb_clrtag(up), struct eb32_node, node.branches);
+
+		if (sub->node.bit >= 0 && ((sub->key ^ x) >> sub->node.bit) < EB_NODE_BRANCHES) {
+			*side = (x >> sub->node.bit) & EB_NODE_BRANCH_MASK;
+			return &sub->node.branches;
+		}
+		up = sub->node.node_p;
+	}
+	*side = EB_LEFT;
+	return root;
+}
+
 /*
- * Find the first occurence of a key in the tree <root>. If none can be
- * found, return NULL.
+ * Find the first occurence of a key below branch <side> of <sub>, which is
+ * either the tree's root or the branches of a node part whose subtree the
+ * descent for <x> would enter. If none can be found, return NULL.
  */
-static forceinline struct eb32_node *__eb32_lookup(struct eb_root *root, u32 x)
+static forceinline struct eb32_node *__eb32_lookup_below(struct eb_root *sub, unsigned int side, u32 x)
 {
 	struct eb32_node *node;
 	eb_troot_t *troot;
 	u32 y;
 	int node_bit;
 
-	troot = root->b[EB_LEFT];
+	troot = sub->b[side];
 	if (unlikely(troot == NULL))
 		return NULL;
 
@@ -186,6 +263,34 @@ static forceinline struct eb32_node *__eb32_lookup(struct eb_root *root, u32 x)
 	}
 }
 
+/*
+ * Find the first occurence of a key in the tree <root>. If none can be
+ * found, return NULL.
+ */
+static forceinline struct eb32_node *__eb32_lookup(struct eb_root *root, u32 x)
+{
+	return __eb32_lookup_below(root, EB_LEFT, x);
+}
+
+/*
+ * Find the first occurence of a key in the tree <root>, starting from the
+ * node <hint> of this tree, or from the root if <hint> is NULL or not queued.
+ * The descent only starts from the lowest node part above <hint> which covers
+ * <x>, so the cost depends on the distance between the keys rather than on
+ * the tree's height. If none can be found, return NULL.
+ */
+static forceinline struct eb32_node *__eb32_lookup_from(struct eb_root *root, struct eb32_node *hint, u32 x)
+{
+	struct eb_root *sub;
+	unsigned int side;
+
+	if (!hint || !hint->node.leaf_p)
+		return __eb32_lookup(root, x);
+
+	sub = __eb32_climb(root, hint->node.leaf_p, x, &side);
+	return __eb32_lookup_below(sub, side, x);
+}
+
 /*
  * Find the first occurence of a signed key in the tree <root>. If none can
  * be found, return NULL.
@@ -238,14 +343,81 @@ static forceinline struct eb32_node *__eb32i_lookup(struct eb_root *root, s32 x)
 	}
 }
 
-/* Insert eb32_node <new> into subtree starting at node root <root>.
- * Only new->key needs be set with the key. The eb32_node is returned.
- * If root->b[EB_RGHT]==1, the tree may only contain unique keys.
+/*
+ * Find the first occurence of a key in the tree <root> and remove it from the
+ * tree. The node is returned, or NULL if none could be found.
+ */
+static forceinline struct eb32_node *__eb32_pick(struct eb_root *root, u32 x)
+{
+	struct eb32_node *node = __eb32_lookup(root, x);
+
+	if (node)
+		__eb_delete(&node->node);
+	return node;
+}
+
+#ifdef EB_COUNT
+/*
+ * Return the number of keys in the tree <root> which are lower than <x>, or
+ * lower than or equal to <x> if <le> is non-zero. The descent stops as soon
+ * as <x> leaves the current subtree, whose keys then all sit on one side.
+ */
+static forceinline unsigned int __eb32_rank(struct eb_root *root, u32 x, int le)
+{
+	struct eb32_node *node;
+	eb_troot_t *troot;
+	unsigned int rank = 0;
+	int node_bit, side;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return 0;
+
+	while (1) {
+		if ((eb_gettag(troot) == EB_LEAF)) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct eb32_node, node.branches);
+			if (node->key < x || (le && node->key == x))
+				rank++;
+			return rank;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct eb32_node, node.branches);
+		node_bit = node->node.bit;
+
+		if (node_bit < 0) {
+			/* a dup tree only holds equal keys */
+			if (node->key < x || (le && node->key == x))
+				rank += node->node.count;
+			return rank;
+		}
+
+		if (((x ^ node->key) >> node_bit) >= EB_NODE_BRANCHES) {
+			/* no more common bits, the whole subtree is either
+			 * below or above <x>.
+			 */
+			if ((node->key >> node_bit) < (x >> node_bit))
+				rank += node->node.count;
+			return rank;
+		}
+
+		side = (x >> node_bit) & EB_NODE_BRANCH_MASK;
+		if (side)
+			rank += eb_troot_count(node->node.branches.b[EB_LEFT]);
+		troot = node->node.branches.b[side];
+	}
+}
+#endif
+
+/* Insert eb32_node <new> below branch <side> of <sub>, which is either the
+ * tree's root <root> or the branches of a node part whose subtree the descent
+ * from <root> would enter, and must not be empty. Only new->key needs be set
+ * with the key. The eb32_node is returned. If root->b[EB_RGHT]==1, the tree
+ * may only contain unique keys.
  */
 static forceinline struct eb32_node *
-__eb32_insert(struct eb_root *root, struct eb32_node *new) {
+__eb32_insert_below(struct eb_root *root, struct eb_root *sub, unsigned int side, struct eb32_node *new) {
 	struct eb32_node *old;
-	unsigned int side;
 	eb_troot_t *troot, **up_ptr;
 	u32 newkey; /* caching the key saves approximately one cycle */
 	eb_troot_t *root_right;
@@ -253,16 +425,9 @@ __eb32_insert(struct eb_root *root, struct eb32_node *new) {
 	eb_troot_t *new_leaf;
 	int old_node_bit;
 
-	side = EB_LEFT;
-	troot = root->b[EB_LEFT];
 	root_right = root->b[EB_RGHT];
-	if (unlikely(troot == NULL)) {
-		/* Tree is empty, insert the leaf part below the left branch */
-		root->b[EB_LEFT] = eb_dotag(&new->node.branches, EB_LEAF);
-		new->node.leaf_p = eb_dotag(root, EB_LEFT);
-		new->node.node_p = NULL; /* node part unused */
-		return new;
-	}
+	root = sub;
+	troot = root->b[side];
 
 	/* The tree descent is fairly easy :
 	 *  - first, check if we have reached a leaf node
@@ -351,13 +516,13 @@ __eb32_insert(struct eb_root *root, struct eb32_node *new) {
 		new->node.branches.b[EB_LEFT] = troot;
 		new->node.branches.b[EB_RGHT] = new_leaf;
 		new->node.leaf_p = new_rght;
-		*up_ptr = new_left;
+		eb_publish(up_ptr, new_left);
 	}
 	else {
 		new->node.branches.b[EB_LEFT] = new_leaf;
 		new->node.branches.b[EB_RGHT] = troot;
 		new->node.leaf_p = new_left;
-		*up_ptr = new_rght;
+		eb_publish(up_ptr, new_rght);
 	}
 
 	/* Ok, now we are inserting <new> between <root> and <old>. <old>'s
@@ -366,10 +531,96 @@ __eb32_insert(struct eb_root *root, struct eb32_node *new) {
 	 * find the side by checking the side of new->node.node_p.
 	 */
 
-	root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+	eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+	__eb_count_update(new->node.leaf_p);
 	return new;
 }
 
+/* Insert eb32_node <new> into subtree starting at node root <root>.
+ * Only new->key needs be set with the key. The eb32_node is returned.
+ * If root->b[EB_RGHT]==1, the tree may only contain unique keys.
+ */
+static forceinline struct eb32_node *
+__eb32_insert(struct eb_root *root, struct eb32_node *new) {
+	if (unlikely(root->b[EB_LEFT] == NULL)) {
+		/* Tree is empty, insert the leaf part below the left branch */
+		new->node.leaf_p = eb_dotag(root, EB_LEFT);
+		new->node.node_p = NULL; /* node part unused */
+		eb_publish(&root->b[EB_LEFT], eb_dotag(&new->node.branches, EB_LEAF));
+		return new;
+	}
+	return __eb32_insert_below(root, root, EB_LEFT, new);
+}
+
+/* Insert eb32_node <new> into the tree <root>, starting from the node <hint> of
+ * this tree, or from the root if <hint> is NULL or not queued. The descent
+ * only starts from the lowest node part above <hint> which covers new->key.
+ * Only new->key needs be set with the key. The eb32_node is returned. If
+ * root->b[EB_RGHT]==1, the tree may only contain unique keys.
+ */
+static forceinline struct eb32_node *
+__eb32_insert_from(struct eb_root *root, struct eb32_node *hint, struct eb32_node *new) {
+	struct eb_root *sub;
+	unsigned int side;
+
+	if (!hint || !hint->node.leaf_p)
+		return __eb32_insert(root, new);
+
+	sub = __eb32_climb(root, hint->node.leaf_p, new->key, &side);
+	return __eb32_insert_below(root, sub, side, new);
+}
+
+/* Change the key of eb32_node <node> to <x> and move it accordingly in the
+ * tree <root>, or insert it if it was not queued. The leaf's parent splits the
+ * keys at the highest bit where the node's key differs from one of its
+ * neighbours, so as long as the new key keeps all the bits from this one
+ * upwards, the shape of the tree does not change and the key is simply updated
+ * in place. This is not possible for duplicates, which must all keep the same
+ * key. Otherwise the node is deleted, and the new key is inserted from the
+ * lowest node part above its former sibling whose subtree still covers it,
+ * instead of from the root. The node is returned, or, if root->b[EB_RGHT]==1
+ * and the new key is already present, the existing node, as for an insert.
+ */
+static forceinline struct eb32_node *
+__eb32_requeue(struct eb_root *root, struct eb32_node *node, u32 x)
+{
+	struct eb_node *parent;
+	struct eb_root *sub;
+	eb_troot_t *sibling, *up;
+	unsigned int side;
+
+	if (!node->node.leaf_p) {
+		node->key = x;
+		return __eb32_insert(root, node);
+	}
+
+	if (node->key == x)
+		return node;
+
+	side = eb_gettag(node->node.leaf_p);
+	parent = eb_root_to_node(eb_untag(node->node.leaf_p, side));
+	if (eb_clrtag(parent->branches.b[EB_RGHT]) == NULL ||
+	    (parent->bit >= 0 && !((node->key ^ x) >> parent->bit))) {
+		node->key = x;
+		return node;
+	}
+
+	/* The sibling takes the parent's place once we're unlinked, so its
+	 * parent pointer is our finger into the tree.
+	 */
+	sibling = parent->branches.b[!side];
+	__eb_delete(&node->node);
+	node->key = x;
+
+	if (eb_gettag(sibling) == EB_LEAF)
+		up = eb_root_to_node(eb_untag(sibling, EB_LEAF))->leaf_p;
+	else
+		up = eb_root_to_node(eb_untag(sibling, EB_NODE))->node_p;
+
+	sub = __eb32_climb(root, up, x, &side);
+	return __eb32_insert_below(root, sub, side, node);
+}
+
 /* Insert eb32_node <new> into subtree starting at node root <root>, using
  * signed keys. Only new->key needs be set with the key. The eb32_node
  * is returned. If root->b[EB_RGHT]==1, the tree may only contain unique keys.
@@ -390,9 +641,9 @@ __eb32i_insert(struct eb_root *root, struct eb32_node *new) {
 	root_right = root->b[EB_RGHT];
 	if (unlikely(troot == NULL)) {
 		/* Tree is empty, insert the leaf part below the left branch */
-		root->b[EB_LEFT] = eb_dotag(&new->node.branches, EB_LEAF);
 		new->node.leaf_p = eb_dotag(root, EB_LEFT);
 		new->node.node_p = NULL; /* node part unused */
+		eb_publish(&root->b[EB_LEFT], eb_dotag(&new->node.branches, EB_LEAF));
 		return new;
 	}
 
@@ -484,13 +735,13 @@ __eb32i_insert(struct eb_root *root, struct eb32_node *new) {
 		new->node.branches.b[EB_LEFT] = troot;
 		new->node.branches.b[EB_RGHT] = new_leaf;
 		new->node.leaf_p = new_rght;
-		*up_ptr = new_left;
+		eb_publish(up_ptr, new_left);
 	}
 	else {
 		new->node.branches.b[EB_LEFT] = new_leaf;
 		new->node.branches.b[EB_RGHT] = troot;
 		new->node.leaf_p = new_left;
-		*up_ptr = new_rght;
+		eb_publish(up_ptr, new_rght);
 	}
 
 	/* Ok, now we are inserting <new> between <root> and <old>. <old>'s
@@ -499,7 +750,8 @@ __eb32i_insert(struct eb_root *root, struct eb32_node *new) {
 	 * find the side by checking the side of new->node.node_p.
 	 */
 
-	root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+	eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+	__eb_count_update(new->node.leaf_p);
 	return new;
 }
 
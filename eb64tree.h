@@ -117,16 +117,70 @@ static inline void eb64_delete(struct eb64_node *eb64)
 	eb_delete(&eb64->node);
 }
 
+/* Remove the leftmost node from the tree and return it, or NULL if none */
+static inline struct eb64_node *eb64_pick_first(struct eb_root *root)
+{
+	return eb64_entry(eb_pick_first(root), struct eb64_node, node);
+}
+
+/* Remove the rightmost node from the tree and return it, or NULL if none */
+static inline struct eb64_node *eb64_pick_last(struct eb_root *root)
+{
+	return eb64_entry(eb_pick_last(root), struct eb64_node, node);
+}
+
+#ifdef EB_COUNT
+/* Return the node at position <rank> (starting at zero), or NULL if none */
+static inline struct eb64_node *eb64_select(struct eb_root *root, unsigned int rank)
+{
+	return eb64_entry(eb_select(root, rank), struct eb64_node, node);
+}
+#endif
+
 /*
  * The following functions are not inlined by default. They are declared
  * in eb64tree.c, which simply relies on their inline version.
  */
 struct eb64_node *eb64_lookup(struct eb_root *root, u64 x);
+struct eb64_node *eb64_lookup_from(struct eb_root *root, struct eb64_node *hint, u64 x);
 struct eb64_node *eb64i_lookup(struct eb_root *root, s64 x);
 struct eb64_node *eb64_lookup_le(struct eb_root *root, u64 x);
 struct eb64_node *eb64_lookup_ge(struct eb_root *root, u64 x);
+struct eb64_node *eb64_pick(struct eb_root *root, u64 x);
+struct eb64_node *eb64_pick_le(struct eb_root *root, u64 x);
+struct eb64_node *eb64_pick_ge(struct eb_root *root, u64 x);
+void eb64_delete_range(struct eb_root *root, u64 min, u64 max, struct eb_root *out);
 struct eb64_node *eb64_insert(struct eb_root *root, struct eb64_node *new);
+struct eb64_node *eb64_insert_from(struct eb_root *root, struct eb64_node *hint, struct eb64_node *new);
+struct eb64_node *eb64_requeue(struct eb_root *root, struct eb64_node *node, u64 x);
+unsigned int eb64_build_sorted(struct eb_root *root, struct eb64_node **nodes, unsigned int nb);
 struct eb64_node *eb64i_insert(struct eb_root *root, struct eb64_node *new);
+void eb64_lookup_batch(struct eb_root *root, const u64 *keys, struct eb64_node **res, unsigned int nb);
+#ifdef EB_COUNT
+unsigned int eb64_rank(struct eb_root *root, u64 x);
+unsigned int eb64_count_range(struct eb_root *root, u64 min, u64 max);
+#endif
+
+/* Return the first node whose key is within [<min>, <max>], or NULL if none.
+ * Together with eb64_range_next(), this makes a cursor over a key interval.
+ */
+static inline struct eb64_node *eb64_range_first(struct eb_root *root, u64 min, u64 max)
+{
+	struct eb64_node *node = eb64_lookup_ge(root, min);
+
+	if (node && node->key > max)
+		return NULL;
+	return node;
+}
+
+/* Return the node following <node> if its key is not above <max>, or NULL */
+static inline struct eb64_node *eb64_range_next(struct eb64_node *node, u64 max)
+{
+	node = eb64_next(node);
+	if (node && node->key > max)
+		return NULL;
+	return node;
+}
 
 /*
  * The following functions are less likely to be used directly, because their
@@ -139,17 +193,40 @@ static forceinline void __eb64_delete(struct eb64_node *eb64)
 	__eb_delete(&eb64->node);
 }
 
+/* Climb from the tagged parent pointer <up> of a node of the tree <root> to the
+ * lowest node part whose subtree a descent for key <x> would enter, and return
+ * its branches with the branch to follow in <side>. <root> is returned with
+ * EB_LEFT if no node part covers <x>. Duplicate trees are climbed over since
+ * the descent stops above them.
+ */
+static forceinline struct eb_root *
+__eb64_climb(struct eb_root *root, eb_troot_t *up, u64 x, unsigned int *side)
+{
+	while (eb_clrtag(up) != root) {
+		struct eb64_node *sub = container_of(eb_clrtag(up), struct eb64_node, node.branches);
+
+		if (sub->node.bit >= 0 && ((sub->key ^ x) >> sub->node.bit) < EB_NODE_BRANCHES) {
+			*side = (x >> sub->node.bit) & EB_NODE_BRANCH_MASK;
+			return &sub->node.branches;
+		}
+		up = sub->node.node_p;
+	}
+	*side = EB_LEFT;
+	return root;
+}
+
 /*
- * Find the first occurence of a key in the tree <root>. If none can be
- * found, return NULL.
+ * Find the first occurence of a key below branch <side> of <sub>, which is
+ * either the tree's root or the branches of a node part whose subtree the
+ * descent for <x> would enter. If none can be found, return NULL.
  */
-static forceinline struct eb64_node *__eb64_lookup(struct eb_root *root, u64 x)
+static forceinline struct eb64_node *__eb64_lookup_below(struct eb_root *sub, unsigned int side, u64 x)
 {
 	struct eb64_node *node;
 	eb_troot_t *troot;
 	u64 y;
 
-	troot = root->b[EB_LEFT];
+	troot = sub->b[side];
 	if (unlikely(troot == NULL))
 		return NULL;
 
@@ -188,6 +265,34 @@ static forceinline struct eb64_node *__eb64_lookup(struct eb_root *root, u64 x)
 	}
 }
 
+/*
+ * Find the first occurence of a key in the tree <root>. If none can be
+ * found, return NULL.
+ */
+static forceinline struct eb64_node *__eb64_lookup(struct eb_root *root, u64 x)
+{
+	return __eb64_lookup_below(root, EB_LEFT, x);
+}
+
+/*
+ * Find the first occurence of a key in the tree <root>, starting from the
+ * node <hint> of this tree, or from the root if <hint> is NULL or not queued.
+ * The descent only starts from the lowest node part above <hint> which covers
+ * <x>, so the cost depends on the distance between the keys rather than on
+ * the tree's height. If none can be found, return NULL.
+ */
+static forceinline struct eb64_node *__eb64_lookup_from(struct eb_root *root, struct eb64_node *hint, u64 x)
+{
+	struct eb_root *sub;
+	unsigned int side;
+
+	if (!hint || !hint->node.leaf_p)
+		return __eb64_lookup(root, x);
+
+	sub = __eb64_climb(root, hint->node.leaf_p, x, &side);
+	return __eb64_lookup_below(sub, side, x);
+}
+
 /*
  * Find the first occurence of a signed key in the tree <root>. If none can
  * be found, return NULL.
@@ -238,29 +343,90 @@ static forceinline struct eb64_node *__eb64i_lookup(struct eb_root *root, s64 x)
 	}
 }
 
-/* Insert eb64_node <new> into subtree starting at node root <root>.
- * Only new->key needs be set with the key. The eb64_node is returned.
- * If root->b[EB_RGHT]==1, the tree may only contain unique keys.
+/*
+ * Find the first occurence of a key in the tree <root> and remove it from the
+ * tree. The node is returned, or NULL if none could be found.
+ */
+static forceinline struct eb64_node *__eb64_pick(struct eb_root *root, u64 x)
+{
+	struct eb64_node *node = __eb64_lookup(root, x);
+
+	if (node)
+		__eb_delete(&node->node);
+	return node;
+}
+
+#ifdef EB_COUNT
+/*
+ * Return the number of keys in the tree <root> which are lower than <x>, or
+ * lower than or equal to <x> if <le> is non-zero. The descent stops as soon
+ * as <x> leaves the current subtree, whose keys then all sit on one side.
+ */
+static forceinline unsigned int __eb64_rank(struct eb_root *root, u64 x, int le)
+{
+	struct eb64_node *node;
+	eb_troot_t *troot;
+	unsigned int rank = 0;
+	int node_bit, side;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return 0;
+
+	while (1) {
+		if ((eb_gettag(troot) == EB_LEAF)) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct eb64_node, node.branches);
+			if (node->key < x || (le && node->key == x))
+				rank++;
+			return rank;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct eb64_node, node.branches);
+		node_bit = node->node.bit;
+
+		if (node_bit < 0) {
+			/* a dup tree only holds equal keys */
+			if (node->key < x || (le && node->key == x))
+				rank += node->node.count;
+			return rank;
+		}
+
+		if (((x ^ node->key) >> node_bit) >= EB_NODE_BRANCHES) {
+			/* no more common bits, the whole subtree is either
+			 * below or above <x>.
+			 */
+			if ((node->key >> node_bit) < (x >> node_bit))
+				rank += node->node.count;
+			return rank;
+		}
+
+		side = (x >> node_bit) & EB_NODE_BRANCH_MASK;
+		if (side)
+			rank += eb_troot_count(node->node.branches.b[EB_LEFT]);
+		troot = node->node.branches.b[side];
+	}
+}
+#endif
+
+/* Insert eb64_node <new> below branch <side> of <sub>, which is either the
+ * tree's root <root> or the branches of a node part whose subtree the descent
+ * from <root> would enter, and must not be empty. Only new->key needs be set
+ * with the key. The eb64_node is returned. If root->b[EB_RGHT]==1, the tree
+ * may only contain unique keys.
  */
 static forceinline struct eb64_node *
-__eb64_insert(struct eb_root *root, struct eb64_node *new) {
+__eb64_insert_below(struct eb_root *root, struct eb_root *sub, unsigned int side, struct eb64_node *new) {
 	struct eb64_node *old;
-	unsigned int side;
 	eb_troot_t *troot;
+	eb_troot_t **up_ptr, *up_val;
 	u64 newkey; /* caching the key saves approximately one cycle */
 	eb_troot_t *root_right;
 	int old_node_bit;
 
-	side = EB_LEFT;
-	troot = root->b[EB_LEFT];
 	root_right = root->b[EB_RGHT];
-	if (unlikely(troot == NULL)) {
-		/* Tree is empty, insert the leaf part below the left branch */
-		root->b[EB_LEFT] = eb_dotag(&new->node.branches, EB_LEAF);
-		new->node.leaf_p = eb_dotag(root, EB_LEFT);
-		new->node.node_p = NULL; /* node part unused */
-		return new;
-	}
+	root = sub;
+	troot = root->b[side];
 
 	/* The tree descent is fairly easy :
 	 *  - first, check if we have reached a leaf node
@@ -308,7 +474,8 @@ __eb64_insert(struct eb_root *root, struct eb64_node *new) {
 			 
 			if (new->key < old->key) {
 				new->node.leaf_p = new_left;
-				old->node.leaf_p = new_rght;
+				up_ptr = &old->node.leaf_p;
+				up_val = new_rght;
 				new->node.branches.b[EB_LEFT] = new_leaf;
 				new->node.branches.b[EB_RGHT] = old_leaf;
 			} else {
@@ -319,14 +486,17 @@ __eb64_insert(struct eb_root *root, struct eb64_node *new) {
 					return old;
 
 				/* new->key >= old->key, new goes the right */
-				old->node.leaf_p = new_left;
+				up_ptr = &old->node.leaf_p;
+				up_val = new_left;
 				new->node.leaf_p = new_rght;
 				new->node.branches.b[EB_LEFT] = old_leaf;
 				new->node.branches.b[EB_RGHT] = new_leaf;
 
 				if (new->key == old->key) {
 					new->node.bit = -1;
-					root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+					eb_publish(up_ptr, up_val);
+					eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+					__eb_count_update(new->node.leaf_p);
 					return new;
 				}
 			}
@@ -361,12 +531,14 @@ __eb64_insert(struct eb_root *root, struct eb64_node *new) {
 
 			if (new->key < old->key) {
 				new->node.leaf_p = new_left;
-				old->node.node_p = new_rght;
+				up_ptr = &old->node.node_p;
+				up_val = new_rght;
 				new->node.branches.b[EB_LEFT] = new_leaf;
 				new->node.branches.b[EB_RGHT] = old_node;
 			}
 			else if (new->key > old->key) {
-				old->node.node_p = new_left;
+				up_ptr = &old->node.node_p;
+				up_val = new_left;
 				new->node.leaf_p = new_rght;
 				new->node.branches.b[EB_LEFT] = old_node;
 				new->node.branches.b[EB_RGHT] = new_leaf;
@@ -400,9 +572,10 @@ __eb64_insert(struct eb_root *root, struct eb64_node *new) {
 	}
 
 	/* Ok, now we are inserting <new> between <root> and <old>. <old>'s
-	 * parent is already set to <new>, and the <root>'s branch is still in
-	 * <side>. Update the root's leaf till we have it. Note that we can also
-	 * find the side by checking the side of new->node.node_p.
+	 * parent pointer is in <up_ptr> and will be set to <up_val>, and the
+	 * <root>'s branch is still in <side>. once <new> is complete,
+	 * these two links are published, parent first, so that concurrent readers
+	 * never reach a partially initialized node.
 	 */
 
 	/* We need the common higher bits between new->key and old->key.
@@ -413,11 +586,93 @@ __eb64_insert(struct eb_root *root, struct eb64_node *new) {
 	 */
 	/* note that if EB_NODE_BITS > 1, we should check that it's still >= 0 */
 	new->node.bit = fls64(new->key ^ old->key) - EB_NODE_BITS;
-	root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+	eb_publish(up_ptr, up_val);
+	eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+	__eb_count_update(new->node.leaf_p);
 
 	return new;
 }
 
+/* Insert eb64_node <new> into subtree starting at node root <root>.
+ * Only new->key needs be set with the key. The eb64_node is returned.
+ * If root->b[EB_RGHT]==1, the tree may only contain unique keys.
+ */
+static forceinline struct eb64_node *
+__eb64_insert(struct eb_root *root, struct eb64_node *new) {
+	if (unlikely(root->b[EB_LEFT] == NULL)) {
+		/* Tree is empty, insert the leaf part below the left branch */
+		new->node.leaf_p = eb_dotag(root, EB_LEFT);
+		new->node.node_p = NULL; /* node part unused */
+		eb_publish(&root->b[EB_LEFT], eb_dotag(&new->node.branches, EB_LEAF));
+		return new;
+	}
+	return __eb64_insert_below(root, root, EB_LEFT, new);
+}
+
+/* Insert eb64_node <new> into the tree <root>, starting from the node <hint> of
+ * this tree, or from the root if <hint> is NULL or not queued. The descent
+ * only starts from the lowest node part above <hint> which covers new->key.
+ * Only new->key needs be set with the key. The eb64_node is returned. If
+ * root->b[EB_RGHT]==1, the tree may only contain unique keys.
+ */
+static forceinline struct eb64_node *
+__eb64_insert_from(struct eb_root *root, struct eb64_node *hint, struct eb64_node *new) {
+	struct eb_root *sub;
+	unsigned int side;
+
+	if (!hint || !hint->node.leaf_p)
+		return __eb64_insert(root, new);
+
+	sub = __eb64_climb(root, hint->node.leaf_p, new->key, &side);
+	return __eb64_insert_below(root, sub, side, new);
+}
+
+/* Change the key of eb64_node <node> to <x> and move it accordingly in the
+ * tree <root>, or insert it if it was not queued. The key is updated in place
+ * when it keeps all the bits from the leaf parent's split bit upwards, which
+ * leaves the shape of the tree unchanged, except for duplicates. Otherwise the
+ * node is deleted and reinserted from the lowest node part above its former
+ * sibling whose subtree still covers the new key. The node is returned, or,
+ * if root->b[EB_RGHT]==1 and the new key is already present, the existing
+ * node, as for an insert. See __eb32_requeue() for more details.
+ */
+static forceinline struct eb64_node *
+__eb64_requeue(struct eb_root *root, struct eb64_node *node, u64 x)
+{
+	struct eb_node *parent;
+	struct eb_root *sub;
+	eb_troot_t *sibling, *up;
+	unsigned int side;
+
+	if (!node->node.leaf_p) {
+		node->key = x;
+		return __eb64_insert(root, node);
+	}
+
+	if (node->key == x)
+		return node;
+
+	side = eb_gettag(node->node.leaf_p);
+	parent = eb_root_to_node(eb_untag(node->node.leaf_p, side));
+	if (eb_clrtag(parent->branches.b[EB_RGHT]) == NULL ||
+	    (parent->bit >= 0 && !((node->key ^ x) >> parent->bit))) {
+		node->key = x;
+		return node;
+	}
+
+	sibling = parent->branches.b[!side];
+	__eb_delete(&node->node);
+	node->key = x;
+
+	if (eb_gettag(sibling) == EB_LEAF)
+		up = eb_root_to_node(eb_untag(sibling, EB_LEAF))->leaf_p;
+	else
+		up = eb_root_to_node(eb_untag(sibling, EB_NODE))->node_p;
+
+	sub = __eb64_climb(root, up, x, &side);
+	return __eb64_insert_below(root, sub, side, node);
+}
+
 /* Insert eb64_node <new> into subtree starting at node root <root>, using
  * signed keys. Only new->key needs be set with the key. The eb64_node
  * is returned. If root->b[EB_RGHT]==1, the tree may only contain unique keys.
@@ -427,6 +682,7 @@ __eb64i_insert(struct eb_root *root, struct eb64_node *new) {
 	struct eb64_node *old;
 	unsigned int side;
 	eb_troot_t *troot;
+	eb_troot_t **up_ptr, *up_val;
 	u64 newkey; /* caching the key saves approximately one cycle */
 	eb_troot_t *root_right;
 	int old_node_bit;
@@ -436,9 +692,9 @@ __eb64i_insert(struct eb_root *root, struct eb64_node *new) {
 	root_right = root->b[EB_RGHT];
 	if (unlikely(troot == NULL)) {
 		/* Tree is empty, insert the leaf part below the left branch */
-		root->b[EB_LEFT] = eb_dotag(&new->node.branches, EB_LEAF);
 		new->node.leaf_p = eb_dotag(root, EB_LEFT);
 		new->node.node_p = NULL; /* node part unused */
+		eb_publish(&root->b[EB_LEFT], eb_dotag(&new->node.branches, EB_LEAF));
 		return new;
 	}
 
@@ -490,7 +746,8 @@ __eb64i_insert(struct eb_root *root, struct eb64_node *new) {
 			 
 			if ((s64)new->key < (s64)old->key) {
 				new->node.leaf_p = new_left;
-				old->node.leaf_p = new_rght;
+				up_ptr = &old->node.leaf_p;
+				up_val = new_rght;
 				new->node.branches.b[EB_LEFT] = new_leaf;
 				new->node.branches.b[EB_RGHT] = old_leaf;
 			} else {
@@ -501,14 +758,17 @@ __eb64i_insert(struct eb_root *root, struct eb64_node *new) {
 					return old;
 
 				/* new->key >= old->key, new goes the right */
-				old->node.leaf_p = new_left;
+				up_ptr = &old->node.leaf_p;
+				up_val = new_left;
 				new->node.leaf_p = new_rght;
 				new->node.branches.b[EB_LEFT] = old_leaf;
 				new->node.branches.b[EB_RGHT] = new_leaf;
 
 				if (new->key == old->key) {
 					new->node.bit = -1;
-					root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+					eb_publish(up_ptr, up_val);
+					eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+					__eb_count_update(new->node.leaf_p);
 					return new;
 				}
 			}
@@ -543,12 +803,14 @@ __eb64i_insert(struct eb_root *root, struct eb64_node *new) {
 
 			if ((s64)new->key < (s64)old->key) {
 				new->node.leaf_p = new_left;
-				old->node.node_p = new_rght;
+				up_ptr = &old->node.node_p;
+				up_val = new_rght;
 				new->node.branches.b[EB_LEFT] = new_leaf;
 				new->node.branches.b[EB_RGHT] = old_node;
 			}
 			else if ((s64)new->key > (s64)old->key) {
-				old->node.node_p = new_left;
+				up_ptr = &old->node.node_p;
+				up_val = new_left;
 				new->node.leaf_p = new_rght;
 				new->node.branches.b[EB_LEFT] = old_node;
 				new->node.branches.b[EB_RGHT] = new_leaf;
@@ -582,9 +844,10 @@ __eb64i_insert(struct eb_root *root, struct eb64_node *new) {
 	}
 
 	/* Ok, now we are inserting <new> between <root> and <old>. <old>'s
-	 * parent is already set to <new>, and the <root>'s branch is still in
-	 * <side>. Update the root's leaf till we have it. Note that we can also
-	 * find the side by checking the side of new->node.node_p.
+	 * parent pointer is in <up_ptr> and will be set to <up_val>, and the
+	 * <root>'s branch is still in <side>. once <new> is complete,
+	 * these two links are published, parent first, so that concurrent readers
+	 * never reach a partially initialized node.
 	 */
 
 	/* We need the common higher bits between new->key and old->key.
@@ -595,7 +858,9 @@ __eb64i_insert(struct eb_root *root, struct eb64_node *new) {
 	 */
 	/* note that if EB_NODE_BITS > 1, we should check that it's still >= 0 */
 	new->node.bit = fls64(new->key ^ old->key) - EB_NODE_BITS;
-	root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+	eb_publish(up_ptr, up_val);
+	eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+	__eb_count_update(new->node.leaf_p);
 
 	return new;
 }
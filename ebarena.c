@@ -0,0 +1,316 @@
+/*
+ * Elastic Binary Trees - node allocator.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult ebarena.h for more details about those functions */
+
+#include <string.h>
+#include "ebtree.h"
+#include "ebarena.h"
+
+/* Returns the class of objects of <size> bytes and sets <csize> to the size of
+ * the objects of this class. Sizes are rounded up to 8 bytes up to 128, then
+ * to 1/8 of the next power of two. With EB_ARENA_F_LINE, they are first rounded
+ * up to a power of two up to the cache line size, and to a multiple of it past
+ * it, all of which are class sizes.
+ */
+static inline unsigned int eb_arena_class(const struct eb_arena *arena, size_t size, unsigned int *csize)
+{
+	unsigned int shift, units;
+
+	if (!size)
+		size = 1;
+
+	if (arena->flags & EB_ARENA_F_LINE) {
+		if (size <= EB_ARENA_LINE)
+			size = size <= 16 ? 16 : 1UL << flsnz32(size - 1);
+		else
+			size = (size + EB_ARENA_LINE - 1) & -(size_t)EB_ARENA_LINE;
+	}
+
+	if (size <= 128) {
+		*csize = (size + 7) & -8;
+		return *csize / 8 - 1;
+	}
+	shift = flsnz32(size - 1) - 4;
+	units = (size + (1U << shift) - 1) >> shift;
+	*csize = units << shift;
+	return 16 + (shift - 4) * 8 + units - 9;
+}
+
+/* Returns non-zero if block <blk> can hold one more object */
+static inline int eb_arena_room(const struct eb_arena_block *blk)
+{
+	return blk->free || blk->bump + blk->size <= EB_ARENA_BLOCK;
+}
+
+/* Queues block <blk> on the list of blocks of class <cls> with room left */
+static inline void eb_arena_queue(struct eb_arena_class *cls, struct eb_arena_block *blk)
+{
+	blk->prev = NULL;
+	blk->next = cls->avail;
+	if (blk->next)
+		blk->next->prev = blk;
+	cls->avail = blk;
+	blk->queued = 1;
+}
+
+/* Removes block <blk> from the list of blocks of class <cls> */
+static inline void eb_arena_dequeue(struct eb_arena_class *cls, struct eb_arena_block *blk)
+{
+	if (blk->prev)
+		blk->prev->next = blk->next;
+	else
+		cls->avail = blk->next;
+	if (blk->next)
+		blk->next->prev = blk->prev;
+	blk->queued = 0;
+}
+
+/* Assigns an empty block to objects of <csize> bytes of class <cls>, and
+ * queues it. A new chunk is allocated if no empty block remains. Returns the
+ * block or NULL if memory is exhausted.
+ */
+static struct eb_arena_block *eb_arena_new_block(struct eb_arena *arena, struct eb_arena_class *cls,
+						 unsigned int csize)
+{
+	struct eb_arena_block *blk;
+	void *chunk;
+	int i;
+
+	if (!arena->empty) {
+		if (posix_memalign(&chunk, EB_ARENA_BLOCK, EB_ARENA_BLOCK * EB_ARENA_CHUNK))
+			return NULL;
+
+		for (i = EB_ARENA_CHUNK - 1; i >= 0; i--) {
+			blk = (struct eb_arena_block *)((char *)chunk + i * EB_ARENA_BLOCK);
+			blk->chunk = NULL;
+			blk->size = 0;
+			blk->next = arena->empty;
+			arena->empty = blk;
+		}
+		blk->chunk = arena->chunks;
+		arena->chunks = blk;
+	}
+
+	blk = arena->empty;
+	arena->empty = blk->next;
+	blk->free = NULL;
+	blk->size = csize;
+	blk->used = 0;
+	blk->bump = EB_ARENA_LINE;
+	eb_arena_queue(cls, blk);
+	return blk;
+}
+
+/* Takes a zeroed object from block <blk> of class <cls>, which must have room.
+ * The block is dequeued once full.
+ */
+static inline void *eb_arena_take(struct eb_arena_class *cls, struct eb_arena_block *blk)
+{
+	void *obj = blk->free;
+
+	if (obj)
+		blk->free = *(void **)obj;
+	else {
+		obj = (char *)blk + blk->bump;
+		blk->bump += blk->size;
+	}
+	blk->used++;
+	if (blk->queued && !eb_arena_room(blk))
+		eb_arena_dequeue(cls, blk);
+	return memset(obj, 0, blk->size);
+}
+
+/* Allocates a zeroed object of <size> bytes larger than EB_ARENA_MAX_SIZE in a
+ * block of its own. Returns NULL if memory is exhausted.
+ */
+static void *eb_arena_alloc_big(struct eb_arena *arena, size_t size)
+{
+	struct eb_arena_block *blk;
+	void *mem;
+
+	if (posix_memalign(&mem, EB_ARENA_BLOCK, EB_ARENA_LINE + size))
+		return NULL;
+
+	blk = mem;
+	blk->size = 0;
+	blk->prev = NULL;
+	blk->next = arena->big;
+	if (blk->next)
+		blk->next->prev = blk;
+	arena->big = blk;
+	return memset((char *)blk + EB_ARENA_LINE, 0, size);
+}
+
+/* Initializes arena <arena> with flags <flags> (EB_ARENA_F_*) */
+void eb_arena_init(struct eb_arena *arena, unsigned int flags)
+{
+	memset(arena, 0, sizeof(*arena));
+	arena->flags = flags;
+}
+
+/* Releases all the memory used by arena <arena>, including all the objects it
+ * allocated, which must not be used anymore. The arena is reinitialized and
+ * may be used again.
+ */
+void eb_arena_destroy(struct eb_arena *arena)
+{
+	struct eb_arena_block *blk;
+
+	while ((blk = arena->big)) {
+		arena->big = blk->next;
+		free(blk);
+	}
+
+	while ((blk = arena->chunks)) {
+		arena->chunks = blk->chunk;
+		free(blk);
+	}
+	eb_arena_init(arena, arena->flags);
+}
+
+/* Returns a zeroed object of <size> bytes allocated from arena <arena>,
+ * preferably reusing a freed one, or NULL if memory is exhausted.
+ */
+void *eb_arena_alloc(struct eb_arena *arena, size_t size)
+{
+	struct eb_arena_block *blk;
+	struct eb_arena_class *cls;
+	unsigned int csize;
+
+	if (size > EB_ARENA_MAX_SIZE)
+		return eb_arena_alloc_big(arena, size);
+
+	cls = &arena->cls[eb_arena_class(arena, size, &csize)];
+	blk = cls->avail;
+	if (!blk && !(blk = eb_arena_new_block(arena, cls, csize)))
+		return NULL;
+	return eb_arena_take(cls, blk);
+}
+
+/* Same as eb_arena_alloc() but places the object in the same block as object
+ * <hint> if it is of the same class and there is room there. Otherwise the
+ * object starts a new block. <hint> must be NULL or an object allocated from
+ * <arena> and not yet freed.
+ */
+void *eb_arena_alloc_near(struct eb_arena *arena, size_t size, const void *hint)
+{
+	struct eb_arena_block *blk;
+	struct eb_arena_class *cls;
+	unsigned int csize;
+	void *obj;
+
+	if (size > EB_ARENA_MAX_SIZE)
+		return eb_arena_alloc_big(arena, size);
+
+	cls = &arena->cls[eb_arena_class(arena, size, &csize)];
+	if (hint) {
+		blk = eb_arena_block_of(hint);
+		if (blk->size == csize && eb_arena_room(blk))
+			return eb_arena_take(cls, blk);
+	}
+
+	/* The object goes to the first block with room, which it may only fill
+	 * up to half, so that the rest remains for its future neighbours. The
+	 * block is reachable through them past this point.
+	 */
+	blk = cls->avail;
+	if (!blk && !(blk = eb_arena_new_block(arena, cls, csize)))
+		return NULL;
+	obj = eb_arena_take(cls, blk);
+	if (blk->queued && blk->bump > EB_ARENA_BLOCK / 2 && !blk->free)
+		eb_arena_dequeue(cls, blk);
+	return obj;
+}
+
+/* Allocates <nb> zeroed objects of <size> bytes from arena <arena> and stores
+ * them into <objs>. Returns the number of objects allocated, which is lower
+ * than <nb> only if memory is exhausted.
+ */
+unsigned int eb_arena_alloc_bulk(struct eb_arena *arena, size_t size, void **objs, unsigned int nb)
+{
+	struct eb_arena_block *blk;
+	struct eb_arena_class *cls;
+	unsigned int csize, n = 0;
+
+	if (size > EB_ARENA_MAX_SIZE) {
+		for (; n < nb && (objs[n] = eb_arena_alloc_big(arena, size)); n++)
+			;
+		return n;
+	}
+
+	cls = &arena->cls[eb_arena_class(arena, size, &csize)];
+	while (n < nb) {
+		blk = cls->avail;
+		if (!blk && !(blk = eb_arena_new_block(arena, cls, csize)))
+			break;
+		/* fill the block before looking at the list again */
+		do {
+			objs[n++] = eb_arena_take(cls, blk);
+		} while (n < nb && blk->queued);
+	}
+	return n;
+}
+
+/* Returns object <obj> of <size> bytes to arena <arena>. <size> must be the one
+ * passed when allocating it. The object is reused by the next allocation of
+ * its class. Nothing is done if <obj> is NULL.
+ */
+void eb_arena_free(struct eb_arena *arena, void *obj, size_t size)
+{
+	struct eb_arena_block *blk;
+	struct eb_arena_class *cls;
+	unsigned int csize;
+
+	if (!obj)
+		return;
+
+	blk = eb_arena_block_of(obj);
+	if (size > EB_ARENA_MAX_SIZE) {
+		if (blk->prev)
+			blk->prev->next = blk->next;
+		else
+			arena->big = blk->next;
+		if (blk->next)
+			blk->next->prev = blk->prev;
+		free(blk);
+		return;
+	}
+
+	cls = &arena->cls[eb_arena_class(arena, size, &csize)];
+	*(void **)obj = blk->free;
+	blk->free = obj;
+	if (--blk->used == 0) {
+		/* the block is empty, any class may use it now */
+		if (blk->queued)
+			eb_arena_dequeue(cls, blk);
+		blk->size = 0;
+		blk->next = arena->empty;
+		arena->empty = blk;
+	}
+	else if (!blk->queued)
+		eb_arena_queue(cls, blk);
+}
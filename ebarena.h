@@ -0,0 +1,120 @@
+/*
+ * Elastic Binary Trees - node allocator.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+  An arena allocates tree nodes (or any other small objects) from 4 kB blocks
+  which it carves out of large chunks, so that nodes are packed together instead
+  of being spread over the heap, and so that they may all be released at once:
+
+      struct eb_arena arena;
+
+      eb_arena_init(&arena, 0);
+      node = eb_arena_alloc(&arena, sizeof(*node));
+      ...
+      eb_arena_free(&arena, node, sizeof(*node));
+      ...
+      eb_arena_destroy(&arena);
+
+  Objects are grouped by size class, so ebmb and ebst nodes of various key
+  lengths may be allocated from the same arena, and a block only holds objects
+  of a single class. Freed objects are kept on their block's free list and are
+  reused first. Once all of a block's objects are freed, the block may be used
+  by any class. The size passed to eb_arena_free() must be the one passed at
+  allocation time. Objects larger than EB_ARENA_MAX_SIZE get a block of their
+  own, which is directly allocated and freed, and still released with the
+  arena.
+
+  eb_arena_alloc_near() places the new object in the same block as <hint> when
+  there is room there. Passing the node which will be the new one's neighbour
+  in the tree, such as the one returned by eb32_lookup_le() (or _ge() when
+  there is none), keeps together the nodes visited at the bottom of lookups,
+  which then touch fewer cache lines and pages. When a hint's block is full,
+  the object starts a new block so that its own neighbours can join it later.
+
+  With EB_ARENA_F_LINE, object sizes are rounded up so that no object spans
+  two cache lines unless it is larger than one, at the expense of some memory
+  (eg: 40-byte eb32 nodes take 64 bytes).
+
+  An arena is not thread-safe, and all objects returned are zeroed.
+ */
+
+#ifndef _EBARENA_H
+#define _EBARENA_H
+
+#include <stdlib.h>
+#include "compiler.h"
+
+#define EB_ARENA_BLOCK      4096        /* block size and alignment, power of 2 */
+#define EB_ARENA_CHUNK      64          /* blocks allocated at once */
+#define EB_ARENA_LINE       64          /* cache line size */
+#define EB_ARENA_MAX_SIZE   1024        /* largest object allocated from blocks */
+#define EB_ARENA_CLASSES    40          /* number of size classes */
+
+/* arena flags */
+#define EB_ARENA_F_LINE     0x0001      /* do not let objects span cache lines */
+
+/* Block header, always at the beginning of the block, the objects start at
+ * the next cache line. Blocks with room left are queued on their class's list,
+ * empty blocks on the arena's list, and large objects' blocks on the arena's
+ * list of large blocks.
+ */
+struct eb_arena_block {
+	struct eb_arena_block *next;    /* next block in the list */
+	struct eb_arena_block *prev;    /* previous block in the list */
+	struct eb_arena_block *chunk;   /* next chunk, only in a chunk's first block */
+	void *free;                     /* free objects of this block */
+	unsigned short size;            /* object size, 0 when unassigned or large */
+	unsigned short used;            /* objects in use */
+	unsigned short bump;            /* offset of the first never used object */
+	unsigned short queued;          /* non-zero if queued on its class's list */
+};
+
+struct eb_arena_class {
+	struct eb_arena_block *avail;   /* blocks of this class with room left */
+};
+
+struct eb_arena {
+	struct eb_arena_class cls[EB_ARENA_CLASSES];
+	struct eb_arena_block *empty;   /* unassigned blocks */
+	struct eb_arena_block *chunks;  /* first block of each chunk */
+	struct eb_arena_block *big;     /* large objects' blocks */
+	unsigned int flags;
+};
+
+/* Returns the block containing arena object <obj> */
+static inline struct eb_arena_block *eb_arena_block_of(const void *obj)
+{
+	return (struct eb_arena_block *)((size_t)obj & ~(size_t)(EB_ARENA_BLOCK - 1));
+}
+
+void eb_arena_init(struct eb_arena *arena, unsigned int flags);
+void eb_arena_destroy(struct eb_arena *arena);
+void *eb_arena_alloc(struct eb_arena *arena, size_t size);
+void *eb_arena_alloc_near(struct eb_arena *arena, size_t size, const void *hint);
+unsigned int eb_arena_alloc_bulk(struct eb_arena *arena, size_t size, void **objs, unsigned int nb);
+void eb_arena_free(struct eb_arena *arena, void *obj, size_t size);
+
+#endif /* _EBARENA_H */
@@ -0,0 +1,1252 @@
+/*
+ * Elastic Binary Trees - benchmark driver.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Usage: ebbench [-n nodes] [-t trees] [-w workloads] [-s seed] [-H] [-b] [-k] [-a] [-q]
+ *
+ * Runs each workload against each tree type and reports, for every operation,
+ * the average cost in cycles and nanoseconds as well as the 50th and 99th
+ * percentile latencies, in CSV format on stdout. Trees and workloads are
+ * comma-separated lists taken from the names below ("all" by default). Each
+ * operation is timed individually, and the timer's own overhead is measured
+ * at startup and subtracted.
+ *
+ * Trees:     eb32, eb32i, eb64, ebmb, ebst, ebis, ebim, ebpt
+ * Workloads: random     - uniformly distributed keys
+ *            sequential - increasing keys
+ *            zipf       - Zipf distribution (s=1) over as many distinct keys
+ *            clustered  - runs of 64 consecutive keys at random places
+ *            dups       - only one distinct key per 100 nodes
+ *            timer      - expiration dates, "move" requeues the earliest one
+ *                         later as a scheduler does
+ *            timeout    - connection timeouts (5s, 30s or 1h) in ticks which
+ *                         wrap during the test; "move" and "rearm" replay
+ *                         bursts of activity pushing them back (eb32 only)
+ *
+ * Operations: insert, lookup (of existing keys in random order), lookup_batch_16
+ * (eb32/eb64 only, same keys by batches of 16, or of 1 to 64 with -b, whose
+ * results are checked against lookup), walk (eb_next), lookup_sorted (in key
+ * order, eb32/eb64 only), lookup_from (same, starting from the previous node),
+ * move (timer and timeout, using delete+insert), requeue (timer, using
+ * eb32/eb64/ebmb_requeue()), rearm (timeout, using ebtimer_rearm()), delete
+ * (in random order), and insert_from (eb32/eb64 only, in the initial order,
+ * starting from the previously inserted node), freeze (building a frozen
+ * snapshot 9 times, per node) and lookup_frozen (same as lookup, in the snapshot,
+ * eb32/eb64/ebmb only).
+ *
+ * With -k, the byte string comparison kernels are measured instead, for keys
+ * of 4 to 256 bytes differing on their last byte: equal_bits(), check_bits()
+ * and string_equal_bits(), which use vector instructions when available, and
+ * the portable eb_memdiff_scalar() and eb_strdiff_scalar() for reference.
+ * They are reported as tree "bytes" with the key length as the node count.
+ *
+ * With -a, eb32 and ebst trees of random keys are built from nodes allocated
+ * one at a time with calloc() ("calloc"), from an arena ("arena"), from an
+ * arena next to the future neighbour found with lookup_le() or lookup_ge()
+ * ("arena_near"), and the same with cache line aligned nodes ("arena_line").
+ * The ebst keys are 16 to 31 characters long so that several size classes are
+ * used. The workload column reports the allocation mode, and insert and delete
+ * include the allocation and the release of the node. Use a large number of
+ * nodes to see the effect of cache misses. The average number of pages and
+ * cache lines holding the nodes visited by a lookup is reported on stderr.
+ *
+ * With -q, eb32 and eb64 trees of random unique keys are compared with qb32 and
+ * qb64 trees, which have 4 branches per node: insert, lookup, lookup_le (of
+ * random keys), walk and delete. The average number of levels between a leaf
+ * and the top of the tree is reported on stderr.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "eb32tree.h"
+#include "eb64tree.h"
+#include "ebpttree.h"
+#include "ebmbtree.h"
+#include "ebsttree.h"
+#include "ebimtree.h"
+#include "ebistree.h"
+#include "ebtimer.h"
+#include "ebarena.h"
+#include "ebfreeze.h"
+#include "qb32tree.h"
+#include "qb64tree.h"
+
+#define BATCH 16
+#define FREEZE_RUNS 9
+
+/* all nodes are allocated with this size, the key storage of ebmb/ebst and
+ * ebim/ebis follows the node.
+ */
+struct bnode {
+	union {
+		struct eb32_node n32;
+		struct eb64_node n64;
+		struct ebpt_node npt;
+		struct eb_node node;
+	};
+	unsigned char data[24];
+};
+
+/* ebmb nodes store their key just after the node */
+#define MB(n) ((struct ebmb_node *)(n))
+
+struct tree {
+	const char *name;
+	void (*set_key)(struct bnode *n, unsigned long long key);
+	void (*insert)(struct eb_root *root, struct bnode *n);
+	struct eb_node *(*lookup)(struct eb_root *root, struct bnode *probe);
+	void (*lookup_batch)(struct eb_root *root, const void *keys, void *res, unsigned int first, unsigned int nb);
+	void (*requeue)(struct eb_root *root, struct bnode *n, unsigned long long key);
+	void (*insert_from)(struct eb_root *root, struct bnode *hint, struct bnode *n);
+	struct eb_node *(*lookup_from)(struct eb_root *root, struct bnode *hint, struct bnode *probe);
+	void *(*freeze)(struct eb_root *root);
+	struct eb_node *(*lookup_frozen)(const void *snap, struct bnode *probe);
+	void (*frozen_free)(void *snap);
+	void *(*batch_keys)(struct bnode *probes, unsigned int nb);
+	struct eb_node *(*batch_res)(const void *res, unsigned int i);
+};
+
+/* timer, using the TSC when available so that cycles are real cycles */
+#if defined(__x86_64__) || defined(__i386__)
+static inline unsigned long long now_cycles(void)
+{
+	unsigned int a, d;
+
+	__asm__ __volatile__("rdtsc" : "=a" (a), "=d" (d));
+	return ((unsigned long long)d << 32) | a;
+}
+#else
+static inline unsigned long long now_cycles(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* batch sizes used for lookup_batch, 1 to 64 with -b */
+static unsigned int batch_min = 16, batch_max = 16;
+
+static double cycles_per_ns;
+static unsigned long long timer_overhead;
+static unsigned long long rnd_state = 0x9e3779b97f4a7c15ULL;
+
+static inline unsigned long long rnd64(void)
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 7;
+	rnd_state ^= rnd_state << 17;
+	return rnd_state;
+}
+
+static void put_be64(unsigned char *p, unsigned long long key)
+{
+	int i;
+
+	for (i = 7; i >= 0; i--, key >>= 8)
+		p[i] = key;
+}
+
+static void put_hex(unsigned char *p, unsigned long long key)
+{
+	snprintf((char *)p, 17, "%016llx", key);
+}
+
+/* tree-specific operations */
+
+static void set_key32(struct bnode *n, unsigned long long key)  { n->n32.key = key; }
+static void set_key64(struct bnode *n, unsigned long long key)  { n->n64.key = key; }
+static void set_keypt(struct bnode *n, unsigned long long key)  { n->npt.key = (void *)(long)key; }
+static void set_keymb(struct bnode *n, unsigned long long key)  { put_be64(MB(n)->key, key); }
+static void set_keyst(struct bnode *n, unsigned long long key)  { put_hex(MB(n)->key, key); }
+static void set_keyim(struct bnode *n, unsigned long long key)  { put_be64(n->data, key); n->npt.key = n->data; }
+static void set_keyis(struct bnode *n, unsigned long long key)  { put_hex(n->data, key); n->npt.key = n->data; }
+
+static void ins32(struct eb_root *r, struct bnode *n)  { eb32_insert(r, &n->n32); }
+static void ins32i(struct eb_root *r, struct bnode *n) { eb32i_insert(r, &n->n32); }
+static void ins64(struct eb_root *r, struct bnode *n)  { eb64_insert(r, &n->n64); }
+static void inspt(struct eb_root *r, struct bnode *n)  { ebpt_insert(r, &n->npt); }
+static void insmb(struct eb_root *r, struct bnode *n)  { ebmb_insert(r, MB(n), 8); }
+static void insst(struct eb_root *r, struct bnode *n)  { ebst_insert(r, MB(n)); }
+static void insim(struct eb_root *r, struct bnode *n)  { ebim_insert(r, &n->npt, 8); }
+static void insis(struct eb_root *r, struct bnode *n)  { ebis_insert(r, &n->npt); }
+
+static struct eb_node *lkp32(struct eb_root *r, struct bnode *p)
+{
+	struct eb32_node *n = eb32_lookup(r, p->n32.key);
+	return n ? &n->node : NULL;
+}
+
+static struct eb_node *lkp32i(struct eb_root *r, struct bnode *p)
+{
+	struct eb32_node *n = eb32i_lookup(r, p->n32.key);
+	return n ? &n->node : NULL;
+}
+
+static struct eb_node *lkp64(struct eb_root *r, struct bnode *p)
+{
+	struct eb64_node *n = eb64_lookup(r, p->n64.key);
+	return n ? &n->node : NULL;
+}
+
+static struct eb_node *lkppt(struct eb_root *r, struct bnode *p)
+{
+	struct ebpt_node *n = ebpt_lookup(r, p->npt.key);
+	return n ? &n->node : NULL;
+}
+
+static struct eb_node *lkpmb(struct eb_root *r, struct bnode *p)
+{
+	struct ebmb_node *n = ebmb_lookup(r, MB(p)->key, 8);
+	return n ? &n->node : NULL;
+}
+
+static struct eb_node *lkpst(struct eb_root *r, struct bnode *p)
+{
+	struct ebmb_node *n = ebst_lookup(r, (const char *)MB(p)->key);
+	return n ? &n->node : NULL;
+}
+
+static struct eb_node *lkpim(struct eb_root *r, struct bnode *p)
+{
+	struct ebpt_node *n = ebim_lookup(r, p->npt.key, 8);
+	return n ? &n->node : NULL;
+}
+
+static struct eb_node *lkpis(struct eb_root *r, struct bnode *p)
+{
+	struct ebpt_node *n = ebis_lookup(r, p->npt.key);
+	return n ? &n->node : NULL;
+}
+
+static void batch32(struct eb_root *r, const void *k, void *res, unsigned int first, unsigned int nb)
+{
+	eb32_lookup_batch(r, (const u32 *)k + first, (struct eb32_node **)res + first, nb);
+}
+
+static void batch64(struct eb_root *r, const void *k, void *res, unsigned int first, unsigned int nb)
+{
+	eb64_lookup_batch(r, (const u64 *)k + first, (struct eb64_node **)res + first, nb);
+}
+
+/* returns the array of the keys of the <nb> probes, to be freed */
+static void *bkeys32(struct bnode *p, unsigned int nb)
+{
+	u32 *keys = malloc(nb * sizeof(*keys));
+	unsigned int i;
+
+	for (i = 0; i < nb; i++)
+		keys[i] = p[i].n32.key;
+	return keys;
+}
+
+static void *bkeys64(struct bnode *p, unsigned int nb)
+{
+	u64 *keys = malloc(nb * sizeof(*keys));
+	unsigned int i;
+
+	for (i = 0; i < nb; i++)
+		keys[i] = p[i].n64.key;
+	return keys;
+}
+
+/* returns result <i> of a batched lookup */
+static struct eb_node *bres32(const void *res, unsigned int i)
+{
+	struct eb32_node *n = ((struct eb32_node * const *)res)[i];
+	return n ? &n->node : NULL;
+}
+
+static struct eb_node *bres64(const void *res, unsigned int i)
+{
+	struct eb64_node *n = ((struct eb64_node * const *)res)[i];
+	return n ? &n->node : NULL;
+}
+
+static void rqu32(struct eb_root *r, struct bnode *n, unsigned long long key)
+{
+	eb32_requeue(r, &n->n32, key);
+}
+
+static void rqu64(struct eb_root *r, struct bnode *n, unsigned long long key)
+{
+	eb64_requeue(r, &n->n64, key);
+}
+
+static void rqumb(struct eb_root *r, struct bnode *n, unsigned long long key)
+{
+	unsigned char k[8];
+
+	put_be64(k, key);
+	ebmb_requeue(r, MB(n), k, 8);
+}
+
+static void insf32(struct eb_root *r, struct bnode *h, struct bnode *n)
+{
+	eb32_insert_from(r, h ? &h->n32 : NULL, &n->n32);
+}
+
+static void insf64(struct eb_root *r, struct bnode *h, struct bnode *n)
+{
+	eb64_insert_from(r, h ? &h->n64 : NULL, &n->n64);
+}
+
+static struct eb_node *lkpf32(struct eb_root *r, struct bnode *h, struct bnode *p)
+{
+	struct eb32_node *n = eb32_lookup_from(r, h ? &h->n32 : NULL, p->n32.key);
+	return n ? &n->node : NULL;
+}
+
+static struct eb_node *lkpf64(struct eb_root *r, struct bnode *h, struct bnode *p)
+{
+	struct eb64_node *n = eb64_lookup_from(r, h ? &h->n64 : NULL, p->n64.key);
+	return n ? &n->node : NULL;
+}
+
+static void *frz32(struct eb_root *r) { return eb32_freeze(r); }
+static void *frz64(struct eb_root *r) { return eb64_freeze(r); }
+static void *frzmb(struct eb_root *r) { return ebmb_freeze(r, 8); }
+
+static struct eb_node *lkpz32(const void *s, struct bnode *p)
+{
+	struct eb32_node *n = eb32_frozen_lookup(s, p->n32.key);
+	return n ? &n->node : NULL;
+}
+
+static struct eb_node *lkpz64(const void *s, struct bnode *p)
+{
+	struct eb64_node *n = eb64_frozen_lookup(s, p->n64.key);
+	return n ? &n->node : NULL;
+}
+
+static struct eb_node *lkpzmb(const void *s, struct bnode *p)
+{
+	struct ebmb_node *n = ebmb_frozen_lookup(s, MB(p)->key);
+	return n ? &n->node : NULL;
+}
+
+static void frf32(void *s) { eb32_frozen_free(s); }
+static void frf64(void *s) { eb64_frozen_free(s); }
+static void frfmb(void *s) { ebmb_frozen_free(s); }
+
+static const struct tree trees[] = {
+	{ "eb32",  set_key32, ins32,  lkp32,  batch32, rqu32, insf32, lkpf32, frz32, lkpz32, frf32, bkeys32, bres32 },
+	{ "eb32i", set_key32, ins32i, lkp32i, NULL,    NULL,  NULL,   NULL,   NULL,  NULL,   NULL,  NULL,    NULL   },
+	{ "eb64",  set_key64, ins64,  lkp64,  batch64, rqu64, insf64, lkpf64, frz64, lkpz64, frf64, bkeys64, bres64 },
+	{ "ebmb",  set_keymb, insmb,  lkpmb,  NULL,    rqumb, NULL,   NULL,   frzmb, lkpzmb, frfmb, NULL,    NULL   },
+	{ "ebst",  set_keyst, insst,  lkpst,  NULL,    NULL,  NULL,   NULL,   NULL,  NULL,   NULL,  NULL,    NULL   },
+	{ "ebis",  set_keyis, insis,  lkpis,  NULL,    NULL,  NULL,   NULL,   NULL,  NULL,   NULL,  NULL,    NULL   },
+	{ "ebim",  set_keyim, insim,  lkpim,  NULL,    NULL,  NULL,   NULL,   NULL,  NULL,   NULL,  NULL,    NULL   },
+	{ "ebpt",  set_keypt, inspt,  lkppt,  NULL,    NULL,  NULL,   NULL,   NULL,  NULL,   NULL,  NULL,    NULL   },
+};
+
+/* workloads, filling <keys> with <nb> keys */
+
+static void gen_random(unsigned long long *keys, unsigned int nb)
+{
+	unsigned int i;
+
+	for (i = 0; i < nb; i++)
+		keys[i] = rnd64();
+}
+
+static void gen_sequential(unsigned long long *keys, unsigned int nb)
+{
+	unsigned int i;
+
+	for (i = 0; i < nb; i++)
+		keys[i] = i;
+}
+
+/* key ranks follow a Zipf law of exponent 1, and are then scattered */
+static void gen_zipf(unsigned long long *keys, unsigned int nb)
+{
+	double *cdf = malloc(nb * sizeof(*cdf));
+	double sum = 0, x;
+	unsigned int i, lo, hi, mid;
+
+	for (i = 0; i < nb; i++) {
+		sum += 1.0 / (i + 1);
+		cdf[i] = sum;
+	}
+
+	for (i = 0; i < nb; i++) {
+		x = (rnd64() >> 11) * (1.0 / 9007199254740992.0) * sum;
+		lo = 0; hi = nb - 1;
+		while (lo < hi) {
+			mid = (lo + hi) / 2;
+			if (cdf[mid] < x)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		keys[i] = (lo + 1) * 0x9e3779b97f4a7c15ULL;
+	}
+	free(cdf);
+}
+
+static void gen_clustered(unsigned long long *keys, unsigned int nb)
+{
+	unsigned long long base = 0;
+	unsigned int i;
+
+	for (i = 0; i < nb; i++) {
+		if (!(i & 63))
+			base = rnd64();
+		keys[i] = base + (i & 63);
+	}
+}
+
+static void gen_dups(unsigned long long *keys, unsigned int nb)
+{
+	unsigned int i, distinct = nb / 100 + 1;
+
+	for (i = 0; i < nb; i++)
+		keys[i] = (rnd64() % distinct) * 0x9e3779b97f4a7c15ULL;
+}
+
+/* expiration dates within the next 10 seconds, in ms */
+static void gen_timer(unsigned long long *keys, unsigned int nb)
+{
+	unsigned int i;
+
+	for (i = 0; i < nb; i++)
+		keys[i] = rnd64() % 10000;
+}
+
+/* connection timeouts armed during the last 5 seconds before the date
+ * TIMEOUT_BASE, which is close enough to the 32-bit wrap for it to happen
+ * during the replay. The timeout of each connection depends on its index.
+ */
+#define TIMEOUT_BASE	0xFFFFF000U
+
+static unsigned int timeout_of(unsigned int i)
+{
+	if (i % 20 == 0)
+		return 3600000;  /* tunnels */
+	if (i % 20 < 4)
+		return 30000;    /* server side */
+	return 5000;             /* keep-alive */
+}
+
+static void gen_timeout(unsigned long long *keys, unsigned int nb)
+{
+	unsigned int i;
+
+	for (i = 0; i < nb; i++)
+		keys[i] = (u32)(TIMEOUT_BASE - rnd64() % 5000 + timeout_of(i));
+}
+
+static const struct workload {
+	const char *name;
+	void (*gen)(unsigned long long *keys, unsigned int nb);
+} workloads[] = {
+	{ "random",     gen_random     },
+	{ "sequential", gen_sequential },
+	{ "zipf",       gen_zipf       },
+	{ "clustered",  gen_clustered  },
+	{ "dups",       gen_dups       },
+	{ "timer",      gen_timer      },
+	{ "timeout",    gen_timeout    },
+};
+
+/* measurement */
+
+static unsigned long long *samples;
+static unsigned int nb_samples;
+
+static int cmp_ull(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return (x > y) - (x < y);
+}
+
+static inline void sample(unsigned long long beg, unsigned long long end)
+{
+	end -= beg;
+	samples[nb_samples++] = end > timer_overhead ? end - timer_overhead : 0;
+}
+
+/* reports the samples collected for operation <op>, each covering <per>
+ * operations, and resets them.
+ */
+static void report(const char *tree, const char *wl, const char *op, unsigned int nodes, unsigned int per)
+{
+	unsigned long long total = 0;
+	unsigned int i;
+	double avg;
+
+	if (!nb_samples)
+		return;
+
+	for (i = 0; i < nb_samples; i++)
+		total += samples[i];
+	qsort(samples, nb_samples, sizeof(*samples), cmp_ull);
+	avg = (double)total / nb_samples / per;
+
+	printf("%s,%s,%s,%u,%u,%.1f,%.1f,%.1f,%.1f\n", tree, wl, op, nodes, nb_samples * per,
+	       avg, avg / cycles_per_ns,
+	       samples[nb_samples / 2] / cycles_per_ns / per,
+	       samples[(unsigned long long)nb_samples * 99 / 100] / cycles_per_ns / per);
+	nb_samples = 0;
+}
+
+static void calibrate(void)
+{
+	unsigned long long c0, c1, t0, t1, best = ~0ULL;
+	int i;
+
+	for (i = 0; i < 1000; i++) {
+		c0 = now_cycles();
+		c1 = now_cycles();
+		if (c1 - c0 < best)
+			best = c1 - c0;
+	}
+	timer_overhead = best;
+
+	t0 = now_ns();
+	c0 = now_cycles();
+	do {
+		t1 = now_ns();
+	} while (t1 - t0 < 50000000);
+	c1 = now_cycles();
+	cycles_per_ns = (double)(c1 - c0) / (t1 - t0);
+}
+
+/* Replays activity on the connections of the timeout workload, starting from
+ * their initial dates <keys>. Half of the events hit the same connection as
+ * the previous one, and the date advances by one tick every 4 events. Each
+ * event pushes the connection's timeout back, either by delete+insert, or by
+ * ebtimer_rearm() if <rearm> is set. The same events are replayed each time.
+ */
+static void replay_timeout(const struct tree *t, const struct workload *w, struct eb_root *root,
+                           struct bnode *nodes, const unsigned long long *keys,
+                           unsigned int nb, int rearm)
+{
+	unsigned long long state = rnd_state;
+	unsigned long long beg, end;
+	unsigned int i, cur = 0;
+	u32 now = TIMEOUT_BASE;
+
+	for (i = 0; i < nb; i++) {
+		eb32_delete(&nodes[i].n32);
+		ebtimer_arm(root, &nodes[i].n32, keys[i]);
+	}
+
+	for (i = 0; i < nb; i++) {
+		if (rnd64() & 1)
+			cur = rnd64() % nb;
+		now += !(i & 3);
+		beg = now_cycles();
+		if (rearm)
+			ebtimer_rearm(root, &nodes[cur].n32, now + timeout_of(cur));
+		else {
+			eb32_delete(&nodes[cur].n32);
+			ebtimer_arm(root, &nodes[cur].n32, now + timeout_of(cur));
+		}
+		end = now_cycles();
+		sample(beg, end);
+	}
+	report(t->name, w->name, rearm ? "rearm" : "move", nb, 1);
+
+	/* the next replay will get the same events */
+	if (!rearm)
+		rnd_state = state;
+}
+
+static void run(const struct tree *t, const struct workload *w, unsigned int nb)
+{
+	struct eb_root root = EB_ROOT;
+	struct bnode *nodes = calloc(nb, sizeof(*nodes));
+	struct bnode *probes = calloc(nb, sizeof(*probes));
+	struct bnode **order = malloc(nb * sizeof(*order));
+	unsigned long long *keys = malloc(nb * sizeof(*keys));
+	unsigned long long beg, end;
+	struct eb_node *node;
+	struct bnode *tmp;
+	unsigned int i, j;
+
+	w->gen(keys, nb);
+	for (i = 0; i < nb; i++)
+		t->set_key(&nodes[i], keys[i]);
+
+	/* random order of existing nodes for lookups and deletes */
+	for (i = 0; i < nb; i++)
+		order[i] = &nodes[i];
+	for (i = nb - 1; i > 0; i--) {
+		j = rnd64() % (i + 1);
+		tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+	}
+	for (i = 0; i < nb; i++)
+		t->set_key(&probes[i], keys[order[i] - nodes]);
+
+	for (i = 0; i < nb; i++) {
+		beg = now_cycles();
+		t->insert(&root, &nodes[i]);
+		end = now_cycles();
+		sample(beg, end);
+	}
+	report(t->name, w->name, "insert", nb, 1);
+
+	for (i = 0; i < nb; i++) {
+		beg = now_cycles();
+		node = t->lookup(&root, &probes[i]);
+		end = now_cycles();
+		sample(beg, end);
+		if (!node) {
+			fprintf(stderr, "%s/%s: key %u not found\n", t->name, w->name, i);
+			exit(1);
+		}
+	}
+	report(t->name, w->name, "lookup", nb, 1);
+
+	if (t->freeze) {
+		void *snap = NULL;
+
+		/* a single freeze is a single sample, so only the last
+		 * snapshot of a few is kept for the lookups.
+		 */
+		for (i = 0; i < FREEZE_RUNS; i++) {
+			if (snap)
+				t->frozen_free(snap);
+			beg = now_cycles();
+			snap = t->freeze(&root);
+			end = now_cycles();
+			sample(beg, end);
+			if (!snap) {
+				fprintf(stderr, "%s/%s: failed to freeze the tree\n", t->name, w->name);
+				exit(1);
+			}
+		}
+		report(t->name, w->name, "freeze", nb, nb);
+
+		for (i = 0; i < nb; i++) {
+			beg = now_cycles();
+			node = t->lookup_frozen(snap, &probes[i]);
+			end = now_cycles();
+			sample(beg, end);
+			if (!node) {
+				fprintf(stderr, "%s/%s: key %u not found in snapshot\n", t->name, w->name, i);
+				exit(1);
+			}
+		}
+		report(t->name, w->name, "lookup_frozen", nb, 1);
+		t->frozen_free(snap);
+	}
+
+	if (t->lookup_batch) {
+		void *bkeys = t->batch_keys(probes, nb);
+		void **bres = malloc(nb * sizeof(*bres));
+		unsigned int batch, n;
+		char op[32];
+
+		for (batch = batch_min; batch <= batch_max; batch++) {
+			for (i = 0; i < nb; i += n) {
+				n = nb - i < batch ? nb - i : batch;
+				beg = now_cycles();
+				t->lookup_batch(&root, bkeys, bres, i, n);
+				end = now_cycles();
+				if (n == batch)
+					sample(beg, end);
+			}
+			for (i = 0; i < nb; i++) {
+				if (t->batch_res(bres, i) != t->lookup(&root, &probes[i])) {
+					fprintf(stderr, "%s/%s: batch %u: mismatch on key %u\n", t->name, w->name, batch, i);
+					exit(1);
+				}
+			}
+			snprintf(op, sizeof(op), "lookup_batch_%u", batch);
+			report(t->name, w->name, op, nb, batch);
+		}
+		free(bres);
+		free(bkeys);
+	}
+
+	node = eb_first(&root);
+	while (node) {
+		beg = now_cycles();
+		node = eb_next(node);
+		end = now_cycles();
+		sample(beg, end);
+	}
+	report(t->name, w->name, "walk", nb, 1);
+
+	if (t->lookup_from) {
+		/* lookups in key order, which are the most local ones */
+		node = eb_first(&root);
+		for (i = 0; node; i++, node = eb_next(node))
+			order[i] = (struct bnode *)node;
+
+		for (i = 0; i < nb; i++) {
+			beg = now_cycles();
+			node = t->lookup(&root, order[i]);
+			end = now_cycles();
+			sample(beg, end);
+		}
+		report(t->name, w->name, "lookup_sorted", nb, 1);
+
+		tmp = NULL;
+		for (i = 0; i < nb; i++) {
+			beg = now_cycles();
+			tmp = (struct bnode *)t->lookup_from(&root, tmp, order[i]);
+			end = now_cycles();
+			sample(beg, end);
+		}
+		report(t->name, w->name, "lookup_from", nb, 1);
+	}
+
+	if (w->gen == gen_timer) {
+		/* the earliest timer is requeued within the next 10 seconds */
+		for (i = 0; i < nb; i++) {
+			beg = now_cycles();
+			tmp = (struct bnode *)eb_first(&root);
+			eb_delete(&tmp->node);
+			keys[tmp - nodes] += 1 + rnd64() % 10000;
+			t->set_key(tmp, keys[tmp - nodes]);
+			t->insert(&root, tmp);
+			end = now_cycles();
+			sample(beg, end);
+		}
+		report(t->name, w->name, "move", nb, 1);
+	}
+
+	if (w->gen == gen_timer && t->requeue) {
+		/* same as above using the tree's requeue function */
+		for (i = 0; i < nb; i++) {
+			beg = now_cycles();
+			tmp = (struct bnode *)eb_first(&root);
+			keys[tmp - nodes] += 1 + rnd64() % 10000;
+			t->requeue(&root, tmp, keys[tmp - nodes]);
+			end = now_cycles();
+			sample(beg, end);
+		}
+		report(t->name, w->name, "requeue", nb, 1);
+	}
+
+	if (w->gen == gen_timeout && t->insert == ins32) {
+		replay_timeout(t, w, &root, nodes, keys, nb, 0);
+		replay_timeout(t, w, &root, nodes, keys, nb, 1);
+	}
+
+	/* delete in random order */
+	for (i = 0; i < nb; i++)
+		order[i] = &nodes[i];
+	for (i = nb - 1; i > 0; i--) {
+		j = rnd64() % (i + 1);
+		tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+	}
+	for (i = 0; i < nb; i++) {
+		beg = now_cycles();
+		eb_delete(&order[i]->node);
+		end = now_cycles();
+		sample(beg, end);
+	}
+	report(t->name, w->name, "delete", nb, 1);
+
+	if (t->insert_from) {
+		/* insert again in the initial order, next to the previous node */
+		for (i = 0; i < nb; i++) {
+			beg = now_cycles();
+			t->insert_from(&root, i ? &nodes[i - 1] : NULL, &nodes[i]);
+			end = now_cycles();
+			sample(beg, end);
+		}
+		report(t->name, w->name, "insert_from", nb, 1);
+	}
+
+	free(keys);
+	free(order);
+	free(probes);
+	free(nodes);
+}
+
+/* Measures the byte comparison kernels on <nb> pairs of keys of each length */
+static void run_kernels(unsigned int nb)
+{
+	static const unsigned int lengths[] = { 4, 8, 16, 32, 64, 128, 256 };
+	unsigned char *a, *b;
+	unsigned long long beg, end;
+	unsigned int l, len, i, j, k;
+	char wl[16];
+	size_t ret = 0;
+
+	a = malloc(BATCH * 257);
+	b = malloc(BATCH * 257);
+
+	for (l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+		len = lengths[l];
+		snprintf(wl, sizeof(wl), "len%u", len);
+
+		/* non-zero bytes, the last one differs, then the trailing zero */
+		for (i = 0; i < BATCH; i++) {
+			for (j = 0; j < len; j++)
+				a[i * 257 + j] = b[i * 257 + j] = 1 + rnd64() % 255;
+			b[i * 257 + len - 1] ^= 1 + rnd64() % 255;
+			if (!b[i * 257 + len - 1])
+				b[i * 257 + len - 1] = 1;
+			a[i * 257 + len] = b[i * 257 + len] = 0;
+		}
+
+#define TIME_KERNEL(name, expr)						\
+		do {							\
+			for (i = 0; i + BATCH <= nb; i += BATCH) {	\
+				beg = now_cycles();			\
+				for (k = 0; k < BATCH; k++)		\
+					ret += (expr);			\
+				end = now_cycles();			\
+				sample(beg, end);			\
+			}						\
+			report("bytes", wl, name, len, BATCH);		\
+		} while (0)
+
+		TIME_KERNEL("equal_bits", equal_bits(a + k * 257, b + k * 257, 0, len << 3));
+		TIME_KERNEL("check_bits", check_bits(a + k * 257, b + k * 257, 0, len << 3) != 0);
+		TIME_KERNEL("string_equal_bits", string_equal_bits(a + k * 257, b + k * 257, 0));
+		TIME_KERNEL("memdiff_scalar", eb_memdiff_scalar(a + k * 257, b + k * 257, 0, len));
+		TIME_KERNEL("strdiff_scalar", eb_strdiff_scalar(a + k * 257, b + k * 257, 0));
+#undef TIME_KERNEL
+	}
+
+	/* make sure the results are used */
+	if (ret == 1)
+		fprintf(stderr, "\n");
+	free(b);
+	free(a);
+}
+
+/* node allocation modes compared by run_arena() */
+enum { ALLOC_CALLOC, ALLOC_ARENA, ALLOC_NEAR, ALLOC_LINE, ALLOC_MODES };
+static const char *alloc_names[ALLOC_MODES] = { "calloc", "arena", "arena_near", "arena_line" };
+
+/* Returns the size of the node for <key>, and its string in <str> if not NULL */
+static size_t arena_key(int st, unsigned long long key, char *str)
+{
+	size_t len = 16 + key % 16;
+
+	if (!st)
+		return sizeof(struct eb32_node);
+	if (str) {
+		put_hex((unsigned char *)str, key);
+		memset(str + 16, 'x', len - 16);
+		str[len] = 0;
+	}
+	return sizeof(struct ebmb_node) + len + 1;
+}
+
+/* Adds to <pages> and <lines> the number of pages and cache lines holding the
+ * nodes on the path from leaf <node> up to the root, which are assumed to span
+ * <size> bytes each. Consecutive nodes sharing a page or a line count once.
+ */
+static void path_locality(struct eb_node *node, size_t size,
+			  unsigned long long *pages, unsigned long long *lines)
+{
+	size_t last_page = 0, last_line = 0, beg, end, line;
+	eb_troot_t *up = node->leaf_p;
+	struct eb_root *branches;
+
+	while (1) {
+		beg = (size_t)node;
+		end = beg + size - 1;
+		*pages += (end >> 12) - (beg >> 12) + ((beg >> 12) != last_page);
+		for (line = beg >> 6; line <= end >> 6; line++)
+			*lines += line != last_line;
+		last_page = end >> 12;
+		last_line = end >> 6;
+
+		branches = eb_untag(up, eb_gettag(up));
+		if (eb_clrtag(branches->b[EB_RGHT]) == NULL)
+			break;
+		node = eb_root_to_node(branches);
+		up = node->node_p;
+	}
+}
+
+/* Builds an eb32 tree (or an ebst one if <st> is set) of <nb> random keys from
+ * nodes allocated according to <mode>, then looks them up, walks and deletes
+ * them.
+ */
+static void run_arena(int st, int mode, unsigned int nb)
+{
+	const char *tname = st ? "ebst" : "eb32";
+	struct eb_root root = EB_ROOT;
+	unsigned long long *keys = malloc(nb * sizeof(*keys));
+	void **nodes = malloc(nb * sizeof(*nodes));
+	unsigned long long beg, end;
+	struct eb_arena arena;
+	struct eb_node *node;
+	unsigned long long pages = 0, lines = 0;
+	void *hint, *n;
+	char str[40];
+	unsigned int i;
+	size_t size;
+
+	eb_arena_init(&arena, mode == ALLOC_LINE ? EB_ARENA_F_LINE : 0);
+	gen_random(keys, nb);
+
+	for (i = 0; i < nb; i++) {
+		size = arena_key(st, keys[i], str);
+		beg = now_cycles();
+		if (mode == ALLOC_CALLOC)
+			n = calloc(1, size);
+		else if (mode == ALLOC_ARENA)
+			n = eb_arena_alloc(&arena, size);
+		else {
+			if (st) {
+				hint = ebst_lookup_le(&root, str);
+				if (!hint)
+					hint = ebst_lookup_ge(&root, str);
+			} else {
+				hint = eb32_lookup_le(&root, keys[i]);
+				if (!hint)
+					hint = eb32_lookup_ge(&root, keys[i]);
+			}
+			n = eb_arena_alloc_near(&arena, size, hint);
+		}
+		if (st) {
+			strcpy((char *)((struct ebmb_node *)n)->key, str);
+			ebst_insert(&root, n);
+		} else {
+			((struct eb32_node *)n)->key = keys[i];
+			eb32_insert(&root, n);
+		}
+		end = now_cycles();
+		sample(beg, end);
+		nodes[i] = n;
+	}
+	report(tname, alloc_names[mode], "insert", nb, 1);
+
+	/* lookups in random order */
+	for (i = 0; i < nb; i++) {
+		unsigned long long key = keys[rnd64() % nb];
+
+		arena_key(st, key, str);
+		beg = now_cycles();
+		node = st ? &ebst_lookup(&root, str)->node : &eb32_lookup(&root, key)->node;
+		end = now_cycles();
+		sample(beg, end);
+		if (!node) {
+			fprintf(stderr, "%s/%s: key %u not found\n", tname, alloc_names[mode], i);
+			exit(1);
+		}
+	}
+	report(tname, alloc_names[mode], "lookup", nb, 1);
+
+	/* memory locality of the lookups, independent from the machine */
+	for (i = 0; i < nb; i++)
+		path_locality(nodes[i], st ? sizeof(struct ebmb_node) + 24 : sizeof(struct eb32_node),
+			      &pages, &lines);
+	fprintf(stderr, "# %s,%s: %.2f pages and %.2f cache lines per lookup\n",
+		tname, alloc_names[mode], (double)pages / nb, (double)lines / nb);
+
+	node = eb_first(&root);
+	while (node) {
+		beg = now_cycles();
+		node = eb_next(node);
+		end = now_cycles();
+		sample(beg, end);
+	}
+	report(tname, alloc_names[mode], "walk", nb, 1);
+
+	/* delete in insertion order, which is random in the tree */
+	for (i = 0; i < nb; i++) {
+		size = arena_key(st, keys[i], NULL);
+		beg = now_cycles();
+		eb_delete(nodes[i]);
+		if (mode == ALLOC_CALLOC)
+			free(nodes[i]);
+		else
+			eb_arena_free(&arena, nodes[i], size);
+		end = now_cycles();
+		sample(beg, end);
+	}
+	report(tname, alloc_names[mode], "delete", nb, 1);
+
+	eb_arena_destroy(&arena);
+	free(nodes);
+	free(keys);
+}
+
+/* the nodes compared by run_quad() */
+struct qnode {
+	union {
+		struct eb32_node e32;
+		struct eb64_node e64;
+		struct qb32_node q32;
+		struct qb64_node q64;
+	};
+};
+
+/* Returns the number of levels between leaf <node> and the top of its tree,
+ * for an EB node, or a QB node if <quad> is set.
+ */
+static unsigned int quad_depth(struct qnode *node, int quad)
+{
+	struct qb_node *q = node->q32.node.leaf_p;
+	eb_troot_t *up = node->e32.node.leaf_p;
+	unsigned int depth = 0;
+
+	if (quad) {
+		for (; q; q = q->node_p)
+			depth++;
+		return depth;
+	}
+	if (!up)
+		return 0; /* duplicate key, not inserted */
+	while (eb_clrtag(eb_untag(up, eb_gettag(up))->b[EB_RGHT])) {
+		depth++;
+		up = eb_root_to_node(eb_untag(up, eb_gettag(up)))->node_p;
+	}
+	return depth;
+}
+
+/* Builds an eb32 tree (eb64 if <w64> is set) of <nb> random unique keys, or a
+ * qb32/qb64 one if <quad> is set, then looks them up, looks up random keys
+ * with lookup_le(), walks and deletes them.
+ */
+static void run_quad(int w64, int quad, unsigned int nb)
+{
+	static const char *names[4] = { "eb32", "qb32", "eb64", "qb64" };
+	const char *tname = names[w64 * 2 + quad];
+	unsigned long long *keys = malloc(nb * sizeof(*keys));
+	struct eb_root root = EB_ROOT_UNIQUE;
+	struct qb_root qroot = QB_ROOT;
+	unsigned long long beg, end, depth = 0;
+	unsigned long long key;
+	void *node;
+	struct qnode *nodes;
+	unsigned int i;
+
+	/* QB nodes are one cache line each when aligned */
+	if (posix_memalign((void **)&nodes, 64, nb * sizeof(*nodes)))
+		exit(1);
+	memset(nodes, 0, nb * sizeof(*nodes));
+
+	gen_random(keys, nb);
+	for (i = 0; i < nb; i++) {
+		if (!w64)
+			keys[i] &= 0xffffffffULL;
+		if (quad && w64)
+			nodes[i].q64.key = keys[i];
+		else if (quad)
+			nodes[i].q32.key = keys[i];
+		else if (w64)
+			nodes[i].e64.key = keys[i];
+		else
+			nodes[i].e32.key = keys[i];
+	}
+
+	for (i = 0; i < nb; i++) {
+		beg = now_cycles();
+		if (quad && w64)
+			qb64_insert(&qroot, &nodes[i].q64);
+		else if (quad)
+			qb32_insert(&qroot, &nodes[i].q32);
+		else if (w64)
+			eb64_insert(&root, &nodes[i].e64);
+		else
+			eb32_insert(&root, &nodes[i].e32);
+		end = now_cycles();
+		sample(beg, end);
+	}
+	report(tname, "random", "insert", nb, 1);
+
+	for (i = 0; i < nb; i++) {
+		key = keys[rnd64() % nb];
+		beg = now_cycles();
+		if (quad && w64)
+			node = qb64_lookup(&qroot, key);
+		else if (quad)
+			node = qb32_lookup(&qroot, key);
+		else if (w64)
+			node = eb64_lookup(&root, key);
+		else
+			node = eb32_lookup(&root, key);
+		end = now_cycles();
+		sample(beg, end);
+		if (!node) {
+			fprintf(stderr, "%s: key %u not found\n", tname, i);
+			exit(1);
+		}
+	}
+	report(tname, "random", "lookup", nb, 1);
+
+	for (i = 0; i < nb; i++) {
+		key = w64 ? rnd64() : (rnd64() & 0xffffffffULL);
+		beg = now_cycles();
+		if (quad && w64)
+			node = qb64_lookup_le(&qroot, key);
+		else if (quad)
+			node = qb32_lookup_le(&qroot, key);
+		else if (w64)
+			node = eb64_lookup_le(&root, key);
+		else
+			node = eb32_lookup_le(&root, key);
+		end = now_cycles();
+		sample(beg, end);
+	}
+	report(tname, "random", "lookup_le", nb, 1);
+
+	/* tree height, independent from the machine */
+	for (i = 0; i < nb; i++)
+		depth += quad_depth(&nodes[i], quad);
+	fprintf(stderr, "# %s,%u: %.2f levels per lookup\n", tname, nb, (double)depth / nb);
+
+	node = quad ? (w64 ? (void *)qb64_first(&qroot) : (void *)qb32_first(&qroot)) : (void *)eb_first(&root);
+	while (node) {
+		beg = now_cycles();
+		if (quad && w64)
+			node = qb64_next(node);
+		else if (quad)
+			node = qb32_next(node);
+		else
+			node = eb_next(node);
+		end = now_cycles();
+		sample(beg, end);
+	}
+	report(tname, "random", "walk", nb, 1);
+
+	for (i = 0; i < nb; i++) {
+		beg = now_cycles();
+		if (quad && w64)
+			qb64_delete(&qroot, &nodes[i].q64);
+		else if (quad)
+			qb32_delete(&qroot, &nodes[i].q32);
+		else
+			eb_delete(&nodes[i].e32.node);
+		end = now_cycles();
+		sample(beg, end);
+	}
+	report(tname, "random", "delete", nb, 1);
+
+	free(keys);
+	free(nodes);
+}
+
+/* returns non-zero if <name> is in comma-delimited list <list> */
+static int in_list(const char *list, const char *name)
+{
+	size_t len = strlen(name);
+
+	if (strcmp(list, "all") == 0)
+		return 1;
+
+	while (*list) {
+		if (strncmp(list, name, len) == 0 && (list[len] == ',' || !list[len]))
+			return 1;
+		list = strchr(list, ',');
+		if (!list)
+			break;
+		list++;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *tlist = "all", *wlist = "all";
+	unsigned int nb = 100000;
+	unsigned int t, w;
+	int header = 1;
+	int kernels = 0, arena = 0, quad = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:t:w:s:Hbkaq")) != -1) {
+		switch (opt) {
+		case 'n': nb = atoi(optarg); break;
+		case 't': tlist = optarg; break;
+		case 'w': wlist = optarg; break;
+		case 's': rnd_state = strtoull(optarg, NULL, 0) | 1; break;
+		case 'H': header = 0; break;
+		case 'b': batch_min = 1; batch_max = 64; break;
+		case 'k': kernels = 1; break;
+		case 'a': arena = 1; break;
+		case 'q': quad = 1; break;
+		default:
+			fprintf(stderr, "Usage: %s [-n nodes] [-t trees] [-w workloads] [-s seed] [-H] [-b] [-k] [-a] [-q]\n", argv[0]);
+			exit(1);
+		}
+	}
+
+	if (nb < BATCH)
+		nb = BATCH;
+
+	samples = malloc(nb * sizeof(*samples));
+	calibrate();
+
+	if (header)
+		printf("tree,workload,op,nodes,ops,cycles_per_op,ns_per_op,p50_ns,p99_ns\n");
+
+	if (kernels) {
+		run_kernels(nb);
+		return 0;
+	}
+
+	if (arena) {
+		for (w = 0; w < 2; w++)
+			for (t = 0; t < ALLOC_MODES; t++)
+				run_arena(w, t, nb);
+		return 0;
+	}
+
+	if (quad) {
+		/* both trees get the same keys */
+		unsigned long long seed = rnd_state;
+
+		for (w = 0; w < 2; w++) {
+			for (t = 0; t < 2; t++) {
+				rnd_state = seed;
+				run_quad(w, t, nb);
+			}
+		}
+		return 0;
+	}
+
+	for (w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+		if (!in_list(wlist, workloads[w].name))
+			continue;
+		for (t = 0; t < sizeof(trees) / sizeof(trees[0]); t++) {
+			if (!in_list(tlist, trees[t].name))
+				continue;
+			run(&trees[t], &workloads[w], nb);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,175 @@
+/*
+ * Elastic Binary Trees - exported functions for deferred trees.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult ebdefer.h for more details about those functions */
+
+#include <stdlib.h>
+#include "ebdefer.h"
+
+/* Initialize <defer> to apply deferred operations to <tree>, which holds
+ * <bits>-bit keys (32 or 64), by batches of at most <batch_size> operations
+ * stored into <batch>.
+ */
+void ebdefer_init(struct ebdefer *defer, struct ebshard *tree, unsigned int bits,
+                  struct ebdefer_op *batch, unsigned int batch_size)
+{
+	defer->tree = tree;
+	defer->logs = NULL;
+	defer->batch = batch;
+	defer->batch_size = batch_size;
+	defer->bits = bits;
+	defer->dropped = 0;
+}
+
+/* Register the log <log> of <size> operations stored into <ops> for <defer>.
+ * <size> must be a power of two. Logs cannot be unregistered, but an idle log
+ * costs nothing.
+ */
+void ebdefer_register(struct ebdefer *defer, struct ebdefer_log *log,
+                      struct ebdefer_op *ops, unsigned int size)
+{
+	log->head = log->tail = 0;
+	log->size = size;
+	log->ops = ops;
+	log->defer = defer;
+	log->next = __atomic_load_n(&defer->logs, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&defer->logs, &log->next, log, 0,
+	                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		;
+}
+
+/* orders operations by key, then by position in the batch (see below) */
+static int cmp_key(const void *a, const void *b)
+{
+	const struct ebdefer_op *x = a, *y = b;
+
+	if (x->key != y->key)
+		return x->key < y->key ? -1 : 1;
+	return x->type < y->type ? -1 : x->type > y->type;
+}
+
+/* Apply the <nb> operations of <defer>'s batch to its tree, whose lock must be
+ * held.
+ */
+static void ebdefer_apply(struct ebdefer *defer, unsigned int nb)
+{
+	struct ebdefer_op *batch = defer->batch;
+	struct eb_root *root = &defer->tree->root;
+	unsigned int i, ins;
+	int shift;
+
+	/* Unlink the queued nodes, which will be reinserted if their last
+	 * operation is an insert. Unlinked nodes do not use their node_p, so
+	 * it designates the node's last insert in the batch meanwhile.
+	 */
+	for (i = 0; i < nb; i++) {
+		__eb_delete(batch[i].node);
+		batch[i].node->node_p = (batch[i].type == EBDEFER_INSERT) ? (eb_troot_t *)&batch[i] : NULL;
+	}
+
+	/* Only inserts remain, so their type is replaced with their position
+	 * in the batch, which follows the order of each log. qsort()
+	 * is not stable, and equal keys must be inserted in this order so that
+	 * duplicates keep it, and so that the first one wins on a unique tree.
+	 */
+	for (i = ins = 0; i < nb; i++) {
+		if (batch[i].node->node_p == (eb_troot_t *)&batch[i]) {
+			batch[ins] = batch[i];
+			batch[ins].type = ins;
+			ins++;
+		}
+	}
+
+	/* Sorted keys are inserted starting from the previous one when they
+	 * share at least the upper half of the bits which differ across the
+	 * tree, since climbing from a distant key costs more than a descent
+	 * from the root.
+	 */
+	qsort(batch, ins, sizeof(*batch), cmp_key);
+	shift = 0;
+	if (eb_gettag(root->b[EB_LEFT]) == EB_NODE)
+		shift = (eb_root_to_node(eb_untag(root->b[EB_LEFT], EB_NODE))->bit + 1) / 2;
+
+	if (defer->bits == 64) {
+		struct eb64_node *prev = NULL, *node;
+
+		for (i = 0; i < ins; i++) {
+			node = container_of(batch[i].node, struct eb64_node, node);
+			node->key = batch[i].key;
+			if (prev && (prev->key ^ node->key) >> shift)
+				prev = NULL;
+			prev = __eb64_insert_from(root, prev, node);
+			defer->dropped += prev != node;
+		}
+	} else {
+		struct eb32_node *prev = NULL, *node;
+
+		for (i = 0; i < ins; i++) {
+			node = container_of(batch[i].node, struct eb32_node, node);
+			node->key = batch[i].key;
+			if (prev && (prev->key ^ node->key) >> shift)
+				prev = NULL;
+			prev = __eb32_insert_from(root, prev, node);
+			defer->dropped += prev != node;
+		}
+	}
+}
+
+/* Apply to <defer>'s tree all the operations logged by all threads before the
+ * call, and return their number. The operations logged meanwhile are left for
+ * the next call. The tree's lock is taken, and must not be held by the caller.
+ */
+unsigned int ebdefer_flush(struct ebdefer *defer)
+{
+	struct ebdefer_log *logs, *log;
+	unsigned int head, tail, nb, done = 0;
+	int more;
+
+	ebshard_lock(defer->tree);
+	logs = __atomic_load_n(&defer->logs, __ATOMIC_ACQUIRE);
+	for (log = logs; log; log = log->next)
+		log->stop = __atomic_load_n(&log->head, __ATOMIC_ACQUIRE);
+
+	do {
+		more = 0;
+		nb = 0;
+		for (log = logs; log; log = log->next) {
+			head = log->stop;
+			tail = log->tail;
+			while (tail != head && nb < defer->batch_size) {
+				defer->batch[nb++] = log->ops[tail & (log->size - 1)];
+				tail++;
+			}
+			__atomic_store_n(&log->tail, tail, __ATOMIC_RELEASE);
+			if (tail != head)
+				more = 1;
+		}
+		ebdefer_apply(defer, nb);
+		done += nb;
+	} while (more);
+	ebshard_unlock(defer->tree);
+	return done;
+}
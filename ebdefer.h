@@ -0,0 +1,153 @@
+/*
+ * Elastic Binary Trees - deferred updates of 32bit and 64bit trees.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+  A deferred tree lets many threads queue inserts and deletes into an eb32 or
+  eb64 tree without taking its lock for each of them. Each thread registers its
+  own log, a ring of pending operations that only it writes to, and appends its
+  operations there. They are applied to the tree by whichever thread calls
+  ebdefer_flush(), under the tree's lock, by batches :
+
+      struct ebdefer defer;
+      struct ebdefer_op batch[1024];
+      struct ebshard_root sr;
+      struct ebshard tree;
+
+      ebshard_init(&sr, &tree, 0, 0);
+      ebdefer_init(&defer, &tree, 32, batch, 1024);
+
+      (in each thread)
+      ebdefer_register(&defer, &log, ops, 256);
+      ebdefer_delete(&log, &node->node);
+      ebdefer_insert(&log, &node->node, new_key);
+
+      (in the thread needing up-to-date results, or periodically)
+      ebdefer_flush(&defer);
+      ebshard_lock(&tree);
+      node = eb32_lookup(&tree.root, key);
+      ebshard_unlock(&tree);
+
+  Within a batch, only the last operation on each node matters : a queued node
+  is first deleted, then the nodes to be inserted are sorted by key and each of
+  them is inserted starting from the previous one (see eb32_insert_from()), so
+  that close keys share most of their descent. The key to insert is part of the
+  operation and is only set into the node when it is applied, so the node
+  itself must not be touched outside of the tree's lock while it is known to
+  the tree. All the operations on a node must be made by the same thread. The
+  operations logged by any thread before a call to ebdefer_flush() are applied
+  when it returns. A thread whose log is full flushes it itself.
+
+  In a tree which only accepts unique keys (EB_ROOT_UNIQUE), an insert whose
+  key is already present, or is inserted earlier in the same batch, is dropped
+  like with eb32_insert() : the node is left unqueued (its leaf_p is NULL, which
+  the thread owning it may check under the tree's lock), and defer->dropped is
+  incremented.
+ */
+
+#ifndef _EBDEFER_H
+#define _EBDEFER_H
+
+#include "ebshard.h"
+
+/* operation types */
+#define EBDEFER_INSERT	0
+#define EBDEFER_DELETE	1
+
+/* A pending operation, with the key to insert */
+struct ebdefer_op {
+	struct eb_node *node;
+	u64 key;
+	unsigned int type;
+};
+
+/* A thread's log of pending operations, a ring of <size> entries which is only
+ * written to by its thread and only read from under the tree's lock. <head> and
+ * <tail> are free-running counters, so <size> must be a power of two.
+ */
+struct ebdefer_log {
+	unsigned int head;               /* next entry to write, set by the thread */
+	unsigned int size;
+	struct ebdefer_op *ops;
+	struct ebdefer *defer;
+	struct ebdefer_log *next;        /* next registered log */
+	ALWAYS_ALIGN(EBSHARD_ALIGN);
+	unsigned int tail;               /* next entry to apply, set by the flusher */
+	unsigned int stop;               /* end of the current flush */
+} ALIGNED(EBSHARD_ALIGN);
+
+/* A deferred tree of <bits>-bit keys (32 or 64) stored in <tree>, and the
+ * scratch array of <batch_size> operations used to apply batches.
+ */
+struct ebdefer {
+	struct ebshard *tree;
+	struct ebdefer_log *logs;
+	struct ebdefer_op *batch;
+	unsigned int batch_size;
+	unsigned int bits;
+	unsigned int dropped;            /* inserts dropped on a unique tree */
+};
+
+/*
+ * The following functions are not inlined by default. They are declared
+ * in ebdefer.c.
+ */
+void ebdefer_init(struct ebdefer *defer, struct ebshard *tree, unsigned int bits,
+                  struct ebdefer_op *batch, unsigned int batch_size);
+void ebdefer_register(struct ebdefer *defer, struct ebdefer_log *log,
+                      struct ebdefer_op *ops, unsigned int size);
+unsigned int ebdefer_flush(struct ebdefer *defer);
+
+/* Append the operation <type> on <node> with key <key> to the log <log>,
+ * flushing the tree first if the log is full.
+ */
+static inline void ebdefer_log_op(struct ebdefer_log *log, struct eb_node *node, u64 key, unsigned int type)
+{
+	unsigned int head = log->head;
+	struct ebdefer_op *op;
+
+	while (head - __atomic_load_n(&log->tail, __ATOMIC_ACQUIRE) >= log->size)
+		ebdefer_flush(log->defer);
+
+	op = &log->ops[head & (log->size - 1)];
+	op->node = node;
+	op->key = key;
+	op->type = type;
+	__atomic_store_n(&log->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/* Queue the insertion of <node> into the tree with the key <key> */
+static inline void ebdefer_insert(struct ebdefer_log *log, struct eb_node *node, u64 key)
+{
+	ebdefer_log_op(log, node, key, EBDEFER_INSERT);
+}
+
+/* Queue the deletion of <node> from the tree */
+static inline void ebdefer_delete(struct ebdefer_log *log, struct eb_node *node)
+{
+	ebdefer_log_op(log, node, 0, EBDEFER_DELETE);
+}
+
+#endif /* _EBDEFER_H */
@@ -0,0 +1,364 @@
+/*
+ * Elastic Binary Trees - macros and structures for operations on float nodes.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+  These trees index float keys (ebf32) and double keys (ebf64, see
+  ebf64tree.h) in their numerical order, without requiring the caller to map
+  them to integers first. Keys are compared by their bit patterns after an
+  order-preserving transformation: the sign bit is flipped for positive values
+  and all bits are flipped for negative ones, which is done without any branch
+  by xoring the key with its sign extended to the whole word, and with the
+  sign bit. This places the keys in the IEEE-754 total order :
+
+      -NaN < -inf < ... < -1.0 < ... < -0.0 < +0.0 < ... < 1.0 < ... < +inf < +NaN
+
+  Thus -0.0 and +0.0 are distinct keys, -0.0 being placed immediately before
+  +0.0, and NaNs are placed at the ends of the tree depending on their sign.
+  NaNs of different payloads are distinct keys too. Callers who want -0.0 to
+  match 0.0 may simply add 0.0 to their keys, and lookup_le()/lookup_ge()
+  naturally return one or the other when looking up a zero.
+
+  The transformation does not change the highest bit which differs between
+  two keys : for keys of opposite signs it is the sign bit before and after,
+  and keys of the same sign are xored with the same value so their xor is
+  unchanged. Since the tree only splits keys on this bit, it has exactly the
+  same shape as an eb32/eb64 tree of the transformed keys. The
+  transformation is only needed to pick a branch during the descent, and it
+  is applied once to the looked up key. The nodes' keys are only transformed
+  when comparing them for order at the end of the descent.
+*/
+
+#ifndef _EBF32TREE_H
+#define _EBF32TREE_H
+
+#include "ebtree.h"
+#include "eb32tree.h"
+
+
+/* Return the structure of type <type> whose member <member> points to <ptr> */
+#define ebf32_entry(ptr, type, member) container_of(ptr, type, member)
+
+#define EBF32_ROOT	EB_ROOT
+#define EBF32_TREE_HEAD	EB_TREE_HEAD
+
+/* This structure carries a node, a leaf, and a float key. It must start with
+ * the eb_node so that it can be cast into an eb_node.
+ */
+struct ebf32_node {
+	struct eb_node node; /* the tree node, must be at the beginning */
+	MAYBE_ALIGN(sizeof(float));
+	float key;
+} ALIGNED(sizeof(void*));
+
+/*
+ * Exported functions and macros.
+ * Many of them are always inlined because they are extremely small, and
+ * are generally called at most once or twice in a program.
+ */
+
+/* Return leftmost node in the tree, or NULL if none */
+static inline struct ebf32_node *ebf32_first(struct eb_root *root)
+{
+	return ebf32_entry(eb_first(root), struct ebf32_node, node);
+}
+
+/* Return rightmost node in the tree, or NULL if none */
+static inline struct ebf32_node *ebf32_last(struct eb_root *root)
+{
+	return ebf32_entry(eb_last(root), struct ebf32_node, node);
+}
+
+/* Return next node in the tree, or NULL if none */
+static inline struct ebf32_node *ebf32_next(struct ebf32_node *ebf32)
+{
+	return ebf32_entry(eb_next(&ebf32->node), struct ebf32_node, node);
+}
+
+/* Return previous node in the tree, or NULL if none */
+static inline struct ebf32_node *ebf32_prev(struct ebf32_node *ebf32)
+{
+	return ebf32_entry(eb_prev(&ebf32->node), struct ebf32_node, node);
+}
+
+/* Return next leaf node within a duplicate sub-tree, or NULL if none. */
+static inline struct ebf32_node *ebf32_next_dup(struct ebf32_node *ebf32)
+{
+	return ebf32_entry(eb_next_dup(&ebf32->node), struct ebf32_node, node);
+}
+
+/* Return previous leaf node within a duplicate sub-tree, or NULL if none. */
+static inline struct ebf32_node *ebf32_prev_dup(struct ebf32_node *ebf32)
+{
+	return ebf32_entry(eb_prev_dup(&ebf32->node), struct ebf32_node, node);
+}
+
+/* Return next node in the tree, skipping duplicates, or NULL if none */
+static inline struct ebf32_node *ebf32_next_unique(struct ebf32_node *ebf32)
+{
+	return ebf32_entry(eb_next_unique(&ebf32->node), struct ebf32_node, node);
+}
+
+/* Return previous node in the tree, skipping duplicates, or NULL if none */
+static inline struct ebf32_node *ebf32_prev_unique(struct ebf32_node *ebf32)
+{
+	return ebf32_entry(eb_prev_unique(&ebf32->node), struct ebf32_node, node);
+}
+
+/* Delete node from the tree if it was linked in. Mark the node unused. Note
+ * that this function relies on a non-inlined generic function: eb_delete.
+ */
+static inline void ebf32_delete(struct ebf32_node *ebf32)
+{
+	eb_delete(&ebf32->node);
+}
+
+/* Detach and return the leftmost node of the tree, or NULL if none */
+static inline struct ebf32_node *ebf32_pick_first(struct eb_root *root)
+{
+	return ebf32_entry(eb_pick_first(root), struct ebf32_node, node);
+}
+
+/* Detach and return the rightmost node of the tree, or NULL if none */
+static inline struct ebf32_node *ebf32_pick_last(struct eb_root *root)
+{
+	return ebf32_entry(eb_pick_last(root), struct ebf32_node, node);
+}
+
+/*
+ * The following functions are not inlined by default. They are declared
+ * in ebf32tree.c, which simply relies on their inline version.
+ */
+struct ebf32_node *ebf32_lookup(struct eb_root *root, float x);
+struct ebf32_node *ebf32_lookup_le(struct eb_root *root, float x);
+struct ebf32_node *ebf32_lookup_ge(struct eb_root *root, float x);
+struct ebf32_node *ebf32_insert(struct eb_root *root, struct ebf32_node *new);
+
+/*
+ * The following functions are less likely to be used directly, because their
+ * code is larger. The non-inlined version is preferred.
+ */
+
+/* Returns the bit pattern of float <x> */
+static forceinline u32 __ebf32_bits(float x)
+{
+	union { float f; u32 u; } v;
+
+	v.f = x;
+	return v.u;
+}
+
+/* Returns the order-preserving image of bit pattern <b> of a float, that is,
+ * <b> with only its sign bit flipped if it is positive, or all its bits
+ * flipped if it is negative.
+ */
+static forceinline u32 __ebf32_order(u32 b)
+{
+	return b ^ ((u32)((s32)b >> 31) | 0x80000000U);
+}
+
+/* Delete node from the tree if it was linked in. Mark the node unused. */
+static forceinline void __ebf32_delete(struct ebf32_node *ebf32)
+{
+	__eb_delete(&ebf32->node);
+}
+
+/*
+ * Find the first occurence of a key in the tree <root>. If none can be
+ * found, return NULL. The key is compared by its bit pattern, so -0.0 does
+ * not match 0.0, and a NaN matches the same NaN.
+ */
+static forceinline struct ebf32_node *__ebf32_lookup(struct eb_root *root, float x)
+{
+	struct ebf32_node *node;
+	eb_troot_t *troot;
+	u32 bits = __ebf32_bits(x);
+	u32 key = __ebf32_order(bits);
+	u32 y;
+	int node_bit;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	while (1) {
+		if ((eb_gettag(troot) == EB_LEAF)) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebf32_node, node.branches);
+			if (__ebf32_bits(node->key) == bits)
+				return node;
+			else
+				return NULL;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct ebf32_node, node.branches);
+		node_bit = node->node.bit;
+
+		y = __ebf32_bits(node->key) ^ bits;
+		if (!y) {
+			/* Either we found the node which holds the key, or
+			 * we have a dup tree. In the later case, we have to
+			 * walk it down left to get the first entry.
+			 */
+			if (node_bit < 0) {
+				troot = node->node.branches.b[EB_LEFT];
+				while (eb_gettag(troot) != EB_LEAF)
+					troot = (eb_untag(troot, EB_NODE))->b[EB_LEFT];
+				node = container_of(eb_untag(troot, EB_LEAF),
+						    struct ebf32_node, node.branches);
+			}
+			return node;
+		}
+
+		if ((y >> node_bit) >= EB_NODE_BRANCHES)
+			return NULL; /* no more common bits */
+
+		troot = node->node.branches.b[(key >> node_bit) & EB_NODE_BRANCH_MASK];
+	}
+}
+
+/* Insert ebf32_node <new> into subtree starting at node root <root>.
+ * Only new->key needs be set with the key. The ebf32_node is returned.
+ * If root->b[EB_RGHT]==1, the tree may only contain unique keys.
+ */
+static forceinline struct ebf32_node *
+__ebf32_insert(struct eb_root *root, struct ebf32_node *new) {
+	struct ebf32_node *old;
+	unsigned int side;
+	eb_troot_t *troot, **up_ptr;
+	u32 newbits, oldbits;
+	u32 newkey; /* caching the key saves approximately one cycle */
+	eb_troot_t *root_right;
+	eb_troot_t *new_left, *new_rght;
+	eb_troot_t *new_leaf;
+	int old_node_bit;
+
+	side = EB_LEFT;
+	troot = root->b[EB_LEFT];
+	root_right = root->b[EB_RGHT];
+	if (unlikely(troot == NULL)) {
+		/* Tree is empty, insert the leaf part below the left branch */
+		new->node.leaf_p = eb_dotag(root, EB_LEFT);
+		new->node.node_p = NULL; /* node part unused */
+		eb_publish(&root->b[EB_LEFT], eb_dotag(&new->node.branches, EB_LEAF));
+		return new;
+	}
+
+	/* The tree descent is the same as in __eb32i_insert(), except that
+	 * <newkey> carries the order-preserving image of the key, which is
+	 * only used to pick branches. Differing bits are the same on the
+	 * keys and on their images.
+	 */
+	newbits = __ebf32_bits(new->key);
+	newkey = __ebf32_order(newbits);
+
+	while (1) {
+		if (eb_gettag(troot) == EB_LEAF) {
+			/* insert above a leaf */
+			old = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebf32_node, node.branches);
+			new->node.node_p = old->node.leaf_p;
+			up_ptr = &old->node.leaf_p;
+			break;
+		}
+
+		/* OK we're walking down this link */
+		old = container_of(eb_untag(troot, EB_NODE),
+				    struct ebf32_node, node.branches);
+		old_node_bit = old->node.bit;
+
+		/* Stop going down when we don't have common bits anymore. We
+		 * also stop in front of a duplicates tree because it means we
+		 * have to insert above.
+		 */
+
+		if ((old_node_bit < 0) || /* we're above a duplicate tree, stop here */
+		    (((newbits ^ __ebf32_bits(old->key)) >> old_node_bit) >= EB_NODE_BRANCHES)) {
+			/* The tree did not contain the key, so we insert <new> before the node
+			 * <old>, and set ->bit to designate the lowest bit position in <new>
+			 * which applies to ->branches.b[].
+			 */
+			new->node.node_p = old->node.node_p;
+			up_ptr = &old->node.node_p;
+			break;
+		}
+
+		/* walk down */
+		root = &old->node.branches;
+		side = (newkey >> old_node_bit) & EB_NODE_BRANCH_MASK;
+		troot = root->b[side];
+	}
+
+	new_left = eb_dotag(&new->node.branches, EB_LEFT);
+	new_rght = eb_dotag(&new->node.branches, EB_RGHT);
+	new_leaf = eb_dotag(&new->node.branches, EB_LEAF);
+	oldbits = __ebf32_bits(old->key);
+
+	/* note that if EB_NODE_BITS > 1, we should check that it's still >= 0 */
+	new->node.bit = flsnz(newbits ^ oldbits) - EB_NODE_BITS;
+
+	if (newbits == oldbits) {
+		new->node.bit = -1; /* mark as new dup tree, just in case */
+
+		if (likely(eb_gettag(root_right))) {
+			/* we refuse to duplicate this key if the tree is
+			 * tagged as containing only unique keys.
+			 */
+			return old;
+		}
+
+		if (eb_gettag(troot) != EB_LEAF) {
+			/* there was already a dup tree below */
+			struct eb_node *ret;
+			ret = eb_insert_dup(&old->node, &new->node);
+			return container_of(ret, struct ebf32_node, node);
+		}
+		/* otherwise fall through */
+	}
+
+	if (newkey >= __ebf32_order(oldbits)) {
+		new->node.branches.b[EB_LEFT] = troot;
+		new->node.branches.b[EB_RGHT] = new_leaf;
+		new->node.leaf_p = new_rght;
+		eb_publish(up_ptr, new_left);
+	}
+	else {
+		new->node.branches.b[EB_LEFT] = new_leaf;
+		new->node.branches.b[EB_RGHT] = troot;
+		new->node.leaf_p = new_left;
+		eb_publish(up_ptr, new_rght);
+	}
+
+	/* Ok, now we are inserting <new> between <root> and <old>. <old>'s
+	 * parent is already set to <new>, and the <root>'s branch is still in
+	 * <side>.
+	 */
+
+	eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+	__eb_count_update(new->node.leaf_p);
+	return new;
+}
+
+#endif /* _EBF32_TREE_H */
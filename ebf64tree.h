@@ -0,0 +1,342 @@
+/*
+ * Elastic Binary Trees - macros and structures for operations on double nodes.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* These trees index double keys in their IEEE-754 total order. They work
+ * exactly like the ebf32 trees, whose principle is described in ebf32tree.h.
+ */
+
+#ifndef _EBF64TREE_H
+#define _EBF64TREE_H
+
+#include "ebtree.h"
+#include "eb64tree.h"
+
+
+/* Return the structure of type <type> whose member <member> points to <ptr> */
+#define ebf64_entry(ptr, type, member) container_of(ptr, type, member)
+
+#define EBF64_ROOT	EB_ROOT
+#define EBF64_TREE_HEAD	EB_TREE_HEAD
+
+/* This structure carries a node, a leaf, and a double key. It must start with
+ * the eb_node so that it can be cast into an eb_node.
+ */
+struct ebf64_node {
+	struct eb_node node; /* the tree node, must be at the beginning */
+	MAYBE_ALIGN(sizeof(double));
+	ALWAYS_ALIGN(sizeof(void*));
+	double key;
+} ALIGNED(sizeof(void*));
+
+/*
+ * Exported functions and macros.
+ * Many of them are always inlined because they are extremely small, and
+ * are generally called at most once or twice in a program.
+ */
+
+/* Return leftmost node in the tree, or NULL if none */
+static inline struct ebf64_node *ebf64_first(struct eb_root *root)
+{
+	return ebf64_entry(eb_first(root), struct ebf64_node, node);
+}
+
+/* Return rightmost node in the tree, or NULL if none */
+static inline struct ebf64_node *ebf64_last(struct eb_root *root)
+{
+	return ebf64_entry(eb_last(root), struct ebf64_node, node);
+}
+
+/* Return next node in the tree, or NULL if none */
+static inline struct ebf64_node *ebf64_next(struct ebf64_node *ebf64)
+{
+	return ebf64_entry(eb_next(&ebf64->node), struct ebf64_node, node);
+}
+
+/* Return previous node in the tree, or NULL if none */
+static inline struct ebf64_node *ebf64_prev(struct ebf64_node *ebf64)
+{
+	return ebf64_entry(eb_prev(&ebf64->node), struct ebf64_node, node);
+}
+
+/* Return next leaf node within a duplicate sub-tree, or NULL if none. */
+static inline struct ebf64_node *ebf64_next_dup(struct ebf64_node *ebf64)
+{
+	return ebf64_entry(eb_next_dup(&ebf64->node), struct ebf64_node, node);
+}
+
+/* Return previous leaf node within a duplicate sub-tree, or NULL if none. */
+static inline struct ebf64_node *ebf64_prev_dup(struct ebf64_node *ebf64)
+{
+	return ebf64_entry(eb_prev_dup(&ebf64->node), struct ebf64_node, node);
+}
+
+/* Return next node in the tree, skipping duplicates, or NULL if none */
+static inline struct ebf64_node *ebf64_next_unique(struct ebf64_node *ebf64)
+{
+	return ebf64_entry(eb_next_unique(&ebf64->node), struct ebf64_node, node);
+}
+
+/* Return previous node in the tree, skipping duplicates, or NULL if none */
+static inline struct ebf64_node *ebf64_prev_unique(struct ebf64_node *ebf64)
+{
+	return ebf64_entry(eb_prev_unique(&ebf64->node), struct ebf64_node, node);
+}
+
+/* Delete node from the tree if it was linked in. Mark the node unused. Note
+ * that this function relies on a non-inlined generic function: eb_delete.
+ */
+static inline void ebf64_delete(struct ebf64_node *ebf64)
+{
+	eb_delete(&ebf64->node);
+}
+
+/* Detach and return the leftmost node of the tree, or NULL if none */
+static inline struct ebf64_node *ebf64_pick_first(struct eb_root *root)
+{
+	return ebf64_entry(eb_pick_first(root), struct ebf64_node, node);
+}
+
+/* Detach and return the rightmost node of the tree, or NULL if none */
+static inline struct ebf64_node *ebf64_pick_last(struct eb_root *root)
+{
+	return ebf64_entry(eb_pick_last(root), struct ebf64_node, node);
+}
+
+/*
+ * The following functions are not inlined by default. They are declared
+ * in ebf64tree.c, which simply relies on their inline version.
+ */
+struct ebf64_node *ebf64_lookup(struct eb_root *root, double x);
+struct ebf64_node *ebf64_lookup_le(struct eb_root *root, double x);
+struct ebf64_node *ebf64_lookup_ge(struct eb_root *root, double x);
+struct ebf64_node *ebf64_insert(struct eb_root *root, struct ebf64_node *new);
+
+/*
+ * The following functions are less likely to be used directly, because their
+ * code is larger. The non-inlined version is preferred.
+ */
+
+/* Returns the bit pattern of double <x> */
+static forceinline u64 __ebf64_bits(double x)
+{
+	union { double f; u64 u; } v;
+
+	v.f = x;
+	return v.u;
+}
+
+/* Returns the order-preserving image of bit pattern <b> of a double, that is,
+ * <b> with only its sign bit flipped if it is positive, or all its bits
+ * flipped if it is negative.
+ */
+static forceinline u64 __ebf64_order(u64 b)
+{
+	return b ^ ((u64)((s64)b >> 63) | (1ULL << 63));
+}
+
+/* Delete node from the tree if it was linked in. Mark the node unused. */
+static forceinline void __ebf64_delete(struct ebf64_node *ebf64)
+{
+	__eb_delete(&ebf64->node);
+}
+
+/*
+ * Find the first occurence of a key in the tree <root>. If none can be
+ * found, return NULL. The key is compared by its bit pattern, so -0.0 does
+ * not match 0.0, and a NaN matches the same NaN.
+ */
+static forceinline struct ebf64_node *__ebf64_lookup(struct eb_root *root, double x)
+{
+	struct ebf64_node *node;
+	eb_troot_t *troot;
+	u64 bits = __ebf64_bits(x);
+	u64 key = __ebf64_order(bits);
+	u64 y;
+	int node_bit;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	while (1) {
+		if ((eb_gettag(troot) == EB_LEAF)) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebf64_node, node.branches);
+			if (__ebf64_bits(node->key) == bits)
+				return node;
+			else
+				return NULL;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct ebf64_node, node.branches);
+		node_bit = node->node.bit;
+
+		y = __ebf64_bits(node->key) ^ bits;
+		if (!y) {
+			/* Either we found the node which holds the key, or
+			 * we have a dup tree. In the later case, we have to
+			 * walk it down left to get the first entry.
+			 */
+			if (node_bit < 0) {
+				troot = node->node.branches.b[EB_LEFT];
+				while (eb_gettag(troot) != EB_LEAF)
+					troot = (eb_untag(troot, EB_NODE))->b[EB_LEFT];
+				node = container_of(eb_untag(troot, EB_LEAF),
+						    struct ebf64_node, node.branches);
+			}
+			return node;
+		}
+
+		if ((y >> node_bit) >= EB_NODE_BRANCHES)
+			return NULL; /* no more common bits */
+
+		troot = node->node.branches.b[(key >> node_bit) & EB_NODE_BRANCH_MASK];
+	}
+}
+
+/* Insert ebf64_node <new> into subtree starting at node root <root>.
+ * Only new->key needs be set with the key. The ebf64_node is returned.
+ * If root->b[EB_RGHT]==1, the tree may only contain unique keys.
+ */
+static forceinline struct ebf64_node *
+__ebf64_insert(struct eb_root *root, struct ebf64_node *new) {
+	struct ebf64_node *old;
+	unsigned int side;
+	eb_troot_t *troot, **up_ptr;
+	u64 newbits, oldbits;
+	u64 newkey; /* caching the key saves approximately one cycle */
+	eb_troot_t *root_right;
+	eb_troot_t *new_left, *new_rght;
+	eb_troot_t *new_leaf;
+	int old_node_bit;
+
+	side = EB_LEFT;
+	troot = root->b[EB_LEFT];
+	root_right = root->b[EB_RGHT];
+	if (unlikely(troot == NULL)) {
+		/* Tree is empty, insert the leaf part below the left branch */
+		new->node.leaf_p = eb_dotag(root, EB_LEFT);
+		new->node.node_p = NULL; /* node part unused */
+		eb_publish(&root->b[EB_LEFT], eb_dotag(&new->node.branches, EB_LEAF));
+		return new;
+	}
+
+	/* The tree descent is the same as in __eb64i_insert(), except that
+	 * <newkey> carries the order-preserving image of the key, which is
+	 * only used to pick branches. Differing bits are the same on the
+	 * keys and on their images.
+	 */
+	newbits = __ebf64_bits(new->key);
+	newkey = __ebf64_order(newbits);
+
+	while (1) {
+		if (eb_gettag(troot) == EB_LEAF) {
+			/* insert above a leaf */
+			old = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebf64_node, node.branches);
+			new->node.node_p = old->node.leaf_p;
+			up_ptr = &old->node.leaf_p;
+			break;
+		}
+
+		/* OK we're walking down this link */
+		old = container_of(eb_untag(troot, EB_NODE),
+				    struct ebf64_node, node.branches);
+		old_node_bit = old->node.bit;
+
+		/* Stop going down when we don't have common bits anymore. We
+		 * also stop in front of a duplicates tree because it means we
+		 * have to insert above.
+		 */
+
+		if ((old_node_bit < 0) || /* we're above a duplicate tree, stop here */
+		    (((newbits ^ __ebf64_bits(old->key)) >> old_node_bit) >= EB_NODE_BRANCHES)) {
+			/* The tree did not contain the key, so we insert <new> before the node
+			 * <old>, and set ->bit to designate the lowest bit position in <new>
+			 * which applies to ->branches.b[].
+			 */
+			new->node.node_p = old->node.node_p;
+			up_ptr = &old->node.node_p;
+			break;
+		}
+
+		/* walk down */
+		root = &old->node.branches;
+		side = (newkey >> old_node_bit) & EB_NODE_BRANCH_MASK;
+		troot = root->b[side];
+	}
+
+	new_left = eb_dotag(&new->node.branches, EB_LEFT);
+	new_rght = eb_dotag(&new->node.branches, EB_RGHT);
+	new_leaf = eb_dotag(&new->node.branches, EB_LEAF);
+	oldbits = __ebf64_bits(old->key);
+
+	/* note that if EB_NODE_BITS > 1, we should check that it's still >= 0 */
+	new->node.bit = fls64(newbits ^ oldbits) - EB_NODE_BITS;
+
+	if (newbits == oldbits) {
+		new->node.bit = -1; /* mark as new dup tree, just in case */
+
+		if (likely(eb_gettag(root_right))) {
+			/* we refuse to duplicate this key if the tree is
+			 * tagged as containing only unique keys.
+			 */
+			return old;
+		}
+
+		if (eb_gettag(troot) != EB_LEAF) {
+			/* there was already a dup tree below */
+			struct eb_node *ret;
+			ret = eb_insert_dup(&old->node, &new->node);
+			return container_of(ret, struct ebf64_node, node);
+		}
+		/* otherwise fall through */
+	}
+
+	if (newkey >= __ebf64_order(oldbits)) {
+		new->node.branches.b[EB_LEFT] = troot;
+		new->node.branches.b[EB_RGHT] = new_leaf;
+		new->node.leaf_p = new_rght;
+		eb_publish(up_ptr, new_left);
+	}
+	else {
+		new->node.branches.b[EB_LEFT] = new_leaf;
+		new->node.branches.b[EB_RGHT] = troot;
+		new->node.leaf_p = new_left;
+		eb_publish(up_ptr, new_rght);
+	}
+
+	/* Ok, now we are inserting <new> between <root> and <old>. <old>'s
+	 * parent is already set to <new>, and the <root>'s branch is still in
+	 * <side>.
+	 */
+
+	eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+	__eb_count_update(new->node.leaf_p);
+	return new;
+}
+
+#endif /* _EBF64_TREE_H */
@@ -0,0 +1,488 @@
+/*
+ * Elastic Binary Trees - frozen snapshots of trees.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult ebfreeze.h for more details about those functions */
+
+#include <stdlib.h>
+#include <string.h>
+#include "ebfreeze.h"
+
+/* a prefix of a prefix tree, while freezing it */
+struct ebmb_frozen_pfx {
+	struct ebmb_node *node;
+	const unsigned char *start;   /* first key covered by the prefix */
+	unsigned int pfx;             /* prefix length in bits */
+	unsigned int order;           /* position in the tree */
+	unsigned int len;             /* key length in bytes */
+};
+
+/* Assigns the ranks of the keys to the slots of the blocks of a static B-tree
+ * of <blocks> blocks of <b> keys, starting at block <k> and rank *<r>, which
+ * is updated. The keys are assigned in order, block <k>'s key <i> following
+ * all the keys of its child <i> and preceeding those of child <i+1>. Slots past
+ * the last key are assigned rank <nb>.
+ */
+static void eb_frozen_layout(unsigned int *rank, unsigned int b, size_t blocks, size_t k,
+			     unsigned int *r, unsigned int nb)
+{
+	unsigned int i;
+
+	if (k >= blocks)
+		return;
+
+	for (i = 0; i < b; i++) {
+		eb_frozen_layout(rank, b, blocks, k * (b + 1) + i + 1, r, nb);
+		rank[k * b + i] = *r < nb ? (*r)++ : nb;
+	}
+	eb_frozen_layout(rank, b, blocks, k * (b + 1) + b + 1, r, nb);
+}
+
+/* Allocates the cache line aligned area of a snapshot of <nb> keys stored in
+ * blocks of <b> keys of <ksize> bytes, followed by their ranks, and by <extra>
+ * zeroed bytes. The number of blocks is set in <blocks>, and the ranks are
+ * assigned. Returns the area, or NULL if memory is exhausted.
+ */
+static void *eb_frozen_alloc(unsigned int nb, unsigned int b, size_t ksize, size_t extra,
+			     unsigned int *blocks)
+{
+	unsigned int *rank;
+	unsigned int r = 0;
+	size_t slots, size;
+	void *area;
+
+	*blocks = (nb + b - 1) / b;
+	slots = (size_t)*blocks * b;
+	size = slots * (ksize + sizeof(*rank)) + extra + 1;
+	if (posix_memalign(&area, EB_FROZEN_LINE, size))
+		return NULL;
+
+	memset(area, 0, size);
+
+	rank = (unsigned int *)((char *)area + slots * ksize);
+	eb_frozen_layout(rank, b, *blocks, 0, &r, nb);
+	return area;
+}
+
+/* Returns a snapshot of the eb32 tree <root>, or NULL if memory is exhausted */
+struct eb32_frozen *eb32_freeze(struct eb_root *root)
+{
+	struct eb32_node *node, *next;
+	struct eb32_frozen *f;
+	unsigned int nb = 0, r, slot;
+	unsigned int *rank;
+	u32 *keys;
+	void *area;
+
+	for (node = eb32_first(root); node; node = next) {
+		next = eb32_next(node);
+		nb += !next || next->key != node->key;
+	}
+
+	f = malloc(sizeof(*f));
+	if (!f)
+		return NULL;
+
+	area = eb_frozen_alloc(nb, EB32_FROZEN_KEYS, sizeof(*keys), 2 * nb * sizeof(*f->first), &f->blocks);
+	if (!area) {
+		free(f);
+		return NULL;
+	}
+
+	keys = area;
+	rank = (unsigned int *)(keys + f->blocks * EB32_FROZEN_KEYS);
+	f->first = (struct eb32_node **)(rank + f->blocks * EB32_FROZEN_KEYS);
+	f->last = f->first + nb;
+	f->keys = keys;
+	f->rank = rank;
+	f->nb = nb;
+
+	r = 0;
+	for (node = eb32_first(root); node; node = next) {
+		next = eb32_next(node);
+		if (!f->first[r])
+			f->first[r] = node;
+		if (!next || next->key != node->key)
+			f->last[r++] = node;
+	}
+
+	for (slot = 0; slot < f->blocks * EB32_FROZEN_KEYS; slot++)
+		keys[slot] = rank[slot] < nb ? f->first[rank[slot]]->key : ~(u32)0;
+	return f;
+}
+
+/* Returns a snapshot of the eb64 tree <root>, or NULL if memory is exhausted */
+struct eb64_frozen *eb64_freeze(struct eb_root *root)
+{
+	struct eb64_node *node, *next;
+	struct eb64_frozen *f;
+	unsigned int nb = 0, r, slot;
+	unsigned int *rank;
+	u64 *keys;
+	void *area;
+
+	for (node = eb64_first(root); node; node = next) {
+		next = eb64_next(node);
+		nb += !next || next->key != node->key;
+	}
+
+	f = malloc(sizeof(*f));
+	if (!f)
+		return NULL;
+
+	area = eb_frozen_alloc(nb, EB64_FROZEN_KEYS, sizeof(*keys), 2 * nb * sizeof(*f->first), &f->blocks);
+	if (!area) {
+		free(f);
+		return NULL;
+	}
+
+	keys = area;
+	rank = (unsigned int *)(keys + f->blocks * EB64_FROZEN_KEYS);
+	f->first = (struct eb64_node **)(rank + f->blocks * EB64_FROZEN_KEYS);
+	f->last = f->first + nb;
+	f->keys = keys;
+	f->rank = rank;
+	f->nb = nb;
+
+	r = 0;
+	for (node = eb64_first(root); node; node = next) {
+		next = eb64_next(node);
+		if (!f->first[r])
+			f->first[r] = node;
+		if (!next || next->key != node->key)
+			f->last[r++] = node;
+	}
+
+	for (slot = 0; slot < f->blocks * EB64_FROZEN_KEYS; slot++)
+		keys[slot] = rank[slot] < nb ? f->first[rank[slot]]->key : ~(u64)0;
+	return f;
+}
+
+/* Allocates an ebmb snapshot of <nb> keys of <len> bytes. Its <full> and
+ * <first> arrays must then be filled, and its blocks built using
+ * ebmb_frozen_fill(). Returns NULL if memory is exhausted.
+ */
+static struct ebmb_frozen *ebmb_frozen_alloc(unsigned int nb, unsigned int len, int prefix)
+{
+	struct ebmb_frozen *f;
+	size_t ptrs = prefix ? nb : 2 * nb;
+	unsigned int *rank;
+	void *area;
+
+	f = malloc(sizeof(*f));
+	if (!f)
+		return NULL;
+
+	area = eb_frozen_alloc(nb, EB64_FROZEN_KEYS, sizeof(u64),
+			       ptrs * sizeof(*f->first) + (size_t)nb * len, &f->blocks);
+	if (!area) {
+		free(f);
+		return NULL;
+	}
+
+	rank = (unsigned int *)((u64 *)area + f->blocks * EB64_FROZEN_KEYS);
+	f->keys = area;
+	f->rank = rank;
+	f->first = (struct ebmb_node **)(rank + f->blocks * EB64_FROZEN_KEYS);
+	f->last = prefix ? NULL : f->first + nb;
+	f->full = (unsigned char *)(f->first + ptrs);
+	f->nb = nb;
+	f->len = len;
+	f->prefix = prefix;
+	return f;
+}
+
+/* Fills the blocks of snapshot <f> with the first bytes of its sorted keys */
+static void ebmb_frozen_fill(struct ebmb_frozen *f)
+{
+	u64 *keys = (u64 *)f->keys;
+	unsigned int slot;
+
+	for (slot = 0; slot < f->blocks * EB64_FROZEN_KEYS; slot++)
+		keys[slot] = f->rank[slot] < f->nb ?
+			__ebmb_frozen_prefix(f->full + (size_t)f->rank[slot] * f->len, f->len) : ~0ULL;
+}
+
+/* Returns a snapshot of the ebmb tree <root> of keys of <len> bytes, or NULL if
+ * memory is exhausted.
+ */
+struct ebmb_frozen *ebmb_freeze(struct eb_root *root, unsigned int len)
+{
+	struct ebmb_node *node, *next;
+	struct ebmb_frozen *f;
+	unsigned int nb = 0, r;
+
+	for (node = ebmb_first(root); node; node = next) {
+		next = ebmb_next(node);
+		nb += !next || memcmp(next->key, node->key, len) != 0;
+	}
+
+	f = ebmb_frozen_alloc(nb, len, 0);
+	if (!f)
+		return NULL;
+
+	r = 0;
+	for (node = ebmb_first(root); node; node = next) {
+		next = ebmb_next(node);
+		if (!f->first[r])
+			f->first[r] = node;
+		if (!next || memcmp(next->key, node->key, len) != 0) {
+			memcpy((unsigned char *)f->full + (size_t)r * len, node->key, len);
+			f->last[r++] = node;
+		}
+	}
+
+	ebmb_frozen_fill(f);
+	return f;
+}
+
+/* Sorts prefixes by first covered key, then by length, then by position in the
+ * tree, so that enclosing prefixes come first.
+ */
+static int ebmb_frozen_cmp_pfx(const void *a, const void *b)
+{
+	const struct ebmb_frozen_pfx *pa = a, *pb = b;
+	int ret = memcmp(pa->start, pb->start, pa->len);
+
+	if (ret)
+		return ret;
+	if (pa->pfx != pb->pfx)
+		return pa->pfx < pb->pfx ? -1 : 1;
+	return pa->order < pb->order ? -1 : pa->order > pb->order;
+}
+
+/* Copies key <key> of <len> bytes to <out> with all bits past <pfx> set to
+ * <fill> (0 or 1).
+ */
+static void ebmb_frozen_mask(unsigned char *out, const unsigned char *key, unsigned int len,
+			     unsigned int pfx, int fill)
+{
+	unsigned int i;
+	unsigned char mask;
+
+	for (i = 0; i < len; i++) {
+		if (i * 8 + 8 <= pfx)
+			mask = 0xff;
+		else if (i * 8 >= pfx)
+			mask = 0;
+		else
+			mask = 0xff << (8 - (pfx - i * 8));
+		out[i] = (key[i] & mask) | (fill ? ~mask : 0);
+	}
+}
+
+/* Sets <out> to the range boundary <key> of <len> bytes plus one. Returns zero
+ * if it overflows.
+ */
+static int ebmb_frozen_next(unsigned char *out, const unsigned char *key, unsigned int len)
+{
+	unsigned int i = len;
+
+	memcpy(out, key, len);
+	while (i--) {
+		if (++out[i])
+			return 1;
+	}
+	return 0;
+}
+
+/* Appends boundary <b> of <len> bytes starting a range where <node> is the
+ * longest matching prefix to the <*nb> boundaries in <full> and <nodes>. A
+ * boundary equal to the last one replaces it, and ranges with the same node
+ * are merged.
+ */
+static void ebmb_frozen_emit(unsigned char *full, struct ebmb_node **nodes, unsigned int *nb,
+			     const unsigned char *b, unsigned int len, struct ebmb_node *node)
+{
+	if (*nb && memcmp(full + (size_t)(*nb - 1) * len, b, len) == 0) {
+		nodes[*nb - 1] = node;
+		if (*nb > 1 && nodes[*nb - 2] == node)
+			(*nb)--;
+		return;
+	}
+	if (*nb && nodes[*nb - 1] == node)
+		return;
+	memcpy(full + (size_t)*nb * len, b, len);
+	nodes[(*nb)++] = node;
+}
+
+/* Returns a snapshot of the prefix tree <root> of keys of <len> bytes for use
+ * with ebmb_frozen_lookup_longest(), or NULL if memory is exhausted.
+ */
+struct ebmb_frozen *ebmb_freeze_prefix(struct eb_root *root, unsigned int len)
+{
+	struct ebmb_frozen_pfx *pfx = NULL;
+	struct ebmb_node **nodes = NULL, **stack_node = NULL;
+	unsigned char *starts = NULL, *full = NULL, *stack_end = NULL, *bound = NULL;
+	struct ebmb_frozen *f = NULL;
+	struct ebmb_node *node;
+	unsigned int nb = 0, i, j, sp, out;
+
+	for (node = ebmb_first(root); node; node = ebmb_next(node))
+		nb++;
+
+	/* each prefix may start a range and end one, and up to len*8+1 prefixes
+	 * may be nested.
+	 */
+	pfx        = malloc((nb + 1) * sizeof(*pfx));
+	starts     = malloc((size_t)(nb + 1) * len);
+	nodes      = malloc((2 * nb + 1) * sizeof(*nodes));
+	full       = malloc((size_t)(2 * nb + 1) * len + 1);
+	stack_node = malloc((len * 8 + 1) * sizeof(*stack_node));
+	stack_end  = malloc((size_t)(len * 8 + 1) * len + 1);
+	bound      = malloc(len + 1);
+	if (!pfx || !starts || !nodes || !full || !stack_node || !stack_end || !bound)
+		goto out;
+
+	for (i = 0, node = ebmb_first(root); node; node = ebmb_next(node), i++) {
+		pfx[i].node = node;
+		pfx[i].start = starts + (size_t)i * len;
+		pfx[i].pfx = node->node.pfx;
+		pfx[i].order = i;
+		pfx[i].len = len;
+		ebmb_frozen_mask(starts + (size_t)i * len, node->key, len, node->node.pfx, 0);
+	}
+	qsort(pfx, nb, sizeof(*pfx), ebmb_frozen_cmp_pfx);
+
+	/* sweep over the sorted prefixes, keeping the enclosing ones on a stack */
+	memset(bound, 0, len);
+	out = 0;
+	ebmb_frozen_emit(full, nodes, &out, bound, len, NULL);
+	for (i = sp = 0; i < nb; i++) {
+		if (i && pfx[i].pfx == pfx[i - 1].pfx && memcmp(pfx[i].start, pfx[i - 1].start, len) == 0)
+			continue; /* duplicate, the first one is returned */
+
+		/* close the prefixes ending before this one */
+		while (sp && memcmp(stack_end + (size_t)(sp - 1) * len, pfx[i].start, len) < 0) {
+			sp--;
+			ebmb_frozen_next(bound, stack_end + (size_t)sp * len, len);
+			ebmb_frozen_emit(full, nodes, &out, bound, len, sp ? stack_node[sp - 1] : NULL);
+		}
+		ebmb_frozen_mask(stack_end + (size_t)sp * len, pfx[i].start, len, pfx[i].pfx, 1);
+		stack_node[sp++] = pfx[i].node;
+		ebmb_frozen_emit(full, nodes, &out, pfx[i].start, len, pfx[i].node);
+	}
+
+	/* close the remaining ones, unless they reach the end */
+	while (sp) {
+		sp--;
+		if (!ebmb_frozen_next(bound, stack_end + (size_t)sp * len, len))
+			break;
+		ebmb_frozen_emit(full, nodes, &out, bound, len, sp ? stack_node[sp - 1] : NULL);
+	}
+
+	f = ebmb_frozen_alloc(out, len, 1);
+	if (!f)
+		goto out;
+
+	memcpy((unsigned char *)f->full, full, (size_t)out * len);
+	for (j = 0; j < out; j++)
+		f->first[j] = nodes[j];
+	ebmb_frozen_fill(f);
+ out:
+	free(bound);
+	free(stack_end);
+	free(stack_node);
+	free(full);
+	free(nodes);
+	free(starts);
+	free(pfx);
+	return f;
+}
+
+/* Release snapshots, the nodes they reference are not affected */
+void eb32_frozen_free(struct eb32_frozen *f)
+{
+	if (f) {
+		free((void *)f->keys);
+		free(f);
+	}
+}
+
+void eb64_frozen_free(struct eb64_frozen *f)
+{
+	if (f) {
+		free((void *)f->keys);
+		free(f);
+	}
+}
+
+void ebmb_frozen_free(struct ebmb_frozen *f)
+{
+	if (f) {
+		free((void *)f->keys);
+		free(f);
+	}
+}
+
+struct eb32_node *eb32_frozen_lookup(const struct eb32_frozen *f, u32 x)
+{
+	return __eb32_frozen_lookup(f, x);
+}
+
+struct eb32_node *eb32_frozen_lookup_le(const struct eb32_frozen *f, u32 x)
+{
+	return __eb32_frozen_lookup_le(f, x);
+}
+
+struct eb32_node *eb32_frozen_lookup_ge(const struct eb32_frozen *f, u32 x)
+{
+	return __eb32_frozen_lookup_ge(f, x);
+}
+
+struct eb64_node *eb64_frozen_lookup(const struct eb64_frozen *f, u64 x)
+{
+	return __eb64_frozen_lookup(f, x);
+}
+
+struct eb64_node *eb64_frozen_lookup_le(const struct eb64_frozen *f, u64 x)
+{
+	return __eb64_frozen_lookup_le(f, x);
+}
+
+struct eb64_node *eb64_frozen_lookup_ge(const struct eb64_frozen *f, u64 x)
+{
+	return __eb64_frozen_lookup_ge(f, x);
+}
+
+struct ebmb_node *ebmb_frozen_lookup(const struct ebmb_frozen *f, const void *x)
+{
+	return __ebmb_frozen_lookup(f, x);
+}
+
+struct ebmb_node *ebmb_frozen_lookup_le(const struct ebmb_frozen *f, const void *x)
+{
+	return __ebmb_frozen_lookup_le(f, x);
+}
+
+struct ebmb_node *ebmb_frozen_lookup_ge(const struct ebmb_frozen *f, const void *x)
+{
+	return __ebmb_frozen_lookup_ge(f, x);
+}
+
+struct ebmb_node *ebmb_frozen_lookup_longest(const struct ebmb_frozen *f, const void *x)
+{
+	return __ebmb_frozen_lookup_longest(f, x);
+}
@@ -0,0 +1,307 @@
+/*
+ * Elastic Binary Trees - frozen snapshots of trees.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+  A frozen snapshot is an immutable copy of the keys of an eb32, eb64 or ebmb
+  tree, laid out for lookups to touch as few cache lines as possible. It suits
+  trees which are rarely modified but very often looked up, such as ACLs or
+  maps, which can be rebuilt and frozen again on each change :
+
+      snap = eb32_freeze(&root);
+      node = eb32_frozen_lookup(snap, key);
+      ...
+      eb32_frozen_free(snap);
+
+  The distinct keys are stored in a static B-tree made of blocks of one cache
+  line each (16 keys for eb32, 8 for eb64 and ebmb), which is searched from its
+  root to a leaf. Block <k>'s children are blocks k*(B+1)+1 to k*(B+1)+B+1,
+  and its keys separate them, so no pointer is needed. A lookup thus visits
+  log(n)/log(B+1) blocks (4 for one million keys), instead of one node per
+  level in the tree. It then reads the rank of the matching key, and the node
+  itself. The keys of ebmb snapshots are represented by their first 8 bytes,
+  and the keys sharing them are compared in full using a sorted array.
+
+  The lookup functions return the same nodes as their tree counterparts, which
+  means the first duplicate for exact and ge lookups, and the last one for le
+  lookups. A snapshot references the tree's nodes, which must neither be freed
+  nor have their keys changed as long as it is used, though they may be removed
+  from the tree. Snapshots are read-only, and may thus be looked up by any
+  number of threads without locking.
+
+  ebmb_freeze_prefix() freezes a prefix tree (built using ebmb_insert_prefix())
+  for ebmb_frozen_lookup_longest(). The prefixes are converted into the sorted
+  list of the boundaries of the key ranges where the longest matching prefix
+  changes, each with the node to return (or NULL), so that the lookup is a
+  simple search of the last boundary below the key. Such a snapshot may only
+  be used with ebmb_frozen_lookup_longest(), and the other ones may not.
+ */
+
+#ifndef _EBFREEZE_H
+#define _EBFREEZE_H
+
+#include "eb32tree.h"
+#include "eb64tree.h"
+#include "ebmbtree.h"
+
+#define EB_FROZEN_LINE      64                      /* block size */
+#define EB32_FROZEN_KEYS    (EB_FROZEN_LINE / 4)    /* keys per eb32 block */
+#define EB64_FROZEN_KEYS    (EB_FROZEN_LINE / 8)    /* keys per eb64/ebmb block */
+
+struct eb32_frozen {
+	const u32 *keys;              /* <blocks> blocks of keys, padded with ~0 */
+	const unsigned int *rank;     /* rank of each key of <keys>, <nb> for padding */
+	struct eb32_node **first;     /* first node of each distinct key */
+	struct eb32_node **last;      /* last node of each distinct key */
+	unsigned int nb;              /* number of distinct keys */
+	unsigned int blocks;          /* number of blocks */
+};
+
+struct eb64_frozen {
+	const u64 *keys;              /* <blocks> blocks of keys, padded with ~0 */
+	const unsigned int *rank;     /* rank of each key of <keys>, <nb> for padding */
+	struct eb64_node **first;     /* first node of each distinct key */
+	struct eb64_node **last;      /* last node of each distinct key */
+	unsigned int nb;              /* number of distinct keys */
+	unsigned int blocks;          /* number of blocks */
+};
+
+struct ebmb_frozen {
+	const u64 *keys;              /* first 8 bytes of the keys, big endian */
+	const unsigned int *rank;     /* rank of each key of <keys>, <nb> for padding */
+	const unsigned char *full;    /* <nb> sorted keys of <len> bytes */
+	struct ebmb_node **first;     /* first node of each key, or range's node */
+	struct ebmb_node **last;      /* last node of each key, NULL for prefixes */
+	unsigned int nb;              /* number of distinct keys or ranges */
+	unsigned int blocks;          /* number of blocks */
+	unsigned int len;             /* key length in bytes */
+	unsigned int prefix;          /* non-zero if made by ebmb_freeze_prefix() */
+};
+
+/* Returns the rank of the first key of <f> equal to or greater than <x>, or
+ * f->nb if there is none. In each block, the number of keys lower than <x>
+ * designates both the first candidate key and the child to visit, which only
+ * holds keys lower than this candidate. The last candidate is thus the best.
+ */
+static forceinline unsigned int __eb32_frozen_rank(const struct eb32_frozen *f, u32 x)
+{
+	const u32 *blk;
+	size_t k = 0, slot = ~(size_t)0;
+	unsigned int i, j;
+
+	while (k < f->blocks) {
+		blk = f->keys + k * EB32_FROZEN_KEYS;
+		for (i = j = 0; j < EB32_FROZEN_KEYS; j++)
+			i += blk[j] < x;
+		if (i < EB32_FROZEN_KEYS)
+			slot = k * EB32_FROZEN_KEYS + i;
+		k = k * (EB32_FROZEN_KEYS + 1) + i + 1;
+	}
+	return slot == ~(size_t)0 ? f->nb : f->rank[slot];
+}
+
+/* Same as above for eb64 and ebmb snapshots, which both use 64-bit keys */
+static forceinline unsigned int __eb64_frozen_rank(const u64 *keys, const unsigned int *rank,
+						   unsigned int blocks, unsigned int nb, u64 x)
+{
+	const u64 *blk;
+	size_t k = 0, slot = ~(size_t)0;
+	unsigned int i, j;
+
+	while (k < blocks) {
+		blk = keys + k * EB64_FROZEN_KEYS;
+		for (i = j = 0; j < EB64_FROZEN_KEYS; j++)
+			i += blk[j] < x;
+		if (i < EB64_FROZEN_KEYS)
+			slot = k * EB64_FROZEN_KEYS + i;
+		k = k * (EB64_FROZEN_KEYS + 1) + i + 1;
+	}
+	return slot == ~(size_t)0 ? nb : rank[slot];
+}
+
+/* Returns the first 8 bytes of key <x> of <len> bytes as a big endian integer,
+ * padded with zeroes if the key is shorter.
+ */
+static forceinline u64 __ebmb_frozen_prefix(const unsigned char *x, unsigned int len)
+{
+	u64 v = 0;
+	unsigned int i;
+
+	for (i = 0; i < 8; i++)
+		v = (v << 8) | (i < len ? x[i] : 0);
+	return v;
+}
+
+/* Returns the rank of the first key of <f> equal to or greater than <x> if
+ * <gt> is zero, or greater than <x> otherwise, or f->nb if there is none. The
+ * keys sharing their first 8 bytes with <x> are compared in full.
+ */
+static forceinline unsigned int __ebmb_frozen_rank(const struct ebmb_frozen *f, const unsigned char *x, int gt)
+{
+	u64 xp = __ebmb_frozen_prefix(x, f->len);
+	unsigned int lo, hi, mid;
+
+	lo = __eb64_frozen_rank(f->keys, f->rank, f->blocks, f->nb, xp);
+	if (lo == f->nb || __ebmb_frozen_prefix(f->full + (size_t)lo * f->len, f->len) != xp)
+		return lo;
+
+	/* some keys share the same first bytes, look for the first one which is
+	 * not lower (or not lower or equal) among them.
+	 */
+	hi = (xp == ~0ULL) ? f->nb : __eb64_frozen_rank(f->keys, f->rank, f->blocks, f->nb, xp + 1);
+	while (lo < hi) {
+		int cmp;
+
+		mid = (lo + hi) / 2;
+		cmp = memcmp(f->full + (size_t)mid * f->len, x, f->len);
+		if (cmp < 0 || (gt && cmp == 0))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Returns the first node of the snapshot <f> of an eb32 tree whose key is <x>,
+ * or NULL if not found.
+ */
+static forceinline struct eb32_node *__eb32_frozen_lookup(const struct eb32_frozen *f, u32 x)
+{
+	unsigned int r = __eb32_frozen_rank(f, x);
+
+	if (r < f->nb && f->first[r]->key == x)
+		return f->first[r];
+	return NULL;
+}
+
+/* Returns the last node of the highest key in the snapshot <f> of an eb32 tree
+ * which is equal to or less than <x>, or NULL if none matches.
+ */
+static forceinline struct eb32_node *__eb32_frozen_lookup_le(const struct eb32_frozen *f, u32 x)
+{
+	unsigned int r = (x == ~(u32)0) ? f->nb : __eb32_frozen_rank(f, x + 1);
+
+	return r ? f->last[r - 1] : NULL;
+}
+
+/* Returns the first node of the lowest key in the snapshot <f> of an eb32 tree
+ * which is equal to or greater than <x>, or NULL if none matches.
+ */
+static forceinline struct eb32_node *__eb32_frozen_lookup_ge(const struct eb32_frozen *f, u32 x)
+{
+	unsigned int r = __eb32_frozen_rank(f, x);
+
+	return r < f->nb ? f->first[r] : NULL;
+}
+
+/* Same as __eb32_frozen_lookup() for eb64 snapshots */
+static forceinline struct eb64_node *__eb64_frozen_lookup(const struct eb64_frozen *f, u64 x)
+{
+	unsigned int r = __eb64_frozen_rank(f->keys, f->rank, f->blocks, f->nb, x);
+
+	if (r < f->nb && f->first[r]->key == x)
+		return f->first[r];
+	return NULL;
+}
+
+/* Same as __eb32_frozen_lookup_le() for eb64 snapshots */
+static forceinline struct eb64_node *__eb64_frozen_lookup_le(const struct eb64_frozen *f, u64 x)
+{
+	unsigned int r = (x == ~(u64)0) ? f->nb : __eb64_frozen_rank(f->keys, f->rank, f->blocks, f->nb, x + 1);
+
+	return r ? f->last[r - 1] : NULL;
+}
+
+/* Same as __eb32_frozen_lookup_ge() for eb64 snapshots */
+static forceinline struct eb64_node *__eb64_frozen_lookup_ge(const struct eb64_frozen *f, u64 x)
+{
+	unsigned int r = __eb64_frozen_rank(f->keys, f->rank, f->blocks, f->nb, x);
+
+	return r < f->nb ? f->first[r] : NULL;
+}
+
+/* Returns the first node of the snapshot <f> of an ebmb tree whose key is <x>,
+ * or NULL if not found.
+ */
+static forceinline struct ebmb_node *__ebmb_frozen_lookup(const struct ebmb_frozen *f, const void *x)
+{
+	unsigned int r = __ebmb_frozen_rank(f, x, 0);
+
+	if (r < f->nb && memcmp(f->first[r]->key, x, f->len) == 0)
+		return f->first[r];
+	return NULL;
+}
+
+/* Returns the last node of the highest key in the snapshot <f> of an ebmb tree
+ * which is equal to or less than <x>, or NULL if none matches.
+ */
+static forceinline struct ebmb_node *__ebmb_frozen_lookup_le(const struct ebmb_frozen *f, const void *x)
+{
+	unsigned int r = __ebmb_frozen_rank(f, x, 1);
+
+	return r ? f->last[r - 1] : NULL;
+}
+
+/* Returns the first node of the lowest key in the snapshot <f> of an ebmb tree
+ * which is equal to or greater than <x>, or NULL if none matches.
+ */
+static forceinline struct ebmb_node *__ebmb_frozen_lookup_ge(const struct ebmb_frozen *f, const void *x)
+{
+	unsigned int r = __ebmb_frozen_rank(f, x, 0);
+
+	return r < f->nb ? f->first[r] : NULL;
+}
+
+/* Returns the node with the longest prefix matching <x> in the snapshot <f> of
+ * a prefix tree, or NULL if none matches.
+ */
+static forceinline struct ebmb_node *__ebmb_frozen_lookup_longest(const struct ebmb_frozen *f, const void *x)
+{
+	unsigned int r = __ebmb_frozen_rank(f, x, 1);
+
+	/* the first boundary is always zero, so r > 0 */
+	return f->first[r - 1];
+}
+
+/* The following functions are not inlined by default */
+struct eb32_frozen *eb32_freeze(struct eb_root *root);
+struct eb64_frozen *eb64_freeze(struct eb_root *root);
+struct ebmb_frozen *ebmb_freeze(struct eb_root *root, unsigned int len);
+struct ebmb_frozen *ebmb_freeze_prefix(struct eb_root *root, unsigned int len);
+void eb32_frozen_free(struct eb32_frozen *f);
+void eb64_frozen_free(struct eb64_frozen *f);
+void ebmb_frozen_free(struct ebmb_frozen *f);
+struct eb32_node *eb32_frozen_lookup(const struct eb32_frozen *f, u32 x);
+struct eb32_node *eb32_frozen_lookup_le(const struct eb32_frozen *f, u32 x);
+struct eb32_node *eb32_frozen_lookup_ge(const struct eb32_frozen *f, u32 x);
+struct eb64_node *eb64_frozen_lookup(const struct eb64_frozen *f, u64 x);
+struct eb64_node *eb64_frozen_lookup_le(const struct eb64_frozen *f, u64 x);
+struct eb64_node *eb64_frozen_lookup_ge(const struct eb64_frozen *f, u64 x);
+struct ebmb_node *ebmb_frozen_lookup(const struct ebmb_frozen *f, const void *x);
+struct ebmb_node *ebmb_frozen_lookup_le(const struct ebmb_frozen *f, const void *x);
+struct ebmb_node *ebmb_frozen_lookup_ge(const struct ebmb_frozen *f, const void *x);
+struct ebmb_node *ebmb_frozen_lookup_longest(const struct ebmb_frozen *f, const void *x);
+
+#endif /* _EBFREEZE_H */
@@ -0,0 +1,250 @@
+/*
+ * Elastic Binary Trees - persistent images of ebmb/ebst trees.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult ebimage.h for more details about those functions */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ebimage.h"
+
+/* Associates a node of the source tree with its position in the image */
+struct ebm_image_pos {
+	const struct ebmb_node *node;
+	size_t pos;
+};
+
+static int ebm_image_cmp_pos(const void *a, const void *b)
+{
+	const struct ebmb_node *na = ((const struct ebm_image_pos *)a)->node;
+	const struct ebmb_node *nb = ((const struct ebm_image_pos *)b)->node;
+
+	return (na > nb) - (na < nb);
+}
+
+/* Returns the key length of node <node> for keys of <len> bytes, or
+ * zero-terminated strings if <len> is zero.
+ */
+static size_t ebm_image_key_len(const struct ebmb_node *node, unsigned int len)
+{
+	if (!len)
+		return strlen((const char *)node->key) + 1;
+	return len;
+}
+
+/* Returns the size of node <node> in the image, see ebm_image_key_len() */
+static size_t ebm_image_node_size(const struct ebmb_node *node, unsigned int len)
+{
+	return (sizeof(struct ebmdb_node) + ebm_image_key_len(node, len) + 3) & ~(size_t)3;
+}
+
+/* Returns the tagged pointer in image <img> corresponding to tagged pointer
+ * <troot> from the tree <root>, whose <nb> nodes are sorted in <pos>.
+ */
+static eb_troot_t *ebm_image_xlate(struct ebm_image *img, const struct eb_root *root,
+                                   const struct ebm_image_pos *pos, size_t nb,
+                                   eb_troot_t *troot)
+{
+	const struct eb_root *target = eb_clrtag(troot);
+	size_t l, r, m;
+
+	if (!target)
+		return troot;
+
+	if (target == root)
+		return eb_dotag((void *)&img->root, eb_gettag(troot));
+
+	/* nodes start with their branches, which is what is designated */
+	l = 0; r = nb;
+	while (l < r) {
+		m = (l + r) / 2;
+		if ((const void *)pos[m].node < (const void *)target)
+			l = m + 1;
+		else
+			r = m;
+	}
+	return eb_dotag((struct eb_root *)((char *)img + pos[l].pos), eb_gettag(troot));
+}
+
+/* Writes an image of tree <root> made of ebmb nodes with <len>-byte keys, or
+ * of zero-terminated strings if <len> is zero, to file descriptor <fd>. The
+ * tree is not modified. Returns 0 on success, or -1 with errno set.
+ */
+static int ebm_image_write(struct eb_root *root, unsigned int len, int fd)
+{
+	struct ebm_image_pos *pos = NULL;
+	struct ebm_image *img = NULL;
+	struct ebmb_node *node;
+	struct ebmdb_node *new;
+	size_t nb, size, i, done;
+	ssize_t ret;
+	int err;
+
+	/* first pass: count the nodes and measure the image */
+	nb = 0;
+	size = (sizeof(*img) + 3) & ~(size_t)3;
+	for (node = ebmb_first(root); node; node = ebmb_next(node)) {
+		size += ebm_image_node_size(node, len);
+		nb++;
+	}
+
+	if (size > 0x7fffffff) {
+		errno = EFBIG;
+		return -1;
+	}
+
+	pos = malloc(nb * sizeof(*pos) + 1);
+	img = calloc(1, size);
+	if (!pos || !img) {
+		err = ENOMEM;
+		goto fail;
+	}
+
+	/* second pass: assign the nodes' positions in key order */
+	i = 0;
+	size = (sizeof(*img) + 3) & ~(size_t)3;
+	for (node = ebmb_first(root); node; node = ebmb_next(node)) {
+		pos[i].node = node;
+		pos[i].pos = size;
+		size += ebm_image_node_size(node, len);
+		i++;
+	}
+
+	memcpy(img->magic, EBM_IMAGE_MAGIC, sizeof(img->magic));
+	img->keylen = len;
+	img->size = size;
+	img->nodes = nb;
+
+	/* third pass: copy the nodes and translate all links, which requires
+	 * to look the nodes up by their address.
+	 */
+	qsort(pos, nb, sizeof(*pos), ebm_image_cmp_pos);
+
+	__ebr_set(&img->root.b[EB_LEFT], ebm_image_xlate(img, root, pos, nb, root->b[EB_LEFT]), 4);
+	__ebr_set(&img->root.b[EB_RGHT], root->b[EB_RGHT], 4);
+
+	for (i = 0; i < nb; i++) {
+		new = (struct ebmdb_node *)((char *)img + pos[i].pos);
+		node = (struct ebmb_node *)pos[i].node;
+
+		memcpy(new->key, node->key, ebm_image_key_len(node, len));
+		new->node.pfx = node->node.pfx;
+		__ebr_set(&new->node.leaf_p, ebm_image_xlate(img, root, pos, nb, node->node.leaf_p), 4);
+
+		/* the branches of an unused node part are meaningless */
+		if (!node->node.node_p)
+			continue;
+
+		__ebr_set(&new->node.node_p, ebm_image_xlate(img, root, pos, nb, node->node.node_p), 4);
+		__ebr_set(&new->node.branches.b[EB_LEFT],
+			  ebm_image_xlate(img, root, pos, nb, node->node.branches.b[EB_LEFT]), 4);
+		__ebr_set(&new->node.branches.b[EB_RGHT],
+			  ebm_image_xlate(img, root, pos, nb, node->node.branches.b[EB_RGHT]), 4);
+		new->node.bit = node->node.bit;
+	}
+
+	for (done = 0; done < size; done += ret) {
+		ret = write(fd, (char *)img + done, size - done);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				ret = 0;
+				continue;
+			}
+			err = errno;
+			goto fail;
+		}
+	}
+
+	free(img);
+	free(pos);
+	return 0;
+ fail:
+	free(img);
+	free(pos);
+	errno = err;
+	return -1;
+}
+
+/* Writes an image of tree <root> made of ebmb nodes with <len>-byte keys to
+ * file descriptor <fd>. Returns 0 on success, or -1 with errno set.
+ */
+int ebmb_image_write(struct eb_root *root, unsigned int len, int fd)
+{
+	if (!len) {
+		errno = EINVAL;
+		return -1;
+	}
+	return ebm_image_write(root, len, fd);
+}
+
+/* Writes an image of tree <root> made of ebmb nodes with zero-terminated
+ * string keys (ebst) to file descriptor <fd>. Returns 0 on success, or -1
+ * with errno set.
+ */
+int ebst_image_write(struct eb_root *root, int fd)
+{
+	return ebm_image_write(root, 0, fd);
+}
+
+/* Maps read-only the image stored in file descriptor <fd>, which may be
+ * closed afterwards. Returns the image, whose tree is in ->root, or NULL with
+ * errno set. The image must be released using ebm_image_unmap().
+ */
+struct ebm_image *ebm_image_map(int fd)
+{
+	struct ebm_image *img;
+	struct stat st;
+
+	if (fstat(fd, &st) < 0)
+		return NULL;
+
+	if (st.st_size < (off_t)sizeof(*img)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	img = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (img == MAP_FAILED)
+		return NULL;
+
+	if (memcmp(img->magic, EBM_IMAGE_MAGIC, sizeof(img->magic)) != 0 ||
+	    img->size != (unsigned long long)st.st_size) {
+		munmap(img, st.st_size);
+		errno = EINVAL;
+		return NULL;
+	}
+	return img;
+}
+
+/* Unmaps image <img> previously mapped by ebm_image_map() */
+void ebm_image_unmap(struct ebm_image *img)
+{
+	munmap(img, img->size);
+}
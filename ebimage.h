@@ -0,0 +1,71 @@
+/*
+ * Elastic Binary Trees - persistent images of ebmb/ebst trees.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+  An image is a flat file holding a copy of an ebmb or ebst tree made of
+  medium relative nodes (see ebrtree.h) followed by their keys. Since relative
+  nodes do not contain any absolute address, the file can be mapped anywhere
+  and looked up directly, with no fixup nor allocation at load time. The same
+  pages may then be shared by all the processes mapping the same file :
+
+      img = ebm_image_map(fd);
+      node = ebmds_lookup(&img->root, "some string");
+
+  The lookup functions to use are ebmdb_lookup(), ebmdb_lookup_longest() and
+  ebmds_lookup(), which are the relative equivalents of ebmb_lookup(),
+  ebmb_lookup_longest() and ebst_lookup(). The mapping is read-only, so the
+  tree may not be modified. The nodes are exact copies of the original ones,
+  so duplicates, unique trees and prefix trees are preserved. An image may
+  not exceed 2 GB and uses the byte order of the machine which wrote it.
+ */
+
+#ifndef _EBIMAGE_H
+#define _EBIMAGE_H
+
+#include "ebmbtree.h"
+#include "ebrmbtree.h"
+#include "ebrsttree.h"
+
+#define EBM_IMAGE_MAGIC  "EBMIMG1"
+
+/* Image header, immediately followed by the nodes. Each node is an ebmdb_node
+ * followed by its key, and is aligned on 4 bytes.
+ */
+struct ebm_image {
+	char magic[8];              /* EBM_IMAGE_MAGIC */
+	unsigned int keylen;        /* key length in bytes, 0 for strings */
+	unsigned int reserved;      /* always zero for now */
+	unsigned long long size;    /* total image size in bytes */
+	unsigned long long nodes;   /* number of nodes in the tree */
+	struct ebm_root root;       /* the tree's root */
+};
+
+int ebmb_image_write(struct eb_root *root, unsigned int len, int fd);
+int ebst_image_write(struct eb_root *root, int fd);
+struct ebm_image *ebm_image_map(int fd);
+void ebm_image_unmap(struct ebm_image *img);
+
+#endif /* _EBIMAGE_H */
@@ -38,6 +38,30 @@ ebim_lookup(struct eb_root *root, const void *x, unsigned int len)
 	return __ebim_lookup(root, x, len);
 }
 
+/* Same as ebim_lookup() but also removes the node from the tree */
+struct ebpt_node *ebim_pick(struct eb_root *root, const void *x, unsigned int len)
+{
+	return __ebim_pick(root, x, len);
+}
+
+/* Find the last occurrence of the highest key in the tree <root> which is
+ * lower than or equal to <x>. The tree must only contain keys of <len> bytes. NULL is
+ * returned if no key matches.
+ */
+struct ebpt_node *ebim_lookup_le(struct eb_root *root, const void *x, unsigned int len)
+{
+	return __ebim_lookup_bound(root, x, len, 0);
+}
+
+/* Find the first occurrence of the lowest key in the tree <root> which is
+ * greater than or equal to <x>. The tree must only contain keys of <len> bytes. NULL is
+ * returned if no key matches.
+ */
+struct ebpt_node *ebim_lookup_ge(struct eb_root *root, const void *x, unsigned int len)
+{
+	return __ebim_lookup_bound(root, x, len, 1);
+}
+
 /* Insert ebpt_node <new> into subtree starting at node root <root>.
  * Only new->key needs be set with the key. The ebpt_node is returned.
  * If root->b[EB_RGHT]==1, the tree may only contain unique keys. The
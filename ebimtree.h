@@ -39,6 +39,9 @@
  * in ebimtree.c, which simply relies on their inline version.
  */
 struct ebpt_node *ebim_lookup(struct eb_root *root, const void *x, unsigned int len);
+struct ebpt_node *ebim_lookup_le(struct eb_root *root, const void *x, unsigned int len);
+struct ebpt_node *ebim_lookup_ge(struct eb_root *root, const void *x, unsigned int len);
+struct ebpt_node *ebim_pick(struct eb_root *root, const void *x, unsigned int len);
 struct ebpt_node *ebim_insert(struct eb_root *root, struct ebpt_node *new, unsigned int len);
 
 /* Find the first occurence of a key of a least <len> bytes matching <x> in the
@@ -134,6 +137,68 @@ __ebim_lookup(struct eb_root *root, const void *x, unsigned int len)
 	return NULL;
 }
 
+/* Find the last occurrence of the highest key of <len> bytes in the tree <root>
+ * which is lower than or equal to <x> if <ge> is zero, otherwise the first
+ * occurrence of the lowest key which is greater than or equal to <x>. The tree
+ * must only contain keys of <len> bytes inserted with ebim_insert(). Bits known
+ * to be equal are not compared again, and the descent stops on the first
+ * subtree which does not contain <x>. NULL is returned if no key matches.
+ */
+static forceinline struct ebpt_node *
+__ebim_lookup_bound(struct eb_root *root, const void *x, unsigned int len, int ge)
+{
+	struct ebpt_node *node;
+	eb_troot_t *troot;
+	size_t bit = 0;
+	int node_bit, side, cmp;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	while (1) {
+		if (eb_gettag(troot) == EB_LEAF) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebpt_node, node.branches);
+			cmp = memcmp((const unsigned char *)node->key, x, len);
+			break;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct ebpt_node, node.branches);
+
+		node_bit = node->node.bit;
+		if (node_bit < 0) {
+			/* a dup tree only holds equal keys */
+			cmp = memcmp((const unsigned char *)node->key, x, len);
+			break;
+		}
+
+		bit = equal_bits(x, (const unsigned char *)node->key, bit, node_bit);
+		if (bit < (size_t)node_bit) {
+			/* the whole subtree is on the same side of <x> */
+			cmp = cmp_bits((const unsigned char *)node->key, x, bit);
+			break;
+		}
+
+		side = (((const unsigned char *)x)[node_bit >> 3] >> (~node_bit & 7)) & 1;
+		troot = node->node.branches.b[side];
+	}
+	return ebpt_entry(__eb_lookup_bound(troot, cmp, ge), struct ebpt_node, node);
+}
+
+/* Find the first occurence of a key matching <x> like __ebim_lookup() does,
+ * and remove it from the tree. The node is returned, or NULL if none could be
+ * found.
+ */
+static forceinline struct ebpt_node *__ebim_pick(struct eb_root *root, const void *x, unsigned int len)
+{
+	struct ebpt_node *node = __ebim_lookup(root, x, len);
+
+	if (node)
+		__eb_delete(&node->node);
+	return node;
+}
+
 /* Insert ebpt_node <new> into subtree starting at node root <root>.
  * Only new->key needs be set with the key. The ebpt_node is returned.
  * If root->b[EB_RGHT]==1, the tree may only contain unique keys. The
@@ -145,6 +210,7 @@ __ebim_insert(struct eb_root *root, struct ebpt_node *new, unsigned int len)
 	struct ebpt_node *old;
 	unsigned int side;
 	eb_troot_t *troot;
+	eb_troot_t **up_ptr, *up_val;
 	eb_troot_t *root_right;
 	int diff;
 	int bit;
@@ -155,9 +221,9 @@ __ebim_insert(struct eb_root *root, struct ebpt_node *new, unsigned int len)
 	root_right = root->b[EB_RGHT];
 	if (unlikely(troot == NULL)) {
 		/* Tree is empty, insert the leaf part below the left branch */
-		root->b[EB_LEFT] = eb_dotag(&new->node.branches, EB_LEAF);
 		new->node.leaf_p = eb_dotag(root, EB_LEFT);
 		new->node.node_p = NULL; /* node part unused */
+		eb_publish(&root->b[EB_LEFT], eb_dotag(&new->node.branches, EB_LEAF));
 		return new;
 	}
 
@@ -218,7 +284,8 @@ __ebim_insert(struct eb_root *root, struct ebpt_node *new, unsigned int len)
 
 			if (diff < 0) {
 				new->node.leaf_p = new_left;
-				old->node.leaf_p = new_rght;
+				up_ptr = &old->node.leaf_p;
+				up_val = new_rght;
 				new->node.branches.b[EB_LEFT] = new_leaf;
 				new->node.branches.b[EB_RGHT] = old_leaf;
 			} else {
@@ -229,14 +296,17 @@ __ebim_insert(struct eb_root *root, struct ebpt_node *new, unsigned int len)
 					return old;
 
 				/* new->key >= old->key, new goes the right */
-				old->node.leaf_p = new_left;
+				up_ptr = &old->node.leaf_p;
+				up_val = new_left;
 				new->node.leaf_p = new_rght;
 				new->node.branches.b[EB_LEFT] = old_leaf;
 				new->node.branches.b[EB_RGHT] = new_leaf;
 
 				if (diff == 0) {
 					new->node.bit = -1;
-					root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+					eb_publish(up_ptr, up_val);
+					eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+					__eb_count_update(new->node.leaf_p);
 					return new;
 				}
 			}
@@ -289,12 +359,14 @@ __ebim_insert(struct eb_root *root, struct ebpt_node *new, unsigned int len)
 
 			if (diff < 0) {
 				new->node.leaf_p = new_left;
-				old->node.node_p = new_rght;
+				up_ptr = &old->node.node_p;
+				up_val = new_rght;
 				new->node.branches.b[EB_LEFT] = new_leaf;
 				new->node.branches.b[EB_RGHT] = old_node;
 			}
 			else if (diff > 0) {
-				old->node.node_p = new_left;
+				up_ptr = &old->node.node_p;
+				up_val = new_left;
 				new->node.leaf_p = new_rght;
 				new->node.branches.b[EB_LEFT] = old_node;
 				new->node.branches.b[EB_RGHT] = new_leaf;
@@ -314,16 +386,19 @@ __ebim_insert(struct eb_root *root, struct ebpt_node *new, unsigned int len)
 	}
 
 	/* Ok, now we are inserting <new> between <root> and <old>. <old>'s
-	 * parent is already set to <new>, and the <root>'s branch is still in
-	 * <side>. Update the root's leaf till we have it. Note that we can also
-	 * find the side by checking the side of new->node.node_p.
+	 * parent pointer is in <up_ptr> and will be set to <up_val>, and the
+	 * <root>'s branch is still in <side>. once <new> is complete,
+	 * these two links are published, parent first, so that concurrent readers
+	 * never reach a partially initialized node.
 	 */
 
 	/* We need the common higher bits between new->key and old->key.
 	 * This number of bits is already in <bit>.
 	 */
 	new->node.bit = bit;
-	root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+	eb_publish(up_ptr, up_val);
+	eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+	__eb_count_update(new->node.leaf_p);
 	return new;
 }
 
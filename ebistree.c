@@ -37,6 +37,30 @@ struct ebpt_node *ebis_lookup(struct eb_root *root, const char *x)
 	return __ebis_lookup(root, x);
 }
 
+/* Same as ebis_lookup() but also removes the node from the tree */
+struct ebpt_node *ebis_pick(struct eb_root *root, const char *x)
+{
+	return __ebis_pick(root, x);
+}
+
+/* Find the last occurrence of the highest key in the tree <root> which is
+ * lower than or equal to <x>. The tree must only contain zero-terminated strings. NULL is
+ * returned if no key matches.
+ */
+struct ebpt_node *ebis_lookup_le(struct eb_root *root, const char *x)
+{
+	return __ebis_lookup_bound(root, x, 0);
+}
+
+/* Find the first occurrence of the lowest key in the tree <root> which is
+ * greater than or equal to <x>. The tree must only contain zero-terminated strings. NULL is
+ * returned if no key matches.
+ */
+struct ebpt_node *ebis_lookup_ge(struct eb_root *root, const char *x)
+{
+	return __ebis_lookup_bound(root, x, 1);
+}
+
 /* Insert ebpt_node <new> into subtree starting at node root <root>. Only
  * new->key needs be set with the zero-terminated string key. The ebpt_node is
  * returned. If root->b[EB_RGHT]==1, the tree may only contain unique keys. The
@@ -42,6 +42,9 @@
  * in ebistree.c, which simply relies on their inline version.
  */
 struct ebpt_node *ebis_lookup(struct eb_root *root, const char *x);
+struct ebpt_node *ebis_lookup_le(struct eb_root *root, const char *x);
+struct ebpt_node *ebis_lookup_ge(struct eb_root *root, const char *x);
+struct ebpt_node *ebis_pick(struct eb_root *root, const char *x);
 struct ebpt_node *ebis_insert(struct eb_root *root, struct ebpt_node *new);
 
 /* Find the first occurence of a length <len> string <x> in the tree <root>.
@@ -137,6 +140,73 @@ static forceinline struct ebpt_node *__ebis_lookup(struct eb_root *root, const v
 	}
 }
 
+/* Find the last occurrence of the highest zero-terminated string in the tree
+ * <root> which is lower than or equal to <x> if <ge> is zero, otherwise the
+ * first occurrence of the lowest one which is greater than or equal to <x>.
+ * It's the caller's reponsibility to use this function only on trees which
+ * only contain zero-terminated strings. The descent stops on the first
+ * subtree which does not contain <x>. NULL is returned if no key matches.
+ */
+static forceinline struct ebpt_node *
+__ebis_lookup_bound(struct eb_root *root, const void *x, int ge)
+{
+	struct ebpt_node *node;
+	eb_troot_t *troot;
+	int bit = 0;
+	int node_bit, side, cmp;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	while (1) {
+		if (eb_gettag(troot) == EB_LEAF) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebpt_node, node.branches);
+			cmp = strcmp((const char *)(const unsigned char *)node->key, x);
+			break;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct ebpt_node, node.branches);
+
+		node_bit = node->node.bit;
+		if (node_bit < 0) {
+			/* a dup tree only holds equal keys */
+			cmp = strcmp((const char *)(const unsigned char *)node->key, x);
+			break;
+		}
+
+		bit = string_equal_bits(x, (const unsigned char *)node->key, bit);
+		if (bit >= 0 && bit < node_bit) {
+			/* the whole subtree is on the same side of <x> */
+			cmp = cmp_bits((const unsigned char *)node->key, x, bit);
+			break;
+		}
+
+		/* bit < 0 means <x> equals this node's key. In both cases, we
+		 * must bound the bit for the next comparisons, as explained
+		 * in __ebis_lookup().
+		 */
+		bit = node_bit;
+		side = (((const unsigned char *)x)[node_bit >> 3] >> (~node_bit & 7)) & 1;
+		troot = node->node.branches.b[side];
+	}
+	return ebpt_entry(__eb_lookup_bound(troot, cmp, ge), struct ebpt_node, node);
+}
+
+/* Find the first occurence of a key matching <x> like __ebis_lookup() does,
+ * and remove it from the tree. The node is returned, or NULL if none could be
+ * found.
+ */
+static forceinline struct ebpt_node *__ebis_pick(struct eb_root *root, const void *x)
+{
+	struct ebpt_node *node = __ebis_lookup(root, x);
+
+	if (node)
+		__eb_delete(&node->node);
+	return node;
+}
+
 /* Insert ebpt_node <new> into subtree starting at node root <root>. Only
  * new->key needs be set with the zero-terminated string key. The ebpt_node is
  * returned. If root->b[EB_RGHT]==1, the tree may only contain unique keys. The
@@ -148,6 +218,7 @@ __ebis_insert(struct eb_root *root, struct ebpt_node *new)
 	struct ebpt_node *old;
 	unsigned int side;
 	eb_troot_t *troot;
+	eb_troot_t **up_ptr, *up_val;
 	eb_troot_t *root_right;
 	int diff;
 	int bit;
@@ -158,9 +229,9 @@ __ebis_insert(struct eb_root *root, struct ebpt_node *new)
 	root_right = root->b[EB_RGHT];
 	if (unlikely(troot == NULL)) {
 		/* Tree is empty, insert the leaf part below the left branch */
-		root->b[EB_LEFT] = eb_dotag(&new->node.branches, EB_LEAF);
 		new->node.leaf_p = eb_dotag(root, EB_LEFT);
 		new->node.node_p = NULL; /* node part unused */
+		eb_publish(&root->b[EB_LEFT], eb_dotag(&new->node.branches, EB_LEAF));
 		return new;
 	}
 
@@ -220,12 +291,15 @@ __ebis_insert(struct eb_root *root, struct ebpt_node *new)
 					return old;
 
 				/* new arbitrarily goes to the right and tops the dup tree */
-				old->node.leaf_p = new_left;
+				up_ptr = &old->node.leaf_p;
+				up_val = new_left;
 				new->node.leaf_p = new_rght;
 				new->node.branches.b[EB_LEFT] = old_leaf;
 				new->node.branches.b[EB_RGHT] = new_leaf;
 				new->node.bit = -1;
-				root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+				eb_publish(up_ptr, up_val);
+				eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+				__eb_count_update(new->node.leaf_p);
 				return new;
 			}
 
@@ -233,12 +307,14 @@ __ebis_insert(struct eb_root *root, struct ebpt_node *new)
 			if (diff < 0) {
 				/* new->key < old->key, new takes the left */
 				new->node.leaf_p = new_left;
-				old->node.leaf_p = new_rght;
+				up_ptr = &old->node.leaf_p;
+				up_val = new_rght;
 				new->node.branches.b[EB_LEFT] = new_leaf;
 				new->node.branches.b[EB_RGHT] = old_leaf;
 			} else {
 				/* new->key > old->key, new takes the right */
-				old->node.leaf_p = new_left;
+				up_ptr = &old->node.leaf_p;
+				up_val = new_left;
 				new->node.leaf_p = new_rght;
 				new->node.branches.b[EB_LEFT] = old_leaf;
 				new->node.branches.b[EB_RGHT] = new_leaf;
@@ -298,12 +374,14 @@ __ebis_insert(struct eb_root *root, struct ebpt_node *new)
 			diff = cmp_bits(new->key, old->key, bit);
 			if (diff < 0) {
 				new->node.leaf_p = new_left;
-				old->node.node_p = new_rght;
+				up_ptr = &old->node.node_p;
+				up_val = new_rght;
 				new->node.branches.b[EB_LEFT] = new_leaf;
 				new->node.branches.b[EB_RGHT] = old_node;
 			}
 			else {
-				old->node.node_p = new_left;
+				up_ptr = &old->node.node_p;
+				up_val = new_left;
 				new->node.leaf_p = new_rght;
 				new->node.branches.b[EB_LEFT] = old_node;
 				new->node.branches.b[EB_RGHT] = new_leaf;
@@ -318,9 +396,10 @@ __ebis_insert(struct eb_root *root, struct ebpt_node *new)
 	}
 
 	/* Ok, now we are inserting <new> between <root> and <old>. <old>'s
-	 * parent is already set to <new>, and the <root>'s branch is still in
-	 * <side>. Update the root's leaf till we have it. Note that we can also
-	 * find the side by checking the side of new->node.node_p.
+	 * parent pointer is in <up_ptr> and will be set to <up_val>, and the
+	 * <root>'s branch is still in <side>. once <new> is complete,
+	 * these two links are published, parent first, so that concurrent readers
+	 * never reach a partially initialized node.
 	 */
 
 	/* We need the common higher bits between new->key and old->key.
@@ -328,7 +407,9 @@ __ebis_insert(struct eb_root *root, struct ebpt_node *new)
 	 * NOTE: we can't get here whit bit < 0 since we found a dup !
 	 */
 	new->node.bit = bit;
-	root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+	eb_publish(up_ptr, up_val);
+	eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+	__eb_count_update(new->node.leaf_p);
 	return new;
 }
 
@@ -37,21 +37,105 @@ ebmb_lookup(struct eb_root *root, const void *x, unsigned int len)
 	return __ebmb_lookup(root, x, len);
 }
 
+/* Same as ebmb_lookup() but also removes the node from the tree */
+struct ebmb_node *ebmb_pick(struct eb_root *root, const void *x, unsigned int len)
+{
+	return __ebmb_pick(root, x, len);
+}
+
+/* Find the last occurrence of the highest key in the tree <root> which is
+ * lower than or equal to <x>. The tree must only contain keys of <len> bytes. NULL is
+ * returned if no key matches.
+ */
+EB_MULTIVERSION
+struct ebmb_node *ebmb_lookup_le(struct eb_root *root, const void *x, unsigned int len)
+{
+	return __ebmb_lookup_bound(root, x, len, 0);
+}
+
+/* Find the first occurrence of the lowest key in the tree <root> which is
+ * greater than or equal to <x>. The tree must only contain keys of <len> bytes. NULL is
+ * returned if no key matches.
+ */
+EB_MULTIVERSION
+struct ebmb_node *ebmb_lookup_ge(struct eb_root *root, const void *x, unsigned int len)
+{
+	return __ebmb_lookup_bound(root, x, len, 1);
+}
+
+#ifdef EB_COUNT
+/* Return the number of keys of <len> bytes lower than <x> in the tree <root>,
+ * which is also the position of the first key greater than or equal to <x>.
+ */
+unsigned int ebmb_rank(struct eb_root *root, const void *x, unsigned int len)
+{
+	return __ebmb_rank(root, x, len, 0);
+}
+
+/* Return the number of keys of <len> bytes between <min> and <max> inclusive
+ * in the tree <root>.
+ */
+unsigned int ebmb_count_range(struct eb_root *root, const void *min, const void *max, unsigned int len)
+{
+	if (memcmp(min, max, len) > 0)
+		return 0;
+	return __ebmb_rank(root, max, len, 1) - __ebmb_rank(root, min, len, 0);
+}
+#endif
+
 /* Insert ebmb_node <new> into subtree starting at node root <root>.
  * Only new->key needs be set with the key. The ebmb_node is returned.
  * If root->b[EB_RGHT]==1, the tree may only contain unique keys. The
  * len is specified in bytes.
  */
+EB_MULTIVERSION
 struct ebmb_node *
 ebmb_insert(struct eb_root *root, struct ebmb_node *new, unsigned int len)
 {
 	return __ebmb_insert(root, new, len);
 }
 
+EB_MULTIVERSION
+struct ebmb_node *
+ebmb_requeue(struct eb_root *root, struct ebmb_node *node, const void *x, unsigned int len)
+{
+	return __ebmb_requeue(root, node, x, len);
+}
+
+/* Build the tree <root>, which must be empty, from the <nb> nodes pointed to
+ * by <nodes>, whose keys of <len> bytes must be sorted in ascending order. The result is the
+ * same tree as if the nodes had been inserted in this order, except for the
+ * node parts in use, but it is built in linear time without any descent. If
+ * root->b[EB_RGHT]==1, duplicates are left unlinked as an insertion would do.
+ * The number of nodes linked into the tree is returned.
+ */
+unsigned int ebmb_build_sorted(struct eb_root *root, struct ebmb_node **nodes, unsigned int nb, unsigned int len)
+{
+	struct eb_root sub;
+	eb_troot_t *last = NULL;
+	unsigned int i, j, done = 0;
+
+	for (i = 0; i < nb; i = j) {
+		__eb_build_leaf(&sub, &nodes[i]->node);
+		for (j = i + 1; j < nb && memcmp(nodes[i]->key, nodes[j]->key, len) == 0; j++) {
+			if (eb_gettag(root->b[EB_RGHT]))
+				continue;
+			__eb_build_dup(&sub, &nodes[j]->node);
+			done++;
+		}
+		last = __eb_build_append(root, last, &sub, &nodes[i]->node,
+					 i ? equal_bits(nodes[i - 1]->key, nodes[i]->key, 0, len << 3) : 0, 1);
+		done++;
+	}
+	__eb_build_finish(last);
+	return done;
+}
+
 /* Find the first occurence of the longest prefix matching a key <x> in the
  * tree <root>. It's the caller's responsibility to ensure that key <x> is at
  * least as long as the keys in the tree. If none can be found, return NULL.
  */
+EB_MULTIVERSION
 struct ebmb_node *
 ebmb_lookup_longest(struct eb_root *root, const void *x)
 {
@@ -61,6 +145,7 @@ ebmb_lookup_longest(struct eb_root *root, const void *x)
 /* Find the first occurence of a prefix matching a key <x> of <pfx> BITS in the
  * tree <root>. If none can be found, return NULL.
  */
+EB_MULTIVERSION
 struct ebmb_node *
 ebmb_lookup_prefix(struct eb_root *root, const void *x, unsigned int pfx)
 {
@@ -76,6 +161,7 @@ ebmb_lookup_prefix(struct eb_root *root, const void *x, unsigned int pfx)
  * If root->b[EB_RGHT]==1, the tree may only contain unique keys. The
  * len is specified in bytes.
  */
+EB_MULTIVERSION
 struct ebmb_node *
 ebmb_insert_prefix(struct eb_root *root, struct ebmb_node *new, unsigned int len)
 {
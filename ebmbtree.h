@@ -115,14 +115,43 @@ static forceinline void ebmb_delete(struct ebmb_node *ebmb)
 	eb_delete(&ebmb->node);
 }
 
+/* Remove the leftmost node from the tree and return it, or NULL if none */
+static forceinline struct ebmb_node *ebmb_pick_first(struct eb_root *root)
+{
+	return ebmb_entry(eb_pick_first(root), struct ebmb_node, node);
+}
+
+/* Remove the rightmost node from the tree and return it, or NULL if none */
+static forceinline struct ebmb_node *ebmb_pick_last(struct eb_root *root)
+{
+	return ebmb_entry(eb_pick_last(root), struct ebmb_node, node);
+}
+
+#ifdef EB_COUNT
+/* Return the node at position <rank> (starting at zero), or NULL if none */
+static forceinline struct ebmb_node *ebmb_select(struct eb_root *root, unsigned int rank)
+{
+	return ebmb_entry(eb_select(root, rank), struct ebmb_node, node);
+}
+#endif
+
 /* The following functions are not inlined by default. They are declared
  * in ebmbtree.c, which simply relies on their inline version.
  */
 struct ebmb_node *ebmb_lookup(struct eb_root *root, const void *x, unsigned int len);
+struct ebmb_node *ebmb_lookup_le(struct eb_root *root, const void *x, unsigned int len);
+struct ebmb_node *ebmb_lookup_ge(struct eb_root *root, const void *x, unsigned int len);
+struct ebmb_node *ebmb_pick(struct eb_root *root, const void *x, unsigned int len);
 struct ebmb_node *ebmb_insert(struct eb_root *root, struct ebmb_node *new, unsigned int len);
+struct ebmb_node *ebmb_requeue(struct eb_root *root, struct ebmb_node *node, const void *x, unsigned int len);
 struct ebmb_node *ebmb_lookup_longest(struct eb_root *root, const void *x);
 struct ebmb_node *ebmb_lookup_prefix(struct eb_root *root, const void *x, unsigned int pfx);
 struct ebmb_node *ebmb_insert_prefix(struct eb_root *root, struct ebmb_node *new, unsigned int len);
+unsigned int ebmb_build_sorted(struct eb_root *root, struct ebmb_node **nodes, unsigned int nb, unsigned int len);
+#ifdef EB_COUNT
+unsigned int ebmb_rank(struct eb_root *root, const void *x, unsigned int len);
+unsigned int ebmb_count_range(struct eb_root *root, const void *min, const void *max, unsigned int len);
+#endif
 
 /* The following functions are less likely to be used directly, because their
  * code is larger. The non-inlined version is preferred.
@@ -226,36 +255,149 @@ static forceinline struct ebmb_node *__ebmb_lookup(struct eb_root *root, const v
 	return NULL;
 }
 
-/* Insert ebmb_node <new> into subtree starting at node root <root>.
- * Only new->key needs be set with the key. The ebmb_node is returned.
- * If root->b[EB_RGHT]==1, the tree may only contain unique keys. The
- * len is specified in bytes. It is absolutely mandatory that this length
- * is the same for all keys in the tree. This function cannot be used to
- * insert strings.
+/* Find the last occurrence of the highest key of <len> bytes in the tree <root>
+ * which is lower than or equal to <x> if <ge> is zero, otherwise the first
+ * occurrence of the lowest key which is greater than or equal to <x>. The tree
+ * must only contain keys of <len> bytes inserted with ebmb_insert(). Bits known
+ * to be equal are not compared again, and the descent stops on the first
+ * subtree which does not contain <x>. NULL is returned if no key matches.
  */
 static forceinline struct ebmb_node *
-__ebmb_insert(struct eb_root *root, struct ebmb_node *new, unsigned int len)
+__ebmb_lookup_bound(struct eb_root *root, const void *x, unsigned int len, int ge)
+{
+	struct ebmb_node *node;
+	eb_troot_t *troot;
+	size_t bit = 0;
+	int node_bit, side, cmp;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	while (1) {
+		if (eb_gettag(troot) == EB_LEAF) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebmb_node, node.branches);
+			cmp = memcmp(node->key, x, len);
+			break;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct ebmb_node, node.branches);
+
+		node_bit = node->node.bit;
+		if (node_bit < 0) {
+			/* a dup tree only holds equal keys */
+			cmp = memcmp(node->key, x, len);
+			break;
+		}
+
+		bit = equal_bits(x, node->key, bit, node_bit);
+		if (bit < (size_t)node_bit) {
+			/* the whole subtree is on the same side of <x> */
+			cmp = cmp_bits(node->key, x, bit);
+			break;
+		}
+
+		side = (((const unsigned char *)x)[node_bit >> 3] >> (~node_bit & 7)) & 1;
+		troot = node->node.branches.b[side];
+	}
+	return ebmb_entry(__eb_lookup_bound(troot, cmp, ge), struct ebmb_node, node);
+}
+
+/* Find the first occurence of a key matching <x> like __ebmb_lookup() does,
+ * and remove it from the tree. The node is returned, or NULL if none could be
+ * found.
+ */
+static forceinline struct ebmb_node *__ebmb_pick(struct eb_root *root, const void *x, unsigned int len)
+{
+	struct ebmb_node *node = __ebmb_lookup(root, x, len);
+
+	if (node)
+		__eb_delete(&node->node);
+	return node;
+}
+
+#ifdef EB_COUNT
+/* Return the number of keys of <len> bytes in the tree <root> which are lower
+ * than <x>, or lower than or equal to <x> if <le> is non-zero. The tree must
+ * only contain keys of <len> bytes. The descent stops as soon as <x> leaves
+ * the current subtree, whose keys then all sit on one side.
+ */
+static forceinline unsigned int __ebmb_rank(struct eb_root *root, const void *x, unsigned int len, int le)
+{
+	struct ebmb_node *node;
+	eb_troot_t *troot;
+	unsigned int rank = 0;
+	int node_bit, side, cmp;
+	size_t bit = 0;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return 0;
+
+	while (1) {
+		if (eb_gettag(troot) == EB_LEAF) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebmb_node, node.branches);
+			cmp = memcmp(node->key, x, len);
+			if (cmp < 0 || (le && cmp == 0))
+				rank++;
+			return rank;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct ebmb_node, node.branches);
+
+		node_bit = node->node.bit;
+		if (node_bit < 0) {
+			/* a dup tree only holds equal keys */
+			cmp = memcmp(node->key, x, len);
+			if (cmp < 0 || (le && cmp == 0))
+				rank += node->node.count;
+			return rank;
+		}
+
+		/* the first <bit> bits are already known to be equal, as in
+		 * __ebmb_insert().
+		 */
+		bit = equal_bits(x, node->key, bit, node_bit);
+		if (bit < (size_t)node_bit) {
+			/* <x> leaves this subtree whose keys all share bit <bit> */
+			if (cmp_bits(node->key, x, bit) < 0)
+				rank += node->node.count;
+			return rank;
+		}
+
+		side = (((const unsigned char *)x)[node_bit >> 3] >> (~node_bit & 7)) & 1;
+		if (side)
+			rank += eb_troot_count(node->node.branches.b[EB_LEFT]);
+		troot = node->node.branches.b[side];
+	}
+}
+#endif
+
+/* Insert ebmb_node <new> below branch <side> of <sub>, which is either the
+ * tree's root <root> or the branches of a node part whose subtree the descent
+ * from <root> would enter, and must not be empty. The first <bit> bits of
+ * new->key are known to be equal to those of the keys below this branch. Only
+ * new->key needs be set with the key. The ebmb_node is returned. If
+ * root->b[EB_RGHT]==1, the tree may only contain unique keys. The len is
+ * specified in bytes.
+ */
+static forceinline struct ebmb_node *
+__ebmb_insert_below(struct eb_root *root, struct eb_root *sub, unsigned int side,
+		    struct ebmb_node *new, unsigned int len, int bit)
 {
 	struct ebmb_node *old;
-	unsigned int side;
 	eb_troot_t *troot, **up_ptr;
 	eb_troot_t *root_right;
 	int diff;
-	int bit;
 	eb_troot_t *new_left, *new_rght;
 	eb_troot_t *new_leaf;
 	int old_node_bit;
 
-	side = EB_LEFT;
-	troot = root->b[EB_LEFT];
 	root_right = root->b[EB_RGHT];
-	if (unlikely(troot == NULL)) {
-		/* Tree is empty, insert the leaf part below the left branch */
-		root->b[EB_LEFT] = eb_dotag(&new->node.branches, EB_LEAF);
-		new->node.leaf_p = eb_dotag(root, EB_LEFT);
-		new->node.node_p = NULL; /* node part unused */
-		return new;
-	}
+	root = sub;
+	troot = root->b[side];
 
 	/* The tree descent is fairly easy :
 	 *  - first, check if we have reached a leaf node
@@ -269,7 +411,6 @@ __ebmb_insert(struct eb_root *root, struct ebmb_node *new, unsigned int len)
 	 * was attached.
 	 */
 
-	bit = 0;
 	while (1) {
 		if (unlikely(eb_gettag(troot) == EB_LEAF)) {
 			/* insert above a leaf */
@@ -362,13 +503,13 @@ __ebmb_insert(struct eb_root *root, struct ebmb_node *new, unsigned int len)
 		new->node.branches.b[EB_LEFT] = troot;
 		new->node.branches.b[EB_RGHT] = new_leaf;
 		new->node.leaf_p = new_rght;
-		*up_ptr = new_left;
+		eb_publish(up_ptr, new_left);
 	}
 	else {
 		new->node.branches.b[EB_LEFT] = new_leaf;
 		new->node.branches.b[EB_RGHT] = troot;
 		new->node.leaf_p = new_left;
-		*up_ptr = new_rght;
+		eb_publish(up_ptr, new_rght);
 	}
 
 	/* Ok, now we are inserting <new> between <root> and <old>. <old>'s
@@ -377,11 +518,88 @@ __ebmb_insert(struct eb_root *root, struct ebmb_node *new, unsigned int len)
 	 * find the side by checking the side of new->node.node_p.
 	 */
 
-	root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+	eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+	__eb_count_update(new->node.leaf_p);
 	return new;
 }
 
 
+/* Insert ebmb_node <new> into subtree starting at node root <root>.
+ * Only new->key needs be set with the key. The ebmb_node is returned.
+ * If root->b[EB_RGHT]==1, the tree may only contain unique keys. The
+ * len is specified in bytes. It is absolutely mandatory that this length
+ * is the same for all keys in the tree. This function cannot be used to
+ * insert strings.
+ */
+static forceinline struct ebmb_node *
+__ebmb_insert(struct eb_root *root, struct ebmb_node *new, unsigned int len)
+{
+	if (unlikely(root->b[EB_LEFT] == NULL)) {
+		/* Tree is empty, insert the leaf part below the left branch */
+		new->node.leaf_p = eb_dotag(root, EB_LEFT);
+		new->node.node_p = NULL; /* node part unused */
+		eb_publish(&root->b[EB_LEFT], eb_dotag(&new->node.branches, EB_LEAF));
+		return new;
+	}
+	return __ebmb_insert_below(root, root, EB_LEFT, new, len, 0);
+}
+
+/* Replace the key of ebmb_node <node> with the <len> bytes at <x> and move it
+ * accordingly in the tree <root>, or insert it if it was not queued. The key
+ * is updated in place when it keeps all the bits up to the leaf parent's split
+ * bit, which leaves the shape of the tree unchanged, except for duplicates.
+ * Otherwise the node is deleted and reinserted from the lowest node part above
+ * its former sibling whose subtree still covers the new key. The node is
+ * returned, or, if root->b[EB_RGHT]==1 and the new key is already present, the
+ * existing node, as for an insert. This function cannot be used on prefix
+ * trees. See __eb32_requeue() for more details.
+ */
+static forceinline struct ebmb_node *
+__ebmb_requeue(struct eb_root *root, struct ebmb_node *node, const void *x, unsigned int len)
+{
+	struct eb_node *parent;
+	eb_troot_t *sibling, *up;
+	int side;
+
+	if (!node->node.leaf_p) {
+		memcpy(node->key, x, len);
+		return __ebmb_insert(root, node, len);
+	}
+
+	if (memcmp(node->key, x, len) == 0)
+		return node;
+
+	side = eb_gettag(node->node.leaf_p);
+	parent = eb_root_to_node(eb_untag(node->node.leaf_p, side));
+	if (eb_clrtag(parent->branches.b[EB_RGHT]) == NULL ||
+	    (parent->bit >= 0 && (int)equal_bits(node->key, x, 0, parent->bit + 1) > parent->bit)) {
+		memcpy(node->key, x, len);
+		return node;
+	}
+
+	sibling = parent->branches.b[!side];
+	__eb_delete(&node->node);
+	memcpy(node->key, x, len);
+
+	if (eb_gettag(sibling) == EB_LEAF)
+		up = eb_root_to_node(eb_untag(sibling, EB_LEAF))->leaf_p;
+	else
+		up = eb_root_to_node(eb_untag(sibling, EB_NODE))->node_p;
+
+	while (eb_clrtag(up) != root) {
+		struct ebmb_node *sub = container_of(eb_clrtag(up), struct ebmb_node, node.branches);
+		int sub_bit = sub->node.bit;
+
+		if (sub_bit >= 0 && (int)equal_bits(node->key, sub->key, 0, sub_bit) >= sub_bit)
+			return __ebmb_insert_below(root, &sub->node.branches,
+						   (node->key[sub_bit >> 3] >> (~sub_bit & 7)) & 1,
+						   node, len, sub_bit + 1);
+		up = sub->node.node_p;
+	}
+	return __ebmb_insert(root, node, len);
+}
+
+
 /* Find the first occurence of the longest prefix matching a key <x> in the
  * tree <root>. It's the caller's responsibility to ensure that key <x> is at
  * least as long as the keys in the tree. Note that this can be ensured by
@@ -597,9 +815,9 @@ __ebmb_insert_prefix(struct eb_root *root, struct ebmb_node *new, unsigned int l
 	root_right = root->b[EB_RGHT];
 	if (unlikely(troot == NULL)) {
 		/* Tree is empty, insert the leaf part below the left branch */
-		root->b[EB_LEFT] = eb_dotag(&new->node.branches, EB_LEAF);
 		new->node.leaf_p = eb_dotag(root, EB_LEFT);
 		new->node.node_p = NULL; /* node part unused */
+		eb_publish(&root->b[EB_LEFT], eb_dotag(&new->node.branches, EB_LEAF));
 		return new;
 	}
 
@@ -801,16 +1019,17 @@ __ebmb_insert_prefix(struct eb_root *root, struct ebmb_node *new, unsigned int l
 		new->node.branches.b[EB_LEFT] = troot;
 		new->node.branches.b[EB_RGHT] = new_leaf;
 		new->node.leaf_p = new_rght;
-		*up_ptr = new_left;
+		eb_publish(up_ptr, new_left);
 	}
 	else {
 		new->node.branches.b[EB_LEFT] = new_leaf;
 		new->node.branches.b[EB_RGHT] = troot;
 		new->node.leaf_p = new_left;
-		*up_ptr = new_rght;
+		eb_publish(up_ptr, new_rght);
 	}
 
-	root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+	eb_publish(&root->b[side], eb_dotag(&new->node.branches, EB_NODE));
+	__eb_count_update(new->node.leaf_p);
 	return new;
 }
 
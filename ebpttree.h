@@ -121,6 +121,18 @@ static forceinline void ebpt_delete(struct ebpt_node *ebpt)
 	eb_delete(&ebpt->node);
 }
 
+/* Remove the leftmost node from the tree and return it, or NULL if none */
+static forceinline struct ebpt_node *ebpt_pick_first(struct eb_root *root)
+{
+	return ebpt_entry(eb_pick_first(root), struct ebpt_node, node);
+}
+
+/* Remove the rightmost node from the tree and return it, or NULL if none */
+static forceinline struct ebpt_node *ebpt_pick_last(struct eb_root *root)
+{
+	return ebpt_entry(eb_pick_last(root), struct ebpt_node, node);
+}
+
 /*
  * The following functions are inlined but derived from the integer versions.
  */
@@ -148,6 +160,30 @@ static forceinline struct ebpt_node *ebpt_lookup_ge(struct eb_root *root, void *
 		return (struct ebpt_node *)eb64_lookup_ge(root, (u64)(PTR_INT_TYPE)x);
 }
 
+static forceinline struct ebpt_node *ebpt_pick(struct eb_root *root, void *x)
+{
+	if (sizeof(void *) == 4)
+		return (struct ebpt_node *)eb32_pick(root, (u32)(PTR_INT_TYPE)x);
+	else
+		return (struct ebpt_node *)eb64_pick(root, (u64)(PTR_INT_TYPE)x);
+}
+
+static forceinline struct ebpt_node *ebpt_pick_le(struct eb_root *root, void *x)
+{
+	if (sizeof(void *) == 4)
+		return (struct ebpt_node *)eb32_pick_le(root, (u32)(PTR_INT_TYPE)x);
+	else
+		return (struct ebpt_node *)eb64_pick_le(root, (u64)(PTR_INT_TYPE)x);
+}
+
+static forceinline struct ebpt_node *ebpt_pick_ge(struct eb_root *root, void *x)
+{
+	if (sizeof(void *) == 4)
+		return (struct ebpt_node *)eb32_pick_ge(root, (u32)(PTR_INT_TYPE)x);
+	else
+		return (struct ebpt_node *)eb64_pick_ge(root, (u64)(PTR_INT_TYPE)x);
+}
+
 static forceinline struct ebpt_node *ebpt_insert(struct eb_root *root, struct ebpt_node *new)
 {
 	if (sizeof(void *) == 4)
@@ -175,6 +211,14 @@ static forceinline struct ebpt_node *__ebpt_lookup(struct eb_root *root, void *x
 		return (struct ebpt_node *)__eb64_lookup(root, (u64)(PTR_INT_TYPE)x);
 }
 
+static forceinline struct ebpt_node *__ebpt_pick(struct eb_root *root, void *x)
+{
+	if (sizeof(void *) == 4)
+		return (struct ebpt_node *)__eb32_pick(root, (u32)(PTR_INT_TYPE)x);
+	else
+		return (struct ebpt_node *)__eb64_pick(root, (u64)(PTR_INT_TYPE)x);
+}
+
 static forceinline struct ebpt_node *__ebpt_insert(struct eb_root *root, struct ebpt_node *new)
 {
 	if (sizeof(void *) == 4)
@@ -0,0 +1,222 @@
+/*
+ * Elastic Binary Trees - exported functions for operations on 32bit nodes
+ * with relative addressing.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult ebr32tree.h for more details about those functions */
+
+#include "ebr32tree.h"
+
+/*
+ * Find the last occurrence of the highest key in the tree <root>, which is
+ * equal to or less than <x>. NULL is returned is no key matches.
+ */
+static forceinline void *__ebr32_lookup_le(void *root, u32 x, const int sz)
+{
+	void *node;
+	eb_troot_t *troot;
+	int node_bit;
+
+	troot = __ebr_br(root, EB_LEFT, sz);
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	while (1) {
+		if ((eb_gettag(troot) == EB_LEAF)) {
+			/* We reached a leaf, which means that the whole upper
+			 * parts were common. We will return either the current
+			 * node or its next one if the former is too small.
+			 */
+			node = eb_untag(troot, EB_LEAF);
+			if (*__ebr32_key(node, sz) <= x)
+				return node;
+			/* return prev */
+			troot = __ebr_get(__ebr_leaf_p(node, sz), sz);
+			break;
+		}
+		node = eb_untag(troot, EB_NODE);
+		node_bit = *__ebr_bit(node, sz);
+
+		if (node_bit < 0) {
+			/* We're at the top of a dup tree. Either we got a
+			 * matching value and we return the rightmost node, or
+			 * we don't and we skip the whole subtree to return the
+			 * prev node before the subtree.
+			 */
+			if (*__ebr32_key(node, sz) <= x)
+				return __ebr_walk_down(__ebr_br(node, EB_RGHT, sz), EB_RGHT, sz);
+			/* return prev */
+			troot = __ebr_get(__ebr_node_p(node, sz), sz);
+			break;
+		}
+
+		if (((x ^ *__ebr32_key(node, sz)) >> node_bit) >= EB_NODE_BRANCHES) {
+			/* No more common bits at all. Either this node is too
+			 * small and we need to get its highest value, or it is
+			 * too large, and we need to get the prev value.
+			 */
+			if ((*__ebr32_key(node, sz) >> node_bit) < (x >> node_bit))
+				return __ebr_walk_down(__ebr_br(node, EB_RGHT, sz), EB_RGHT, sz);
+
+			/* Further values will be too high here, so return the prev
+			 * unique node (if it exists).
+			 */
+			troot = __ebr_get(__ebr_node_p(node, sz), sz);
+			break;
+		}
+		troot = __ebr_br(node, (x >> node_bit) & EB_NODE_BRANCH_MASK, sz);
+	}
+
+	/* If we get here, it means we want to report previous node before the
+	 * current one which is not above. <troot> is already initialised to
+	 * the parent's branches.
+	 */
+	while (eb_gettag(troot) == EB_LEFT) {
+		/* Walking up from left branch. We must ensure that we never
+		 * walk beyond root.
+		 */
+		if (unlikely(eb_clrtag(__ebr_br(eb_untag(troot, EB_LEFT), EB_RGHT, sz)) == NULL))
+			return NULL;
+		troot = __ebr_get(__ebr_node_p(eb_untag(troot, EB_LEFT), sz), sz);
+	}
+	/* Note that <troot> cannot be NULL at this stage */
+	troot = __ebr_br(eb_untag(troot, EB_RGHT), EB_LEFT, sz);
+	return __ebr_walk_down(troot, EB_RGHT, sz);
+}
+
+/*
+ * Find the first occurrence of the lowest key in the tree <root>, which is
+ * equal to or greater than <x>. NULL is returned is no key matches.
+ */
+static forceinline void *__ebr32_lookup_ge(void *root, u32 x, const int sz)
+{
+	void *node;
+	eb_troot_t *troot;
+	int node_bit;
+
+	troot = __ebr_br(root, EB_LEFT, sz);
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	while (1) {
+		if ((eb_gettag(troot) == EB_LEAF)) {
+			/* We reached a leaf, which means that the whole upper
+			 * parts were common. We will return either the current
+			 * node or its next one if the former is too small.
+			 */
+			node = eb_untag(troot, EB_LEAF);
+			if (*__ebr32_key(node, sz) >= x)
+				return node;
+			/* return next */
+			troot = __ebr_get(__ebr_leaf_p(node, sz), sz);
+			break;
+		}
+		node = eb_untag(troot, EB_NODE);
+		node_bit = *__ebr_bit(node, sz);
+
+		if (node_bit < 0) {
+			/* We're at the top of a dup tree. Either we got a
+			 * matching value and we return the leftmost node, or
+			 * we don't and we skip the whole subtree to return the
+			 * next node after the subtree.
+			 */
+			if (*__ebr32_key(node, sz) >= x)
+				return __ebr_walk_down(__ebr_br(node, EB_LEFT, sz), EB_LEFT, sz);
+			/* return next */
+			troot = __ebr_get(__ebr_node_p(node, sz), sz);
+			break;
+		}
+
+		if (((x ^ *__ebr32_key(node, sz)) >> node_bit) >= EB_NODE_BRANCHES) {
+			/* No more common bits at all. Either this node is too
+			 * large and we need to get its lowest value, or it is too
+			 * small, and we need to get the next value.
+			 */
+			if ((*__ebr32_key(node, sz) >> node_bit) > (x >> node_bit))
+				return __ebr_walk_down(__ebr_br(node, EB_LEFT, sz), EB_LEFT, sz);
+
+			/* Further values will be too low here, so return the next
+			 * unique node (if it exists).
+			 */
+			troot = __ebr_get(__ebr_node_p(node, sz), sz);
+			break;
+		}
+		troot = __ebr_br(node, (x >> node_bit) & EB_NODE_BRANCH_MASK, sz);
+	}
+
+	/* If we get here, it means we want to report next node after the
+	 * current one which is not below. <troot> is already initialised
+	 * to the parent's branches.
+	 */
+	while (eb_gettag(troot) != EB_LEFT)
+		/* Walking up from right branch, so we cannot be below root */
+		troot = __ebr_get(__ebr_node_p(eb_untag(troot, EB_RGHT), sz), sz);
+
+	/* Note that <troot> cannot be NULL at this stage */
+	troot = __ebr_br(eb_untag(troot, EB_LEFT), EB_RGHT, sz);
+	if (eb_clrtag(troot) == NULL)
+		return NULL;
+	return __ebr_walk_down(troot, EB_LEFT, sz);
+}
+
+struct ebmd32_node *ebmd32_lookup(struct ebm_root *root, u32 x)
+{
+	return __ebr32_lookup(root, x, sizeof(root->b[0]));
+}
+
+struct ebmd32_node *ebmd32_lookup_le(struct ebm_root *root, u32 x)
+{
+	return __ebr32_lookup_le(root, x, sizeof(root->b[0]));
+}
+
+struct ebmd32_node *ebmd32_lookup_ge(struct ebm_root *root, u32 x)
+{
+	return __ebr32_lookup_ge(root, x, sizeof(root->b[0]));
+}
+
+struct ebmd32_node *ebmd32_insert(struct ebm_root *root, struct ebmd32_node *new)
+{
+	return __ebr32_insert(root, new, sizeof(root->b[0]));
+}
+
+struct ebsd32_node *ebsd32_lookup(struct ebs_root *root, u32 x)
+{
+	return __ebr32_lookup(root, x, sizeof(root->b[0]));
+}
+
+struct ebsd32_node *ebsd32_lookup_le(struct ebs_root *root, u32 x)
+{
+	return __ebr32_lookup_le(root, x, sizeof(root->b[0]));
+}
+
+struct ebsd32_node *ebsd32_lookup_ge(struct ebs_root *root, u32 x)
+{
+	return __ebr32_lookup_ge(root, x, sizeof(root->b[0]));
+}
+
+struct ebsd32_node *ebsd32_insert(struct ebs_root *root, struct ebsd32_node *new)
+{
+	return __ebr32_insert(root, new, sizeof(root->b[0]));
+}
@@ -0,0 +1,301 @@
+/*
+ * Elastic Binary Trees - macros and structures for operations on 64bit nodes
+ * with relative addressing.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _EBR64TREE_H
+#define _EBR64TREE_H
+
+#include "ebrtree.h"
+#include "eb64tree.h"
+
+/* This structure carries a medium relative node, a leaf, and a key. It must
+ * start with the ebm_node, and the key must immediately follow it.
+ */
+struct ebmd64_node {
+	struct ebm_node node; /* the tree node, must be at the beginning */
+	u64 key;
+};
+
+/* This structure carries a small relative node, a leaf, and a key. It must
+ * start with the ebs_node, and the key must immediately follow it.
+ */
+struct ebsd64_node {
+	struct ebs_node node; /* the tree node, must be at the beginning */
+	u64 key;
+};
+
+/*
+ * Exported functions and macros.
+ * Many of them are always inlined because they are extremely small, and
+ * are generally called at most once or twice in a program.
+ */
+
+/* Return leftmost node in the tree, or NULL if none */
+static inline struct ebmd64_node *ebmd64_first(struct ebm_root *root)
+{
+	return container_of(ebm_first(root), struct ebmd64_node, node);
+}
+
+/* Return rightmost node in the tree, or NULL if none */
+static inline struct ebmd64_node *ebmd64_last(struct ebm_root *root)
+{
+	return container_of(ebm_last(root), struct ebmd64_node, node);
+}
+
+/* Return next node in the tree, or NULL if none */
+static inline struct ebmd64_node *ebmd64_next(struct ebmd64_node *ebmd64)
+{
+	return container_of(ebm_next(&ebmd64->node), struct ebmd64_node, node);
+}
+
+/* Return previous node in the tree, or NULL if none */
+static inline struct ebmd64_node *ebmd64_prev(struct ebmd64_node *ebmd64)
+{
+	return container_of(ebm_prev(&ebmd64->node), struct ebmd64_node, node);
+}
+
+/* Delete node from the tree if it was linked in. Mark the node unused. */
+static inline void ebmd64_delete(struct ebmd64_node *ebmd64)
+{
+	ebm_delete(&ebmd64->node);
+}
+
+/* Return leftmost node in the tree, or NULL if none */
+static inline struct ebsd64_node *ebsd64_first(struct ebs_root *root)
+{
+	return container_of(ebs_first(root), struct ebsd64_node, node);
+}
+
+/* Return rightmost node in the tree, or NULL if none */
+static inline struct ebsd64_node *ebsd64_last(struct ebs_root *root)
+{
+	return container_of(ebs_last(root), struct ebsd64_node, node);
+}
+
+/* Return next node in the tree, or NULL if none */
+static inline struct ebsd64_node *ebsd64_next(struct ebsd64_node *ebsd64)
+{
+	return container_of(ebs_next(&ebsd64->node), struct ebsd64_node, node);
+}
+
+/* Return previous node in the tree, or NULL if none */
+static inline struct ebsd64_node *ebsd64_prev(struct ebsd64_node *ebsd64)
+{
+	return container_of(ebs_prev(&ebsd64->node), struct ebsd64_node, node);
+}
+
+/* Delete node from the tree if it was linked in. Mark the node unused. */
+static inline void ebsd64_delete(struct ebsd64_node *ebsd64)
+{
+	ebs_delete(&ebsd64->node);
+}
+
+/*
+ * The following functions are not inlined by default. They are declared
+ * in ebr64tree.c, which simply relies on their inline version.
+ */
+struct ebmd64_node *ebmd64_lookup(struct ebm_root *root, u64 x);
+struct ebmd64_node *ebmd64_lookup_le(struct ebm_root *root, u64 x);
+struct ebmd64_node *ebmd64_lookup_ge(struct ebm_root *root, u64 x);
+struct ebmd64_node *ebmd64_insert(struct ebm_root *root, struct ebmd64_node *new);
+
+struct ebsd64_node *ebsd64_lookup(struct ebs_root *root, u64 x);
+struct ebsd64_node *ebsd64_lookup_le(struct ebs_root *root, u64 x);
+struct ebsd64_node *ebsd64_lookup_ge(struct ebs_root *root, u64 x);
+struct ebsd64_node *ebsd64_insert(struct ebs_root *root, struct ebsd64_node *new);
+
+/*
+ * The following functions are less likely to be used directly, because their
+ * code is larger. The non-inlined version is preferred. They are common to
+ * both addressing models, which are designated by their offset size <sz>.
+ */
+
+/* Returns a pointer to the key of node <node> */
+static forceinline u64 *__ebr64_key(const void *node, const int sz)
+{
+	if (sz == 2)
+		return &((struct ebsd64_node *)node)->key;
+	return &((struct ebmd64_node *)node)->key;
+}
+
+/*
+ * Find the first occurence of a key in the tree <root>. If none can be
+ * found, return NULL.
+ */
+static forceinline void *__ebr64_lookup(void *root, u64 x, const int sz)
+{
+	void *node;
+	eb_troot_t *troot;
+	u64 y;
+	int node_bit;
+
+	troot = __ebr_br(root, EB_LEFT, sz);
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	while (1) {
+		if ((eb_gettag(troot) == EB_LEAF)) {
+			node = eb_untag(troot, EB_LEAF);
+			if (*__ebr64_key(node, sz) == x)
+				return node;
+			else
+				return NULL;
+		}
+		node = eb_untag(troot, EB_NODE);
+		node_bit = *__ebr_bit(node, sz);
+
+		y = *__ebr64_key(node, sz) ^ x;
+		if (!y) {
+			/* Either we found the node which holds the key, or
+			 * we have a dup tree. In the later case, we have to
+			 * walk it down left to get the first entry.
+			 */
+			if (node_bit < 0)
+				node = __ebr_walk_down(__ebr_br(node, EB_LEFT, sz), EB_LEFT, sz);
+			return node;
+		}
+
+		if ((y >> node_bit) >= EB_NODE_BRANCHES)
+			return NULL; /* no more common bits */
+
+		troot = __ebr_br(node, (x >> node_bit) & EB_NODE_BRANCH_MASK, sz);
+	}
+}
+
+/* Insert node <new> into subtree starting at node root <root>. Only the key
+ * of <new> needs be set. The node is returned. If the root's right branch is
+ * 1, the tree may only contain unique keys.
+ */
+static forceinline void *__ebr64_insert(void *root, void *new, const int sz)
+{
+	void *old;
+	unsigned int side;
+	eb_troot_t *troot;
+	void *up_ptr;
+	u64 newkey, oldkey;
+	eb_troot_t *root_right;
+	eb_troot_t *new_left, *new_rght;
+	eb_troot_t *new_leaf;
+	int old_node_bit;
+
+	side = EB_LEFT;
+	troot = __ebr_br(root, EB_LEFT, sz);
+	root_right = __ebr_br(root, EB_RGHT, sz);
+	if (unlikely(troot == NULL)) {
+		/* Tree is empty, insert the leaf part below the left branch */
+		__ebr_set(__ebr_leaf_p(new, sz), eb_dotag(root, EB_LEFT), sz);
+		__ebr_set(__ebr_node_p(new, sz), NULL, sz); /* node part unused */
+		__ebr_publish(__ebr_branch(root, EB_LEFT, sz), eb_dotag(new, EB_LEAF), sz);
+		return new;
+	}
+
+	/* The tree descent is the same as in __eb64_insert() */
+	newkey = *__ebr64_key(new, sz);
+
+	while (1) {
+		if (eb_gettag(troot) == EB_LEAF) {
+			/* insert above a leaf */
+			old = eb_untag(troot, EB_LEAF);
+			__ebr_set(__ebr_node_p(new, sz), __ebr_get(__ebr_leaf_p(old, sz), sz), sz);
+			up_ptr = __ebr_leaf_p(old, sz);
+			break;
+		}
+
+		/* OK we're walking down this link */
+		old = eb_untag(troot, EB_NODE);
+		old_node_bit = *__ebr_bit(old, sz);
+
+		/* Stop going down when we don't have common bits anymore. We
+		 * also stop in front of a duplicates tree because it means we
+		 * have to insert above.
+		 */
+
+		if ((old_node_bit < 0) || /* we're above a duplicate tree, stop here */
+		    (((newkey ^ *__ebr64_key(old, sz)) >> old_node_bit) >= EB_NODE_BRANCHES)) {
+			/* The tree did not contain the key, so we insert <new> before the node
+			 * <old>, and set ->bit to designate the lowest bit position in <new>
+			 * which applies to ->branches.b[].
+			 */
+			__ebr_set(__ebr_node_p(new, sz), __ebr_get(__ebr_node_p(old, sz), sz), sz);
+			up_ptr = __ebr_node_p(old, sz);
+			break;
+		}
+
+		/* walk down */
+		root = old;
+		side = (newkey >> old_node_bit) & EB_NODE_BRANCH_MASK;
+		troot = __ebr_br(root, side, sz);
+	}
+
+	new_left = eb_dotag(new, EB_LEFT);
+	new_rght = eb_dotag(new, EB_RGHT);
+	new_leaf = eb_dotag(new, EB_LEAF);
+	oldkey = *__ebr64_key(old, sz);
+
+	/* note that if EB_NODE_BITS > 1, we should check that it's still >= 0 */
+	*__ebr_bit(new, sz) = flsnz(newkey ^ oldkey) - EB_NODE_BITS;
+
+	if (newkey == oldkey) {
+		*__ebr_bit(new, sz) = -1; /* mark as new dup tree, just in case */
+
+		if (likely(eb_gettag(root_right))) {
+			/* we refuse to duplicate this key if the tree is
+			 * tagged as containing only unique keys.
+			 */
+			return old;
+		}
+
+		if (eb_gettag(troot) != EB_LEAF) {
+			/* there was already a dup tree below */
+			if (sz == 2)
+				return ebs_insert_dup(old, new);
+			return ebm_insert_dup(old, new);
+		}
+		/* otherwise fall through */
+	}
+
+	if (newkey >= oldkey) {
+		__ebr_set(__ebr_branch(new, EB_LEFT, sz), troot, sz);
+		__ebr_set(__ebr_branch(new, EB_RGHT, sz), new_leaf, sz);
+		__ebr_set(__ebr_leaf_p(new, sz), new_rght, sz);
+		__ebr_publish(up_ptr, new_left, sz);
+	}
+	else {
+		__ebr_set(__ebr_branch(new, EB_LEFT, sz), new_leaf, sz);
+		__ebr_set(__ebr_branch(new, EB_RGHT, sz), troot, sz);
+		__ebr_set(__ebr_leaf_p(new, sz), new_left, sz);
+		__ebr_publish(up_ptr, new_rght, sz);
+	}
+
+	/* Ok, now we are inserting <new> between <root> and <old>. <old>'s
+	 * parent is already set to <new>, and the <root>'s branch is still in
+	 * <side>.
+	 */
+	__ebr_publish(__ebr_branch(root, side, sz), eb_dotag(new, EB_NODE), sz);
+	return new;
+}
+
+#endif /* _EBR64TREE_H */
@@ -0,0 +1,55 @@
+/*
+ * Elastic Binary Trees - exported functions for Multi-Byte data nodes
+ * with relative addressing.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult ebrmbtree.h for more details about those functions */
+
+#include "ebrmbtree.h"
+
+struct ebmdb_node *ebmdb_lookup(struct ebm_root *root, const void *x, unsigned int len)
+{
+	return __ebrmb_lookup(root, x, len, sizeof(root->b[0]));
+}
+
+struct ebmdb_node *ebmdb_insert(struct ebm_root *root, struct ebmdb_node *new, unsigned int len)
+{
+	return __ebrmb_insert(root, new, len, sizeof(root->b[0]));
+}
+
+struct ebmdb_node *ebmdb_lookup_longest(struct ebm_root *root, const void *x)
+{
+	return __ebmdb_lookup_longest(root, x);
+}
+
+struct ebsdb_node *ebsdb_lookup(struct ebs_root *root, const void *x, unsigned int len)
+{
+	return __ebrmb_lookup(root, x, len, sizeof(root->b[0]));
+}
+
+struct ebsdb_node *ebsdb_insert(struct ebs_root *root, struct ebsdb_node *new, unsigned int len)
+{
+	return __ebrmb_insert(root, new, len, sizeof(root->b[0]));
+}
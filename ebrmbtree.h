@@ -0,0 +1,441 @@
+/*
+ * Elastic Binary Trees - macros and structures for Multi-Byte data nodes
+ * with relative addressing.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _EBRMBTREE_H
+#define _EBRMBTREE_H
+
+#include <string.h>
+#include "ebrtree.h"
+
+/* This structure carries a medium relative node, a leaf, and a key. It must
+ * start with the ebm_node, and the key must immediately follow it. Its size
+ * depends on the application, and must be the same for all keys of a tree.
+ */
+struct ebmdb_node {
+	struct ebm_node node; /* the tree node, must be at the beginning */
+	unsigned char key[0]; /* the key, its size depends on the application */
+};
+
+/* This structure carries a small relative node, a leaf, and a key. It must
+ * start with the ebs_node, and the key must immediately follow it.
+ */
+struct ebsdb_node {
+	struct ebs_node node; /* the tree node, must be at the beginning */
+	unsigned char key[0]; /* the key, its size depends on the application */
+};
+
+/*
+ * Exported functions and macros.
+ * Many of them are always inlined because they are extremely small, and
+ * are generally called at most once or twice in a program.
+ */
+
+/* Return leftmost node in the tree, or NULL if none */
+static inline struct ebmdb_node *ebmdb_first(struct ebm_root *root)
+{
+	return container_of(ebm_first(root), struct ebmdb_node, node);
+}
+
+/* Return rightmost node in the tree, or NULL if none */
+static inline struct ebmdb_node *ebmdb_last(struct ebm_root *root)
+{
+	return container_of(ebm_last(root), struct ebmdb_node, node);
+}
+
+/* Return next node in the tree, or NULL if none */
+static inline struct ebmdb_node *ebmdb_next(struct ebmdb_node *ebmdb)
+{
+	return container_of(ebm_next(&ebmdb->node), struct ebmdb_node, node);
+}
+
+/* Return previous node in the tree, or NULL if none */
+static inline struct ebmdb_node *ebmdb_prev(struct ebmdb_node *ebmdb)
+{
+	return container_of(ebm_prev(&ebmdb->node), struct ebmdb_node, node);
+}
+
+/* Delete node from the tree if it was linked in. Mark the node unused. */
+static inline void ebmdb_delete(struct ebmdb_node *ebmdb)
+{
+	ebm_delete(&ebmdb->node);
+}
+
+/* Return leftmost node in the tree, or NULL if none */
+static inline struct ebsdb_node *ebsdb_first(struct ebs_root *root)
+{
+	return container_of(ebs_first(root), struct ebsdb_node, node);
+}
+
+/* Return rightmost node in the tree, or NULL if none */
+static inline struct ebsdb_node *ebsdb_last(struct ebs_root *root)
+{
+	return container_of(ebs_last(root), struct ebsdb_node, node);
+}
+
+/* Return next node in the tree, or NULL if none */
+static inline struct ebsdb_node *ebsdb_next(struct ebsdb_node *ebsdb)
+{
+	return container_of(ebs_next(&ebsdb->node), struct ebsdb_node, node);
+}
+
+/* Return previous node in the tree, or NULL if none */
+static inline struct ebsdb_node *ebsdb_prev(struct ebsdb_node *ebsdb)
+{
+	return container_of(ebs_prev(&ebsdb->node), struct ebsdb_node, node);
+}
+
+/* Delete node from the tree if it was linked in. Mark the node unused. */
+static inline void ebsdb_delete(struct ebsdb_node *ebsdb)
+{
+	ebs_delete(&ebsdb->node);
+}
+
+/*
+ * The following functions are not inlined by default. They are declared
+ * in ebrmbtree.c, which simply relies on their inline version.
+ */
+struct ebmdb_node *ebmdb_lookup(struct ebm_root *root, const void *x, unsigned int len);
+struct ebmdb_node *ebmdb_insert(struct ebm_root *root, struct ebmdb_node *new, unsigned int len);
+struct ebmdb_node *ebmdb_lookup_longest(struct ebm_root *root, const void *x);
+
+struct ebsdb_node *ebsdb_lookup(struct ebs_root *root, const void *x, unsigned int len);
+struct ebsdb_node *ebsdb_insert(struct ebs_root *root, struct ebsdb_node *new, unsigned int len);
+
+/*
+ * The following functions are less likely to be used directly, because their
+ * code is larger. The non-inlined version is preferred. They are common to
+ * both addressing models, which are designated by their offset size <sz>.
+ */
+
+/* Returns a pointer to the key of node <node> */
+static forceinline unsigned char *__ebrmb_key(const void *node, const int sz)
+{
+	if (sz == 2)
+		return ((struct ebsdb_node *)node)->key;
+	return ((struct ebmdb_node *)node)->key;
+}
+
+/* Find the first occurence of a key of a least <len> bytes matching <x> in the
+ * tree <root>. The caller is responsible for ensuring that <len> will not exceed
+ * the common parts between the tree's keys and <x>. In case of multiple matches,
+ * the leftmost node is returned. This means that this function can be used to
+ * lookup string keys by prefix if all keys in the tree are zero-terminated. If
+ * no match is found, NULL is returned. Returns first node if <len> is zero.
+ */
+static forceinline void *__ebrmb_lookup(void *root, const void *x, unsigned int len, const int sz)
+{
+	void *node;
+	eb_troot_t *troot;
+	int pos, side;
+	int node_bit;
+
+	troot = __ebr_br(root, EB_LEFT, sz);
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	if (unlikely(len == 0))
+		goto walk_down;
+
+	pos = 0;
+	while (1) {
+		if (eb_gettag(troot) == EB_LEAF) {
+			node = eb_untag(troot, EB_LEAF);
+			if (memcmp(__ebrmb_key(node, sz) + pos, x, len) != 0)
+				return NULL;
+			return node;
+		}
+		node = eb_untag(troot, EB_NODE);
+
+		node_bit = *__ebr_bit(node, sz);
+		if (node_bit < 0) {
+			/* We have a dup tree now. Either it's for the same
+			 * value, and we walk down left, or it's a different
+			 * one and we don't have our key.
+			 */
+			if (memcmp(__ebrmb_key(node, sz) + pos, x, len) != 0)
+				return NULL;
+			goto walk_left;
+		}
+
+		/* OK, normal data node, let's walk down. We check if all full
+		 * bytes are equal, and we start from the last one we did not
+		 * completely check. We stop as soon as we reach the last byte,
+		 * because we must decide to go left/right or abort.
+		 */
+		node_bit = ~node_bit + (pos << 3) + 8; /* = (pos<<3) + (7 - node_bit) */
+		if (node_bit < 0) {
+			while (1) {
+				if (__ebrmb_key(node, sz)[pos++] ^ *(unsigned char*)(x++))
+					return NULL; /* more than one full byte is different */
+				if (--len == 0)
+					goto walk_left; /* return first node if all bytes matched */
+				node_bit += 8;
+				if (node_bit >= 0)
+					break;
+			}
+		}
+
+		/* here we know that only the last byte differs, so node_bit < 8.
+		 * We have 2 possibilities :
+		 *   - more than the last bit differs => return NULL
+		 *   - walk down on side = (x[pos] >> node_bit) & 1
+		 */
+		side = *(unsigned char *)x >> node_bit;
+		if (((__ebrmb_key(node, sz)[pos] >> node_bit) ^ side) > 1)
+			return NULL;
+		side &= 1;
+		troot = __ebr_br(node, side, sz);
+	}
+ walk_left:
+	troot = __ebr_br(node, EB_LEFT, sz);
+ walk_down:
+	return __ebr_walk_down(troot, EB_LEFT, sz);
+}
+
+/* Insert node <new> into subtree starting at node root <root>. Only the key
+ * of <new> needs be set. The node is returned. If the root's right branch is
+ * 1, the tree may only contain unique keys. The len is specified in bytes. It
+ * is absolutely mandatory that this length is the same for all keys in the
+ * tree.
+ */
+static forceinline void *__ebrmb_insert(void *root, void *new, unsigned int len, const int sz)
+{
+	void *old;
+	unsigned int side;
+	eb_troot_t *troot;
+	void *up_ptr;
+	eb_troot_t *root_right;
+	int diff;
+	int bit;
+	eb_troot_t *new_left, *new_rght;
+	eb_troot_t *new_leaf;
+	int old_node_bit;
+
+	side = EB_LEFT;
+	troot = __ebr_br(root, EB_LEFT, sz);
+	root_right = __ebr_br(root, EB_RGHT, sz);
+	if (unlikely(troot == NULL)) {
+		/* Tree is empty, insert the leaf part below the left branch */
+		__ebr_set(__ebr_leaf_p(new, sz), eb_dotag(root, EB_LEFT), sz);
+		__ebr_set(__ebr_node_p(new, sz), NULL, sz); /* node part unused */
+		__ebr_publish(__ebr_branch(root, EB_LEFT, sz), eb_dotag(new, EB_LEAF), sz);
+		return new;
+	}
+
+	/* The tree descent is the same as in __ebmb_insert() */
+	bit = 0;
+	while (1) {
+		if (unlikely(eb_gettag(troot) == EB_LEAF)) {
+			/* insert above a leaf */
+			old = eb_untag(troot, EB_LEAF);
+			__ebr_set(__ebr_node_p(new, sz), __ebr_get(__ebr_leaf_p(old, sz), sz), sz);
+			up_ptr = __ebr_leaf_p(old, sz);
+			goto check_bit_and_break;
+		}
+
+		/* OK we're walking down this link */
+		old = eb_untag(troot, EB_NODE);
+		old_node_bit = *__ebr_bit(old, sz);
+
+		if (unlikely(old_node_bit < 0)) {
+			/* We're above a duplicate tree, so we must compare the whole value */
+			__ebr_set(__ebr_node_p(new, sz), __ebr_get(__ebr_node_p(old, sz), sz), sz);
+			up_ptr = __ebr_node_p(old, sz);
+		check_bit_and_break:
+			bit = equal_bits(__ebrmb_key(new, sz), __ebrmb_key(old, sz), bit, len << 3);
+			break;
+		}
+
+		/* Stop going down when we don't have common bits anymore. We
+		 * also stop in front of a duplicates tree because it means we
+		 * have to insert above.
+		 */
+		bit = equal_bits(__ebrmb_key(new, sz), __ebrmb_key(old, sz), bit, old_node_bit);
+		if (unlikely(bit < old_node_bit)) {
+			/* The tree did not contain the key, so we insert <new> before the
+			 * node <old>, and set ->bit to designate the lowest bit position in
+			 * <new> which applies to ->branches.b[].
+			 */
+			__ebr_set(__ebr_node_p(new, sz), __ebr_get(__ebr_node_p(old, sz), sz), sz);
+			up_ptr = __ebr_node_p(old, sz);
+			break;
+		}
+		/* we don't want to skip bits for further comparisons, so we must limit <bit>.
+		 * However, since we're going down around <old_node_bit>, we know it will be
+		 * properly matched, so we can skip this bit.
+		 */
+		bit = old_node_bit + 1;
+
+		/* walk down */
+		root = old;
+		side = old_node_bit & 7;
+		side ^= 7;
+		side = (__ebrmb_key(new, sz)[old_node_bit >> 3] >> side) & 1;
+		troot = __ebr_br(root, side, sz);
+	}
+
+	new_left = eb_dotag(new, EB_LEFT);
+	new_rght = eb_dotag(new, EB_RGHT);
+	new_leaf = eb_dotag(new, EB_LEAF);
+
+	*__ebr_bit(new, sz) = bit;
+
+	/* Note: we can compare more bits than the current node's because as
+	 * long as they are identical, we know we descend along the correct
+	 * side. However we don't want to start to compare past the end.
+	 */
+	diff = 0;
+	if (((unsigned)bit >> 3) < len)
+		diff = cmp_bits(__ebrmb_key(new, sz), __ebrmb_key(old, sz), bit);
+
+	if (diff == 0) {
+		*__ebr_bit(new, sz) = -1; /* mark as new dup tree, just in case */
+
+		if (likely(eb_gettag(root_right))) {
+			/* we refuse to duplicate this key if the tree is
+			 * tagged as containing only unique keys.
+			 */
+			return old;
+		}
+
+		if (eb_gettag(troot) != EB_LEAF) {
+			/* there was already a dup tree below */
+			if (sz == 2)
+				return ebs_insert_dup(old, new);
+			return ebm_insert_dup(old, new);
+		}
+		/* otherwise fall through */
+	}
+
+	if (diff >= 0) {
+		__ebr_set(__ebr_branch(new, EB_LEFT, sz), troot, sz);
+		__ebr_set(__ebr_branch(new, EB_RGHT, sz), new_leaf, sz);
+		__ebr_set(__ebr_leaf_p(new, sz), new_rght, sz);
+		__ebr_publish(up_ptr, new_left, sz);
+	}
+	else {
+		__ebr_set(__ebr_branch(new, EB_LEFT, sz), new_leaf, sz);
+		__ebr_set(__ebr_branch(new, EB_RGHT, sz), troot, sz);
+		__ebr_set(__ebr_leaf_p(new, sz), new_left, sz);
+		__ebr_publish(up_ptr, new_rght, sz);
+	}
+
+	/* Ok, now we are inserting <new> between <root> and <old>. <old>'s
+	 * parent is already set to <new>, and the <root>'s branch is still in
+	 * <side>.
+	 */
+	__ebr_publish(__ebr_branch(root, side, sz), eb_dotag(new, EB_NODE), sz);
+	return new;
+}
+
+/* Find the first occurence of the longest prefix matching a key <x> in the
+ * medium relative tree <root>. This is the same as __ebmb_lookup_longest(),
+ * and it only works on trees built by prefix insertion, which in practice
+ * are copied from an ebmb tree (see ebimage.h). It is only available with
+ * medium relative nodes since small relative ones do not have the prefix
+ * length. If none can be found, return NULL.
+ */
+static forceinline struct ebmdb_node *__ebmdb_lookup_longest(struct ebm_root *root, const void *x)
+{
+	struct ebmdb_node *node;
+	eb_troot_t *troot, *cover;
+	int pos, side;
+	int node_bit;
+	const int sz = sizeof(root->b[0]);
+
+	troot = __ebr_br(root, EB_LEFT, sz);
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	cover = NULL;
+	pos = 0;
+	while (1) {
+		if ((eb_gettag(troot) == EB_LEAF)) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebmdb_node, node.branches);
+			if (check_bits((unsigned char *)x - pos, node->key, pos, node->node.pfx))
+				goto not_found;
+
+			return node;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct ebmdb_node, node.branches);
+
+		node_bit = node->node.bit;
+		if (node_bit < 0) {
+			/* We have a dup tree now. Either it's for the same
+			 * value, and we walk down left, or it's a different
+			 * one and we don't have our key.
+			 */
+			if (check_bits((unsigned char *)x - pos, node->key, pos, node->node.pfx))
+				goto not_found;
+
+			return __ebr_walk_down(__ebr_br(node, EB_LEFT, sz), EB_LEFT, sz);
+		}
+
+		node_bit >>= 1; /* strip cover bit */
+		node_bit = ~node_bit + (pos << 3) + 8; /* = (pos<<3) + (7 - node_bit) */
+		if (node_bit < 0) {
+			while (1) {
+				x++; pos++;
+				if (node->key[pos-1] ^ *((unsigned char*)x - 1))
+					goto not_found; /* more than one full byte is different */
+				node_bit += 8;
+				if (node_bit >= 0)
+					break;
+			}
+		}
+
+		/* here we know that only the last byte differs, so 0 <= node_bit <= 7.
+		 * We have 2 possibilities :
+		 *   - more than the last bit differs => data does not match
+		 *   - walk down on side = (x[pos] >> node_bit) & 1
+		 */
+		side = *(unsigned char *)x >> node_bit;
+		if (((node->key[pos] >> node_bit) ^ side) > 1)
+			goto not_found;
+
+		if (!(node->node.bit & 1)) {
+			/* This is a cover node, let's keep a reference to it
+			 * for later. The covering subtree is on the left, and
+			 * the covered subtree is on the right, so we have to
+			 * walk down right.
+			 */
+			cover = __ebr_br(node, EB_LEFT, sz);
+			troot = __ebr_br(node, EB_RGHT, sz);
+			continue;
+		}
+		side &= 1;
+		troot = __ebr_br(node, side, sz);
+	}
+
+ not_found:
+	/* Walk down last cover tree if it exists. It does not matter if cover is NULL */
+	return __ebr_walk_down(cover, EB_LEFT, sz);
+}
+
+#endif /* _EBRMBTREE_H */
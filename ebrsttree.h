@@ -0,0 +1,112 @@
+/*
+ * Elastic Binary Trees - macros to manipulate String data nodes with
+ * relative addressing.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* These functions and macros rely on Multi-Byte nodes */
+
+#ifndef _EBRSTTREE_H
+#define _EBRSTTREE_H
+
+#include <string.h>
+#include "ebrtree.h"
+#include "ebrmbtree.h"
+
+/* The following functions are not inlined by default. They are declared
+ * in ebrsttree.c, which simply relies on their inline version.
+ */
+struct ebmdb_node *ebmds_lookup(struct ebm_root *root, const char *x);
+struct ebsdb_node *ebsds_lookup(struct ebs_root *root, const char *x);
+
+/* Find the first occurence of a zero-terminated string <x> in the tree <root>.
+ * It's the caller's reponsibility to use this function only on trees which
+ * only contain zero-terminated strings. If none can be found, return NULL.
+ * This is the same as __ebst_lookup().
+ */
+static forceinline void *__ebrst_lookup(void *root, const void *x, const int sz)
+{
+	void *node;
+	eb_troot_t *troot;
+	int bit;
+	int node_bit;
+
+	troot = __ebr_br(root, EB_LEFT, sz);
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	bit = 0;
+	while (1) {
+		if ((eb_gettag(troot) == EB_LEAF)) {
+			node = eb_untag(troot, EB_LEAF);
+			if (strcmp((char *)__ebrmb_key(node, sz), x) == 0)
+				return node;
+			else
+				return NULL;
+		}
+		node = eb_untag(troot, EB_NODE);
+		node_bit = *__ebr_bit(node, sz);
+
+		if (node_bit < 0) {
+			/* We have a dup tree now. Either it's for the same
+			 * value, and we walk down left, or it's a different
+			 * one and we don't have our key.
+			 */
+			if (strcmp((char *)__ebrmb_key(node, sz), x) != 0)
+				return NULL;
+
+			return __ebr_walk_down(__ebr_br(node, EB_LEFT, sz), EB_LEFT, sz);
+		}
+
+		/* OK, normal data node, let's walk down but don't compare data
+		 * if we already reached the end of the key.
+		 */
+		if (likely(bit >= 0)) {
+			bit = string_equal_bits(x, __ebrmb_key(node, sz), bit);
+			if (likely(bit < node_bit)) {
+				if (bit >= 0)
+					return NULL; /* no more common bits */
+
+				/* bit < 0 : we reached the end of the key. If we
+				 * are in a tree with unique keys, we can return
+				 * this node. Otherwise we have to walk it down
+				 * and stop comparing bits.
+				 */
+				if (eb_gettag(__ebr_br(root, EB_RGHT, sz)))
+					return node;
+			}
+			/* if the bit is larger than the node's, we must bound it
+			 * because we might have compared too many bytes with an
+			 * inappropriate leaf (see __ebst_lookup()).
+			 */
+			else
+				bit = node_bit;
+		}
+
+		troot = __ebr_br(node, (((unsigned char*)x)[node_bit >> 3] >>
+					(~node_bit & 7)) & 1, sz);
+	}
+}
+
+#endif /* _EBRSTTREE_H */
@@ -0,0 +1,73 @@
+/*
+ * Elastic Binary Trees - exported generic functions for relative addressing
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ebrtree.h"
+
+/* Return next leaf node after an existing leaf node, or NULL if none. */
+struct ebm_node *ebm_next(struct ebm_node *node)
+{
+	return __ebr_next(node, sizeof(node->node_p));
+}
+
+/* Return previous leaf node before an existing leaf node, or NULL if none. */
+struct ebm_node *ebm_prev(struct ebm_node *node)
+{
+	return __ebr_prev(node, sizeof(node->node_p));
+}
+
+void ebm_delete(struct ebm_node *node)
+{
+	__ebr_delete(node, sizeof(node->node_p));
+}
+
+/* used by insertion primitives */
+struct ebm_node *ebm_insert_dup(struct ebm_node *sub, struct ebm_node *new)
+{
+	return __ebr_insert_dup(sub, new, sizeof(new->node_p));
+}
+
+/* Return next leaf node after an existing leaf node, or NULL if none. */
+struct ebs_node *ebs_next(struct ebs_node *node)
+{
+	return __ebr_next(node, sizeof(node->node_p));
+}
+
+/* Return previous leaf node before an existing leaf node, or NULL if none. */
+struct ebs_node *ebs_prev(struct ebs_node *node)
+{
+	return __ebr_prev(node, sizeof(node->node_p));
+}
+
+void ebs_delete(struct ebs_node *node)
+{
+	__ebr_delete(node, sizeof(node->node_p));
+}
+
+/* used by insertion primitives */
+struct ebs_node *ebs_insert_dup(struct ebs_node *sub, struct ebs_node *new)
+{
+	return __ebr_insert_dup(sub, new, sizeof(new->node_p));
+}
@@ -0,0 +1,462 @@
+/*
+ * Elastic Binary Trees - generic macros and structures for relative addressing.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+  Relative addressing
+  -------------------
+  These trees are exactly the same as the ones described in ebtree.h, except
+  that the branches, node_p and leaf_p pointers are replaced with signed
+  offsets. Following doc/naming.txt, two addressing models are supported :
+
+    - medium relative ("ebm"), with 32-bit offsets. A node takes 20 bytes
+      instead of 36 on 64-bit machines, and all nodes and the root must be
+      located within +/- 2 GB of each other.
+
+    - small relative ("ebs"), with 16-bit offsets. A node takes 10 bytes,
+      and all nodes and the root must be located within +/- 32 kB of each
+      other.
+
+  An offset designates the distance in bytes between the end of the location
+  storing it and the eb_root it designates. Nodes and roots are always at
+  least 16-bit aligned, so this distance is even and bit 0 carries the same
+  tag as absolute pointers do (EB_LEAF/EB_NODE or EB_LEFT/EB_RGHT). Since no
+  node may start right after a location designating it (the root's right
+  branch never designates anything), a zero distance is never used and it
+  represents NULL. This way a zeroed area is an empty root or an unlinked
+  node, just like with absolute pointers.
+
+  Since no absolute address is stored anywhere, a tree built this way may be
+  moved, copied, shared between processes or mapped at any address, provided
+  that the root and all the nodes are moved together. This is convenient for
+  trees built inside a single arena or a shared memory segment.
+
+  The generic code below works on both models, which only differ by the
+  offset size <sz> (2 or 4), always passed as a constant so that the compiler
+  can eliminate the irrelevant code. Offsets are decoded into regular tagged
+  pointers (eb_troot_t) when loaded and encoded again when stored, so that the
+  algorithms are the same as in ebtree.h. Note that it is not possible to copy
+  an offset from one location to another without re-encoding it.
+ */
+
+#ifndef _EBRTREE_H
+#define _EBRTREE_H
+
+#include "ebtree.h"
+
+/* The root of a medium relative tree. It is initialized with both offsets
+ * zero (NULL), and only the left one changes during its life. The right one
+ * is set to 1 (NULL tagged with 1) for trees only accepting unique keys.
+ */
+struct ebm_root {
+	signed int     b[EB_NODE_BRANCHES]; /* left and right branches */
+};
+
+/* The medium relative node. It is the same as the eb_node, with 32-bit
+ * offsets instead of pointers. Do not change the order, the generic code
+ * relies on it. The prefix length fits in what would otherwise be padding.
+ */
+struct ebm_node {
+	struct ebm_root branches; /* branches, must be at the beginning */
+	signed int     node_p;  /* link node's parent */
+	signed int     leaf_p;  /* leaf node's parent */
+	short int      bit;     /* link's bit position. */
+	short unsigned int pfx; /* data prefix length, always related to leaf */
+};
+
+/* The root of a small relative tree */
+struct ebs_root {
+	signed short   b[EB_NODE_BRANCHES]; /* left and right branches */
+};
+
+/* The small relative node, with 16-bit offsets instead of pointers. There is
+ * no room for the prefix length here.
+ */
+struct ebs_node {
+	struct ebs_root branches; /* branches, must be at the beginning */
+	signed short   node_p;  /* link node's parent */
+	signed short   leaf_p;  /* leaf node's parent */
+	short int      bit;     /* link's bit position. */
+};
+
+#define EBM_ROOT						\
+	(struct ebm_root) {				\
+		.b = {[0] = 0, [1] = 0 },		\
+	}
+
+#define EBM_ROOT_UNIQUE					\
+	(struct ebm_root) {				\
+		.b = {[0] = 0, [1] = 1 },		\
+	}
+
+#define EBS_ROOT						\
+	(struct ebs_root) {				\
+		.b = {[0] = 0, [1] = 0 },		\
+	}
+
+#define EBS_ROOT_UNIQUE					\
+	(struct ebs_root) {				\
+		.b = {[0] = 0, [1] = 1 },		\
+	}
+
+
+/***************************************\
+ * Private functions. Not for end-user *
+\***************************************/
+
+/* Returns the tagged pointer designated by the <sz>-byte offset stored at
+ * <ptr>. NULL is returned with its tag.
+ */
+static forceinline eb_troot_t *__ebr_get(const void *ptr, const int sz)
+{
+	unsigned long base = (unsigned long)ptr + sz;
+	long ofs;
+
+	if (sz == 2)
+		ofs = *(const signed short *)ptr;
+	else
+		ofs = *(const signed int *)ptr;
+
+	if (!(ofs & ~1L))
+		base = 0;
+	return (eb_troot_t *)(base + ofs);
+}
+
+/* Returns the offset to store at <ptr> to designate tagged pointer <troot> */
+static forceinline long __ebr_ofs(const void *ptr, const eb_troot_t *troot, const int sz)
+{
+	unsigned long base = (unsigned long)ptr + sz;
+
+	/* NULL is kept as-is with its tag, this is branchless */
+	base &= -(unsigned long)((unsigned long)troot > 1);
+	return (unsigned long)troot - base;
+}
+
+/* Stores into <ptr> the <sz>-byte offset designating tagged pointer <troot> */
+static forceinline void __ebr_set(void *ptr, const eb_troot_t *troot, const int sz)
+{
+	long ofs = __ebr_ofs(ptr, troot, sz);
+
+	if (sz == 2)
+		*(signed short *)ptr = ofs;
+	else
+		*(signed int *)ptr = ofs;
+}
+
+/* Same as __ebr_set() but with release semantics, see eb_publish() */
+static forceinline void __ebr_publish(void *ptr, const eb_troot_t *troot, const int sz)
+{
+	long ofs = __ebr_ofs(ptr, troot, sz);
+
+	if (sz == 2)
+		eb_publish((signed short *)ptr, (signed short)ofs);
+	else
+		eb_publish((signed int *)ptr, (signed int)ofs);
+}
+
+/* Returns the location of branch <side> of node or root <node> */
+static forceinline void *__ebr_branch(const void *node, unsigned int side, const int sz)
+{
+	return (char *)node + side * sz;
+}
+
+/* Returns the location of the node_p offset of node <node> */
+static forceinline void *__ebr_node_p(const void *node, const int sz)
+{
+	return (char *)node + 2 * sz;
+}
+
+/* Returns the location of the leaf_p offset of node <node> */
+static forceinline void *__ebr_leaf_p(const void *node, const int sz)
+{
+	return (char *)node + 3 * sz;
+}
+
+/* Returns the location of the bit field of node <node> */
+static forceinline short *__ebr_bit(const void *node, const int sz)
+{
+	return (short *)((char *)node + 4 * sz);
+}
+
+/* Returns the tagged pointer found in branch <side> of node or root <node> */
+static forceinline eb_troot_t *__ebr_br(const void *node, unsigned int side, const int sz)
+{
+	return __ebr_get(__ebr_branch(node, side, sz), sz);
+}
+
+/* Walks down starting at tagged pointer <start>, and always walking on side
+ * <side>. It either returns the node hosting the first leaf on that side,
+ * or NULL if no leaf is found. <start> may either be NULL or a branch pointer.
+ */
+static forceinline void *__ebr_walk_down(eb_troot_t *start, unsigned int side, const int sz)
+{
+	/* A NULL pointer on an empty tree root will be returned as-is */
+	while (eb_gettag(start) == EB_NODE)
+		start = __ebr_br(eb_untag(start, EB_NODE), side, sz);
+	/* NULL is left untouched (EB_LEAF==0) */
+	return eb_untag(start, EB_LEAF);
+}
+
+/* Return the first leaf in the tree starting at <root>, or NULL if none */
+static forceinline void *__ebr_first(const void *root, const int sz)
+{
+	return __ebr_walk_down(__ebr_br(root, EB_LEFT, sz), EB_LEFT, sz);
+}
+
+/* Return the last leaf in the tree starting at <root>, or NULL if none */
+static forceinline void *__ebr_last(const void *root, const int sz)
+{
+	return __ebr_walk_down(__ebr_br(root, EB_LEFT, sz), EB_RGHT, sz);
+}
+
+/* Return previous leaf node before an existing leaf node, or NULL if none. */
+static forceinline void *__ebr_prev(const void *node, const int sz)
+{
+	eb_troot_t *t = __ebr_get(__ebr_leaf_p(node, sz), sz);
+
+	while (eb_gettag(t) == EB_LEFT) {
+		/* Walking up from left branch. We must ensure that we never
+		 * walk beyond root.
+		 */
+		if (unlikely(eb_clrtag(__ebr_br(eb_untag(t, EB_LEFT), EB_RGHT, sz)) == NULL))
+			return NULL;
+		t = __ebr_get(__ebr_node_p(eb_untag(t, EB_LEFT), sz), sz);
+	}
+	/* Note that <t> cannot be NULL at this stage */
+	t = __ebr_br(eb_untag(t, EB_RGHT), EB_LEFT, sz);
+	return __ebr_walk_down(t, EB_RGHT, sz);
+}
+
+/* Return next leaf node after an existing leaf node, or NULL if none. */
+static forceinline void *__ebr_next(const void *node, const int sz)
+{
+	eb_troot_t *t = __ebr_get(__ebr_leaf_p(node, sz), sz);
+
+	while (eb_gettag(t) != EB_LEFT)
+		/* Walking up from right branch, so we cannot be below root */
+		t = __ebr_get(__ebr_node_p(eb_untag(t, EB_RGHT), sz), sz);
+
+	/* Note that <t> cannot be NULL at this stage */
+	t = __ebr_br(eb_untag(t, EB_LEFT), EB_RGHT, sz);
+	if (eb_clrtag(t) == NULL)
+		return NULL;
+	return __ebr_walk_down(t, EB_LEFT, sz);
+}
+
+/* Adds node <new> to the duplicates subtree <sub> of at least 2 entries. This
+ * is the same as __eb_insert_dup().
+ */
+static forceinline void *__ebr_insert_dup(void *sub, void *new, const int sz)
+{
+	void *head = sub;
+	eb_troot_t *t;
+
+	eb_troot_t *new_left = eb_dotag(new, EB_LEFT);
+	eb_troot_t *new_rght = eb_dotag(new, EB_RGHT);
+	eb_troot_t *new_leaf = eb_dotag(new, EB_LEAF);
+
+	/* first, identify the deepest hole on the right branch */
+	while (eb_gettag(t = __ebr_br(head, EB_RGHT, sz)) != EB_LEAF) {
+		void *last = head;
+		head = eb_untag(t, EB_NODE);
+		if (*__ebr_bit(head, sz) > *__ebr_bit(last, sz) + 1)
+			sub = head;     /* there's a hole here */
+	}
+
+	/* Here we have a leaf attached to (head)->b[EB_RGHT] */
+	if (*__ebr_bit(head, sz) < -1) {
+		/* A hole exists just before the leaf, we insert there */
+		*__ebr_bit(new, sz) = -1;
+		sub = eb_untag(t, EB_LEAF);
+
+		__ebr_set(__ebr_node_p(new, sz), __ebr_get(__ebr_leaf_p(sub, sz), sz), sz);
+		__ebr_set(__ebr_leaf_p(new, sz), new_rght, sz);
+		__ebr_set(__ebr_branch(new, EB_LEFT, sz), eb_dotag(sub, EB_LEAF), sz);
+		__ebr_set(__ebr_branch(new, EB_RGHT, sz), new_leaf, sz);
+		__ebr_publish(__ebr_leaf_p(sub, sz), new_left, sz);
+		__ebr_publish(__ebr_branch(head, EB_RGHT, sz), eb_dotag(new, EB_NODE), sz);
+		return new;
+	} else {
+		int side;
+		/* No hole was found before a leaf. We have to insert above
+		 * <sub>. Note that we cannot be certain that <sub> is attached
+		 * to the right of its parent, as this is only true if <sub>
+		 * is inside the dup tree, not at the head.
+		 */
+		*__ebr_bit(new, sz) = *__ebr_bit(sub, sz) - 1; /* install at the lowest level */
+		t = __ebr_get(__ebr_node_p(sub, sz), sz);
+		side = eb_gettag(t);
+		head = eb_untag(t, side);
+
+		__ebr_set(__ebr_node_p(new, sz), t, sz);
+		__ebr_set(__ebr_leaf_p(new, sz), new_rght, sz);
+		__ebr_set(__ebr_branch(new, EB_LEFT, sz), eb_dotag(sub, EB_NODE), sz);
+		__ebr_set(__ebr_branch(new, EB_RGHT, sz), new_leaf, sz);
+		__ebr_publish(__ebr_node_p(sub, sz), new_left, sz);
+		__ebr_publish(__ebr_branch(head, side, sz), eb_dotag(new, EB_NODE), sz);
+		return new;
+	}
+}
+
+/* Removes a leaf node from the tree if it was still in it. Marks the node
+ * as unlinked. This is the same as __eb_delete().
+ */
+static forceinline void __ebr_delete(void *node, const int sz)
+{
+	unsigned int pside, gpside;
+	void *parent, *gparent;
+	eb_troot_t *t;
+
+	t = __ebr_get(__ebr_leaf_p(node, sz), sz);
+	if (!t)
+		return;
+
+	/* we need the parent, our side, and the grand parent */
+	pside = eb_gettag(t);
+	parent = eb_untag(t, pside);
+
+	if (eb_clrtag(__ebr_br(parent, EB_RGHT, sz)) == NULL) {
+		/* we're just below the root, it's trivial. */
+		__ebr_set(__ebr_branch(parent, EB_LEFT, sz), NULL, sz);
+		goto delete_unlink;
+	}
+
+	/* To release our parent, we have to identify our sibling, and reparent
+	 * it directly to/from the grand parent.
+	 */
+	t = __ebr_get(__ebr_node_p(parent, sz), sz);
+	gpside = eb_gettag(t);
+	gparent = eb_untag(t, gpside);
+
+	t = __ebr_br(parent, !pside, sz);
+	__ebr_set(__ebr_branch(gparent, gpside, sz), t, sz);
+
+	if (eb_gettag(t) == EB_LEAF)
+		__ebr_set(__ebr_leaf_p(eb_untag(t, EB_LEAF), sz), eb_dotag(gparent, gpside), sz);
+	else
+		__ebr_set(__ebr_node_p(eb_untag(t, EB_NODE), sz), eb_dotag(gparent, gpside), sz);
+
+	/* Mark the parent unused. If it is our own node, we'll see it below */
+	__ebr_set(__ebr_node_p(parent, sz), NULL, sz);
+
+	/* If our link part is unused, we can safely exit now */
+	t = __ebr_get(__ebr_node_p(node, sz), sz);
+	if (!t)
+		goto delete_unlink;
+
+	/* From now on, <node> and <parent> are necessarily different, and the
+	 * <node>'s node part is in use, so <parent> takes its place.
+	 */
+	__ebr_set(__ebr_node_p(parent, sz), t, sz);
+	__ebr_set(__ebr_branch(parent, EB_LEFT, sz), __ebr_br(node, EB_LEFT, sz), sz);
+	__ebr_set(__ebr_branch(parent, EB_RGHT, sz), __ebr_br(node, EB_RGHT, sz), sz);
+	*__ebr_bit(parent, sz) = *__ebr_bit(node, sz);
+
+	/* We must now update the new node's parent... */
+	gpside = eb_gettag(t);
+	gparent = eb_untag(t, gpside);
+	__ebr_set(__ebr_branch(gparent, gpside, sz), eb_dotag(parent, EB_NODE), sz);
+
+	/* ... and its branches */
+	for (pside = 0; pside <= 1; pside++) {
+		t = __ebr_br(parent, pside, sz);
+		if (eb_gettag(t) == EB_NODE)
+			__ebr_set(__ebr_node_p(eb_untag(t, EB_NODE), sz), eb_dotag(parent, pside), sz);
+		else
+			__ebr_set(__ebr_leaf_p(eb_untag(t, EB_LEAF), sz), eb_dotag(parent, pside), sz);
+	}
+ delete_unlink:
+	/* Now the node has been completely unlinked */
+	__ebr_set(__ebr_leaf_p(node, sz), NULL, sz);
+}
+
+
+/**************************************\
+ * Public functions, for the end-user *
+\**************************************/
+
+/* Return non-zero if the tree is empty, otherwise zero */
+static inline int ebm_is_empty(const struct ebm_root *root)
+{
+	return !root->b[EB_LEFT];
+}
+
+/* Return non-zero if the tree is empty, otherwise zero */
+static inline int ebs_is_empty(const struct ebs_root *root)
+{
+	return !root->b[EB_LEFT];
+}
+
+/* Return non-zero if the node is a duplicate, otherwise zero */
+static inline int ebm_is_dup(const struct ebm_node *node)
+{
+	return node->bit < 0;
+}
+
+/* Return non-zero if the node is a duplicate, otherwise zero */
+static inline int ebs_is_dup(const struct ebs_node *node)
+{
+	return node->bit < 0;
+}
+
+/* Return the first leaf in the tree starting at <root>, or NULL if none */
+static inline struct ebm_node *ebm_first(struct ebm_root *root)
+{
+	return __ebr_first(root, sizeof(root->b[0]));
+}
+
+/* Return the last leaf in the tree starting at <root>, or NULL if none */
+static inline struct ebm_node *ebm_last(struct ebm_root *root)
+{
+	return __ebr_last(root, sizeof(root->b[0]));
+}
+
+/* Return the first leaf in the tree starting at <root>, or NULL if none */
+static inline struct ebs_node *ebs_first(struct ebs_root *root)
+{
+	return __ebr_first(root, sizeof(root->b[0]));
+}
+
+/* Return the last leaf in the tree starting at <root>, or NULL if none */
+static inline struct ebs_node *ebs_last(struct ebs_root *root)
+{
+	return __ebr_last(root, sizeof(root->b[0]));
+}
+
+/*
+ * The following functions are not inlined by default. They are declared
+ * in ebrtree.c, which simply relies on their inline version.
+ */
+struct ebm_node *ebm_next(struct ebm_node *node);
+struct ebm_node *ebm_prev(struct ebm_node *node);
+void ebm_delete(struct ebm_node *node);
+struct ebm_node *ebm_insert_dup(struct ebm_node *sub, struct ebm_node *new);
+
+struct ebs_node *ebs_next(struct ebs_node *node);
+struct ebs_node *ebs_prev(struct ebs_node *node);
+void ebs_delete(struct ebs_node *node);
+struct ebs_node *ebs_insert_dup(struct ebs_node *sub, struct ebs_node *new);
+
+#endif /* _EBRTREE_H */
@@ -0,0 +1,227 @@
+/*
+ * Elastic Binary Trees - exported functions for sharded trees.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult ebshard.h for more details about those functions */
+
+#include "ebshard.h"
+
+/* Initialize the sharded root <sr> with the 2^<bits> shards pointed to by
+ * <shards>, which hold empty trees of unique keys if <unique> is non-zero.
+ * <bits> must be lower than 32.
+ */
+void ebshard_init(struct ebshard_root *sr, struct ebshard *shards, unsigned int bits, int unique)
+{
+	struct eb_root root = EB_ROOT;
+	struct eb_root root_unique = EB_ROOT_UNIQUE;
+	unsigned int i;
+
+	sr->shard = shards;
+	sr->bits = bits;
+	for (i = 0; i < ebshard_count(sr); i++) {
+		shards[i].root = unique ? root_unique : root;
+		shards[i].lock = 0;
+	}
+}
+
+/* Return non-zero if all the shards of <sr> are empty */
+int ebshard_is_empty(struct ebshard_root *sr)
+{
+	unsigned int i;
+
+	for (i = 0; i < ebshard_count(sr); i++) {
+		if (!eb_is_empty(&sr->shard[i].root))
+			return 0;
+	}
+	return 1;
+}
+
+/* Insert <new> into the shard of <sr> which holds new->key. The node is
+ * returned, or the existing one if the shards only hold unique keys.
+ */
+struct eb32_node *eb32sh_insert(struct ebshard_root *sr, struct eb32_node *new)
+{
+	struct ebshard *shard = eb32sh_shard(sr, new->key);
+	struct eb32_node *ret;
+
+	ebshard_lock(shard);
+	ret = __eb32_insert(&shard->root, new);
+	ebshard_unlock(shard);
+	return ret;
+}
+
+/* Delete <node> from <sr> if it was queued. Its key must not have changed. */
+void eb32sh_delete(struct ebshard_root *sr, struct eb32_node *node)
+{
+	struct ebshard *shard = eb32sh_shard(sr, node->key);
+
+	ebshard_lock(shard);
+	__eb_delete(&node->node);
+	ebshard_unlock(shard);
+}
+
+/* Return the first node of <sr> whose key is <x>, or NULL if none */
+struct eb32_node *eb32sh_lookup(struct ebshard_root *sr, u32 x)
+{
+	struct ebshard *shard = eb32sh_shard(sr, x);
+	struct eb32_node *ret;
+
+	ebshard_lock(shard);
+	ret = __eb32_lookup(&shard->root, x);
+	ebshard_unlock(shard);
+	return ret;
+}
+
+/* Return the first node of <sr> whose key is greater than or equal to <x>,
+ * looking into the next shards if <x>'s shard has none, or NULL if none.
+ */
+struct eb32_node *eb32sh_lookup_ge(struct ebshard_root *sr, u32 x)
+{
+	struct ebshard *shard = eb32sh_shard(sr, x);
+	struct ebshard *end = sr->shard + ebshard_count(sr);
+	struct eb32_node *ret;
+
+	ebshard_lock(shard);
+	ret = eb32_lookup_ge(&shard->root, x);
+	ebshard_unlock(shard);
+
+	while (!ret && ++shard < end) {
+		ebshard_lock(shard);
+		ret = eb32_first(&shard->root);
+		ebshard_unlock(shard);
+	}
+	return ret;
+}
+
+/* Return the node of <sr> with the lowest key, or NULL if all shards are empty */
+struct eb32_node *eb32sh_first(struct ebshard_root *sr)
+{
+	return eb32sh_lookup_ge(sr, 0);
+}
+
+/* Return the node following <node> in <sr>, which may be the first one of a
+ * next shard, or NULL if none. <node> must still be queued.
+ */
+struct eb32_node *eb32sh_next(struct ebshard_root *sr, struct eb32_node *node)
+{
+	struct ebshard *shard = eb32sh_shard(sr, node->key);
+	struct ebshard *end = sr->shard + ebshard_count(sr);
+	struct eb32_node *ret;
+
+	ebshard_lock(shard);
+	ret = eb32_next(node);
+	ebshard_unlock(shard);
+
+	while (!ret && ++shard < end) {
+		ebshard_lock(shard);
+		ret = eb32_first(&shard->root);
+		ebshard_unlock(shard);
+	}
+	return ret;
+}
+
+/* Insert <new> into the shard of <sr> which holds new->key. The node is
+ * returned, or the existing one if the shards only hold unique keys.
+ */
+struct eb64_node *eb64sh_insert(struct ebshard_root *sr, struct eb64_node *new)
+{
+	struct ebshard *shard = eb64sh_shard(sr, new->key);
+	struct eb64_node *ret;
+
+	ebshard_lock(shard);
+	ret = __eb64_insert(&shard->root, new);
+	ebshard_unlock(shard);
+	return ret;
+}
+
+/* Delete <node> from <sr> if it was queued. Its key must not have changed. */
+void eb64sh_delete(struct ebshard_root *sr, struct eb64_node *node)
+{
+	struct ebshard *shard = eb64sh_shard(sr, node->key);
+
+	ebshard_lock(shard);
+	__eb_delete(&node->node);
+	ebshard_unlock(shard);
+}
+
+/* Return the first node of <sr> whose key is <x>, or NULL if none */
+struct eb64_node *eb64sh_lookup(struct ebshard_root *sr, u64 x)
+{
+	struct ebshard *shard = eb64sh_shard(sr, x);
+	struct eb64_node *ret;
+
+	ebshard_lock(shard);
+	ret = __eb64_lookup(&shard->root, x);
+	ebshard_unlock(shard);
+	return ret;
+}
+
+/* Return the first node of <sr> whose key is greater than or equal to <x>,
+ * looking into the next shards if <x>'s shard has none, or NULL if none.
+ */
+struct eb64_node *eb64sh_lookup_ge(struct ebshard_root *sr, u64 x)
+{
+	struct ebshard *shard = eb64sh_shard(sr, x);
+	struct ebshard *end = sr->shard + ebshard_count(sr);
+	struct eb64_node *ret;
+
+	ebshard_lock(shard);
+	ret = eb64_lookup_ge(&shard->root, x);
+	ebshard_unlock(shard);
+
+	while (!ret && ++shard < end) {
+		ebshard_lock(shard);
+		ret = eb64_first(&shard->root);
+		ebshard_unlock(shard);
+	}
+	return ret;
+}
+
+/* Return the node of <sr> with the lowest key, or NULL if all shards are empty */
+struct eb64_node *eb64sh_first(struct ebshard_root *sr)
+{
+	return eb64sh_lookup_ge(sr, 0);
+}
+
+/* Return the node following <node> in <sr>, which may be the first one of a
+ * next shard, or NULL if none. <node> must still be queued.
+ */
+struct eb64_node *eb64sh_next(struct ebshard_root *sr, struct eb64_node *node)
+{
+	struct ebshard *shard = eb64sh_shard(sr, node->key);
+	struct ebshard *end = sr->shard + ebshard_count(sr);
+	struct eb64_node *ret;
+
+	ebshard_lock(shard);
+	ret = eb64_next(node);
+	ebshard_unlock(shard);
+
+	while (!ret && ++shard < end) {
+		ebshard_lock(shard);
+		ret = eb64_first(&shard->root);
+		ebshard_unlock(shard);
+	}
+	return ret;
+}
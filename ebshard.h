@@ -0,0 +1,137 @@
+/*
+ * Elastic Binary Trees - sharded trees of 32bit and 64bit nodes.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+  A sharded root splits the key space of an eb32 or eb64 tree across 2^bits
+  trees, each with its own lock, so that threads working on different keys do
+  not contend on a single lock nor bounce the same cache lines. A key is routed
+  to the shard designated by its <bits> highest bits, so all the keys of a shard
+  are lower than those of the next one, and an ordered walk simply visits the
+  shards in turn. Keys must therefore be spread over their high bits (random
+  IDs, hashes) for the load to be balanced :
+
+      struct ebshard shards[16];
+      struct ebshard_root sr;
+
+      ebshard_init(&sr, shards, 4, 0);
+      eb32sh_insert(&sr, node);
+      node = eb32sh_lookup(&sr, key);
+
+  Each function locks the shard it works on for the duration of the operation
+  only. The node returned by a lookup or a walk may thus be deleted at any time
+  by another thread, so the caller must ensure it does not happen (eg: only the
+  thread owning a node deletes it), or hold the shard's lock around the call
+  and the use of the node with ebshard_lock() and the unlocked tree functions.
+  The same node type must be used for all the shards of a root.
+ */
+
+#ifndef _EBSHARD_H
+#define _EBSHARD_H
+
+#include "eb32tree.h"
+#include "eb64tree.h"
+
+/* Shards are aligned on this size so that two of them never share a cache line */
+#ifndef EBSHARD_ALIGN
+#define EBSHARD_ALIGN	64
+#endif
+
+/* A shard is a tree root protected by a spinlock */
+struct ebshard {
+	struct eb_root root;
+	unsigned int lock;
+} ALIGNED(EBSHARD_ALIGN);
+
+/* A sharded root designates 2^<bits> shards */
+struct ebshard_root {
+	struct ebshard *shard;
+	unsigned int bits;
+};
+
+/* Spin-wait hint for the CPU */
+#if defined(__x86_64__) || defined(__i386__)
+#define ebshard_relax() __asm__ __volatile__("pause" ::: "memory")
+#elif defined(__aarch64__)
+#define ebshard_relax() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define ebshard_relax() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/* Lock the shard <shard>. The lock is not recursive. */
+static inline void ebshard_lock(struct ebshard *shard)
+{
+	while (__atomic_exchange_n(&shard->lock, 1, __ATOMIC_ACQUIRE)) {
+		while (__atomic_load_n(&shard->lock, __ATOMIC_RELAXED))
+			ebshard_relax();
+	}
+}
+
+/* Unlock the shard <shard> */
+static inline void ebshard_unlock(struct ebshard *shard)
+{
+	__atomic_store_n(&shard->lock, 0, __ATOMIC_RELEASE);
+}
+
+/* Return the number of shards of <sr> */
+static inline unsigned int ebshard_count(const struct ebshard_root *sr)
+{
+	return 1U << sr->bits;
+}
+
+/* Return the shard of <sr> which holds the 32-bit key <x> */
+static inline struct ebshard *eb32sh_shard(const struct ebshard_root *sr, u32 x)
+{
+	return &sr->shard[sr->bits ? x >> (32 - sr->bits) : 0];
+}
+
+/* Return the shard of <sr> which holds the 64-bit key <x> */
+static inline struct ebshard *eb64sh_shard(const struct ebshard_root *sr, u64 x)
+{
+	return &sr->shard[sr->bits ? x >> (64 - sr->bits) : 0];
+}
+
+/*
+ * The following functions are not inlined by default. They are declared
+ * in ebshard.c.
+ */
+void ebshard_init(struct ebshard_root *sr, struct ebshard *shards, unsigned int bits, int unique);
+int ebshard_is_empty(struct ebshard_root *sr);
+
+struct eb32_node *eb32sh_insert(struct ebshard_root *sr, struct eb32_node *new);
+void eb32sh_delete(struct ebshard_root *sr, struct eb32_node *node);
+struct eb32_node *eb32sh_lookup(struct ebshard_root *sr, u32 x);
+struct eb32_node *eb32sh_lookup_ge(struct ebshard_root *sr, u32 x);
+struct eb32_node *eb32sh_first(struct ebshard_root *sr);
+struct eb32_node *eb32sh_next(struct ebshard_root *sr, struct eb32_node *node);
+
+struct eb64_node *eb64sh_insert(struct ebshard_root *sr, struct eb64_node *new);
+void eb64sh_delete(struct ebshard_root *sr, struct eb64_node *node);
+struct eb64_node *eb64sh_lookup(struct ebshard_root *sr, u64 x);
+struct eb64_node *eb64sh_lookup_ge(struct ebshard_root *sr, u64 x);
+struct eb64_node *eb64sh_first(struct ebshard_root *sr);
+struct eb64_node *eb64sh_next(struct ebshard_root *sr, struct eb64_node *node);
+
+#endif /* _EBSHARD_H */
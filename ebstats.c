@@ -0,0 +1,197 @@
+/*
+ * Elastic Binary Trees - tree statistics.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult ebstats.h for more details about those functions */
+
+#include <string.h>
+#include "ebstats.h"
+
+/* Fills <st> with the exact statistics of the tree starting at <root>, which
+ * is entirely visited. The tree must not change during the visit.
+ */
+void eb_stats(struct eb_root *root, struct eb_stats *st)
+{
+	struct eb_node *node, *dup = NULL;
+	unsigned long long dup_leaves = 0;
+	struct eb_root *branches;
+	eb_troot_t *troot, *up;
+	unsigned int depth = 0;
+	unsigned int side;
+
+	memset(st, 0, sizeof(*st));
+	troot = root->b[EB_LEFT];
+	if (!troot)
+		return;
+
+	while (1) {
+		/* walk down to the leftmost leaf, noting the first dup node met */
+		while (eb_gettag(troot) == EB_NODE) {
+			node = eb_root_to_node(eb_untag(troot, EB_NODE));
+			st->nodes++;
+			if (node->bit < 0 && !dup) {
+				dup = node;
+				dup_leaves = 0;
+			}
+			depth++;
+			troot = node->branches.b[EB_LEFT];
+		}
+
+		st->leaves++;
+		st->depth_sum += depth;
+		st->depth[depth < EB_STATS_DEPTHS ? depth : EB_STATS_DEPTHS - 1]++;
+		if (depth > st->max_depth)
+			st->max_depth = depth;
+		dup_leaves += !!dup;
+
+		/* walk up as long as we're on the right, leaving the node parts,
+		 * then visit the right branch of the first one we left on the left.
+		 */
+		up = eb_root_to_node(eb_untag(troot, EB_LEAF))->leaf_p;
+		while (1) {
+			side = eb_gettag(up);
+			branches = eb_untag(up, side);
+			if (eb_clrtag(branches->b[EB_RGHT]) == NULL)
+				goto done; /* back to the root */
+			if (side == EB_LEFT)
+				break;
+
+			node = eb_root_to_node(branches);
+			if (node == dup) {
+				st->dup_trees++;
+				st->dup_leaves += dup_leaves;
+				st->dup_size[eb_stats_dup_slot(dup_leaves)]++;
+				if (dup_leaves > st->max_dup)
+					st->max_dup = dup_leaves;
+				dup = NULL;
+			}
+			depth--;
+			up = node->node_p;
+		}
+		troot = branches->b[EB_RGHT];
+	}
+ done:
+	st->keys = st->leaves - st->dup_leaves + st->dup_trees;
+}
+
+/* Initializes sampler <smp> with random seed <seed> */
+void eb_sampler_init(struct eb_sampler *smp, unsigned long long seed)
+{
+	memset(smp, 0, sizeof(*smp));
+	smp->rnd = seed | 1;
+}
+
+/* Performs <count> random descents from <root> and adds what they see to the
+ * running sums of sampler <smp>. A descent reaching a leaf at depth d had a
+ * probability of 2^-d to do so, which is compensated by weighting everything
+ * it sees by 2^d.
+ */
+void eb_stats_sample(struct eb_root *root, struct eb_sampler *smp, unsigned int count)
+{
+	struct eb_node *node;
+	eb_troot_t *troot;
+	unsigned long long rnd = 0;
+	unsigned int depth, bits = 0;
+	int in_dup;
+	double w;
+
+	while (count--) {
+		smp->samples++;
+		troot = root->b[EB_LEFT];
+		if (!troot)
+			continue;
+
+		depth = 0;
+		in_dup = 0;
+		w = 1.0;
+		while (eb_gettag(troot) == EB_NODE) {
+			node = eb_root_to_node(eb_untag(troot, EB_NODE));
+			smp->nodes += w;
+			if (node->bit < 0 && !in_dup) {
+				in_dup = 1;
+				smp->dup_trees += w;
+#ifdef EB_COUNT
+				smp->dup_size[eb_stats_dup_slot(node->count)] += w;
+				if (node->count > smp->max_dup)
+					smp->max_dup = node->count;
+#endif
+			}
+
+			if (!bits) {
+				/* xorshift64* */
+				smp->rnd ^= smp->rnd >> 12;
+				smp->rnd ^= smp->rnd << 25;
+				smp->rnd ^= smp->rnd >> 27;
+				rnd = smp->rnd * 0x2545F4914F6CDD1DULL;
+				bits = 64;
+			}
+			troot = node->branches.b[rnd & 1];
+			rnd >>= 1;
+			bits--;
+			depth++;
+			w *= 2.0;
+		}
+
+		smp->leaves += w;
+		smp->depth_sum += w * depth;
+		smp->depth[depth < EB_STATS_DEPTHS ? depth : EB_STATS_DEPTHS - 1] += w;
+		if (in_dup)
+			smp->dup_leaves += w;
+		if (depth > smp->max_depth)
+			smp->max_depth = depth;
+	}
+}
+
+/* rounds the average of <sum> over <samples> descents */
+static inline unsigned long long eb_sampler_avg(double sum, unsigned long long samples)
+{
+	return (unsigned long long)(sum / samples + 0.5);
+}
+
+/* Fills <st> with the statistics estimated from sampler <smp>. The maximum
+ * depth and duplicate tree size are the largest ones seen by the descents.
+ */
+void eb_sampler_stats(const struct eb_sampler *smp, struct eb_stats *st)
+{
+	unsigned int i;
+
+	memset(st, 0, sizeof(*st));
+	st->samples = smp->samples;
+	if (!smp->samples)
+		return;
+
+	st->leaves     = eb_sampler_avg(smp->leaves, smp->samples);
+	st->nodes      = eb_sampler_avg(smp->nodes, smp->samples);
+	st->dup_trees  = eb_sampler_avg(smp->dup_trees, smp->samples);
+	st->dup_leaves = eb_sampler_avg(smp->dup_leaves, smp->samples);
+	st->depth_sum  = eb_sampler_avg(smp->depth_sum, smp->samples);
+	st->keys       = st->leaves - st->dup_leaves + st->dup_trees;
+	st->max_depth  = smp->max_depth;
+	st->max_dup    = smp->max_dup;
+	for (i = 0; i < EB_STATS_DEPTHS; i++)
+		st->depth[i] = eb_sampler_avg(smp->depth[i], smp->samples);
+	for (i = 0; i < EB_STATS_DUPS; i++)
+		st->dup_size[i] = eb_sampler_avg(smp->dup_size[i], smp->samples);
+}
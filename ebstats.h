@@ -0,0 +1,116 @@
+/*
+ * Elastic Binary Trees - tree statistics.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+  These functions report the shape of any tree made of eb_node (eb32, eb64,
+  ebpt, ebmb, ebst, ebim, ebis), so that degenerated trees (long duplicate
+  chains, deep paths caused by clustered keys) can be spotted :
+
+      struct eb_stats st;
+
+      eb_stats(&root, &st);
+      printf("%llu keys, avg depth %.1f\n", st.keys, eb_stats_avg_depth(&st));
+
+  The depth of a leaf is the number of node parts visited to reach it from the
+  root, so a tree of 2^n distinct keys has an average depth of at least n.
+  eb_stats() visits the whole tree, which must not be modified meanwhile. For
+  large trees in production, a sampler performs random descents instead, each
+  of which only costs one lookup :
+
+      struct eb_sampler smp;
+
+      eb_sampler_init(&smp, seed);
+      eb_stats_sample(&root, &smp, 64);   // may be called repeatedly
+      eb_sampler_stats(&smp, &st);
+
+  Each descent picks a random branch at each level and reaches a leaf at depth
+  d with a probability of 2^-d, so weighting what it sees by 2^d gives unbiased
+  estimates of the counts (Knuth's estimator). The estimates get more precise
+  as samples accumulate, but remain noisy for very unbalanced trees. The sizes
+  of the duplicate trees are only estimated when built with EB_COUNT since the
+  counts make them available without walking the duplicates. A descent reads
+  the tree the same way a lookup does, so the sampler may run concurrently with
+  writers under the same conditions as lockless lookups (see eb_delete_rcu()).
+ */
+
+#ifndef _EBSTATS_H
+#define _EBSTATS_H
+
+#include "ebtree.h"
+
+/* depth histogram slots, the last one also counts deeper leaves */
+#define EB_STATS_DEPTHS  64
+
+/* duplicate tree size histogram slots, slot <i> counts the trees of
+ * 2^i+1 to 2^(i+1) leaves, and the last one also counts larger ones.
+ */
+#define EB_STATS_DUPS    32
+
+struct eb_stats {
+	unsigned long long leaves;      /* number of leaves, ie: of nodes in the tree */
+	unsigned long long nodes;       /* number of node parts in use */
+	unsigned long long keys;        /* number of distinct keys */
+	unsigned long long dup_trees;   /* number of duplicate trees */
+	unsigned long long dup_leaves;  /* number of leaves in duplicate trees */
+	unsigned long long max_dup;     /* leaves in the largest duplicate tree */
+	unsigned long long depth_sum;   /* sum of the depths of all leaves */
+	unsigned long long samples;     /* number of descents, 0 for exact stats */
+	unsigned int max_depth;         /* depth of the deepest leaf */
+	unsigned long long depth[EB_STATS_DEPTHS];    /* leaves per depth */
+	unsigned long long dup_size[EB_STATS_DUPS];   /* duplicate trees per size */
+};
+
+/* running sums of the sampled descents */
+struct eb_sampler {
+	unsigned long long rnd;         /* random generator state */
+	unsigned long long samples;     /* number of descents */
+	unsigned int max_depth;         /* deepest leaf seen */
+	unsigned long long max_dup;     /* largest duplicate tree seen (EB_COUNT) */
+	double leaves, nodes, dup_trees, dup_leaves, depth_sum;
+	double depth[EB_STATS_DEPTHS];
+	double dup_size[EB_STATS_DUPS];
+};
+
+/* Returns the average depth of the leaves reported in <st> */
+static inline double eb_stats_avg_depth(const struct eb_stats *st)
+{
+	return st->leaves ? (double)st->depth_sum / st->leaves : 0.0;
+}
+
+/* Returns the duplicate tree size histogram slot for <size> leaves (>= 2) */
+static inline unsigned int eb_stats_dup_slot(unsigned long long size)
+{
+	unsigned int slot = flsnz64(size - 1) - 1;
+
+	return slot < EB_STATS_DUPS ? slot : EB_STATS_DUPS - 1;
+}
+
+void eb_stats(struct eb_root *root, struct eb_stats *st);
+void eb_sampler_init(struct eb_sampler *smp, unsigned long long seed);
+void eb_stats_sample(struct eb_root *root, struct eb_sampler *smp, unsigned int count);
+void eb_sampler_stats(const struct eb_sampler *smp, struct eb_stats *st);
+
+#endif /* _EBSTATS_H */
@@ -32,16 +32,44 @@
  * It's the caller's reponsibility to use this function only on trees which
  * only contain zero-terminated strings. If none can be found, return NULL.
  */
+EB_MULTIVERSION
 struct ebmb_node *ebst_lookup(struct eb_root *root, const char *x)
 {
 	return __ebst_lookup(root, x);
 }
 
+/* Same as ebst_lookup() but also removes the node from the tree */
+struct ebmb_node *ebst_pick(struct eb_root *root, const char *x)
+{
+	return __ebst_pick(root, x);
+}
+
+/* Find the last occurrence of the highest key in the tree <root> which is
+ * lower than or equal to <x>. The tree must only contain zero-terminated strings. NULL is
+ * returned if no key matches.
+ */
+EB_MULTIVERSION
+struct ebmb_node *ebst_lookup_le(struct eb_root *root, const char *x)
+{
+	return __ebst_lookup_bound(root, x, 0);
+}
+
+/* Find the first occurrence of the lowest key in the tree <root> which is
+ * greater than or equal to <x>. The tree must only contain zero-terminated strings. NULL is
+ * returned if no key matches.
+ */
+EB_MULTIVERSION
+struct ebmb_node *ebst_lookup_ge(struct eb_root *root, const char *x)
+{
+	return __ebst_lookup_bound(root, x, 1);
+}
+
 /* Insert ebmb_node <new> into subtree starting at node root <root>. Only
  * new->key needs be set with the zero-terminated string key. The ebmb_node is
  * returned. If root->b[EB_RGHT]==1, the tree may only contain unique keys. The
  * caller is responsible for properly terminating the key with a zero.
  */
+EB_MULTIVERSION
 struct ebmb_node *ebst_insert(struct eb_root *root, struct ebmb_node *new)
 {
 	return __ebst_insert(root, new);
@@ -0,0 +1,57 @@
+/*
+ * Elastic Binary Trees - exported functions for timer queues.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult ebtimer.h for more details about those functions */
+
+#include "ebtimer.h"
+
+void ebtimer_rearm(struct eb_root *root, struct eb32_node *timer, u32 tick)
+{
+	__ebtimer_rearm(root, timer, tick);
+}
+
+struct eb32_node *ebtimer_pick_expired(struct eb_root *root, u32 now)
+{
+	return __ebtimer_pick_expired(root, now);
+}
+
+/* Dequeue the timers which expired relative to <now> in expiration order and
+ * pass each of them to <fct>, which may free it or queue it again. A timer
+ * queued again with an expired date is run again. The number of calls to
+ * <fct> is returned.
+ */
+unsigned int ebtimer_run_expired(struct eb_root *root, u32 now,
+                                 void (*fct)(struct eb_root *root, struct eb32_node *timer))
+{
+	struct eb32_node *timer;
+	unsigned int done = 0;
+
+	while ((timer = __ebtimer_pick_expired(root, now)) != NULL) {
+		fct(root, timer);
+		done++;
+	}
+	return done;
+}
@@ -0,0 +1,130 @@
+/*
+ * Elastic Binary Trees - timer queues based on 32bit nodes.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _EBTIMER_H
+#define _EBTIMER_H
+
+#include "eb32tree.h"
+
+/* A timer queue is an eb32 tree whose nodes are timers keyed by their
+ * expiration date, expressed in ticks. A tick is any 32-bit time unit which
+ * wraps (eg: milliseconds), so all timers of a queue must expire within 2^31
+ * ticks around the current date <now> for their dates to compare properly.
+ * Since the tree itself is ordered without considering wrapping, the earliest
+ * timer is the first one at or after <now> - EBTIMER_LOOK_BACK, or the first
+ * one of the tree when the dates wrapped. The root must not be
+ * EB_ROOT_UNIQUE since several timers may expire at the same date.
+ */
+#define EBTIMER_LOOK_BACK	(1U << 31)
+
+/* Return non-zero if <tick> is at or before <now> */
+static inline int ebtimer_is_expired(u32 tick, u32 now)
+{
+	return (s32)(tick - now) <= 0;
+}
+
+/* Return non-zero if the timer <timer> is queued */
+static inline int ebtimer_is_armed(const struct eb32_node *timer)
+{
+	return timer->node.leaf_p != NULL;
+}
+
+/* Queue the timer <timer>, which must not be queued, to expire at <tick> */
+static inline void ebtimer_arm(struct eb_root *root, struct eb32_node *timer, u32 tick)
+{
+	timer->key = tick;
+	eb32_insert(root, timer);
+}
+
+/* Dequeue the timer <timer> if it was queued */
+static inline void ebtimer_cancel(struct eb32_node *timer)
+{
+	eb32_delete(timer);
+}
+
+/* Return the timer which expires first relative to <now>, or NULL if the
+ * queue is empty.
+ */
+static inline struct eb32_node *ebtimer_first(struct eb_root *root, u32 now)
+{
+	struct eb32_node *timer;
+
+	timer = eb32_lookup_ge(root, now - EBTIMER_LOOK_BACK);
+	if (!timer)
+		timer = eb32_first(root);
+	return timer;
+}
+
+/* Store into <tick> the date at which the first timer expires relative to
+ * <now> and return non-zero, or return zero if the queue is empty.
+ */
+static inline int ebtimer_next_expiry(struct eb_root *root, u32 now, u32 *tick)
+{
+	struct eb32_node *timer = ebtimer_first(root, now);
+
+	if (!timer)
+		return 0;
+	*tick = timer->key;
+	return 1;
+}
+
+/*
+ * The following functions are not inlined by default. They are declared
+ * in ebtimer.c, which simply relies on their inline version.
+ */
+void ebtimer_rearm(struct eb_root *root, struct eb32_node *timer, u32 tick);
+struct eb32_node *ebtimer_pick_expired(struct eb_root *root, u32 now);
+unsigned int ebtimer_run_expired(struct eb_root *root, u32 now,
+                                 void (*fct)(struct eb_root *root, struct eb32_node *timer));
+
+/*
+ * The following functions are less likely to be used directly, because their
+ * code is larger. The non-inlined version is preferred.
+ */
+
+/* Queue the timer <timer> to expire at <tick>, whether it was queued or not.
+ * The timer stays in place when the tree's shape allows it, otherwise it is
+ * requeued starting from its former position. See __eb32_requeue().
+ */
+static forceinline void __ebtimer_rearm(struct eb_root *root, struct eb32_node *timer, u32 tick)
+{
+	__eb32_requeue(root, timer, tick);
+}
+
+/* Dequeue and return the first timer which expired relative to <now>, or
+ * NULL if none did.
+ */
+static forceinline struct eb32_node *__ebtimer_pick_expired(struct eb_root *root, u32 now)
+{
+	struct eb32_node *timer = ebtimer_first(root, now);
+
+	if (!timer || !ebtimer_is_expired(timer->key, now))
+		return NULL;
+	__eb_delete(&timer->node);
+	return timer;
+}
+
+#endif /* _EBTIMER_H */
@@ -31,8 +31,140 @@ void eb_delete(struct eb_node *node)
 	__eb_delete(node);
 }
 
+struct eb_node *eb_pick_first(struct eb_root *root)
+{
+	return __eb_pick_first(root);
+}
+
+struct eb_node *eb_pick_last(struct eb_root *root)
+{
+	return __eb_pick_last(root);
+}
+
 /* used by insertion primitives */
 struct eb_node *eb_insert_dup(struct eb_node *sub, struct eb_node *new)
 {
 	return __eb_insert_dup(sub, new);
 }
+
+/* Removes leaf node <node> from a tree which may be visited by concurrent
+ * lockless readers using eb32_lookup*(), eb64_lookup*(), ebmb_lookup*(),
+ * ebst_lookup() or eb_next()/eb_prev() and their variants, while all writers
+ * are serialized. Any reader sees either the old or the new tree layout, and
+ * no node part is reused while a reader may still be visiting it. Unless
+ * <node> is directly below the root or below its own node part, its freshly
+ * released parent may only be marked unused or recycled to replace <node>'s
+ * node part after a grace period, which is waited for using rcu->sync(). This
+ * makes this function much more expensive than eb_delete(). Once <node> is
+ * unlinked, it is passed to rcu->reclaim() if set. Contrary to eb_delete(),
+ * the node's leaf_p is not reset since readers may still use it to walk up,
+ * so the node must not be deleted twice.
+ */
+void eb_delete_rcu(struct eb_node *node, struct eb_rcu *rcu)
+{
+	unsigned int pside, gpside, side;
+	struct eb_node *parent;
+	struct eb_root *gparent;
+	eb_troot_t *sibling;
+
+	if (!node->leaf_p)
+		return;
+
+	pside = eb_gettag(node->leaf_p);
+	parent = eb_root_to_node(eb_untag(node->leaf_p, pside));
+
+	if (eb_clrtag(parent->branches.b[EB_RGHT]) == NULL) {
+		/* we're just below the root, it's trivial. */
+		eb_publish(&parent->branches.b[EB_LEFT], NULL);
+		goto reclaim;
+	}
+
+	/* Attach our sibling to the grand parent. Readers still visiting our
+	 * parent will continue to find valid pointers there since we don't
+	 * touch it.
+	 */
+	gpside = eb_gettag(parent->node_p);
+	gparent = eb_untag(parent->node_p, gpside);
+	sibling = parent->branches.b[!pside];
+
+	if (eb_gettag(sibling) == EB_LEAF)
+		eb_publish(&eb_root_to_node(eb_untag(sibling, EB_LEAF))->leaf_p, eb_dotag(gparent, gpside));
+	else
+		eb_publish(&eb_root_to_node(eb_untag(sibling, EB_NODE))->node_p, eb_dotag(gparent, gpside));
+	eb_publish(&gparent->b[gpside], sibling);
+	__eb_count_update(eb_dotag(gparent, gpside));
+
+	/* If our node part was the parent, it leaves with us */
+	if (parent == node)
+		goto reclaim;
+
+	/* The parent is now unreachable from the tree but some readers might
+	 * still be visiting it. Once they're gone, we can either mark it
+	 * unused, or turn it into a copy of our node part and publish it in
+	 * place of the latter.
+	 */
+	rcu->sync(rcu);
+
+	if (!node->node_p) {
+		parent->node_p = NULL;
+		goto reclaim;
+	}
+
+	parent->node_p = node->node_p;
+	parent->branches = node->branches;
+	parent->bit = node->bit;
+#ifdef EB_COUNT
+	parent->count = node->count;
+#endif
+
+	for (side = 0; side <= 1; side++) {
+		if (eb_gettag(parent->branches.b[side]) == EB_NODE)
+			eb_publish(&eb_root_to_node(eb_untag(parent->branches.b[side], EB_NODE))->node_p,
+				   eb_dotag(&parent->branches, side));
+		else
+			eb_publish(&eb_root_to_node(eb_untag(parent->branches.b[side], EB_LEAF))->leaf_p,
+				   eb_dotag(&parent->branches, side));
+	}
+
+	gpside = eb_gettag(parent->node_p);
+	gparent = eb_untag(parent->node_p, gpside);
+	eb_publish(&gparent->b[gpside], eb_dotag(&parent->branches, EB_NODE));
+
+ reclaim:
+	if (rcu->reclaim)
+		rcu->reclaim(rcu, node);
+}
+
+#ifdef EB_COUNT
+/* Returns the number of leaves in the tree starting at <root> */
+unsigned int eb_count(struct eb_root *root)
+{
+	return eb_troot_count(root->b[EB_LEFT]);
+}
+
+/* Returns the leaf at position <rank> (starting at zero) in the tree starting
+ * at <root>, or NULL if the tree does not contain that many leaves. Each level
+ * only needs to check the count of the left branch.
+ */
+struct eb_node *eb_select(struct eb_root *root, unsigned int rank)
+{
+	eb_troot_t *troot;
+	unsigned int left;
+
+	troot = root->b[EB_LEFT];
+	if (rank >= eb_troot_count(troot))
+		return NULL;
+
+	while (eb_gettag(troot) != EB_LEAF) {
+		root = eb_untag(troot, EB_NODE);
+		left = eb_troot_count(root->b[EB_LEFT]);
+		if (rank < left)
+			troot = root->b[EB_LEFT];
+		else {
+			rank -= left;
+			troot = root->b[EB_RGHT];
+		}
+	}
+	return eb_root_to_node(eb_untag(troot, EB_LEAF));
+}
+#endif
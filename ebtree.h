@@ -186,7 +186,9 @@
    This design is currently limited to only two branches per node. Most of the
    tree descent algorithm would be compatible with more branches (eg: 4, to cut
    the height in half), but this would probably require more complex operations
-   and the deletion algorithm would be problematic.
+   and the deletion algorithm would be problematic. The quad branch trees in
+   qbtree.h do this for integer keys, at the expense of larger nodes and of a
+   list of unused node parts used when deleting.
 
    Useful properties :
      - a node is always added above the leaf it is tied to, and never can get
@@ -253,6 +255,7 @@
 #define _EBTREE_H
 
 #include <stdlib.h>
+#include <string.h>
 #include "compiler.h"
 
 /* returns clz from 7 to 0 for 0x01 to 0xFF. Returns 7 for 0 as well. */
@@ -271,9 +274,12 @@ static inline unsigned int clz8(unsigned char c)
  * one. It returns a value from 1 to 32 for 1<<0 to 1<<31.
  */
 
-#if (defined(__i386__) || defined(__x86_64__)) && !defined(__atom__)
+#if (defined(__i386__) || defined(__x86_64__)) && !defined(__atom__) && \
+    !defined(EB_HAVE_MULTIVERSION) && !defined(__LZCNT__)
 /* DO NOT USE ON ATOM! The instruction is emulated and is several times slower
- * than doing the math by hand.
+ * than doing the math by hand. When the code may be built for CPUs supporting
+ * LZCNT, the builtin versions below are used instead so that the compiler
+ * emits it.
  */
 static inline unsigned int flsnz32(unsigned int x)
 {
@@ -392,6 +398,13 @@ static inline unsigned int flsnz64(unsigned long long x)
 #define EB_NODE_BRANCHES      (1 << EB_NODE_BITS)
 #define EB_NODE_BRANCH_MASK   (EB_NODE_BRANCHES - 1)
 
+/* Maximum number of descents advanced in lockstep by the batched lookup
+ * functions. Larger batches are processed in chunks of this size.
+ */
+#ifndef EB_BATCH_LANES
+#define EB_BATCH_LANES        16
+#endif
+
 /* Be careful not to tweak those values. The walking code is optimized for NULL
  * detection on the assumption that the following values are intact.
  */
@@ -428,6 +441,9 @@ struct eb_root {
  * not change the order, benchmarks have shown that it's optimal this way.
  * Note: be careful about this struct's alignment if it gets included into
  * another struct and some atomic ops are expected on the keys or the node.
+ * When built with EB_COUNT defined, each node part also counts the leaves
+ * below it, which enables order statistics (eg: eb32_rank(), eb_select()).
+ * The library and all its users must then be built with the same setting.
  */
 struct eb_node {
 	struct eb_root branches; /* branches, must be at the beginning */
@@ -435,6 +451,9 @@ struct eb_node {
 	eb_troot_t    *leaf_p;  /* leaf node's parent */
 	short int      bit;     /* link's bit position. */
 	short unsigned int pfx; /* data prefix length, always related to leaf */
+#ifdef EB_COUNT
+	unsigned int   count;   /* number of leaves below the node part */
+#endif
 } __attribute__((packed));
 
 /* Return the structure of type <type> whose member <member> points to <ptr> */
@@ -515,6 +534,43 @@ static inline struct eb_node *eb_walk_down(eb_troot_t *start, unsigned int side)
 	return eb_root_to_node(eb_untag(start, EB_LEAF));
 }
 
+#ifdef EB_COUNT
+/* Returns the number of leaves below branch <troot>, which may be NULL */
+static inline unsigned int eb_troot_count(eb_troot_t *troot)
+{
+	if (!troot)
+		return 0;
+	if (eb_gettag(troot) == EB_LEAF)
+		return 1;
+	return eb_root_to_node(eb_untag(troot, EB_NODE))->count;
+}
+
+/* Refreshes the leaf count of all node parts from the one designated by the
+ * tagged parent pointer <up> (a leaf_p or node_p) up to the root. It must be
+ * called after each change to the tree's layout.
+ */
+static forceinline void __eb_count_update(eb_troot_t *up)
+{
+	struct eb_root *branches;
+	struct eb_node *node;
+
+	while (up) {
+		branches = eb_clrtag(up);
+		if (eb_clrtag(branches->b[EB_RGHT]) == NULL)
+			break; /* reached the root */
+		node = eb_root_to_node(branches);
+		node->count = eb_troot_count(branches->b[EB_LEFT]) +
+			      eb_troot_count(branches->b[EB_RGHT]);
+		up = node->node_p;
+	}
+}
+#else
+static forceinline void __eb_count_update(eb_troot_t *up)
+{
+	(void)up;
+}
+#endif
+
 /* This function is used to build a tree of duplicates by adding a new node to
  * a subtree of at least 2 entries. It will probably never be needed inlined,
  * and it is not for end-user.
@@ -543,13 +599,14 @@ __eb_insert_dup(struct eb_node *sub, struct eb_node *new)
 		new->bit = -1;
 		sub = container_of(eb_untag(head->branches.b[EB_RGHT], EB_LEAF),
 				   struct eb_node, branches);
-		head->branches.b[EB_RGHT] = eb_dotag(&new->branches, EB_NODE);
 
 		new->node_p = sub->leaf_p;
 		new->leaf_p = new_rght;
-		sub->leaf_p = new_left;
 		new->branches.b[EB_LEFT] = eb_dotag(&sub->branches, EB_LEAF);
 		new->branches.b[EB_RGHT] = new_leaf;
+		eb_publish(&sub->leaf_p, new_left);
+		eb_publish(&head->branches.b[EB_RGHT], eb_dotag(&new->branches, EB_NODE));
+		__eb_count_update(new->leaf_p);
 		return new;
 	} else {
 		int side;
@@ -561,13 +618,14 @@ __eb_insert_dup(struct eb_node *sub, struct eb_node *new)
 		new->bit = sub->bit - 1; /* install at the lowest level */
 		side = eb_gettag(sub->node_p);
 		head = container_of(eb_untag(sub->node_p, side), struct eb_node, branches);
-		head->branches.b[side] = eb_dotag(&new->branches, EB_NODE);
-					
+
 		new->node_p = sub->node_p;
 		new->leaf_p = new_rght;
-		sub->node_p = new_left;
 		new->branches.b[EB_LEFT] = eb_dotag(&sub->branches, EB_NODE);
 		new->branches.b[EB_RGHT] = new_leaf;
+		eb_publish(&sub->node_p, new_left);
+		eb_publish(&head->branches.b[side], eb_dotag(&new->branches, EB_NODE));
+		__eb_count_update(new->leaf_p);
 		return new;
 	}
 }
@@ -739,21 +797,58 @@ static inline struct eb_node *eb_next_unique(struct eb_node *node)
 }
 
 
-/* Removes a leaf node from the tree if it was still in it. Marks the node
- * as unlinked.
+/* Returns the leaf which ends a lookup_le() descent (<ge> == 0) or a
+ * lookup_ge() descent (<ge> != 0) that stopped on subtree <troot>. All keys of
+ * this subtree compare to the looked up one as indicated by <cmp> (<0, 0, >0).
+ * When they are equal, the last one is returned for lookup_le() and the first
+ * one for lookup_ge(). NULL is returned if no key matches.
  */
-static forceinline void __eb_delete(struct eb_node *node)
+static forceinline struct eb_node *__eb_lookup_bound(eb_troot_t *troot, int cmp, int ge)
+{
+	if (ge) {
+		if (cmp >= 0)
+			return eb_walk_down(troot, EB_LEFT);
+		return eb_next(eb_walk_down(troot, EB_RGHT));
+	}
+	if (cmp <= 0)
+		return eb_walk_down(troot, EB_RGHT);
+	return eb_prev(eb_walk_down(troot, EB_LEFT));
+}
+
+/* Returns the only leaf of subtree <troot> whose node part is not used inside
+ * this subtree. The owner of each node part being a leaf below it which does
+ * not need another node part, the spare leaf is always on the other side.
+ */
+static forceinline struct eb_node *__eb_subtree_spare(eb_troot_t *troot)
+{
+	struct eb_node *node;
+	eb_troot_t *up;
+
+	while (eb_gettag(troot) == EB_NODE) {
+		node = eb_root_to_node(eb_untag(troot, EB_NODE));
+		up = node->leaf_p;
+		while (eb_clrtag(up) != &node->branches)
+			up = eb_root_to_node(eb_clrtag(up))->node_p;
+		troot = node->branches.b[!eb_gettag(up)];
+	}
+	return eb_root_to_node(eb_untag(troot, EB_LEAF));
+}
+
+/* Unlinks from its tree the leaf or subtree attached to the tagged parent
+ * pointer <up>. <node> must be the only leaf of this subtree whose node part
+ * is not used inside it (ie: the leaf itself when <up> is its leaf_p). Its node
+ * part is released, possibly by moving it to the parent's place. Neither the
+ * leaf_p of <node> nor the parent pointer of the subtree are updated.
+ */
+static forceinline void __eb_unlink(eb_troot_t *up, struct eb_node *node)
 {
 	unsigned int pside, gpside, sibtype;
 	struct eb_node *parent;
 	struct eb_root *gparent;
 
-	if (!node->leaf_p)
-		return;
-
 	/* we need the parent, our side, and the grand parent */
-	pside = eb_gettag(node->leaf_p);
-	parent = eb_root_to_node(eb_untag(node->leaf_p, pside));
+	pside = eb_gettag(up);
+	parent = eb_root_to_node(eb_untag(up, pside));
 
 	/* We likely have to release the parent link, unless it's the root,
 	 * in which case we only set our branch to NULL. Note that we can
@@ -763,7 +858,7 @@ static forceinline void __eb_delete(struct eb_node *node)
 	if (eb_clrtag(parent->branches.b[EB_RGHT]) == NULL) {
 		/* we're just below the root, it's trivial. */
 		parent->branches.b[EB_LEFT] = NULL;
-		goto delete_unlink;
+		return;
 	}
 
 	/* To release our parent, we have to identify our sibling, and reparent
@@ -784,6 +879,10 @@ static forceinline void __eb_delete(struct eb_node *node)
 		eb_root_to_node(eb_untag(gparent->b[gpside], EB_NODE))->node_p =
 			eb_dotag(gparent, gpside);
 	}
+
+	/* Counts are refreshed before our node part may be copied below */
+	__eb_count_update(parent->node_p);
+
 	/* Mark the parent unused. Note that we do not check if the parent is
 	 * our own node, but that's not a problem because if it is, it will be
 	 * marked unused at the same time, which we'll use below to know we can
@@ -799,7 +898,7 @@ static forceinline void __eb_delete(struct eb_node *node)
 
 	/* If our link part is unused, we can safely exit now */
 	if (!node->node_p)
-		goto delete_unlink;
+		return;
 
 	/* From now on, <node> and <parent> are necessarily different, and the
 	 * <node>'s node part is in use. By definition, <parent> is at least
@@ -809,6 +908,9 @@ static forceinline void __eb_delete(struct eb_node *node)
 	parent->node_p = node->node_p;
 	parent->branches = node->branches;
 	parent->bit = node->bit;
+#ifdef EB_COUNT
+	parent->count = node->count;
+#endif
 
 	/* We must now update the new node's parent... */
 	gpside = eb_gettag(parent->node_p);
@@ -825,10 +927,296 @@ static forceinline void __eb_delete(struct eb_node *node)
 				eb_dotag(&parent->branches, pside);
 		}
 	}
- delete_unlink:
+}
+
+/* Removes a leaf node from the tree if it was still in it. Marks the node
+ * as unlinked.
+ */
+static forceinline void __eb_delete(struct eb_node *node)
+{
+	if (!node->leaf_p)
+		return;
+
+	__eb_unlink(node->leaf_p, node);
+
 	/* Now the node has been completely unlinked */
 	node->leaf_p = NULL;
-	return; /* tree is not empty yet */
+}
+
+/* Removes the first leaf from the tree starting at <root> and returns it, or
+ * NULL if the tree is empty. The first duplicate is the oldest one, so this is
+ * suited to dequeue from a priority queue in insertion order.
+ */
+static forceinline struct eb_node *__eb_pick_first(struct eb_root *root)
+{
+	struct eb_node *node = eb_first(root);
+
+	if (node)
+		__eb_delete(node);
+	return node;
+}
+
+/* Removes the last leaf from the tree starting at <root> and returns it, or
+ * NULL if the tree is empty.
+ */
+static forceinline struct eb_node *__eb_pick_last(struct eb_root *root)
+{
+	struct eb_node *node = eb_last(root);
+
+	if (node)
+		__eb_delete(node);
+	return node;
+}
+
+/* Returns the parent of the node or leaf designated by <troot> */
+static inline eb_troot_t *__eb_get_parent(eb_troot_t *troot)
+{
+	if (eb_gettag(troot) == EB_LEAF)
+		return eb_root_to_node(eb_untag(troot, EB_LEAF))->leaf_p;
+	return eb_root_to_node(eb_untag(troot, EB_NODE))->node_p;
+}
+
+/* Sets the parent of the node or leaf designated by <troot> to <parent> */
+static inline void __eb_set_parent(eb_troot_t *troot, eb_troot_t *parent)
+{
+	if (eb_gettag(troot) == EB_LEAF)
+		eb_root_to_node(eb_untag(troot, EB_LEAF))->leaf_p = parent;
+	else
+		eb_root_to_node(eb_untag(troot, EB_NODE))->node_p = parent;
+}
+
+/* The functions below build a tree from keys delivered in ascending order,
+ * without any descent. Equal keys are first gathered below a temporary root
+ * <sub> initialized with the first one of them by __eb_build_leaf(), then
+ * added using __eb_build_dup(). The resulting subtree is then appended on the
+ * right of the tree using __eb_build_append(), after which the temporary root
+ * may be reused.
+ */
+
+/* Makes <leaf> the only leaf below the temporary root <sub> */
+static forceinline void __eb_build_leaf(struct eb_root *sub, struct eb_node *leaf)
+{
+	sub->b[EB_LEFT] = eb_dotag(&leaf->branches, EB_LEAF);
+	sub->b[EB_RGHT] = NULL;
+	leaf->leaf_p = eb_dotag(sub, EB_LEFT);
+	leaf->node_p = NULL;
+}
+
+/* Adds <new> after the duplicates already present below temporary root <sub>,
+ * exactly like an insertion would do.
+ */
+static forceinline void __eb_build_dup(struct eb_root *sub, struct eb_node *new)
+{
+	struct eb_node *first;
+
+	if (eb_gettag(sub->b[EB_LEFT]) == EB_NODE) {
+		__eb_insert_dup(eb_root_to_node(eb_untag(sub->b[EB_LEFT], EB_NODE)), new);
+		return;
+	}
+
+	/* first duplicate: <new> takes the right of a new dup tree */
+	first = eb_root_to_node(eb_untag(sub->b[EB_LEFT], EB_LEAF));
+	new->bit = -1;
+	new->branches.b[EB_LEFT] = sub->b[EB_LEFT];
+	new->branches.b[EB_RGHT] = eb_dotag(&new->branches, EB_LEAF);
+	first->leaf_p = eb_dotag(&new->branches, EB_LEFT);
+	new->leaf_p = eb_dotag(&new->branches, EB_RGHT);
+	new->node_p = eb_dotag(sub, EB_LEFT);
+	sub->b[EB_LEFT] = eb_dotag(&new->branches, EB_NODE);
+	__eb_count_update(new->leaf_p);
+}
+
+/* Moves the subtree below temporary root <sub> to the right of the tree <root>
+ * and returns its top. <prev> is the top of the subtree appended by the
+ * previous call, or NULL for the first one. Otherwise the previous keys are
+ * all lower and differ from the new ones at bit <bit>, and the node part of
+ * <split> is used to join them. The right spine is climbed from <prev> up to
+ * the first node above <bit>, so that the whole build is linear. <msb> is set
+ * when bits are numbered from the highest one as in ebmb trees, otherwise it
+ * is zero as in eb32/eb64 trees. __eb_build_finish() must be called once the
+ * last subtree is appended.
+ */
+static forceinline eb_troot_t *
+__eb_build_append(struct eb_root *root, eb_troot_t *prev, struct eb_root *sub,
+		  struct eb_node *split, int bit, int msb)
+{
+	eb_troot_t *troot = sub->b[EB_LEFT];
+	eb_troot_t *left, *up;
+	struct eb_root *branches;
+	struct eb_node *node;
+
+	if (!prev) {
+		root->b[EB_LEFT] = troot;
+		__eb_set_parent(troot, eb_dotag(root, EB_LEFT));
+		return troot;
+	}
+
+	/* climb up the right spine as long as nodes are deeper than <bit> */
+	left = prev;
+	up = __eb_get_parent(prev);
+	while (1) {
+		branches = eb_clrtag(up);
+		if (eb_clrtag(branches->b[EB_RGHT]) == NULL)
+			break; /* reached the root */
+		node = eb_root_to_node(branches);
+		if (msb ? node->bit < bit : node->bit > bit)
+			break;
+#ifdef EB_COUNT
+		/* this node will not change anymore */
+		node->count = eb_troot_count(branches->b[EB_LEFT]) +
+			      eb_troot_count(branches->b[EB_RGHT]);
+#endif
+		left = eb_dotag(branches, EB_NODE);
+		up = node->node_p;
+	}
+
+	split->bit = bit;
+	split->branches.b[EB_LEFT] = left;
+	split->branches.b[EB_RGHT] = troot;
+	split->node_p = up;
+	__eb_set_parent(left, eb_dotag(&split->branches, EB_LEFT));
+	__eb_set_parent(troot, eb_dotag(&split->branches, EB_RGHT));
+	eb_clrtag(up)->b[eb_gettag(up)] = eb_dotag(&split->branches, EB_NODE);
+	return troot;
+}
+
+/* Completes a build whose last appended subtree is <last>, which may be NULL
+ * if nothing was appended. Only the counts of the right spine need it.
+ */
+static forceinline void __eb_build_finish(eb_troot_t *last)
+{
+	if (last)
+		__eb_count_update(__eb_get_parent(last));
+}
+
+/* Returns the offset of the first byte which differs between blocks <a> and
+ * <b> in range [<beg>, <end>), or <end> if they are equal over this range.
+ * This is the portable version, comparing one 64-bit word at a time.
+ */
+static forceinline size_t eb_memdiff_scalar(const unsigned char *a,
+					    const unsigned char *b,
+					    size_t beg, size_t end)
+{
+#if defined(__GNUC__) && ((__GNUC__ > 3) || ((__GNUC__ == 3) && (__GNUC_MINOR__ >= 4))) && \
+    defined(__BYTE_ORDER__)
+	while (beg + 8 <= end) {
+		unsigned long long x, y;
+
+		memcpy(&x, a + beg, sizeof(x));
+		memcpy(&y, b + beg, sizeof(y));
+		x ^= y;
+		if (x) {
+#if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+			return beg + (__builtin_ctzll(x) >> 3);
+#else
+			return beg + (__builtin_clzll(x) >> 3);
+#endif
+		}
+		beg += 8;
+	}
+#endif
+	while (beg < end && a[beg] == b[beg])
+		beg++;
+	return beg;
+}
+
+/* Same as eb_memdiff_scalar() but uses vector instructions when available. */
+static forceinline size_t eb_memdiff(const unsigned char *a,
+				     const unsigned char *b,
+				     size_t beg, size_t end)
+{
+#if defined(EB_SIMD_AVX2)
+	while (beg + 32 <= end) {
+		__m256i va = _mm256_loadu_si256((const __m256i *)(a + beg));
+		__m256i vb = _mm256_loadu_si256((const __m256i *)(b + beg));
+		unsigned int m = ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+
+		if (m)
+			return beg + __builtin_ctz(m);
+		beg += 32;
+	}
+#endif
+#if defined(EB_SIMD_SSE2)
+	while (beg + 16 <= end) {
+		__m128i va = _mm_loadu_si128((const __m128i *)(a + beg));
+		__m128i vb = _mm_loadu_si128((const __m128i *)(b + beg));
+		unsigned int m = _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) ^ 0xffff;
+
+		if (m)
+			return beg + __builtin_ctz(m);
+		beg += 16;
+	}
+#elif defined(EB_SIMD_NEON)
+	while (beg + 16 <= end) {
+		uint8x16_t eq = vceqq_u8(vld1q_u8(a + beg), vld1q_u8(b + beg));
+		/* narrow to 4 bits per byte, all set for equal bytes */
+		unsigned long long m = ~vget_lane_u64(vreinterpret_u64_u8(
+			vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+
+		if (m)
+			return beg + (__builtin_ctzll(m) >> 2);
+		beg += 16;
+	}
+#endif
+	return eb_memdiff_scalar(a, b, beg, end);
+}
+
+/* Returns the offset of the first byte from <beg> where strings <a> and <b>
+ * differ or where both end. This is the portable version.
+ */
+static forceinline size_t eb_strdiff_scalar(const unsigned char *a,
+					    const unsigned char *b,
+					    size_t beg)
+{
+	while (a[beg] == b[beg] && b[beg])
+		beg++;
+	return beg;
+}
+
+/* Same as eb_strdiff_scalar() but uses vector instructions when available.
+ * Since the strings' length is unknown, a block is only loaded when it does
+ * not cross a page boundary on either side, which guarantees that it cannot
+ * fault even if it extends past the trailing zero. The remaining bytes are
+ * checked one at a time until the next page.
+ */
+static forceinline size_t eb_strdiff(const unsigned char *a,
+				     const unsigned char *b,
+				     size_t beg)
+{
+#if defined(EB_SIMD_SSE2) || defined(EB_SIMD_NEON)
+	while (1) {
+		while ((((size_t)(a + beg) & 4095) > 4096 - 16) ||
+		       (((size_t)(b + beg) & 4095) > 4096 - 16)) {
+			if (a[beg] != b[beg] || !b[beg])
+				return beg;
+			beg++;
+		}
+		{
+#if defined(EB_SIMD_SSE2)
+			__m128i va = _mm_loadu_si128((const __m128i *)(a + beg));
+			__m128i vb = _mm_loadu_si128((const __m128i *)(b + beg));
+			unsigned int m;
+
+			/* flag bytes which differ or where b (hence a) is zero */
+			m = _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) ^ 0xffff;
+			m |= _mm_movemask_epi8(_mm_cmpeq_epi8(vb, _mm_setzero_si128()));
+			if (m)
+				return beg + __builtin_ctz(m);
+#else
+			uint8x16_t vb = vld1q_u8(b + beg);
+			uint8x16_t ok = vandq_u8(vceqq_u8(vld1q_u8(a + beg), vb), vtstq_u8(vb, vb));
+			unsigned long long m = ~vget_lane_u64(vreinterpret_u64_u8(
+				vshrn_n_u16(vreinterpretq_u16_u8(ok), 4)), 0);
+
+			if (m)
+				return beg + (__builtin_ctzll(m) >> 2);
+#endif
+		}
+		beg += 16;
+	}
+#else
+	return eb_strdiff_scalar(a, b, beg);
+#endif
 }
 
 /* Compare blocks <a> and <b> byte-to-byte, from bit <ignore> to bit <len-1>.
@@ -842,25 +1230,22 @@ static forceinline size_t equal_bits(const unsigned char *a,
 				     const unsigned char *b,
 				     size_t ignore, size_t len)
 {
-	for (ignore >>= 3, a += ignore, b += ignore, ignore <<= 3;
-	     ignore < len; ) {
-		unsigned char c;
+	size_t beg = ignore >> 3;
+	size_t end = (len + 7) >> 3;
 
-		a++; b++;
-		ignore += 8;
-		c = b[-1] ^ a[-1];
+	if (beg >= end)
+		return beg << 3;
 
-		if (c) {
-			/* OK now we know that old and new differ at byte <ptr> and that <c> holds
-			 * the bit differences. We have to find what bit is differing and report
-			 * it as the number of identical bits. Note that low bit numbers are
-			 * assigned to high positions in the byte, as we compare them as strings.
-			 */
-			ignore -= flsnz_long(c);
-			break;
-		}
-	}
-	return ignore;
+	beg = eb_memdiff(a, b, beg, end);
+	if (beg == end)
+		return end << 3;
+
+	/* OK now we know that old and new differ at byte <beg>. We have to find
+	 * what bit is differing and report it as the number of identical bits.
+	 * Note that low bit numbers are assigned to high positions in the byte,
+	 * as we compare them as strings.
+	 */
+	return ((beg + 1) << 3) - flsnz8(a[beg] ^ b[beg]);
 }
 
 /* check that the two blocks <a> and <b> are equal on <len> bits. If it is known
@@ -872,26 +1257,20 @@ static forceinline int check_bits(const unsigned char *a,
 				  int skip,
 				  int len)
 {
-	int bit, ret;
+	size_t end = len >> 3;
 
-	/* This uncommon construction gives the best performance on x86 because
-	 * it makes heavy use multiple-index addressing and parallel instructions,
-	 * and it prevents gcc from reordering the loop since it is already
-	 * properly oriented. Tested to be fine with 2.95 to 4.2.
-	 */
-	bit = ~len + (skip << 3) + 9; /* = (skip << 3) + (8 - len) */
-	ret = a[skip] ^ b[skip];
-	if (unlikely(bit >= 0))
-		return ret >> bit;
-	while (1) {
-		skip++;
-		if (ret)
-			return ret;
-		ret = a[skip] ^ b[skip];
-		bit += 8;
-		if (bit >= 0)
-			return ret >> bit;
+	if (skip < (int)end) {
+		size_t pos = eb_memdiff(a, b, skip, end);
+
+		if (pos < end)
+			return a[pos] ^ b[pos];
+		skip = end;
 	}
+
+	/* only the first <len & 7> bits of the last byte remain, if any */
+	if (skip > (int)end || !(len & 7))
+		return 0;
+	return (a[end] ^ b[end]) >> (8 - (len & 7));
 }
 
 
@@ -908,31 +1287,23 @@ static forceinline size_t string_equal_bits(const unsigned char *a,
 					     const unsigned char *b,
 					     size_t ignore)
 {
-	unsigned char c, d;
+	unsigned char c;
 	size_t beg;
 
-	beg = ignore >> 3;
-
 	/* skip known and identical bits. We stop at the first different byte
 	 * or at the first zero we encounter on either side.
 	 */
-	while (1) {
-		c = a[beg];
-		d = b[beg];
-		beg++;
-
-		c ^= d;
-		if (c)
-			break;
-		if (!d)
-			return (size_t)-1;
-	}
-	/* OK now we know that a and b differ at byte <beg>, or that both are zero.
-	 * We have to find what bit is differing and report it as the number of
-	 * identical bits. Note that low bit numbers are assigned to high positions
-	 * in the byte, as we compare them as strings.
+	beg = eb_strdiff(a, b, ignore >> 3);
+	c = a[beg] ^ b[beg];
+	if (!c)
+		return (size_t)-1;
+
+	/* OK now we know that a and b differ at byte <beg>. We have to find
+	 * what bit is differing and report it as the number of identical bits.
+	 * Note that low bit numbers are assigned to high positions in the byte,
+	 * as we compare them as strings.
 	 */
-	return (beg << 3) - flsnz(c);
+	return ((beg + 1) << 3) - flsnz(c);
 }
 
 static forceinline int cmp_bits(const unsigned char *a, const unsigned char *b, unsigned int pos)
@@ -958,8 +1329,29 @@ static forceinline int get_bit(const unsigned char *a, unsigned int pos)
 	return (a[ofs] >> pos) & 1;
 }
 
+/* Grace-period callbacks used by eb_delete_rcu() to allow lockless readers to
+ * visit a tree while a single writer modifies it. <sync> must wait for all
+ * readers which were already visiting the tree when it was called to leave it.
+ * <reclaim> is called with each node that was removed from the tree, and must
+ * not release nor reuse it before such a grace period expires (typically by
+ * queuing it or calling sync() first). It may be NULL if the caller takes care
+ * of this itself. <ctx> is left for the caller's use.
+ */
+struct eb_rcu {
+	void (*sync)(struct eb_rcu *rcu);
+	void (*reclaim)(struct eb_rcu *rcu, struct eb_node *node);
+	void *ctx;
+};
+
 /* These functions are declared in ebtree.c */
 void eb_delete(struct eb_node *node);
+void eb_delete_rcu(struct eb_node *node, struct eb_rcu *rcu);
+struct eb_node *eb_pick_first(struct eb_root *root);
+struct eb_node *eb_pick_last(struct eb_root *root);
+#ifdef EB_COUNT
+struct eb_node *eb_select(struct eb_root *root, unsigned int rank);
+unsigned int eb_count(struct eb_root *root);
+#endif
 struct eb_node *eb_insert_dup(struct eb_node *sub, struct eb_node *new);
 
 #endif /* _EB_TREE_H */
@@ -33,6 +33,7 @@
 #include <arpa/inet.h>
 
 #include <ebmbtree.h>
+#include <ebarena.h>
 
 struct one_net {
 	struct ebmb_node eb_node;
@@ -41,6 +42,7 @@ struct one_net {
 };
 
 struct eb_root tree = EB_ROOT;  /* EB_ROOT || EB_ROOT_UNIQUE */
+struct eb_arena arena;          /* all nodes are allocated there */
 
 /* Insert an address into the tree, after checking that it does not match
  * another one. If it does, then only one is kept or they are merged in a
@@ -65,7 +67,7 @@ void insert_net(unsigned addr, unsigned cidr)
 		if (node->node.pfx <= cidr)
 			return;
 		ebmb_delete(node);
-		free(node);
+		eb_arena_free(&arena, node, sizeof(struct one_net));
 	}
 
 	/* 2) check if we can merge this network with the one just below or above */
@@ -81,7 +83,7 @@ void insert_net(unsigned addr, unsigned cidr)
 		if (node) {
 			/* we can merge both entries at cidr - 1 */
 			ebmb_delete(node);
-			free(ebmb_entry(node, struct one_net, eb_node));
+			eb_arena_free(&arena, ebmb_entry(node, struct one_net, eb_node), sizeof(struct one_net));
 			addr &= addr2; /* clear varying bit */
 			cidr--;
 			/* recursively do the same above */
@@ -90,7 +92,7 @@ void insert_net(unsigned addr, unsigned cidr)
 		}
 	}
 
-	net = (struct one_net *)calloc(1, sizeof(*net));
+	net = eb_arena_alloc(&arena, sizeof(*net));
 	net->addr.s_addr = addr;
 	net->eb_node.node.pfx = cidr;
 	ebmb_insert_prefix(&tree, &net->eb_node, sizeof(net->addr.s_addr));
@@ -106,6 +108,7 @@ void insert_net(unsigned addr, unsigned cidr)
 			break;
 		node = ebmb_next(&net->eb_node);
 		ebmb_delete(&net->eb_node);
+		eb_arena_free(&arena, net, sizeof(*net));
 	}
 
 }
@@ -158,7 +161,9 @@ int main(int argc, char **argv)
 			);
 		exit(1);
 	}
+	eb_arena_init(&arena, 0);
 	read_nets_from_stdin();
 	dump_nets();
+	eb_arena_destroy(&arena);
 	return 0;
 }
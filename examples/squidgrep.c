@@ -24,17 +24,23 @@
  * OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
 #include <ebsttree.h>
+#include <ebimage.h>
+#include <ebarena.h>
 
 struct eb_root tree = EB_ROOT_UNIQUE;  /* EB_ROOT || EB_ROOT_UNIQUE */
+struct ebm_image *image;               /* mapped tree if not NULL */
+struct eb_arena arena;                 /* all nodes are allocated there */
 
 int input, match;
 
@@ -46,10 +52,11 @@ void insert_url(const char *url)
 	l = strlen(url);
 	while (l && url[l-1] == '\n')
 		l--;
-	node = calloc(1, sizeof(*node) + l + 1);
+	node = eb_arena_alloc(&arena, sizeof(*node) + l + 1);
 	memcpy(node->key, url, l);
 	node->key[l] = 0;
-	ebst_insert(&tree, node);
+	if (ebst_insert(&tree, node) != node)
+		eb_arena_free(&arena, node, sizeof(*node) + l + 1); /* duplicate */
 }
 
 void read_urls_from_file(FILE *f)
@@ -65,7 +72,7 @@ void match_logs_from_stdin()
 	int field;
 	char line[256];
 	char *str, *url, *end;
-	struct ebmb_node *node;
+	void *node;
 
 	match = 0; input = 0;
 	/* Note: this construct allows easier use of halog's fgets() */
@@ -88,7 +95,10 @@ void match_logs_from_stdin()
 			continue;
 
 		input++;
-		node = ebst_lookup(&tree, url);
+		if (image)
+			node = ebmds_lookup(&image->root, url);
+		else
+			node = ebst_lookup(&tree, url);
 		if (node) {
 			match++;
 			puts(str);
@@ -99,25 +109,54 @@ void match_logs_from_stdin()
 int main(int argc, char **argv)
 {
 	FILE *f;
-	int matches;
-
-	if (argc != 2) {
+	int fd;
+
+	eb_arena_init(&arena, 0);
+	if (argc == 3 && strcmp(argv[1], "-i") == 0) {
+		fd = open(argv[2], O_RDONLY);
+		if (fd < 0) {
+			perror("open");
+			exit(1);
+		}
+		image = ebm_image_map(fd);
+		if (!image) {
+			perror("ebm_image_map");
+			exit(1);
+		}
+		close(fd);
+	}
+	else if (argc == 2 || (argc == 4 && strcmp(argv[1], "-w") == 0)) {
+		f = fopen(argv[argc - 1], "r");
+		if (!f) {
+			perror("fopen");
+			exit(1);
+		}
+		read_urls_from_file(f);
+		fclose(f);
+
+		if (argc == 4) {
+			fd = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if (fd < 0 || ebst_image_write(&tree, fd) < 0) {
+				perror("ebst_image_write");
+				exit(1);
+			}
+			close(fd);
+			return 0;
+		}
+	}
+	else {
 		fprintf(stderr,
 			"Usage:\n"
 			"  $0 url_file < squid_access.log\n"
 			"  Will output all lines referencing one of the URLs from url_file.\n"
+			"  $0 -w image url_file\n"
+			"  Will only save the URLs from url_file into file image.\n"
+			"  $0 -i image < squid_access.log\n"
+			"  Same as the first form but loads the URLs from file image.\n"
 			);
 		exit(1);
 	}
 
-	f = fopen(argv[1], "r");
-	if (!f) {
-		perror("fopen");
-		exit(1);
-	}
-	read_urls_from_file(f);
-	fclose(f);
-
 	match_logs_from_stdin();
 	fprintf(stderr, "Matches: %d/%d\n", match, input);
 	return 0;
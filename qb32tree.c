@@ -0,0 +1,88 @@
+/*
+ * Quad Branch Trees - exported functions for operations on 32bit nodes.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult qb32tree.h and qbtree.h for more details about those functions */
+
+#include "qb32tree.h"
+
+/* Return leftmost node in the tree, or NULL if none */
+struct qb32_node *qb32_first(struct qb_root *root)
+{
+	if (!root->top)
+		return NULL;
+	return qb32_entry(__qb_walk_down(root->top, 0), struct qb32_node, node);
+}
+
+/* Return rightmost node in the tree, or NULL if none */
+struct qb32_node *qb32_last(struct qb_root *root)
+{
+	if (!root->top)
+		return NULL;
+	return qb32_entry(__qb_walk_down(root->top, 1), struct qb32_node, node);
+}
+
+/* Return the node following <node> in its tree, or NULL if none */
+struct qb32_node *qb32_next(struct qb32_node *node)
+{
+	return qb32_entry(__qb_walk_side(node->node.leaf_p, node->node.leaf_s, 1), struct qb32_node, node);
+}
+
+/* Return the node preceding <node> in its tree, or NULL if none */
+struct qb32_node *qb32_prev(struct qb32_node *node)
+{
+	return qb32_entry(__qb_walk_side(node->node.leaf_p, node->node.leaf_s, 0), struct qb32_node, node);
+}
+
+struct qb32_node *qb32_lookup(struct qb_root *root, u32 x)
+{
+	return __qb32_lookup(root, x);
+}
+
+/* Find the node holding the highest key equal to or less than <x> in the
+ * tree <root>, or NULL if none.
+ */
+struct qb32_node *qb32_lookup_le(struct qb_root *root, u32 x)
+{
+	return qb32_entry(__qb_lookup(root, QB_KT_U32, x, QB_WM_LE), struct qb32_node, node);
+}
+
+/* Find the node holding the lowest key equal to or greater than <x> in the
+ * tree <root>, or NULL if none.
+ */
+struct qb32_node *qb32_lookup_ge(struct qb_root *root, u32 x)
+{
+	return qb32_entry(__qb_lookup(root, QB_KT_U32, x, QB_WM_GE), struct qb32_node, node);
+}
+
+struct qb32_node *qb32_insert(struct qb_root *root, struct qb32_node *node)
+{
+	return __qb32_insert(root, node);
+}
+
+struct qb32_node *qb32_delete(struct qb_root *root, struct qb32_node *node)
+{
+	return __qb32_delete(root, node);
+}
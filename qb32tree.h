@@ -0,0 +1,82 @@
+/*
+ * Quad Branch Trees - macros and structures for operations on 32bit nodes.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _QB32TREE_H
+#define _QB32TREE_H
+
+#include "qbtree.h"
+
+/* Return the structure of type <type> whose member <member> points to <ptr> */
+#define qb32_entry(ptr, type, member) container_of_safe(ptr, type, member)
+
+#define QB32_ROOT	QB_ROOT
+
+/* This structure carries a quad branch node and a key. It must start with the
+ * qb_node, and the key must immediately follow it.
+ */
+struct qb32_node {
+	struct qb_node node; /* the tree node, must be at the beginning */
+	u32 key;
+};
+
+/*
+ * The following functions are not inlined by default. They are declared
+ * in qb32tree.c, which simply relies on the generic inline versions.
+ */
+struct qb32_node *qb32_first(struct qb_root *root);
+struct qb32_node *qb32_last(struct qb_root *root);
+struct qb32_node *qb32_next(struct qb32_node *node);
+struct qb32_node *qb32_prev(struct qb32_node *node);
+struct qb32_node *qb32_lookup(struct qb_root *root, u32 x);
+struct qb32_node *qb32_lookup_le(struct qb_root *root, u32 x);
+struct qb32_node *qb32_lookup_ge(struct qb_root *root, u32 x);
+struct qb32_node *qb32_insert(struct qb_root *root, struct qb32_node *node);
+struct qb32_node *qb32_delete(struct qb_root *root, struct qb32_node *node);
+
+/* Find the node holding key <x> in the tree <root>, or NULL if none */
+static forceinline struct qb32_node *__qb32_lookup(struct qb_root *root, u32 x)
+{
+	return qb32_entry(__qb_lookup(root, QB_KT_U32, x, QB_WM_EQ), struct qb32_node, node);
+}
+
+/* Insert node <node> into the tree <root>. Only node->key needs to be set.
+ * The node is returned, or the one already holding the same key if any, in
+ * which case <node> is not inserted.
+ */
+static forceinline struct qb32_node *__qb32_insert(struct qb_root *root, struct qb32_node *node)
+{
+	return qb32_entry(__qb_insert(root, QB_KT_U32, &node->node), struct qb32_node, node);
+}
+
+/* Remove node <node> from the tree <root>. It is returned if it was in the
+ * tree, otherwise NULL is returned. This is done in constant time.
+ */
+static forceinline struct qb32_node *__qb32_delete(struct qb_root *root, struct qb32_node *node)
+{
+	return qb32_entry(__qb_delete(root, &node->node), struct qb32_node, node);
+}
+
+#endif /* _QB32TREE_H */
@@ -0,0 +1,88 @@
+/*
+ * Quad Branch Trees - exported functions for operations on 64bit nodes.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult qb64tree.h and qbtree.h for more details about those functions */
+
+#include "qb64tree.h"
+
+/* Return leftmost node in the tree, or NULL if none */
+struct qb64_node *qb64_first(struct qb_root *root)
+{
+	if (!root->top)
+		return NULL;
+	return qb64_entry(__qb_walk_down(root->top, 0), struct qb64_node, node);
+}
+
+/* Return rightmost node in the tree, or NULL if none */
+struct qb64_node *qb64_last(struct qb_root *root)
+{
+	if (!root->top)
+		return NULL;
+	return qb64_entry(__qb_walk_down(root->top, 1), struct qb64_node, node);
+}
+
+/* Return the node following <node> in its tree, or NULL if none */
+struct qb64_node *qb64_next(struct qb64_node *node)
+{
+	return qb64_entry(__qb_walk_side(node->node.leaf_p, node->node.leaf_s, 1), struct qb64_node, node);
+}
+
+/* Return the node preceding <node> in its tree, or NULL if none */
+struct qb64_node *qb64_prev(struct qb64_node *node)
+{
+	return qb64_entry(__qb_walk_side(node->node.leaf_p, node->node.leaf_s, 0), struct qb64_node, node);
+}
+
+struct qb64_node *qb64_lookup(struct qb_root *root, u64 x)
+{
+	return __qb64_lookup(root, x);
+}
+
+/* Find the node holding the highest key equal to or less than <x> in the
+ * tree <root>, or NULL if none.
+ */
+struct qb64_node *qb64_lookup_le(struct qb_root *root, u64 x)
+{
+	return qb64_entry(__qb_lookup(root, QB_KT_U64, x, QB_WM_LE), struct qb64_node, node);
+}
+
+/* Find the node holding the lowest key equal to or greater than <x> in the
+ * tree <root>, or NULL if none.
+ */
+struct qb64_node *qb64_lookup_ge(struct qb_root *root, u64 x)
+{
+	return qb64_entry(__qb_lookup(root, QB_KT_U64, x, QB_WM_GE), struct qb64_node, node);
+}
+
+struct qb64_node *qb64_insert(struct qb_root *root, struct qb64_node *node)
+{
+	return __qb64_insert(root, node);
+}
+
+struct qb64_node *qb64_delete(struct qb_root *root, struct qb64_node *node)
+{
+	return __qb64_delete(root, node);
+}
@@ -0,0 +1,224 @@
+/*
+ * ebtree 128-bit trees test - 2026
+ *
+ * Usage: test128 [#keys] [#rounds]
+ *
+ * Randomly inserts and deletes eb128 nodes whose keys are built from a few
+ * values around the boundaries of both 64-bit halves (0, 1, 2^63, ~0), into
+ * trees accepting duplicates or not. Each insert, lookup and lookup_le/ge is
+ * checked against a linear scan of the nodes, which also tells which duplicate
+ * must be returned : the oldest one for lookup and lookup_ge, and the most
+ * recent one for lookup_le. Then IPv6 prefixes, mostly around /64, are
+ * inserted with eb128_insert_prefix() and each eb128_lookup_longest() is
+ * checked against a linear scan as well.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "eb128tree.h"
+#include "testutil.h"
+
+/* returns a random 64-bit half, mostly close to a boundary */
+static unsigned long long rnd_half(void)
+{
+	switch (xorshift(&rnd) % 8) {
+	case 0: return 0;
+	case 1: return 1;
+	case 2: return ~0ULL;
+	case 3: return ~0ULL - 1;
+	case 4: return 1ULL << 63;
+	case 5: return (1ULL << 63) - 1;
+	case 6: return xorshift(&rnd) % 4;
+	default: return rnd64();
+	}
+}
+
+static u128 rnd_key(void)
+{
+	return ((u128)rnd_half() << 64) | rnd_half();
+}
+
+static void print128(const char *pfx, u128 k)
+{
+	printf("%s%016llx:%016llx", pfx, (unsigned long long)(k >> 64), (unsigned long long)k);
+}
+
+static int test_keys(int nbkeys, int rounds, int uniq)
+{
+	struct eb128_node *nodes = calloc(nbkeys, sizeof(*nodes));
+	unsigned int *seqs = calloc(nbkeys, sizeof(*seqs));
+	struct eb_root root = uniq ? EB_ROOT_UNIQUE : EB_ROOT;
+	struct eb128_node *n, *p, *exp[3];
+	unsigned int seq = 0, total = 0, seen;
+	unsigned char be[16];
+	int r, i;
+	u128 x;
+
+	for (r = 0; r < rounds; r++) {
+		i = xorshift(&rnd) % nbkeys;
+		if (nodes[i].node.leaf_p) {
+			eb128_delete(&nodes[i]);
+			total--;
+			x = nodes[i].key;
+		} else {
+			x = nodes[i].key = rnd_key();
+			eb128_key_to_be(x, be);
+			if (eb128_key_from_be(be) != x || be[0] != (unsigned char)(x >> 120) || be[15] != (unsigned char)x) {
+				print128("eb128: network byte order conversion failed for ", x);
+				printf("\n");
+				return 0;
+			}
+			exp[0] = NULL;
+			if (uniq)
+				exp[0] = eb128_lookup(&root, x);
+			n = eb128_insert(&root, &nodes[i]);
+			if (n != (exp[0] ? exp[0] : &nodes[i])) {
+				print128("eb128: insert returned the wrong node for ", x);
+				printf(" (uniq=%d)\n", uniq);
+				return 0;
+			}
+			if (n == &nodes[i]) {
+				seqs[i] = seq++;
+				total++;
+			}
+		}
+
+		/* look the last key up, a random one or one of its neighbours */
+		switch (xorshift(&rnd) % 4) {
+		case 0: x = rnd_key(); break;
+		case 1: x++; break;
+		case 2: x--; break;
+		}
+
+		exp[0] = exp[1] = exp[2] = NULL;
+		for (i = 0; i < nbkeys; i++) {
+			n = &nodes[i];
+			if (!n->node.leaf_p)
+				continue;
+			if (n->key == x && (!exp[0] || seqs[i] < seqs[exp[0] - nodes]))
+				exp[0] = n;
+			if (n->key <= x && (!exp[1] || n->key > exp[1]->key ||
+					    (n->key == exp[1]->key && seqs[i] > seqs[exp[1] - nodes])))
+				exp[1] = n;
+			if (n->key >= x && (!exp[2] || n->key < exp[2]->key ||
+					    (n->key == exp[2]->key && seqs[i] < seqs[exp[2] - nodes])))
+				exp[2] = n;
+		}
+		if (eb128_lookup(&root, x) != exp[0] ||
+		    eb128_lookup_le(&root, x) != exp[1] ||
+		    eb128_lookup_ge(&root, x) != exp[2]) {
+			print128("eb128: lookup mismatch on key ", x);
+			printf(" (uniq=%d)\n", uniq);
+			return 0;
+		}
+
+		if ((r & 1023) == 0 || r == rounds - 1) {
+			seen = 0;
+			for (p = NULL, n = eb128_first(&root); n; p = n, n = eb128_next(n), seen++) {
+				if (p && (p->key > n->key || (p->key == n->key && seqs[p - nodes] > seqs[n - nodes]))) {
+					printf("eb128: keys out of order\n");
+					return 0;
+				}
+			}
+			if (seen != total || p != eb128_last(&root)) {
+				printf("eb128: walked %u keys out of %u\n", seen, total);
+				return 0;
+			}
+		}
+	}
+	free(seqs);
+	free(nodes);
+	return 1;
+}
+
+/* returns <k> with only its <pfx> highest bits */
+static u128 mask(u128 k, int pfx)
+{
+	return pfx ? k & (~(u128)0 << (128 - pfx)) : 0;
+}
+
+/* returns a random prefix length, mostly around the halves' boundary */
+static int rnd_pfx(void)
+{
+	static const int lens[] = { 0, 1, 32, 48, 56, 63, 64, 65, 72, 96, 127, 128 };
+	unsigned int r = xorshift(&rnd) % 16;
+
+	return r < sizeof(lens) / sizeof(lens[0]) ? lens[r] : (int)(xorshift(&rnd) % 129);
+}
+
+static int test_prefixes(int nbkeys, int lookups)
+{
+	struct eb128_node *nodes = calloc(nbkeys, sizeof(*nodes));
+	struct eb_root root = EB_ROOT_UNIQUE;
+	struct eb128_node *n, *exp, *ret;
+	u128 bases[8], x;
+	int r, i;
+
+	for (i = 0; i < 8; i++)
+		bases[i] = rnd_key();
+
+	for (i = 0; i < nbkeys; i++) {
+		nodes[i].node.pfx = rnd_pfx();
+		x = bases[xorshift(&rnd) % 8];
+		if (xorshift(&rnd) & 1)
+			x ^= rnd_key();
+		nodes[i].key = mask(x, nodes[i].node.pfx);
+
+		exp = NULL;
+		for (r = 0; r < i; r++) {
+			if (nodes[r].node.leaf_p && nodes[r].key == nodes[i].key && nodes[r].node.pfx == nodes[i].node.pfx)
+				exp = &nodes[r];
+		}
+		ret = eb128_insert_prefix(&root, &nodes[i]);
+		if (ret != (exp ? exp : &nodes[i])) {
+			print128("eb128: insert_prefix returned the wrong node for ", nodes[i].key);
+			printf("/%d\n", nodes[i].node.pfx);
+			return 0;
+		}
+	}
+
+	for (r = 0; r < lookups; r++) {
+		x = nodes[xorshift(&rnd) % nbkeys].key;
+		switch (xorshift(&rnd) % 4) {
+		case 0: x = rnd_key(); break;
+		case 1: x |= rnd64(); break;
+		case 2: x ^= (u128)1 << (xorshift(&rnd) % 128); break;
+		}
+
+		exp = NULL;
+		for (i = 0; i < nbkeys; i++) {
+			n = &nodes[i];
+			if (n->node.leaf_p && mask(x, n->node.pfx) == n->key &&
+			    (!exp || n->node.pfx > exp->node.pfx))
+				exp = n;
+		}
+		ret = eb128_lookup_longest(&root, x);
+		if (ret != exp) {
+			print128("eb128: lookup_longest mismatch on ", x);
+			if (exp)
+				printf(" expected /%d", exp->node.pfx);
+			if (ret)
+				printf(" got /%d", ret->node.pfx);
+			printf("\n");
+			return 0;
+		}
+	}
+	free(nodes);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int nbkeys = 2000, rounds = 100000;
+
+	if (argc > 1)
+		nbkeys = atoi(argv[1]);
+	if (argc > 2)
+		rounds = atoi(argv[2]);
+
+	if (!test_keys(nbkeys, rounds, 0) || !test_keys(nbkeys, rounds, 1) ||
+	    !test_prefixes(nbkeys, rounds))
+		return 1;
+	return 0;
+}
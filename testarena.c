@@ -0,0 +1,163 @@
+/*
+ * ebtree arena allocator test - 2026
+ *
+ * Usage: testarena [#objects] [#rounds]
+ *
+ * Keeps a set of objects of random sizes allocated from an arena, and randomly
+ * frees and reallocates them, in bulk or next to another object, with and
+ * without EB_ARENA_F_LINE. Each object is filled with its own pattern, which
+ * is checked before it is freed, so that overlapping objects are detected.
+ * Objects must be zeroed, aligned on 8 bytes (or on their size up to the cache
+ * line with EB_ARENA_F_LINE), and those of a same size allocated next to
+ * another one must be in its block while there is room.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ebarena.h"
+#include "testutil.h"
+
+struct obj {
+	unsigned char *ptr;
+	size_t size;
+};
+
+/* returns a random size, mostly small, sometimes past EB_ARENA_MAX_SIZE */
+static size_t rnd_size(void)
+{
+	unsigned int r = xorshift(&rnd);
+
+	if (r % 100 == 0)
+		return EB_ARENA_MAX_SIZE + 1 + r % 4000;
+	if (r % 10 == 0)
+		return 1 + r % EB_ARENA_MAX_SIZE;
+	return 24 + r % 80;
+}
+
+/* checks and fills new object <o> with pattern <pat>, returns 0 on error */
+static int fill(struct obj *o, unsigned char pat, int line)
+{
+	size_t i;
+
+	if (!o->ptr) {
+		printf("allocation failed\n");
+		return 0;
+	}
+	if (((size_t)o->ptr & 7) ||
+	    (line && o->size <= EB_ARENA_LINE && ((size_t)o->ptr & (EB_ARENA_LINE - 1)) + o->size > EB_ARENA_LINE)) {
+		printf("object %p of %zu bytes is misaligned\n", o->ptr, o->size);
+		return 0;
+	}
+	for (i = 0; i < o->size; i++) {
+		if (o->ptr[i]) {
+			printf("object %p of %zu bytes is not zeroed\n", o->ptr, o->size);
+			return 0;
+		}
+	}
+	memset(o->ptr, pat, o->size);
+	return 1;
+}
+
+/* checks that object <o> still holds pattern <pat>, returns 0 on error */
+static int check(const struct obj *o, unsigned char pat)
+{
+	size_t i;
+
+	for (i = 0; i < o->size; i++) {
+		if (o->ptr[i] != pat) {
+			printf("object %p of %zu bytes was overwritten\n", o->ptr, o->size);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	struct eb_arena arena;
+	struct obj *objs;
+	void *bulk[16];
+	int nbobj = 20000, rounds = 200000;
+	int line, r, i, j, n;
+
+	if (argc > 1)
+		nbobj = atoi(argv[1]);
+	if (argc > 2)
+		rounds = atoi(argv[2]);
+
+	objs = calloc(nbobj, sizeof(*objs));
+
+	for (line = 0; line <= 1; line++) {
+		eb_arena_init(&arena, line ? EB_ARENA_F_LINE : 0);
+
+		for (i = 0; i < nbobj; i++) {
+			objs[i].size = rnd_size();
+			objs[i].ptr = eb_arena_alloc(&arena, objs[i].size);
+			if (!fill(&objs[i], i, line))
+				return 1;
+		}
+
+		for (r = 0; r < rounds; r++) {
+			i = xorshift(&rnd) % nbobj;
+			if (!check(&objs[i], i))
+				return 1;
+			eb_arena_free(&arena, objs[i].ptr, objs[i].size);
+
+			switch (r % 3) {
+			case 0:
+				objs[i].size = rnd_size();
+				objs[i].ptr = eb_arena_alloc(&arena, objs[i].size);
+				break;
+			case 1:
+				/* same size as another object, next to it */
+				j = xorshift(&rnd) % nbobj;
+				if (j == i)
+					j = (j + 1) % nbobj;
+				objs[i].size = objs[j].size;
+				objs[i].ptr = eb_arena_alloc_near(&arena, objs[i].size, objs[j].ptr);
+				if (objs[i].size <= EB_ARENA_MAX_SIZE &&
+				    eb_arena_block_of(objs[i].ptr) != eb_arena_block_of(objs[j].ptr) &&
+				    eb_arena_block_of(objs[j].ptr)->bump + eb_arena_block_of(objs[j].ptr)->size <= EB_ARENA_BLOCK) {
+					printf("object of %zu bytes not placed near its hint\n", objs[i].size);
+					return 1;
+				}
+				break;
+			case 2:
+				/* reallocate up to 16 objects at once */
+				n = 1;
+				while (n < 16 && i + n < nbobj) {
+					if (!check(&objs[i + n], i + n))
+						return 1;
+					eb_arena_free(&arena, objs[i + n].ptr, objs[i + n].size);
+					n++;
+				}
+				objs[i].size = rnd_size();
+				if (eb_arena_alloc_bulk(&arena, objs[i].size, bulk, n) != (unsigned int)n) {
+					printf("bulk allocation failed\n");
+					return 1;
+				}
+				for (j = 0; j < n; j++) {
+					objs[i + j].size = objs[i].size;
+					objs[i + j].ptr = bulk[j];
+				}
+				for (j = 1; j < n; j++) {
+					if (!fill(&objs[i + j], i + j, line))
+						return 1;
+				}
+				break;
+			}
+			if (!fill(&objs[i], i, line))
+				return 1;
+		}
+
+		for (i = 0; i < nbobj; i++) {
+			if (!check(&objs[i], i))
+				return 1;
+		}
+		eb_arena_destroy(&arena);
+	}
+	free(objs);
+	return 0;
+}
@@ -0,0 +1,189 @@
+/*
+ * ebtree sorted build test - 2026
+ *
+ * Usage: testbuild [#keys]
+ *
+ * Builds eb32, eb64 and ebmb trees from sorted keys (random, with many or only
+ * duplicates, consecutive, or close to 0 and ~0), once by inserting the nodes
+ * one at a time in key order and once with *_build_sorted() on a copy of the
+ * nodes, into trees accepting duplicates or not. Both trees must have exactly
+ * the same shape : same node parts at the same places with the same bits, and
+ * the same leaves at the same places, though the node parts may be provided by
+ * different nodes. The parent pointers of both trees are checked as well.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "eb32tree.h"
+#include "eb64tree.h"
+#include "ebmbtree.h"
+#include "testutil.h"
+
+enum { EB32, EB64, EBMB, TYPES };
+
+static const char *names[TYPES] = { "eb32", "eb64", "ebmb" };
+
+/* all node types start with their eb_node, ebmb keys follow the node */
+struct slot {
+	union {
+		struct eb32_node e32;
+		struct eb64_node e64;
+		struct {
+			struct ebmb_node n;
+			unsigned char k[4];
+		} mb;
+	} u;
+};
+
+/* returns a random key for distribution <dist> at position <i> */
+static u64 rnd_key(int dist, int i)
+{
+	u64 k = rnd64();
+
+	switch (dist) {
+	case 0: return k;
+	case 1: return k % 50;
+	case 2: return 12345;
+	case 3: return i;
+	default: return (k & 1) ? k % 8 : ~0ULL - k % 8;
+	}
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	u64 ka = *(const u64 *)a, kb = *(const u64 *)b;
+
+	return (ka > kb) - (ka < kb);
+}
+
+static void set_key(int type, struct slot *s, u64 k)
+{
+	switch (type) {
+	case EB32: s->u.e32.key = k; break;
+	case EB64: s->u.e64.key = k; break;
+	default:
+		s->u.mb.k[0] = k >> 24; s->u.mb.k[1] = k >> 16; s->u.mb.k[2] = k >> 8; s->u.mb.k[3] = k;
+		break;
+	}
+}
+
+/* the two trees and their nodes */
+struct ctx {
+	struct slot *ia, *ib;
+};
+
+/* Compares the subtrees <a> and <b>, designated from <upa> and <upb>. Returns
+ * non-zero if they have the same shape.
+ */
+static int same(const struct ctx *c, eb_troot_t *a, eb_troot_t *b, eb_troot_t *upa, eb_troot_t *upb)
+{
+	struct eb_node *na, *nb;
+
+	if (!a || !b)
+		return a == b;
+	if (eb_gettag(a) != eb_gettag(b))
+		return 0;
+
+	if (eb_gettag(a) == EB_LEAF) {
+		na = container_of(eb_untag(a, EB_LEAF), struct eb_node, branches);
+		nb = container_of(eb_untag(b, EB_LEAF), struct eb_node, branches);
+		return (struct slot *)na - c->ia == (struct slot *)nb - c->ib &&
+			na->leaf_p == upa && nb->leaf_p == upb;
+	}
+
+	na = container_of(eb_untag(a, EB_NODE), struct eb_node, branches);
+	nb = container_of(eb_untag(b, EB_NODE), struct eb_node, branches);
+	return na->bit == nb->bit && na->node_p == upa && nb->node_p == upb &&
+		same(c, na->branches.b[EB_LEFT], nb->branches.b[EB_LEFT],
+		     eb_dotag(&na->branches, EB_LEFT), eb_dotag(&nb->branches, EB_LEFT)) &&
+		same(c, na->branches.b[EB_RGHT], nb->branches.b[EB_RGHT],
+		     eb_dotag(&na->branches, EB_RGHT), eb_dotag(&nb->branches, EB_RGHT));
+}
+
+static int test(int type, int nb, int dist, int uniq)
+{
+	struct slot *ia = calloc(nb + 1, sizeof(*ia));
+	struct slot *ib = calloc(nb + 1, sizeof(*ib));
+	struct slot **ptrs = calloc(nb + 1, sizeof(*ptrs));
+	u64 *keys = calloc(nb + 1, sizeof(*keys));
+	struct eb_root ra = uniq ? EB_ROOT_UNIQUE : EB_ROOT;
+	struct eb_root rb = ra;
+	struct eb_node *ret;
+	struct ctx c = { ia, ib };
+	unsigned int done, linked = 0;
+	int i;
+
+	for (i = 0; i < nb; i++) {
+		keys[i] = rnd_key(dist, i);
+		if (type == EB32 || type == EBMB)
+			keys[i] = (u32)keys[i];
+	}
+	qsort(keys, nb, sizeof(*keys), cmp_u64);
+
+	for (i = 0; i < nb; i++) {
+		set_key(type, &ia[i], keys[i]);
+		set_key(type, &ib[i], keys[i]);
+		ptrs[i] = &ib[i];
+		switch (type) {
+		case EB32: ret = &eb32_insert(&ra, &ia[i].u.e32)->node; break;
+		case EB64: ret = &eb64_insert(&ra, &ia[i].u.e64)->node; break;
+		default:   ret = &ebmb_insert(&ra, &ia[i].u.mb.n, 4)->node; break;
+		}
+		linked += ret == &ia[i].u.e32.node;
+	}
+
+	switch (type) {
+	case EB32: done = eb32_build_sorted(&rb, (struct eb32_node **)ptrs, nb); break;
+	case EB64: done = eb64_build_sorted(&rb, (struct eb64_node **)ptrs, nb); break;
+	default:   done = ebmb_build_sorted(&rb, (struct ebmb_node **)ptrs, nb, 4); break;
+	}
+
+	if (done != linked) {
+		printf("%s: build_sorted linked %u nodes instead of %u (nb=%d dist=%d uniq=%d)\n",
+		       names[type], done, linked, nb, dist, uniq);
+		return 0;
+	}
+	for (i = 0; i < nb; i++) {
+		if (!ia[i].u.e32.node.leaf_p != !ib[i].u.e32.node.leaf_p) {
+			printf("%s: node %d is linked in only one tree (nb=%d dist=%d uniq=%d)\n",
+			       names[type], i, nb, dist, uniq);
+			return 0;
+		}
+	}
+	if (!same(&c, ra.b[EB_LEFT], rb.b[EB_LEFT], eb_dotag(&ra, EB_LEFT), eb_dotag(&rb, EB_LEFT)) ||
+	    ra.b[EB_RGHT] != rb.b[EB_RGHT]) {
+		printf("%s: trees differ (nb=%d dist=%d uniq=%d)\n", names[type], nb, dist, uniq);
+		return 0;
+	}
+
+	free(keys);
+	free(ptrs);
+	free(ib);
+	free(ia);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	static const int sizes[] = { 0, 1, 2, 3, 4, 5, 7, 16, 33, 100, 1000 };
+	int nbkeys = 20000;
+	int type, dist, uniq, i;
+
+	if (argc > 1)
+		nbkeys = atoi(argv[1]);
+
+	for (type = 0; type < TYPES; type++) {
+		for (dist = 0; dist < 5; dist++) {
+			for (uniq = 0; uniq < 2; uniq++) {
+				for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+					if (!test(type, sizes[i], dist, uniq))
+						return 1;
+				}
+				if (!test(type, nbkeys, dist, uniq))
+					return 1;
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,319 @@
+/*
+ * ebtree compact trees test - 2026
+ *
+ * Usage: testcb [#keys] [#rounds]
+ *
+ * Randomly inserts and deletes cb32, cb64, cbmb and cbst nodes, mirrored into
+ * eb32, eb64, ebmb and ebst trees of unique keys, with keys spread over the
+ * whole key space, over a small range, in a few dense clusters, and at both
+ * ends of the key space. Since the keys are unique, lookup, lookup_le/ge,
+ * first/last and next/prev must return exactly the same nodes in both trees,
+ * and a full walk of the compact tree must visit all of them in the same
+ * order.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "eb32tree.h"
+#include "eb64tree.h"
+#include "ebmbtree.h"
+#include "ebsttree.h"
+#include "cb32tree.h"
+#include "cb64tree.h"
+#include "cbmbtree.h"
+#include "cbsttree.h"
+#include "testutil.h"
+
+/* Each node is part of both trees. The compact node's key is always stored
+ * in <ck> just after the cb_node, and the eb node's key is either in the eb
+ * node or just after its eb_node for ebmb/ebst, thus within <eb> or <ek>.
+ */
+struct n {
+	struct cb_node cb;
+	unsigned char ck[24];
+	union {
+		struct eb32_node e32;
+		struct eb64_node e64;
+		struct ebmb_node emb;
+	} eb;
+	unsigned char ek[24];
+	u64 k;
+};
+
+enum { KT_32, KT_64, KT_MB, KT_ST };
+enum { OP_INS, OP_DEL, OP_LKP, OP_LE, OP_GE, OP_FIRST, OP_LAST, OP_NEXT, OP_PREV };
+
+static const char *names[] = { "cb32", "cb64", "cbmb", "cbst" };
+
+/* returns a random key for workload <t>: random, small range, clustered, or
+ * close to 0 and ~0, so that 0 and ~0 are often in the tree together.
+ */
+static u64 rnd_key(int t, int nbkeys)
+{
+	u64 r = rnd64();
+
+	if (t == 1)
+		return r % (nbkeys * 2 + 1);
+	if (t == 2)
+		return (r & 0xf000000000000000ULL) + (r >> 10 & 0xf0000000ULL) + r % 1024;
+	if (t == 3)
+		return (r & 1) ? (r >> 1) % 8 : ~0ULL - (r >> 1) % 8;
+	return r;
+}
+
+/* returns the key of the eb part of node <n> for ebmb and ebst */
+static unsigned char *ebkey(struct n *n)
+{
+	return (unsigned char *)&n->eb.emb + offsetof(struct ebmb_node, key);
+}
+
+/* sets key <k> of type <kt> into both parts of node <n> */
+static void set_key(struct n *n, int kt, u64 k)
+{
+	int i;
+
+	n->k = k;
+	switch (kt) {
+	case KT_32:
+		((struct cb32_node *)n)->key = n->eb.e32.key = k;
+		break;
+	case KT_64:
+		((struct cb64_node *)n)->key = n->eb.e64.key = k;
+		break;
+	case KT_MB:
+		for (i = 0; i < 8; i++)
+			n->ck[i] = ebkey(n)[i] = k >> (56 - 8 * i);
+		break;
+	case KT_ST:
+		/* no leading zeroes so that keys have different lengths */
+		snprintf((char *)n->ck, 20, "%llx", (unsigned long long)k);
+		snprintf((char *)ebkey(n), 20, "%llx", (unsigned long long)k);
+		break;
+	}
+}
+
+/* prints the key of node <n> of type <kt> */
+static void print_key(const struct n *n, int kt)
+{
+	switch (kt) {
+	case KT_32: printf("%#x", ((struct cb32_node *)n)->key); break;
+	case KT_64: printf("%#llx", (unsigned long long)((struct cb64_node *)n)->key); break;
+	case KT_MB: printf("%02x%02x%02x%02x%02x%02x%02x%02x", n->ck[0], n->ck[1], n->ck[2], n->ck[3],
+			   n->ck[4], n->ck[5], n->ck[6], n->ck[7]); break;
+	case KT_ST: printf("\"%s\"", (const char *)n->ck); break;
+	}
+}
+
+/* performs operation <op> on the compact tree <root> of type <kt>, with node
+ * <n> or the key of <p>, and returns the resulting node or NULL.
+ */
+static struct n *cb_op(int kt, int op, struct cb_node **root, struct n *n, const struct n *p)
+{
+	const void *k = p ? (const void *)p->ck : NULL;
+	void *r = NULL;
+
+	switch (kt) {
+	case KT_32:
+		switch (op) {
+		case OP_INS:   r = cb32_insert(root, (struct cb32_node *)n); break;
+		case OP_DEL:   r = cb32_delete(root, (struct cb32_node *)n); break;
+		case OP_LKP:   r = cb32_lookup(root, *(const u32 *)k); break;
+		case OP_LE:    r = cb32_lookup_le(root, *(const u32 *)k); break;
+		case OP_GE:    r = cb32_lookup_ge(root, *(const u32 *)k); break;
+		case OP_FIRST: r = cb32_first(root); break;
+		case OP_LAST:  r = cb32_last(root); break;
+		case OP_NEXT:  r = cb32_next(root, (struct cb32_node *)n); break;
+		case OP_PREV:  r = cb32_prev(root, (struct cb32_node *)n); break;
+		}
+		break;
+	case KT_64:
+		switch (op) {
+		case OP_INS:   r = cb64_insert(root, (struct cb64_node *)n); break;
+		case OP_DEL:   r = cb64_delete(root, (struct cb64_node *)n); break;
+		case OP_LKP:   r = cb64_lookup(root, *(const u64 *)k); break;
+		case OP_LE:    r = cb64_lookup_le(root, *(const u64 *)k); break;
+		case OP_GE:    r = cb64_lookup_ge(root, *(const u64 *)k); break;
+		case OP_FIRST: r = cb64_first(root); break;
+		case OP_LAST:  r = cb64_last(root); break;
+		case OP_NEXT:  r = cb64_next(root, (struct cb64_node *)n); break;
+		case OP_PREV:  r = cb64_prev(root, (struct cb64_node *)n); break;
+		}
+		break;
+	case KT_MB:
+		switch (op) {
+		case OP_INS:   r = cbmb_insert(root, (struct cbmb_node *)n, 8); break;
+		case OP_DEL:   r = cbmb_delete(root, (struct cbmb_node *)n, 8); break;
+		case OP_LKP:   r = cbmb_lookup(root, k, 8); break;
+		case OP_LE:    r = cbmb_lookup_le(root, k, 8); break;
+		case OP_GE:    r = cbmb_lookup_ge(root, k, 8); break;
+		case OP_FIRST: r = cbmb_first(root, 8); break;
+		case OP_LAST:  r = cbmb_last(root, 8); break;
+		case OP_NEXT:  r = cbmb_next(root, (struct cbmb_node *)n, 8); break;
+		case OP_PREV:  r = cbmb_prev(root, (struct cbmb_node *)n, 8); break;
+		}
+		break;
+	case KT_ST:
+		switch (op) {
+		case OP_INS:   r = cbst_insert(root, (struct cbst_node *)n); break;
+		case OP_DEL:   r = cbst_delete(root, (struct cbst_node *)n); break;
+		case OP_LKP:   r = cbst_lookup(root, k); break;
+		case OP_LE:    r = cbst_lookup_le(root, k); break;
+		case OP_GE:    r = cbst_lookup_ge(root, k); break;
+		case OP_FIRST: r = cbst_first(root); break;
+		case OP_LAST:  r = cbst_last(root); break;
+		case OP_NEXT:  r = cbst_next(root, (struct cbst_node *)n); break;
+		case OP_PREV:  r = cbst_prev(root, (struct cbst_node *)n); break;
+		}
+		break;
+	}
+	return r;
+}
+
+/* same as above on the reference eb tree */
+static struct n *eb_op(int kt, int op, struct eb_root *root, struct n *n, struct n *p)
+{
+	struct eb_node *r = NULL;
+	void *ret = NULL;
+
+	switch (kt) {
+	case KT_32:
+		switch (op) {
+		case OP_INS: ret = eb32_insert(root, &n->eb.e32); break;
+		case OP_LKP: ret = eb32_lookup(root, p->eb.e32.key); break;
+		case OP_LE:  ret = eb32_lookup_le(root, p->eb.e32.key); break;
+		case OP_GE:  ret = eb32_lookup_ge(root, p->eb.e32.key); break;
+		}
+		break;
+	case KT_64:
+		switch (op) {
+		case OP_INS: ret = eb64_insert(root, &n->eb.e64); break;
+		case OP_LKP: ret = eb64_lookup(root, p->eb.e64.key); break;
+		case OP_LE:  ret = eb64_lookup_le(root, p->eb.e64.key); break;
+		case OP_GE:  ret = eb64_lookup_ge(root, p->eb.e64.key); break;
+		}
+		break;
+	case KT_MB:
+		switch (op) {
+		case OP_INS: ret = ebmb_insert(root, &n->eb.emb, 8); break;
+		case OP_LKP: ret = ebmb_lookup(root, ebkey(p), 8); break;
+		case OP_LE:  ret = ebmb_lookup_le(root, ebkey(p), 8); break;
+		case OP_GE:  ret = ebmb_lookup_ge(root, ebkey(p), 8); break;
+		}
+		break;
+	case KT_ST:
+		switch (op) {
+		case OP_INS: ret = ebst_insert(root, &n->eb.emb); break;
+		case OP_LKP: ret = ebst_lookup(root, (const char *)ebkey(p)); break;
+		case OP_LE:  ret = ebst_lookup_le(root, (const char *)ebkey(p)); break;
+		case OP_GE:  ret = ebst_lookup_ge(root, (const char *)ebkey(p)); break;
+		}
+		break;
+	}
+
+	/* all eb nodes start with their eb_node */
+	switch (op) {
+	case OP_DEL:   eb_delete(&n->eb.e32.node); return n;
+	case OP_FIRST: r = eb_first(root); break;
+	case OP_LAST:  r = eb_last(root); break;
+	case OP_NEXT:  r = eb_next(&n->eb.e32.node); break;
+	case OP_PREV:  r = eb_prev(&n->eb.e32.node); break;
+	default:       r = ret; break;
+	}
+	return r ? (struct n *)((char *)r - offsetof(struct n, eb)) : NULL;
+}
+
+static int test(int kt, int t, int nbkeys, int rounds)
+{
+	struct n *nodes = calloc(nbkeys, sizeof(*nodes));
+	struct cb_node *cb = CB_ROOT;
+	struct eb_root eb = EB_ROOT_UNIQUE;
+	struct n probe, *c, *e;
+	unsigned int count = 0, seen;
+	int r, i, op;
+
+	for (r = 0; r < rounds; r++) {
+		i = xorshift(&rnd) % nbkeys;
+		if (nodes[i].eb.e32.node.leaf_p) {
+			if (cb_op(kt, OP_DEL, &cb, &nodes[i], NULL) != &nodes[i] ||
+			    cb_op(kt, OP_DEL, &cb, &nodes[i], NULL) != NULL) {
+				printf("%s: failed to delete key ", names[kt]);
+				print_key(&nodes[i], kt);
+				printf("\n");
+				return 0;
+			}
+			eb_op(kt, OP_DEL, &eb, &nodes[i], NULL);
+			count--;
+		} else {
+			set_key(&nodes[i], kt, rnd_key(t, nbkeys));
+			e = eb_op(kt, OP_INS, &eb, &nodes[i], NULL);
+			c = cb_op(kt, OP_INS, &cb, &nodes[i], NULL);
+			if (c != e) {
+				printf("%s: insert mismatch on key ", names[kt]);
+				print_key(&nodes[i], kt);
+				printf("\n");
+				return 0;
+			}
+			count += e == &nodes[i];
+		}
+
+		/* random keys or keys next to existing ones */
+		set_key(&probe, kt, (xorshift(&rnd) & 1) ? rnd_key(t, nbkeys) :
+			nodes[xorshift(&rnd) % nbkeys].k + (int)(xorshift(&rnd) % 3) - 1);
+
+		for (op = OP_LKP; op <= OP_LAST; op++) {
+			c = cb_op(kt, op, &cb, NULL, &probe);
+			e = eb_op(kt, op, &eb, NULL, &probe);
+			if (c != e)
+				goto fail;
+			if (c && (op == OP_LE || op == OP_GE) &&
+			    (cb_op(kt, OP_NEXT, &cb, c, NULL) != eb_op(kt, OP_NEXT, &eb, c, NULL) ||
+			     cb_op(kt, OP_PREV, &cb, c, NULL) != eb_op(kt, OP_PREV, &eb, c, NULL)))
+				goto fail;
+		}
+
+		if ((r & 4095) == 0 || r == rounds - 1) {
+			seen = 0;
+			e = eb_op(kt, OP_FIRST, &eb, NULL, NULL);
+			for (c = cb_op(kt, OP_FIRST, &cb, NULL, NULL); c; c = cb_op(kt, OP_NEXT, &cb, c, NULL)) {
+				if (c != e) {
+					printf("%s: workload %d: walk mismatch\n", names[kt], t);
+					return 0;
+				}
+				e = eb_op(kt, OP_NEXT, &eb, e, NULL);
+				seen++;
+			}
+			if (seen != count || e) {
+				printf("%s: workload %d: walked %u keys out of %u\n", names[kt], t, seen, count);
+				return 0;
+			}
+		}
+	}
+	free(nodes);
+	return 1;
+ fail:
+	printf("%s: workload %d: op %d mismatch on key ", names[kt], t, op);
+	print_key(&probe, kt);
+	printf("\n");
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int nbkeys = 5000, rounds = 100000;
+	int kt, t;
+
+	if (argc > 1)
+		nbkeys = atoi(argv[1]);
+	if (argc > 2)
+		rounds = atoi(argv[2]);
+
+	for (kt = KT_32; kt <= KT_ST; kt++) {
+		for (t = 0; t < 4; t++) {
+			if (!test(kt, t, nbkeys, rounds) || !test(kt, t, 3, rounds / 100))
+				return 1;
+		}
+	}
+	return 0;
+}
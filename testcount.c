@@ -0,0 +1,311 @@
+/*
+ * ebtree order statistics test - 2026
+ *
+ * Usage: testcount [#keys] [#rounds]
+ *
+ * This test must be built with EB_COUNT defined, as well as the tree code it
+ * uses (see the Makefile). It randomly inserts, deletes, picks and requeues
+ * eb32, eb64 and ebmb nodes, with and without duplicates, into trees accepting
+ * duplicates or not, and from time to time moves a range of keys away with
+ * *_delete_range() or rebuilds the whole tree with *_build_sorted(). After each
+ * operation, eb_count(), *_rank() and *_count_range() are checked against a
+ * linear scan of the nodes, and the trees are periodically walked to check
+ * that *_select() returns each node at its position.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "eb32tree.h"
+#include "eb64tree.h"
+#include "ebmbtree.h"
+#include "testutil.h"
+
+#ifndef EB_COUNT
+#error "testcount must be built with EB_COUNT defined"
+#endif
+
+enum { EB32, EB64, EBMB, TYPES };
+
+static const char *names[TYPES] = { "eb32", "eb64", "ebmb" };
+
+/* all node types start with their eb_node, ebmb keys follow the node */
+struct slot {
+	union {
+		struct eb32_node e32;
+		struct eb64_node e64;
+		struct {
+			struct ebmb_node n;
+			unsigned char k[4];
+		} mb;
+	} u;
+};
+
+/* returns a random key for <type>, possibly in a small range for dups */
+static u64 rnd_key(int type, int dups)
+{
+	u64 k = rnd64();
+
+	if (dups)
+		k = (u64)(s64)((int)(xorshift(&rnd) % 33) - 16);
+	return type == EB64 ? k : (u32)k;
+}
+
+static void put_be32(unsigned char *p, u32 k)
+{
+	p[0] = k >> 24; p[1] = k >> 16; p[2] = k >> 8; p[3] = k;
+}
+
+static u64 get_key(int type, const struct slot *s)
+{
+	const unsigned char *p = s->u.mb.k;
+
+	switch (type) {
+	case EB32: return s->u.e32.key;
+	case EB64: return s->u.e64.key;
+	default:   return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+	}
+}
+
+static void set_key(int type, struct slot *s, u64 k)
+{
+	switch (type) {
+	case EB32: s->u.e32.key = k; break;
+	case EB64: s->u.e64.key = k; break;
+	default:   put_be32(s->u.mb.k, k); break;
+	}
+}
+
+static inline struct eb_node *node_of(struct slot *s)
+{
+	return &s->u.e32.node;
+}
+
+static struct eb_node *insert(int type, struct eb_root *root, struct slot *s)
+{
+	switch (type) {
+	case EB32: return &eb32_insert(root, &s->u.e32)->node;
+	case EB64: return &eb64_insert(root, &s->u.e64)->node;
+	default:   return &ebmb_insert(root, &s->u.mb.n, 4)->node;
+	}
+}
+
+static struct eb_node *requeue(int type, struct eb_root *root, struct slot *s, u64 k)
+{
+	unsigned char be[4];
+
+	switch (type) {
+	case EB32: return &eb32_requeue(root, &s->u.e32, k)->node;
+	case EB64: return &eb64_requeue(root, &s->u.e64, k)->node;
+	default:
+		put_be32(be, k);
+		return &ebmb_requeue(root, &s->u.mb.n, be, 4)->node;
+	}
+}
+
+static struct eb_node *pick(int type, struct eb_root *root, u64 k)
+{
+	unsigned char be[4];
+
+	switch (type) {
+	case EB32: return (struct eb_node *)eb32_pick(root, k);
+	case EB64: return (struct eb_node *)eb64_pick(root, k);
+	default:
+		put_be32(be, k);
+		return (struct eb_node *)ebmb_pick(root, be, 4);
+	}
+}
+
+static unsigned int rank(int type, struct eb_root *root, u64 k)
+{
+	unsigned char be[4];
+
+	switch (type) {
+	case EB32: return eb32_rank(root, k);
+	case EB64: return eb64_rank(root, k);
+	default:
+		put_be32(be, k);
+		return ebmb_rank(root, be, 4);
+	}
+}
+
+static unsigned int count_range(int type, struct eb_root *root, u64 min, u64 max)
+{
+	unsigned char bmin[4], bmax[4];
+
+	switch (type) {
+	case EB32: return eb32_count_range(root, min, max);
+	case EB64: return eb64_count_range(root, min, max);
+	default:
+		put_be32(bmin, min);
+		put_be32(bmax, max);
+		return ebmb_count_range(root, bmin, bmax, 4);
+	}
+}
+
+static struct eb_node *select_node(int type, struct eb_root *root, unsigned int r)
+{
+	switch (type) {
+	case EB32: return (struct eb_node *)eb32_select(root, r);
+	case EB64: return (struct eb_node *)eb64_select(root, r);
+	default:   return (struct eb_node *)ebmb_select(root, r);
+	}
+}
+
+/* Moves the keys within [<min>, <max>] to another tree, then checks and
+ * unlinks them. There is no ebmb_delete_range(). Returns the number of nodes
+ * moved, or -1 on error.
+ */
+static int delete_range(int type, struct eb_root *root, u64 min, u64 max)
+{
+	struct eb_root out = EB_ROOT;
+	struct eb_node *n;
+	unsigned int moved;
+	int nb = 0;
+
+	switch (type) {
+	case EB32: eb32_delete_range(root, min, max, &out); break;
+	case EB64: eb64_delete_range(root, min, max, &out); break;
+	default:   return 0;
+	}
+
+	moved = eb_count(&out);
+	while ((n = eb_pick_first(&out)) != NULL)
+		nb++;
+	return moved == (unsigned int)nb ? nb : -1;
+}
+
+/* Rebuilds the tree with the nodes in their walk order, and returns the
+ * number of nodes linked by *_build_sorted().
+ */
+static unsigned int rebuild(int type, struct eb_root *root, struct slot **tmp, int uniq)
+{
+	struct eb_node *n;
+	unsigned int nb = 0;
+
+	while ((n = eb_pick_first(root)) != NULL)
+		tmp[nb++] = (struct slot *)n;
+	*root = uniq ? EB_ROOT_UNIQUE : EB_ROOT;
+
+	switch (type) {
+	case EB32: return eb32_build_sorted(root, (struct eb32_node **)tmp, nb);
+	case EB64: return eb64_build_sorted(root, (struct eb64_node **)tmp, nb);
+	default:   return ebmb_build_sorted(root, (struct ebmb_node **)tmp, nb, 4);
+	}
+}
+
+static int test(int type, int nbkeys, int rounds, int dups, int uniq)
+{
+	struct slot *nodes = calloc(nbkeys, sizeof(*nodes));
+	struct slot **tmp = calloc(nbkeys, sizeof(*tmp));
+	struct eb_root root = uniq ? EB_ROOT_UNIQUE : EB_ROOT;
+	struct eb_node *n;
+	unsigned int total = 0, below, inside, seen;
+	int r, i, op, ret;
+	u64 x, y, k;
+
+	for (r = 0; r < rounds; r++) {
+		i = xorshift(&rnd) % nbkeys;
+		x = rnd_key(type, dups);
+		y = rnd_key(type, dups);
+		if (x > y) {
+			k = x; x = y; y = k;
+		}
+
+		op = xorshift(&rnd) % 64;
+		if (op == 0) {
+			if (delete_range(type, &root, x, y) < 0) {
+				printf("%s: delete_range count mismatch\n", names[type]);
+				return 0;
+			}
+		}
+		else if (op == 1) {
+			rebuild(type, &root, tmp, uniq);
+		}
+		else if (op < 16) {
+			requeue(type, &root, &nodes[i], rnd_key(type, dups));
+		}
+		else if (op < 24) {
+			n = pick(type, &root, nodes[i].u.e32.node.leaf_p ? get_key(type, &nodes[i]) : x);
+			if (n && n->leaf_p) {
+				printf("%s: picked node still linked\n", names[type]);
+				return 0;
+			}
+		}
+		else if (nodes[i].u.e32.node.leaf_p)
+			eb_delete(node_of(&nodes[i]));
+		else {
+			set_key(type, &nodes[i], rnd_key(type, dups));
+			insert(type, &root, &nodes[i]);
+		}
+
+		/* the count, the rank of <x> and the count within [x, y] */
+		total = below = inside = 0;
+		for (i = 0; i < nbkeys; i++) {
+			if (!nodes[i].u.e32.node.leaf_p)
+				continue;
+			k = get_key(type, &nodes[i]);
+			total++;
+			below += k < x;
+			inside += k >= x && k <= y;
+		}
+		if (eb_count(&root) != total || rank(type, &root, x) != below ||
+		    count_range(type, &root, x, y) != inside || count_range(type, &root, y, x) != (x == y ? inside : 0)) {
+			printf("%s: count mismatch after op %d: count %u/%u, rank %u/%u, range %u/%u (dups=%d uniq=%d)\n",
+			       names[type], op, eb_count(&root), total, rank(type, &root, x), below,
+			       count_range(type, &root, x, y), inside, dups, uniq);
+			return 0;
+		}
+
+		if ((r & 1023) == 0 || r == rounds - 1) {
+			seen = 0;
+			k = 0;
+			for (n = eb_first(&root); n; n = eb_next(n), seen++) {
+				if (select_node(type, &root, seen) != n ||
+				    (seen && get_key(type, (struct slot *)n) < k)) {
+					printf("%s: node %u misplaced or not selected\n", names[type], seen);
+					return 0;
+				}
+				k = get_key(type, (struct slot *)n);
+				if (rank(type, &root, k) > seen) {
+					printf("%s: rank of node %u is %u\n", names[type], seen, rank(type, &root, k));
+					return 0;
+				}
+			}
+			if (seen != total || select_node(type, &root, seen)) {
+				printf("%s: walked %u keys out of %u\n", names[type], seen, total);
+				return 0;
+			}
+		}
+	}
+
+	ret = rebuild(type, &root, tmp, uniq);
+	if ((unsigned int)ret != total || eb_count(&root) != total) {
+		printf("%s: build_sorted linked %d nodes out of %u\n", names[type], ret, total);
+		return 0;
+	}
+	free(tmp);
+	free(nodes);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int nbkeys = 1000, rounds = 50000;
+	int type, dups, uniq;
+
+	if (argc > 1)
+		nbkeys = atoi(argv[1]);
+	if (argc > 2)
+		rounds = atoi(argv[2]);
+
+	for (type = 0; type < TYPES; type++) {
+		for (uniq = 0; uniq < 2; uniq++) {
+			for (dups = 0; dups < 2; dups++) {
+				if (!test(type, nbkeys, rounds, dups, uniq))
+					return 1;
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * ebtree thread-scaling test for deferred updates of an eb32 tree - 2026
+ *
+ * Usage: testdefer [#keys] [seconds per run] [max threads]
+ *
+ * Each thread owns a slice of the nodes, and continuously moves one of them to
+ * a new random key. This is first done with delete+insert under the tree's
+ * lock, then using ebdefer_delete()+ebdefer_insert(), with the thread flushing
+ * the whole tree once every 64 moves. Each run reports the total throughput
+ * for 1, 2, 4... threads, then checks that all nodes are found at their last
+ * key.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "ebdefer.h"
+#include "testutil.h"
+
+#define MAX_THREADS 256
+#define LOG_SIZE    256
+#define BATCH_SIZE  4096
+
+struct worker {
+	unsigned long ops;
+	unsigned int rnd;
+	int id;
+	struct ebdefer_log log;
+	struct ebdefer_op ops_log[LOG_SIZE];
+} ALIGNED(64);
+
+struct ebshard_root sr;
+struct ebshard tree;
+struct ebdefer defer;
+struct ebdefer_op batch[BATCH_SIZE];
+struct worker workers[MAX_THREADS];
+struct eb32_node *nodes;
+u32 *keys;
+int nbkeys, nbthreads, deferred;
+volatile int running;
+
+static void *worker(void *arg)
+{
+	struct worker *w = arg;
+	int slice = nbkeys / nbthreads;
+	int first = w->id * slice;
+	unsigned long ops = 0;
+	int i;
+
+	while (running) {
+		i = first + xorshift(&w->rnd) % slice;
+		keys[i] = xorshift(&w->rnd);
+		if (deferred) {
+			ebdefer_delete(&w->log, &nodes[i].node);
+			ebdefer_insert(&w->log, &nodes[i].node, keys[i]);
+			if (!(ops & 63))
+				ebdefer_flush(&defer);
+		} else {
+			ebshard_lock(&tree);
+			__eb32_delete(&nodes[i]);
+			nodes[i].key = keys[i];
+			__eb32_insert(&tree.root, &nodes[i]);
+			ebshard_unlock(&tree);
+		}
+		ops++;
+	}
+	w->ops = ops;
+	return NULL;
+}
+
+/* checks that all nodes are in the tree at their last key */
+static int check_tree(void)
+{
+	struct eb32_node *node;
+	int i, count = 0;
+
+	for (node = eb32_first(&tree.root); node; node = eb32_next(node))
+		count++;
+	if (count != nbkeys) {
+		printf("found %d nodes instead of %d\n", count, nbkeys);
+		return 0;
+	}
+	for (i = 0; i < nbkeys; i++) {
+		if (nodes[i].key != keys[i] || !eb32_lookup(&tree.root, keys[i])) {
+			printf("node %d not found at key %u\n", i, keys[i]);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t thr[MAX_THREADS];
+	struct timeval beg, end;
+	unsigned long total;
+	double secs, base;
+	int duration, maxthreads;
+	unsigned int rnd = 0x12345678;
+	int i;
+
+	nbkeys = (argc > 1) ? atoi(argv[1]) : 100000;
+	duration = (argc > 2) ? atoi(argv[2]) : 1;
+	maxthreads = (argc > 3) ? atoi(argv[3]) : sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (maxthreads < 1)
+		maxthreads = 1;
+	if (maxthreads > MAX_THREADS)
+		maxthreads = MAX_THREADS;
+	if (nbkeys < maxthreads)
+		nbkeys = maxthreads;
+
+	nodes = calloc(nbkeys, sizeof(*nodes));
+	keys = calloc(nbkeys, sizeof(*keys));
+
+	ebshard_init(&sr, &tree, 0, 0);
+	ebdefer_init(&defer, &tree, 32, batch, BATCH_SIZE);
+	for (i = 0; i < MAX_THREADS; i++)
+		ebdefer_register(&defer, &workers[i].log, workers[i].ops_log, LOG_SIZE);
+
+	for (i = 0; i < nbkeys; i++) {
+		keys[i] = nodes[i].key = xorshift(&rnd);
+		eb32_insert(&tree.root, &nodes[i]);
+	}
+
+	printf("#     mode  threads  moves/s  per-thread  scaling\n");
+	for (deferred = 0; deferred < 2; deferred++) {
+		base = 0;
+		for (nbthreads = 1; nbthreads <= maxthreads; nbthreads *= 2) {
+			running = 1;
+			gettimeofday(&beg, NULL);
+			for (i = 0; i < nbthreads; i++) {
+				workers[i].ops = 0;
+				workers[i].id = i;
+				workers[i].rnd = 0x9e3779b9 * (i + 1);
+				pthread_create(&thr[i], NULL, worker, &workers[i]);
+			}
+			sleep(duration);
+			running = 0;
+			total = 0;
+			for (i = 0; i < nbthreads; i++) {
+				pthread_join(thr[i], NULL);
+				total += workers[i].ops;
+			}
+			ebdefer_flush(&defer);
+			gettimeofday(&end, NULL);
+
+			secs = (end.tv_sec - beg.tv_sec) + (end.tv_usec - beg.tv_usec) / 1000000.0;
+			if (nbthreads == 1)
+				base = total / secs;
+			printf("%10s %8d %8.0f %11.0f %8.2f\n",
+			       deferred ? "deferred" : "locked", nbthreads, total / secs,
+			       total / secs / nbthreads, total / secs / base);
+
+			if (!check_tree())
+				return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,279 @@
+/*
+ * ebtree float and double trees test - 2026
+ *
+ * Usage: testfloat [#keys] [#lookups]
+ *
+ * Fills ebf32 and ebf64 trees with keys made of random bit patterns (thus
+ * including NaNs, infinites and denormals), of special values and small
+ * integers (thus many duplicates), and of random values of both signs. The
+ * keys are sorted apart using the C comparison operators, completed with
+ * the sign bit for zeroes and the payload for NaNs, and the tree walk must
+ * return them in the same order. Exact, le and ge lookups are checked against
+ * a binary search in the sorted keys.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ebf32tree.h"
+#include "ebf64tree.h"
+#include "testutil.h"
+
+static const double specials[] = {
+	0.0, -0.0, 1.0, -1.0, 2.0, -2.0, 0.5, -0.5, INFINITY, -INFINITY, NAN, -NAN,
+	1e-310, -1e-310, 1e-40, -1e-40, 1e300, -1e300,
+};
+
+/* returns a random double for workload <t>: bit patterns, specials, values */
+static double rnd_dbl(int t)
+{
+	union { double f; u64 u; } v;
+
+	if (t == 0) {
+		v.u = rnd64();
+		return v.f;
+	}
+	if (t == 1) {
+		if (xorshift(&rnd) & 1)
+			return specials[xorshift(&rnd) % (sizeof(specials) / sizeof(specials[0]))];
+		return (int)(xorshift(&rnd) % 41) - 20;
+	}
+	return ((int)xorshift(&rnd) / 1024.0) * (xorshift(&rnd) % 1000 / 999.0);
+}
+
+/* returns a random float for workload <t> */
+static float rnd_flt(int t)
+{
+	union { float f; u32 u; } v;
+
+	if (t == 0) {
+		v.u = xorshift(&rnd);
+		return v.f;
+	}
+	return rnd_dbl(t);
+}
+
+/* compares two NaNs or a NaN and a number of the same sign <neg> using their
+ * payloads, which is the magnitude of their bit patterns.
+ */
+static int cmp_mag(u64 a, u64 b, int neg)
+{
+	if (a == b)
+		return 0;
+	return ((a < b) ^ neg) ? -1 : 1;
+}
+
+/* total order comparison of two doubles */
+static int cmp_dbl(double a, double b)
+{
+	union { double f; u64 u; } va, vb;
+
+	if (signbit(a) != signbit(b))
+		return signbit(a) ? -1 : 1;
+	if (!isnan(a) && !isnan(b))
+		return a < b ? -1 : a > b;
+	va.f = a; vb.f = b;
+	return cmp_mag(va.u << 1, vb.u << 1, !!signbit(a));
+}
+
+/* total order comparison of two floats */
+static int cmp_flt(float a, float b)
+{
+	union { float f; u32 u; } va, vb;
+
+	if (signbit(a) != signbit(b))
+		return signbit(a) ? -1 : 1;
+	if (!isnan(a) && !isnan(b))
+		return a < b ? -1 : a > b;
+	va.f = a; vb.f = b;
+	return cmp_mag(va.u << 1, vb.u << 1, !!signbit(a));
+}
+
+static int qcmp_dbl(const void *a, const void *b)
+{
+	return cmp_dbl(*(const double *)a, *(const double *)b);
+}
+
+static int qcmp_flt(const void *a, const void *b)
+{
+	return cmp_flt(*(const float *)a, *(const float *)b);
+}
+
+/* returns the index of the last key of <keys> not above <x>, or -1 */
+static int bsearch_le_flt(const float *keys, int nb, float x)
+{
+	int lo = 0, hi = nb;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (cmp_flt(keys[mid], x) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo - 1;
+}
+
+static int bsearch_le_dbl(const double *keys, int nb, double x)
+{
+	int lo = 0, hi = nb;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (cmp_dbl(keys[mid], x) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo - 1;
+}
+
+static int test32(int t, int nbkeys, int lookups)
+{
+	struct ebf32_node *nodes = calloc(nbkeys + 1, sizeof(*nodes));
+	float *keys = calloc(nbkeys + 1, sizeof(*keys));
+	struct eb_root root = EBF32_ROOT;
+	struct ebf32_node *n;
+	int i, j;
+	float x;
+
+	for (i = 0; i < nbkeys; i++) {
+		keys[i] = nodes[i].key = rnd_flt(t);
+		if (ebf32_insert(&root, &nodes[i]) != &nodes[i]) {
+			printf("ebf32: failed to insert key %g\n", keys[i]);
+			return 0;
+		}
+	}
+	qsort(keys, nbkeys, sizeof(*keys), qcmp_flt);
+
+	for (i = 0, n = ebf32_first(&root); n; i++, n = ebf32_next(n)) {
+		if (i >= nbkeys || memcmp(&n->key, &keys[i], sizeof(x)) != 0) {
+			printf("ebf32: workload %d: key %d is %g instead of %g\n", t, i, n->key, keys[i]);
+			return 0;
+		}
+	}
+	if (i != nbkeys || (nbkeys && memcmp(&ebf32_last(&root)->key, &keys[nbkeys - 1], sizeof(x)) != 0)) {
+		printf("ebf32: workload %d: walked %d keys out of %d\n", t, i, nbkeys);
+		return 0;
+	}
+
+	for (i = 0; i < lookups; i++) {
+		x = (nbkeys && xorshift(&rnd) & 1) ? keys[xorshift(&rnd) % nbkeys] : rnd_flt(t);
+		j = bsearch_le_flt(keys, nbkeys, x);
+
+		n = ebf32_lookup(&root, x);
+		if (!n != (j < 0 || cmp_flt(keys[j], x) != 0) ||
+		    (n && (memcmp(&n->key, &x, sizeof(x)) != 0 ||
+			   (ebf32_prev(n) && cmp_flt(ebf32_prev(n)->key, x) == 0))))
+			goto fail;
+
+		n = ebf32_lookup_le(&root, x);
+		if (!n != (j < 0) ||
+		    (n && (memcmp(&n->key, &keys[j], sizeof(x)) != 0 ||
+			   (ebf32_next(n) && cmp_flt(ebf32_next(n)->key, x) <= 0))))
+			goto fail;
+
+		if (j >= 0 && cmp_flt(keys[j], x) == 0)
+			while (j > 0 && cmp_flt(keys[j - 1], x) == 0)
+				j--;
+		else
+			j++;
+		n = ebf32_lookup_ge(&root, x);
+		if (!n != (j >= nbkeys) ||
+		    (n && (memcmp(&n->key, &keys[j], sizeof(x)) != 0 ||
+			   (ebf32_prev(n) && cmp_flt(ebf32_prev(n)->key, x) >= 0))))
+			goto fail;
+	}
+	free(keys);
+	free(nodes);
+	return 1;
+ fail:
+	printf("ebf32: workload %d: lookup mismatch on key %g\n", t, x);
+	return 0;
+}
+
+static int test64(int t, int nbkeys, int lookups)
+{
+	struct ebf64_node *nodes = calloc(nbkeys + 1, sizeof(*nodes));
+	double *keys = calloc(nbkeys + 1, sizeof(*keys));
+	struct eb_root root = EBF64_ROOT;
+	struct ebf64_node *n;
+	int i, j;
+	double x;
+
+	for (i = 0; i < nbkeys; i++) {
+		keys[i] = nodes[i].key = rnd_dbl(t);
+		if (ebf64_insert(&root, &nodes[i]) != &nodes[i]) {
+			printf("ebf64: failed to insert key %g\n", keys[i]);
+			return 0;
+		}
+	}
+	qsort(keys, nbkeys, sizeof(*keys), qcmp_dbl);
+
+	for (i = 0, n = ebf64_first(&root); n; i++, n = ebf64_next(n)) {
+		if (i >= nbkeys || memcmp(&n->key, &keys[i], sizeof(x)) != 0) {
+			printf("ebf64: workload %d: key %d is %g instead of %g\n", t, i, n->key, keys[i]);
+			return 0;
+		}
+	}
+	if (i != nbkeys || (nbkeys && memcmp(&ebf64_last(&root)->key, &keys[nbkeys - 1], sizeof(x)) != 0)) {
+		printf("ebf64: workload %d: walked %d keys out of %d\n", t, i, nbkeys);
+		return 0;
+	}
+
+	for (i = 0; i < lookups; i++) {
+		x = (nbkeys && xorshift(&rnd) & 1) ? keys[xorshift(&rnd) % nbkeys] : rnd_dbl(t);
+		j = bsearch_le_dbl(keys, nbkeys, x);
+
+		n = ebf64_lookup(&root, x);
+		if (!n != (j < 0 || cmp_dbl(keys[j], x) != 0) ||
+		    (n && (memcmp(&n->key, &x, sizeof(x)) != 0 ||
+			   (ebf64_prev(n) && cmp_dbl(ebf64_prev(n)->key, x) == 0))))
+			goto fail;
+
+		n = ebf64_lookup_le(&root, x);
+		if (!n != (j < 0) ||
+		    (n && (memcmp(&n->key, &keys[j], sizeof(x)) != 0 ||
+			   (ebf64_next(n) && cmp_dbl(ebf64_next(n)->key, x) <= 0))))
+			goto fail;
+
+		if (j >= 0 && cmp_dbl(keys[j], x) == 0)
+			while (j > 0 && cmp_dbl(keys[j - 1], x) == 0)
+				j--;
+		else
+			j++;
+		n = ebf64_lookup_ge(&root, x);
+		if (!n != (j >= nbkeys) ||
+		    (n && (memcmp(&n->key, &keys[j], sizeof(x)) != 0 ||
+			   (ebf64_prev(n) && cmp_dbl(ebf64_prev(n)->key, x) >= 0))))
+			goto fail;
+	}
+	free(keys);
+	free(nodes);
+	return 1;
+ fail:
+	printf("ebf64: workload %d: lookup mismatch on key %g\n", t, x);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int nbkeys = 50000, lookups = 200000;
+	int t;
+
+	if (argc > 1)
+		nbkeys = atoi(argv[1]);
+	if (argc > 2)
+		lookups = atoi(argv[2]);
+
+	for (t = 0; t < 3; t++) {
+		if (!test32(t, nbkeys, lookups) || !test32(t, 0, 10) ||
+		    !test64(t, nbkeys, lookups) || !test64(t, 0, 10))
+			return 1;
+	}
+	return 0;
+}
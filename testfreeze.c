@@ -0,0 +1,225 @@
+/*
+ * ebtree frozen snapshots test - 2026
+ *
+ * Usage: testfreeze [#keys] [#lookups]
+ *
+ * Fills eb32, eb64 and ebmb trees with random, duplicate and clustered keys,
+ * freezes them and checks that exact, le and ge lookups of random keys and of
+ * keys around the existing ones return the same nodes in the snapshot and in
+ * the tree. It then does the same with longest prefix lookups on prefix trees
+ * made of many nested prefixes. The empty trees are checked as well.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ebfreeze.h"
+#include "testutil.h"
+
+struct mb16 {
+	struct ebmb_node node;
+	unsigned char key[16];
+};
+
+struct mb4 {
+	struct ebmb_node node;
+	unsigned char key[4];
+};
+
+/* returns a random key for workload <t>: random, dups, or clustered */
+static u64 rnd_key(int t, int nbkeys)
+{
+	u64 r = rnd64();
+
+	if (t == 1)
+		return r % (nbkeys / 10 + 1);
+	if (t == 2)
+		return (r & 0xffff0000000000ffULL) | (r >> 40 & 0xff00);
+	return r;
+}
+
+/* picks a key to look up: random or close to key <k> */
+static u64 pick(int t, int nbkeys, u64 k)
+{
+	switch (xorshift(&rnd) % 4) {
+	case 0: return rnd_key(t, nbkeys);
+	case 1: return k - 1;
+	case 2: return k + 1;
+	}
+	return k;
+}
+
+static int check32(int t, int nbkeys, int lookups)
+{
+	struct eb32_node *nodes = calloc(nbkeys, sizeof(*nodes));
+	struct eb_root root = EB_ROOT;
+	struct eb32_frozen *f;
+	u32 x;
+	int i;
+
+	for (i = 0; i < nbkeys; i++) {
+		nodes[i].key = rnd_key(t, nbkeys);
+		eb32_insert(&root, &nodes[i]);
+	}
+
+	f = eb32_freeze(&root);
+	for (i = 0; i < lookups; i++) {
+		x = pick(t, nbkeys, nbkeys ? nodes[xorshift(&rnd) % nbkeys].key : 0);
+		if (eb32_frozen_lookup(f, x) != eb32_lookup(&root, x) ||
+		    eb32_frozen_lookup_le(f, x) != eb32_lookup_le(&root, x) ||
+		    eb32_frozen_lookup_ge(f, x) != eb32_lookup_ge(&root, x)) {
+			printf("eb32 workload %d: mismatch on key %#x\n", t, x);
+			return 0;
+		}
+	}
+	eb32_frozen_free(f);
+	free(nodes);
+	return 1;
+}
+
+static int check64(int t, int nbkeys, int lookups)
+{
+	struct eb64_node *nodes = calloc(nbkeys, sizeof(*nodes));
+	struct eb_root root = EB_ROOT;
+	struct eb64_frozen *f;
+	u64 x;
+	int i;
+
+	for (i = 0; i < nbkeys; i++) {
+		nodes[i].key = rnd_key(t, nbkeys);
+		eb64_insert(&root, &nodes[i]);
+	}
+
+	f = eb64_freeze(&root);
+	for (i = 0; i < lookups; i++) {
+		x = pick(t, nbkeys, nbkeys ? nodes[xorshift(&rnd) % nbkeys].key : 0);
+		if (eb64_frozen_lookup(f, x) != eb64_lookup(&root, x) ||
+		    eb64_frozen_lookup_le(f, x) != eb64_lookup_le(&root, x) ||
+		    eb64_frozen_lookup_ge(f, x) != eb64_lookup_ge(&root, x)) {
+			printf("eb64 workload %d: mismatch on key %#llx\n", t, (unsigned long long)x);
+			return 0;
+		}
+	}
+	eb64_frozen_free(f);
+	free(nodes);
+	return 1;
+}
+
+/* 16-byte keys made of a clustered 64-bit word followed by another one, so
+ * that many keys share their first 8 bytes.
+ */
+static void mbkey(unsigned char *key, u64 hi, u64 lo)
+{
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		key[i] = hi >> (56 - 8 * i);
+		key[8 + i] = lo >> (56 - 8 * i);
+	}
+}
+
+static int checkmb(int t, int nbkeys, int lookups)
+{
+	struct mb16 *nodes = calloc(nbkeys, sizeof(*nodes));
+	struct eb_root root = EB_ROOT;
+	struct ebmb_frozen *f;
+	unsigned char x[16];
+	int i, j;
+
+	for (i = 0; i < nbkeys; i++) {
+		mbkey(nodes[i].key, rnd_key(1, nbkeys), rnd_key(t, nbkeys));
+		ebmb_insert(&root, &nodes[i].node, 16);
+	}
+
+	f = ebmb_freeze(&root, 16);
+	for (i = 0; i < lookups; i++) {
+		if (nbkeys && xorshift(&rnd) & 1) {
+			memcpy(x, nodes[xorshift(&rnd) % nbkeys].key, 16);
+			j = xorshift(&rnd) % 17;
+			if (j < 16)
+				x[j] += (xorshift(&rnd) & 1) ? 1 : -1;
+		} else
+			mbkey(x, rnd_key(1, nbkeys), rnd_key(t, nbkeys));
+
+		if (ebmb_frozen_lookup(f, x) != ebmb_lookup(&root, x, 16) ||
+		    ebmb_frozen_lookup_le(f, x) != ebmb_lookup_le(&root, x, 16) ||
+		    ebmb_frozen_lookup_ge(f, x) != ebmb_lookup_ge(&root, x, 16)) {
+			printf("ebmb workload %d: mismatch on key %d\n", t, i);
+			return 0;
+		}
+	}
+	ebmb_frozen_free(f);
+	free(nodes);
+	return 1;
+}
+
+/* prefixes of 0 to 32 bits within a few /8, to get many nested ones */
+static int checkpfx(int nbkeys, int lookups)
+{
+	struct mb4 *nodes = calloc(nbkeys, sizeof(*nodes));
+	struct eb_root root = EB_ROOT;
+	struct ebmb_frozen *f;
+	unsigned char x[4];
+	unsigned int v, pfx;
+	int i;
+
+	for (i = 0; i < nbkeys; i++) {
+		v = (xorshift(&rnd) & 0x03ffffff) | 0x0a000000;
+		pfx = xorshift(&rnd) % 33;
+		if (pfx < 32)
+			v &= ~(0xffffffffU >> pfx);
+		nodes[i].key[0] = v >> 24;
+		nodes[i].key[1] = v >> 16;
+		nodes[i].key[2] = v >> 8;
+		nodes[i].key[3] = v;
+		nodes[i].node.node.pfx = pfx;
+		ebmb_insert_prefix(&root, &nodes[i].node, pfx);
+	}
+
+	f = ebmb_freeze_prefix(&root, 4);
+	for (i = 0; i < lookups; i++) {
+		v = (xorshift(&rnd) & 0x07ffffff) | 0x08000000;
+		if (nbkeys && xorshift(&rnd) & 1) {
+			struct mb4 *n = &nodes[xorshift(&rnd) % nbkeys];
+
+			v = (n->key[0] << 24) + (n->key[1] << 16) + (n->key[2] << 8) + n->key[3];
+			if (xorshift(&rnd) & 1)
+				v |= n->node.node.pfx < 32 ? 0xffffffffU >> n->node.node.pfx : 0;
+			v += (int)(xorshift(&rnd) % 3) - 1;
+		}
+		x[0] = v >> 24;
+		x[1] = v >> 16;
+		x[2] = v >> 8;
+		x[3] = v;
+		if (ebmb_frozen_lookup_longest(f, x) != ebmb_lookup_longest(&root, x)) {
+			printf("prefix: mismatch on key %#x\n", v);
+			return 0;
+		}
+	}
+	ebmb_frozen_free(f);
+	free(nodes);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int nbkeys = 100000, lookups = 200000;
+	int t;
+
+	if (argc > 1)
+		nbkeys = atoi(argv[1]);
+	if (argc > 2)
+		lookups = atoi(argv[2]);
+
+	for (t = 0; t < 3; t++) {
+		if (!check32(t, nbkeys, lookups) || !check32(t, 0, 10) ||
+		    !check64(t, nbkeys, lookups) || !check64(t, 0, 10) ||
+		    !checkmb(t, nbkeys, lookups) || !checkmb(t, 0, 10))
+			return 1;
+	}
+	if (!checkpfx(nbkeys, lookups) || !checkpfx(nbkeys / 1000 + 1, lookups) ||
+	    !checkpfx(0, 10))
+		return 1;
+	return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ * ebtree hinted lookup and insert test - 2026
+ *
+ * Usage: testfrom [#keys] [#rounds]
+ *
+ * Builds two eb32 or eb64 trees with the same keys, accepting duplicates or
+ * not, one with *_insert_from() and one with *_insert(), and randomly deletes
+ * nodes from both. The hints are NULL, unqueued nodes, random nodes (thus often
+ * far from the key), neighbours of the key, or nodes from the duplicate tree
+ * of the key. Each *_lookup_from() from such a hint must return the same node
+ * as *_lookup() on the other tree, and each *_insert_from() must return the
+ * same node as *_insert(). Both trees are periodically walked and must hold
+ * the same nodes in the same order, and the parent pointers of the hinted
+ * tree are checked.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "eb32tree.h"
+#include "eb64tree.h"
+#include "testutil.h"
+
+enum { EB32, EB64, TYPES };
+
+static const char *names[TYPES] = { "eb32", "eb64" };
+
+struct slot {
+	union {
+		struct eb32_node e32;
+		struct eb64_node e64;
+	} u;
+};
+
+static int cur_type;
+
+static u64 rnd_key(int dups)
+{
+	u64 k = rnd64();
+
+	if (dups)
+		k %= 64;
+	return cur_type == EB32 ? (u32)k : k;
+}
+
+static u64 get_key(const struct slot *s)
+{
+	return cur_type == EB32 ? s->u.e32.key : s->u.e64.key;
+}
+
+static void set_key(struct slot *s, u64 k)
+{
+	if (cur_type == EB32)
+		s->u.e32.key = k;
+	else
+		s->u.e64.key = k;
+}
+
+static int linked(const struct slot *s)
+{
+	return s->u.e32.node.leaf_p != NULL;
+}
+
+static struct slot *insert(struct eb_root *root, struct slot *hint, struct slot *s, int from)
+{
+	if (cur_type == EB32)
+		return (struct slot *)(from ? eb32_insert_from(root, hint ? &hint->u.e32 : NULL, &s->u.e32) :
+				       eb32_insert(root, &s->u.e32));
+	return (struct slot *)(from ? eb64_insert_from(root, hint ? &hint->u.e64 : NULL, &s->u.e64) :
+			       eb64_insert(root, &s->u.e64));
+}
+
+static struct slot *lookup(struct eb_root *root, struct slot *hint, u64 x, int from)
+{
+	if (cur_type == EB32)
+		return (struct slot *)(from ? eb32_lookup_from(root, hint ? &hint->u.e32 : NULL, x) :
+				       eb32_lookup(root, x));
+	return (struct slot *)(from ? eb64_lookup_from(root, hint ? &hint->u.e64 : NULL, x) :
+			       eb64_lookup(root, x));
+}
+
+/* Returns a hint among the nodes <a> for key <x> : NULL, a random node which
+ * may not be queued, a random queued node, a queued node with the closest key
+ * below or above <x>, or the last queued node holding <x>.
+ */
+static struct slot *pick_hint(struct slot *a, int nbkeys, u64 x)
+{
+	struct slot *h = NULL;
+	int mode = xorshift(&rnd) % 6;
+	int i, j;
+
+	if (mode == 0)
+		return NULL;
+	if (mode == 1)
+		return &a[xorshift(&rnd) % nbkeys];
+	if (mode == 2) {
+		for (i = 0, j = xorshift(&rnd) % nbkeys; i < nbkeys; i++, j = (j + 1) % nbkeys)
+			if (linked(&a[j]))
+				return &a[j];
+		return NULL;
+	}
+
+	for (i = 0; i < nbkeys; i++) {
+		if (!linked(&a[i]))
+			continue;
+		if (mode == 3 && get_key(&a[i]) < x && (!h || get_key(&a[i]) > get_key(h)))
+			h = &a[i];
+		else if (mode == 4 && get_key(&a[i]) > x && (!h || get_key(&a[i]) < get_key(h)))
+			h = &a[i];
+		else if (mode == 5 && get_key(&a[i]) == x)
+			h = &a[i];
+	}
+	return h;
+}
+
+static int test(int type, int nbkeys, int rounds, int dups, int uniq)
+{
+	struct slot *a = calloc(nbkeys, sizeof(*a));
+	struct slot *b = calloc(nbkeys, sizeof(*b));
+	struct eb_root ra = uniq ? EB_ROOT_UNIQUE : EB_ROOT;
+	struct eb_root rb = ra;
+	struct slot *hint, *ret, *exp;
+	struct eb_node *na, *nb;
+	int r, i, nbin = 0;
+	u64 x;
+
+	cur_type = type;
+	for (r = 0; r < rounds; r++) {
+		i = xorshift(&rnd) % nbkeys;
+		if (linked(&a[i])) {
+			/* delete from time to time, mostly to insert again */
+			if (xorshift(&rnd) % 3 == 0) {
+				eb_delete(&a[i].u.e32.node);
+				eb_delete(&b[i].u.e32.node);
+				nbin--;
+			}
+		}
+		else {
+			x = rnd_key(dups);
+			set_key(&a[i], x);
+			set_key(&b[i], x);
+			hint = pick_hint(a, nbkeys, x);
+			ret = insert(&ra, hint, &a[i], 1);
+			exp = insert(&rb, NULL, &b[i], 0);
+			if (ret - a != exp - b) {
+				printf("%s: insert_from of %#llx from hint %d returned node %d instead of %d (dups=%d uniq=%d)\n",
+				       names[type], (unsigned long long)x, hint ? (int)(hint - a) : -1,
+				       (int)(ret - a), (int)(exp - b), dups, uniq);
+				return 0;
+			}
+			nbin += ret == &a[i];
+		}
+
+		/* look up a key from the tree or a random one */
+		x = (xorshift(&rnd) & 1) ? get_key(&a[xorshift(&rnd) % nbkeys]) : rnd_key(dups);
+		hint = pick_hint(a, nbkeys, x);
+		ret = lookup(&ra, hint, x, 1);
+		exp = lookup(&rb, NULL, x, 0);
+		if ((ret ? ret - a : -1) != (exp ? exp - b : -1)) {
+			printf("%s: lookup_from of %#llx from hint %d returned node %d instead of %d (dups=%d uniq=%d)\n",
+			       names[type], (unsigned long long)x, hint ? (int)(hint - a) : -1,
+			       ret ? (int)(ret - a) : -1, exp ? (int)(exp - b) : -1, dups, uniq);
+			return 0;
+		}
+
+		if ((r & 255) == 0 || r == rounds - 1) {
+			na = eb_first(&ra);
+			nb = eb_first(&rb);
+			while (na && nb && (struct slot *)na - a == (struct slot *)nb - b) {
+				na = eb_next(na);
+				nb = eb_next(nb);
+			}
+			if (na || nb || check_root(&ra) != nbin) {
+				printf("%s: trees differ, or broken links (dups=%d uniq=%d)\n", names[type], dups, uniq);
+				return 0;
+			}
+		}
+	}
+	free(b);
+	free(a);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int nbkeys = 500, rounds = 50000;
+	int type, dups, uniq;
+
+	if (argc > 1)
+		nbkeys = atoi(argv[1]);
+	if (argc > 2)
+		rounds = atoi(argv[2]);
+
+	for (type = 0; type < TYPES; type++) {
+		for (uniq = 0; uniq < 2; uniq++) {
+			for (dups = 0; dups < 2; dups++) {
+				if (!test(type, nbkeys, rounds, dups, uniq))
+					return 1;
+			}
+		}
+	}
+	return 0;
+}
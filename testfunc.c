@@ -5,6 +5,9 @@
  *   make testfunc CFLAGS="-O3 -DTYPE=eb32_node -DINSERT=__eb32_insert -DLOOKUP=__eb32_lookup -DDELETE=__eb32_delete -lm"
  *   make testfunc CFLAGS="-O3 -DTYPE=eb64_node -DINSERT=__eb64_insert -DLOOKUP=__eb64_lookup -DDELETE=__eb64_delete -lm"
  *
+ * Batched lookups may also be measured for batch sizes 1 to 64 by adding
+ * -DBATCH=eb{32|64}_lookup_batch.
+ *
  */
 
 #include <sys/time.h>
@@ -53,6 +56,11 @@ int main(int argc, char **argv)
 	uint64_t v;
 	unsigned long long cal, beg, end;
 	unsigned long long tot_init, tot_insert, tot_lookup, tot_delete, last_insert;
+#ifdef BATCH
+	__typeof__(nodes->key) *keys;
+	struct TYPE **res;
+	int batch, j;
+#endif
 
 	if (argc > 1)
 		nbnodes = atoi(argv[1]);
@@ -132,6 +140,35 @@ int main(int argc, char **argv)
 	       (double)tot_lookup / nbnodes,
 	       (double)tot_lookup / (nbnodes * (1 + log(nbnodes))));
 
+#ifdef BATCH
+	/* look up all nodes again by batches of 1 to 64 keys */
+	keys = malloc(nbnodes * sizeof(*keys));
+	res  = malloc(nbnodes * sizeof(*res));
+	for (i = 0; i < nbnodes; i++)
+		keys[i] = nodes[i].key;
+
+	printf("  Batched lookups (cycles per key):\n");
+	for (batch = 1; batch <= 64; batch++) {
+		cal = rdtsc();
+		beg = rdtsc();
+		for (i = 0; i < nbnodes; i += batch)
+			BATCH(&root, keys + i, res + i, (nbnodes - i < batch) ? nbnodes - i : batch);
+		end = rdtsc();
+		tot_lookup = (end - beg) - (beg - cal);
+
+		for (j = 0; j < nbnodes; j++) {
+			if (res[j] != LOOKUP(&root, keys[j])) {
+				printf("  batch %d: mismatch on key #%d\n", batch, j);
+				return 1;
+			}
+		}
+
+		printf("    %2d: %4.1f\n", batch, (double)tot_lookup / nbnodes);
+	}
+	free(res);
+	free(keys);
+#endif
+
 	/* delete all nodes */
 	cal = rdtsc();
 	beg = rdtsc();
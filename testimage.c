@@ -0,0 +1,221 @@
+/*
+ * ebtree images test - 2026
+ *
+ * Usage: testimage [#keys] [#lookups]
+ *
+ * Builds ebmb trees of 4-byte keys (with duplicates or unique keys), of IPv4
+ * prefixes, and ebst trees of strings, writes their images to a temporary
+ * file, maps them back and compares the image with the source tree : both
+ * walks must return the same keys, prefixes and duplicates in the same order,
+ * and each lookup (or lookup_longest for prefixes) must return the node at
+ * the same rank in both trees.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ebimage.h"
+#include "ebmbtree.h"
+#include "ebsttree.h"
+#include "testutil.h"
+
+enum { BIN, PFX, STR, TYPES };
+
+static const char *names[TYPES] = { "binary", "prefix", "string" };
+
+/* ebmb keys immediately follow the node */
+struct src {
+	struct ebmb_node n;
+	unsigned char k[12];
+};
+
+/* returns a random 32-bit key, possibly within a small range for dups */
+static unsigned int rnd_key(int dups)
+{
+	return dups ? xorshift(&rnd) % 100 : xorshift(&rnd);
+}
+
+/* stores key <k> into <p> for <type>, with <pfx> bits for prefixes */
+static void set_key(unsigned char *p, int type, unsigned int k, int pfx)
+{
+	if (type == STR) {
+		snprintf((char *)p, 12, "%u", k);
+		return;
+	}
+	if (type == PFX && pfx < 32)
+		k &= pfx ? ~0U << (32 - pfx) : 0;
+	p[0] = k >> 24; p[1] = k >> 16; p[2] = k >> 8; p[3] = k;
+	p[4] = 0;
+}
+
+/* a source node and its rank in the tree */
+struct pos {
+	void *p;
+	int r;
+};
+
+static int cmp_pos(const void *a, const void *b)
+{
+	const void *pa = ((const struct pos *)a)->p, *pb = ((const struct pos *)b)->p;
+
+	return (pa > pb) - (pa < pb);
+}
+
+/* returns the rank of source node <node> using the <nb> source nodes sorted
+ * by address in <spos>, -1 for NULL, or -2 if not found.
+ */
+static int src_rank(const struct pos *spos, int nb, const void *node)
+{
+	int l = 0, r = nb, m;
+
+	if (!node)
+		return -1;
+	while (l < r) {
+		m = (l + r) / 2;
+		if (spos[m].p < node)
+			l = m + 1;
+		else
+			r = m;
+	}
+	return (l < nb && spos[l].p == node) ? spos[l].r : -2;
+}
+
+/* returns the rank of image node <node> among the <nb> image nodes <iptr>,
+ * which are stored in key order, thus by address, -1 for NULL, or -2 if not
+ * found.
+ */
+static int img_rank(void **iptr, int nb, const void *node)
+{
+	int l = 0, r = nb, m;
+
+	if (!node)
+		return -1;
+	while (l < r) {
+		m = (l + r) / 2;
+		if (iptr[m] < node)
+			l = m + 1;
+		else
+			r = m;
+	}
+	return (l < nb && iptr[l] == node) ? l : -2;
+}
+
+static int test(int type, int nbkeys, int lookups, int dups)
+{
+	struct src *nodes = calloc(nbkeys + 1, sizeof(*nodes));
+	void **sptr = calloc(nbkeys + 1, sizeof(*sptr));
+	void **iptr = calloc(nbkeys + 1, sizeof(*iptr));
+	struct pos *spos = calloc(nbkeys + 1, sizeof(*spos));
+	struct eb_root root = dups ? EB_ROOT : EB_ROOT_UNIQUE;
+	struct ebm_image *img;
+	struct ebmb_node *sn;
+	struct ebmdb_node *in;
+	unsigned char x[12];
+	FILE *f = tmpfile();
+	int i, nb, sr, ir;
+
+	if (!f) {
+		perror("tmpfile");
+		return 0;
+	}
+
+	for (i = 0; i < nbkeys; i++) {
+		nodes[i].n.node.pfx = type == PFX ? xorshift(&rnd) % 33 : 0;
+		set_key(nodes[i].k, type, rnd_key(dups), nodes[i].n.node.pfx);
+		if (type == PFX)
+			ebmb_insert_prefix(&root, &nodes[i].n, 4);
+		else if (type == STR)
+			ebst_insert(&root, &nodes[i].n);
+		else
+			ebmb_insert(&root, &nodes[i].n, 4);
+	}
+
+	if ((type == STR ? ebst_image_write(&root, fileno(f)) : ebmb_image_write(&root, 4, fileno(f))) < 0) {
+		perror("image_write");
+		return 0;
+	}
+	fflush(f);
+	img = ebm_image_map(fileno(f));
+	if (!img) {
+		perror("image_map");
+		return 0;
+	}
+
+	/* both walks must match, and give the rank of each node */
+	in = ebmdb_first(&img->root);
+	for (nb = 0, sn = ebmb_first(&root); sn; nb++, sn = ebmb_next(sn), in = ebmdb_next(in)) {
+		if (!in || in->node.pfx != sn->node.pfx ||
+		    memcmp(in->key, sn->key, type == STR ? strlen((char *)sn->key) + 1 : 4) != 0) {
+			printf("%s: image node %d differs from the source (dups=%d)\n", names[type], nb, dups);
+			return 0;
+		}
+		sptr[nb] = sn;
+		iptr[nb] = in;
+	}
+	if (in || img->nodes != (unsigned long long)nb) {
+		printf("%s: image has more nodes than the source (dups=%d)\n", names[type], dups);
+		return 0;
+	}
+
+	/* the source nodes are sorted by address to find their rank */
+	for (i = 0; i < nb; i++) {
+		spos[i].p = sptr[i];
+		spos[i].r = i;
+	}
+	qsort(spos, nb, sizeof(*spos), cmp_pos);
+
+	for (i = 0; i < lookups; i++) {
+		if (nbkeys && xorshift(&rnd) & 1)
+			memcpy(x, nodes[xorshift(&rnd) % nbkeys].k, sizeof(x));
+		else
+			set_key(x, type, rnd_key(dups), 32);
+
+		if (type == PFX) {
+			sn = ebmb_lookup_longest(&root, x);
+			in = ebmdb_lookup_longest(&img->root, x);
+		}
+		else if (type == STR) {
+			sn = ebst_lookup(&root, (char *)x);
+			in = ebmds_lookup(&img->root, (char *)x);
+		}
+		else {
+			sn = ebmb_lookup(&root, x, 4);
+			in = ebmdb_lookup(&img->root, x, 4);
+		}
+		sr = src_rank(spos, nb, sn);
+		ir = img_rank(iptr, nb, in);
+		if (sr != ir) {
+			printf("%s: lookup returned rank %d in the image instead of %d (dups=%d)\n",
+			       names[type], ir, sr, dups);
+			return 0;
+		}
+	}
+
+	ebm_image_unmap(img);
+	fclose(f);
+	free(spos);
+	free(iptr);
+	free(sptr);
+	free(nodes);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int nbkeys = 20000, lookups = 200000;
+	int type, dups;
+
+	if (argc > 1)
+		nbkeys = atoi(argv[1]);
+	if (argc > 2)
+		lookups = atoi(argv[2]);
+
+	for (type = 0; type < TYPES; type++) {
+		for (dups = 0; dups < 2; dups++) {
+			if (!test(type, nbkeys, lookups, dups) || !test(type, 0, 10, dups))
+				return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,207 @@
+/*
+ * ebtree multi-byte and string lookup_le/ge test - 2026
+ *
+ * Usage: testlege [#keys] [#rounds]
+ *
+ * Randomly inserts and deletes ebmb and ebim nodes with 4-byte keys, and ebst
+ * and ebis nodes with strings, into trees accepting duplicates or not. Each
+ * lookup, lookup_le and lookup_ge is checked against a linear scan of the
+ * nodes, which also tells which duplicate must be returned : the first one
+ * for lookup and lookup_ge, and the last one for lookup_le. Probes are either
+ * keys from the tree, random keys, or keys just around them (for strings, a
+ * prefix or an extension of a key).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ebmbtree.h"
+#include "ebsttree.h"
+#include "ebimtree.h"
+#include "ebistree.h"
+#include "testutil.h"
+
+enum { EBMB, EBST, EBIM, EBIS, TYPES };
+
+static const char *names[TYPES] = { "ebmb", "ebst", "ebim", "ebis" };
+
+enum { LKP, LE, GE, OPS };
+
+static const char *ops[OPS] = { "lookup", "lookup_le", "lookup_ge" };
+
+/* ebmb keys immediately follow the node, ebpt nodes point to <b> */
+struct slot {
+	union {
+		struct {
+			struct ebmb_node n;
+			unsigned char k[12];
+		} mb;
+		struct ebpt_node pt;
+	} u;
+	unsigned char b[12];
+};
+
+static inline int is_str(int type)
+{
+	return type == EBST || type == EBIS;
+}
+
+/* Sets the key <k> into buffer <p> for <type>: 4 bytes in network order, or
+ * a decimal string.
+ */
+static void set_buf(int type, unsigned char *p, unsigned int k)
+{
+	if (is_str(type))
+		snprintf((char *)p, 12, "%u", k);
+	else {
+		p[0] = k >> 24; p[1] = k >> 16; p[2] = k >> 8; p[3] = k;
+	}
+}
+
+/* returns the key buffer of slot <s> */
+static unsigned char *key_of(int type, struct slot *s)
+{
+	return (type == EBMB || type == EBST) ? s->u.mb.k : s->b;
+}
+
+static int cmp(int type, const unsigned char *a, const unsigned char *b)
+{
+	return is_str(type) ? strcmp((const char *)a, (const char *)b) : memcmp(a, b, 4);
+}
+
+/* returns a random key, possibly in a small range for duplicates */
+static unsigned int rnd_key(int dups)
+{
+	return dups ? xorshift(&rnd) % 40 : xorshift(&rnd);
+}
+
+static struct slot *insert(int type, struct eb_root *root, struct slot *s)
+{
+	switch (type) {
+	case EBMB: return (struct slot *)ebmb_insert(root, &s->u.mb.n, 4);
+	case EBST: return (struct slot *)ebst_insert(root, &s->u.mb.n);
+	case EBIM: s->u.pt.key = s->b; return (struct slot *)ebim_insert(root, &s->u.pt, 4);
+	default:   s->u.pt.key = s->b; return (struct slot *)ebis_insert(root, &s->u.pt);
+	}
+}
+
+static struct slot *lookup(int type, int op, struct eb_root *root, const unsigned char *x)
+{
+	switch (type) {
+	case EBMB:
+		return (struct slot *)(op == LKP ? ebmb_lookup(root, x, 4) :
+				       op == LE ? ebmb_lookup_le(root, x, 4) : ebmb_lookup_ge(root, x, 4));
+	case EBST:
+		return (struct slot *)(op == LKP ? ebst_lookup(root, (const char *)x) :
+				       op == LE ? ebst_lookup_le(root, (const char *)x) : ebst_lookup_ge(root, (const char *)x));
+	case EBIM:
+		return (struct slot *)(op == LKP ? ebim_lookup(root, x, 4) :
+				       op == LE ? ebim_lookup_le(root, x, 4) : ebim_lookup_ge(root, x, 4));
+	default:
+		return (struct slot *)(op == LKP ? ebis_lookup(root, (const char *)x) :
+				       op == LE ? ebis_lookup_le(root, (const char *)x) : ebis_lookup_ge(root, (const char *)x));
+	}
+}
+
+static int test(int type, int nbkeys, int rounds, int dups, int uniq)
+{
+	struct slot *nodes = calloc(nbkeys, sizeof(*nodes));
+	unsigned int *seqs = calloc(nbkeys, sizeof(*seqs));
+	struct eb_root root = uniq ? EB_ROOT_UNIQUE : EB_ROOT;
+	struct slot *exp[OPS], *ret, *n;
+	unsigned char x[16];
+	unsigned int seq = 0;
+	int r, i, c, d, op, len;
+
+	for (r = 0; r < rounds; r++) {
+		i = xorshift(&rnd) % nbkeys;
+		if (nodes[i].u.mb.n.node.leaf_p)
+			eb_delete(&nodes[i].u.mb.n.node);
+		else {
+			set_buf(type, key_of(type, &nodes[i]), rnd_key(dups));
+			ret = insert(type, &root, &nodes[i]);
+			if (ret == &nodes[i])
+				seqs[i] = seq++;
+			else if (!uniq || cmp(type, key_of(type, ret), key_of(type, &nodes[i])) != 0) {
+				printf("%s: insert failure (dups=%d uniq=%d)\n", names[type], dups, uniq);
+				return 0;
+			}
+		}
+
+		/* probe a key from the tree, a random key or a key next to them */
+		memset(x, 0, sizeof(x));
+		if (xorshift(&rnd) & 1)
+			memcpy(x, key_of(type, &nodes[xorshift(&rnd) % nbkeys]), 12);
+		else
+			set_buf(type, x, rnd_key(dups));
+		switch (xorshift(&rnd) % 4) {
+		case 0:
+			if (is_str(type)) {
+				len = strlen((char *)x);
+				x[len ? len - 1 : 0] = 0;
+			}
+			else
+				x[3]--;
+			break;
+		case 1:
+			if (is_str(type)) {
+				len = strlen((char *)x);
+				x[len] = '0' + xorshift(&rnd) % 10;
+			}
+			else
+				x[3]++;
+			break;
+		}
+
+		exp[LKP] = exp[LE] = exp[GE] = NULL;
+		for (i = 0; i < nbkeys; i++) {
+			n = &nodes[i];
+			if (!n->u.mb.n.node.leaf_p)
+				continue;
+			c = cmp(type, key_of(type, n), x);
+			if (c == 0 && (!exp[LKP] || seqs[i] < seqs[exp[LKP] - nodes]))
+				exp[LKP] = n;
+			if (c <= 0 && (!exp[LE] || (d = cmp(type, key_of(type, n), key_of(type, exp[LE]))) > 0 ||
+				       (d == 0 && seqs[i] > seqs[exp[LE] - nodes])))
+				exp[LE] = n;
+			if (c >= 0 && (!exp[GE] || (d = cmp(type, key_of(type, n), key_of(type, exp[GE]))) < 0 ||
+				       (d == 0 && seqs[i] < seqs[exp[GE] - nodes])))
+				exp[GE] = n;
+		}
+
+		for (op = 0; op < OPS; op++) {
+			ret = lookup(type, op, &root, x);
+			if (ret != exp[op]) {
+				printf("%s: %s returned node %d instead of %d (dups=%d uniq=%d)\n",
+				       names[type], ops[op], ret ? (int)(ret - nodes) : -1,
+				       exp[op] ? (int)(exp[op] - nodes) : -1, dups, uniq);
+				return 0;
+			}
+		}
+	}
+	free(seqs);
+	free(nodes);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int nbkeys = 1000, rounds = 30000;
+	int type, dups, uniq;
+
+	if (argc > 1)
+		nbkeys = atoi(argv[1]);
+	if (argc > 2)
+		rounds = atoi(argv[2]);
+
+	for (type = 0; type < TYPES; type++) {
+		for (uniq = 0; uniq < 2; uniq++) {
+			for (dups = 0; dups < 2; dups++) {
+				if (!test(type, nbkeys, rounds, dups, uniq))
+					return 1;
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,258 @@
+/*
+ * ebtree pick functions test - 2026
+ *
+ * Usage: testpick [#keys] [#rounds]
+ *
+ * Fills eb8, eb16, eb32, eb64, eb128, ebf32, ebf64, ebpt, ebmb, ebst, ebim and
+ * ebis trees accepting duplicates or not, then randomly picks nodes using
+ * *_pick(), *_pick_le/ge() and *_pick_first/last() where they exist, and puts
+ * them back with another key. Each picked node must be the one the equivalent
+ * lookup function returned just before, and must be unlinked afterwards. The
+ * trees are periodically walked to check that all remaining nodes are there.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "eb8tree.h"
+#include "eb16tree.h"
+#include "eb32tree.h"
+#include "eb64tree.h"
+#include "eb128tree.h"
+#include "ebf32tree.h"
+#include "ebf64tree.h"
+#include "ebpttree.h"
+#include "ebmbtree.h"
+#include "ebsttree.h"
+#include "ebimtree.h"
+#include "ebistree.h"
+#include "testutil.h"
+
+enum { EB8, EB16, EB32, EB64, EB128, EBF32, EBF64, EBPT, EBMB, EBST, EBIM, EBIS, TYPES };
+
+static const char *names[TYPES] = {
+	"eb8", "eb16", "eb32", "eb64", "eb128", "ebf32", "ebf64", "ebpt", "ebmb", "ebst", "ebim", "ebis",
+};
+
+/* lookup operations, and their pick equivalent */
+enum { LKP, LE, GE, FIRST, LAST, OPS };
+
+static const char *ops[OPS] = { "pick", "pick_le", "pick_ge", "pick_first", "pick_last" };
+
+/* returned for operations which do not exist for a key type */
+#define UNSUP ((struct eb_node *)1)
+
+/* All node types start with their eb_node. ebmb keys immediately follow the
+ * node, while ebim and ebis nodes point to <b>.
+ */
+struct slot {
+	union {
+		struct eb8_node e8;
+		struct eb16_node e16;
+		struct eb32_node e32;
+		struct eb64_node e64;
+		struct eb128_node e128;
+		struct ebf32_node f32;
+		struct ebf64_node f64;
+		struct ebpt_node pt;
+		struct {
+			struct ebmb_node n;
+			unsigned char k[12];
+		} mb;
+	} u;
+	unsigned char b[12];
+};
+
+/* returns a random key, either over the whole key space or in a small range
+ * in order to get duplicates.
+ */
+static unsigned int rnd_key(int dups)
+{
+	unsigned int r = xorshift(&rnd);
+
+	return dups ? (r % 33) - 16 : r;
+}
+
+/* sets the key of slot <s> for <type> from <k> */
+static void set_key(int type, struct slot *s, unsigned int k)
+{
+	switch (type) {
+	case EB8:   s->u.e8.key = k; break;
+	case EB16:  s->u.e16.key = k; break;
+	case EB32:  s->u.e32.key = k; break;
+	case EB64:  s->u.e64.key = ((u64)k << 32) | (k >> 16); break;
+	case EB128: s->u.e128.key = ((u128)k << 96) | ((u128)~k << 32); break;
+	case EBF32: s->u.f32.key = (int)k / 3.0; break;
+	case EBF64: s->u.f64.key = (int)k / 3.0; break;
+	case EBPT:  s->u.pt.key = (void *)(unsigned long)k; break;
+	case EBMB:
+		s->u.mb.k[0] = k >> 24; s->u.mb.k[1] = k >> 16; s->u.mb.k[2] = k >> 8; s->u.mb.k[3] = k;
+		break;
+	case EBST:  snprintf((char *)s->u.mb.k, sizeof(s->u.mb.k), "%u", k); break;
+	case EBIM:
+		s->b[0] = k >> 24; s->b[1] = k >> 16; s->b[2] = k >> 8; s->b[3] = k;
+		s->u.pt.key = s->b;
+		break;
+	case EBIS:
+		snprintf((char *)s->b, sizeof(s->b), "%u", k);
+		s->u.pt.key = s->b;
+		break;
+	}
+}
+
+#define INT_OP(pfx, key)							\
+	switch (op) {								\
+	case LKP:   return (struct eb_node *)(pick ? pfx##_pick(root, key) : pfx##_lookup(root, key)); \
+	case LE:    return (struct eb_node *)(pick ? pfx##_pick_le(root, key) : pfx##_lookup_le(root, key)); \
+	case GE:    return (struct eb_node *)(pick ? pfx##_pick_ge(root, key) : pfx##_lookup_ge(root, key)); \
+	case FIRST: return (struct eb_node *)(pick ? pfx##_pick_first(root) : pfx##_first(root)); \
+	default:    return (struct eb_node *)(pick ? pfx##_pick_last(root) : pfx##_last(root)); \
+	}
+
+/* Performs lookup operation <op> on <root> with the key of probe <p>, or its
+ * pick equivalent if <pick> is set. Returns the node, or UNSUP.
+ */
+static struct eb_node *do_op(int type, int op, int pick, struct eb_root *root, struct slot *p)
+{
+	if (op == FIRST && type >= EBF32)
+		return (struct eb_node *)(pick ? eb_pick_first(root) : eb_first(root));
+	if (op == LAST && type >= EBF32)
+		return (struct eb_node *)(pick ? eb_pick_last(root) : eb_last(root));
+
+	switch (type) {
+	case EB8:   INT_OP(eb8, p->u.e8.key);
+	case EB16:  INT_OP(eb16, p->u.e16.key);
+	case EB32:  INT_OP(eb32, p->u.e32.key);
+	case EB64:  INT_OP(eb64, p->u.e64.key);
+	case EB128: INT_OP(eb128, p->u.e128.key);
+	case EBPT:  INT_OP(ebpt, p->u.pt.key);
+	case EBMB:
+		if (op == LKP)
+			return (struct eb_node *)(pick ? ebmb_pick(root, p->u.mb.k, 4) : ebmb_lookup(root, p->u.mb.k, 4));
+		break;
+	case EBST:
+		if (op == LKP)
+			return (struct eb_node *)(pick ? ebst_pick(root, (char *)p->u.mb.k) : ebst_lookup(root, (char *)p->u.mb.k));
+		break;
+	case EBIM:
+		if (op == LKP)
+			return (struct eb_node *)(pick ? ebim_pick(root, p->b, 4) : ebim_lookup(root, p->b, 4));
+		break;
+	case EBIS:
+		if (op == LKP)
+			return (struct eb_node *)(pick ? ebis_pick(root, (char *)p->b) : ebis_lookup(root, (char *)p->b));
+		break;
+	}
+	return UNSUP;
+}
+
+/* inserts slot <s> and returns the node returned by the insert function */
+static struct eb_node *insert(int type, struct eb_root *root, struct slot *s)
+{
+	switch (type) {
+	case EB8:   return &eb8_insert(root, &s->u.e8)->node;
+	case EB16:  return &eb16_insert(root, &s->u.e16)->node;
+	case EB32:  return &eb32_insert(root, &s->u.e32)->node;
+	case EB64:  return &eb64_insert(root, &s->u.e64)->node;
+	case EB128: return &eb128_insert(root, &s->u.e128)->node;
+	case EBF32: return &ebf32_insert(root, &s->u.f32)->node;
+	case EBF64: return &ebf64_insert(root, &s->u.f64)->node;
+	case EBPT:  return &ebpt_insert(root, &s->u.pt)->node;
+	case EBMB:  return &ebmb_insert(root, &s->u.mb.n, 4)->node;
+	case EBST:  return &ebst_insert(root, &s->u.mb.n)->node;
+	case EBIM:  return &ebim_insert(root, &s->u.pt, 4)->node;
+	default:    return &ebis_insert(root, &s->u.pt)->node;
+	}
+}
+
+static int test(int type, int nbkeys, int rounds, int dups, int uniq)
+{
+	struct slot *nodes = calloc(nbkeys, sizeof(*nodes));
+	struct eb_root root = uniq ? EB_ROOT_UNIQUE : EB_ROOT;
+	struct eb_node *exp, *got, *n;
+	struct slot probe;
+	unsigned int total = 0, seen;
+	int r, i, op;
+
+	for (r = 0; r < rounds; r++) {
+		/* put a random node back if it is not in the tree */
+		i = xorshift(&rnd) % nbkeys;
+		if (!nodes[i].u.e32.node.leaf_p) {
+			set_key(type, &nodes[i], rnd_key(dups));
+			if (insert(type, &root, &nodes[i]) == &nodes[i].u.e32.node)
+				total++;
+		}
+
+		op = xorshift(&rnd) % OPS;
+		if (xorshift(&rnd) & 1)
+			probe = nodes[xorshift(&rnd) % nbkeys];
+		else
+			set_key(type, &probe, rnd_key(dups));
+		if (type == EBIM || type == EBIS)
+			probe.u.pt.key = probe.b;
+
+		exp = do_op(type, op, 0, &root, &probe);
+		if (exp == UNSUP)
+			continue;
+		got = do_op(type, op, 1, &root, &probe);
+		if (got != exp || (got && got->leaf_p)) {
+			printf("%s: %s returned %p instead of %p, %s (dups=%d uniq=%d)\n",
+			       names[type], ops[op], got, exp, got && got->leaf_p ? "still linked" : "not linked",
+			       dups, uniq);
+			return 0;
+		}
+		if (got) {
+			total--;
+			if (do_op(type, op, 0, &root, &probe) == got) {
+				printf("%s: %s did not remove the node (dups=%d uniq=%d)\n",
+				       names[type], ops[op], dups, uniq);
+				return 0;
+			}
+		}
+
+		if ((r & 1023) == 0 || r == rounds - 1) {
+			seen = 0;
+			for (n = eb_first(&root); n; n = eb_next(n))
+				seen++;
+			if (seen != total) {
+				printf("%s: walked %u keys out of %u\n", names[type], seen, total);
+				return 0;
+			}
+		}
+	}
+
+	/* empty the tree by picking the first node */
+	while ((got = do_op(type, FIRST, 1, &root, &probe)) != NULL) {
+		if (got->leaf_p)
+			break;
+		total--;
+	}
+	if (total || !eb_is_empty(&root)) {
+		printf("%s: %u nodes remain after picking all of them\n", names[type], total);
+		return 0;
+	}
+	free(nodes);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int nbkeys = 1000, rounds = 100000;
+	int type, dups, uniq;
+
+	if (argc > 1)
+		nbkeys = atoi(argv[1]);
+	if (argc > 2)
+		rounds = atoi(argv[2]);
+
+	for (type = 0; type < TYPES; type++) {
+		for (uniq = 0; uniq < 2; uniq++) {
+			for (dups = 0; dups < 2; dups++) {
+				if (!test(type, nbkeys, rounds, dups, uniq))
+					return 1;
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,252 @@
+/*
+ * ebtree quad branch trees test - 2026
+ *
+ * Usage: testqb [#keys] [#rounds]
+ *
+ * Randomly inserts and deletes qb32 and qb64 nodes, mirrored into eb32 and eb64
+ * trees of unique keys, with keys spread over the whole key space, over a small
+ * range, and in a few dense clusters. Lookups, lookup_le/ge, first/last and
+ * next/prev must return the same keys as the EB trees. The tree structure is
+ * periodically checked: parent pointers, split bits, number of branches, and
+ * number of unused node parts.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "eb32tree.h"
+#include "eb64tree.h"
+#include "qb32tree.h"
+#include "qb64tree.h"
+#include "testutil.h"
+
+struct n32 {
+	struct qb32_node qb;
+	struct eb32_node eb;
+};
+
+struct n64 {
+	struct qb64_node qb;
+	struct eb64_node eb;
+};
+
+/* returns a random key for workload <t>: random, small range, or clustered */
+static u64 rnd_key(int t, int nbkeys)
+{
+	u64 r = rnd64();
+
+	if (t == 1)
+		return r % (nbkeys * 2 + 1);
+	if (t == 2)
+		return (r & 0xf000000000000000ULL) + (r >> 10 & 0xf0000000ULL) + r % 1024;
+	return r;
+}
+
+/* Checks the subtree below tagged branch <t> attached to branch <s> of <p>,
+ * whose split bits must be lower than <bit>. Counts its leaves and node parts
+ * into <leaves> and <nodes>. <kt> is the key type. Returns 0 on error.
+ */
+static int check_sub(struct qb_node *t, struct qb_node *p, unsigned int s, int bit,
+		     enum qb_key_type kt, unsigned int *leaves, unsigned int *nodes)
+{
+	struct qb_node *n = __qb_untag(t);
+	unsigned int i, nb = 0;
+	u64 k;
+
+	if (__qb_is_leaf(t)) {
+		(*leaves)++;
+		return n->leaf_p == p && (!p || n->leaf_s == s);
+	}
+
+	(*nodes)++;
+	if (n->node_p != p || (p && n->node_s != s) || (n->bit & 1) || n->bit >= bit)
+		return 0;
+
+	k = __qb_key(kt, __qb_walk_down(t, 0));
+	for (i = 0; i < 4; i++) {
+		if (!n->b[i])
+			continue;
+		nb++;
+		/* all keys below must share the bits above this branch */
+		if ((__qb_key(kt, __qb_walk_down(n->b[i], 0)) ^ k) >> n->bit >> 2 ||
+		    ((__qb_key(kt, __qb_walk_down(n->b[i], 1)) >> n->bit) & 3) != i)
+			return 0;
+		if (!check_sub(n->b[i], n, i, n->bit, kt, leaves, nodes))
+			return 0;
+	}
+	return nb >= 2;
+}
+
+/* checks the structure of tree <root> holding <count> keys */
+static int check_tree(struct qb_root *root, enum qb_key_type kt, unsigned int count)
+{
+	unsigned int leaves = 0, nodes = 0, unused = 0;
+	struct qb_node *f;
+
+	if (root->top && !check_sub(root->top, NULL, 0, 64, kt, &leaves, &nodes)) {
+		printf("corrupted tree\n");
+		return 0;
+	}
+	for (f = root->free; f; f = f->b[0]) {
+		if (f->bit != QB_FREE || (f->b[0] && f->b[0]->b[1] != f)) {
+			printf("corrupted list of unused node parts\n");
+			return 0;
+		}
+		unused++;
+	}
+	if (leaves != count || nodes + unused != count) {
+		printf("%u keys: %u leaves, %u node parts, %u unused\n", count, leaves, nodes, unused);
+		return 0;
+	}
+	return 1;
+}
+
+static int test32(int t, int nbkeys, int rounds)
+{
+	struct n32 *nodes = calloc(nbkeys, sizeof(*nodes));
+	struct qb_root qb = QB32_ROOT;
+	struct eb_root eb = EB_ROOT_UNIQUE;
+	struct qb32_node *q;
+	struct eb32_node *e;
+	unsigned int count = 0;
+	int r, i;
+	u32 x;
+
+	for (r = 0; r < rounds; r++) {
+		i = xorshift(&rnd) % nbkeys;
+		if (nodes[i].eb.node.leaf_p) {
+			if (qb32_delete(&qb, &nodes[i].qb) != &nodes[i].qb ||
+			    qb32_delete(&qb, &nodes[i].qb) != NULL) {
+				printf("qb32: failed to delete key %#x\n", nodes[i].qb.key);
+				return 0;
+			}
+			eb32_delete(&nodes[i].eb);
+			count--;
+		} else {
+			x = rnd_key(t, nbkeys);
+			nodes[i].qb.key = nodes[i].eb.key = x;
+			e = eb32_insert(&eb, &nodes[i].eb);
+			q = qb32_insert(&qb, &nodes[i].qb);
+			if ((q == &nodes[i].qb) != (e == &nodes[i].eb) || q->key != x) {
+				printf("qb32: insert mismatch on key %#x\n", x);
+				return 0;
+			}
+			count += e == &nodes[i].eb;
+		}
+
+		x = xorshift(&rnd) & 1 ? (u32)rnd_key(t, nbkeys) : nodes[xorshift(&rnd) % nbkeys].eb.key + (int)(xorshift(&rnd) % 3) - 1;
+		q = qb32_lookup(&qb, x);
+		e = eb32_lookup(&eb, x);
+		if (!q != !e || (q && q->key != e->key))
+			goto fail;
+		q = qb32_lookup_le(&qb, x);
+		e = eb32_lookup_le(&eb, x);
+		if (!q != !e || (q && q->key != e->key))
+			goto fail;
+		q = qb32_lookup_ge(&qb, x);
+		e = eb32_lookup_ge(&eb, x);
+		if (!q != !e || (q && q->key != e->key))
+			goto fail;
+		if (q && (!!qb32_next(q) != !!eb32_next(e) || (qb32_next(q) && qb32_next(q)->key != eb32_next(e)->key) ||
+			  !!qb32_prev(q) != !!eb32_prev(e) || (qb32_prev(q) && qb32_prev(q)->key != eb32_prev(e)->key)))
+			goto fail;
+		q = qb32_first(&qb);
+		e = eb32_first(&eb);
+		if (!q != !e || (q && (q->key != e->key || qb32_last(&qb)->key != eb32_last(&eb)->key)))
+			goto fail;
+
+		if ((r & 1023) == 0 && !check_tree(&qb, QB_KT_U32, count))
+			return 0;
+	}
+	if (!check_tree(&qb, QB_KT_U32, count))
+		return 0;
+	free(nodes);
+	return 1;
+ fail:
+	printf("qb32: workload %d: lookup mismatch on key %#x\n", t, x);
+	return 0;
+}
+
+static int test64(int t, int nbkeys, int rounds)
+{
+	struct n64 *nodes = calloc(nbkeys, sizeof(*nodes));
+	struct qb_root qb = QB64_ROOT;
+	struct eb_root eb = EB_ROOT_UNIQUE;
+	struct qb64_node *q;
+	struct eb64_node *e;
+	unsigned int count = 0;
+	int r, i;
+	u64 x;
+
+	for (r = 0; r < rounds; r++) {
+		i = xorshift(&rnd) % nbkeys;
+		if (nodes[i].eb.node.leaf_p) {
+			if (qb64_delete(&qb, &nodes[i].qb) != &nodes[i].qb ||
+			    qb64_delete(&qb, &nodes[i].qb) != NULL) {
+				printf("qb64: failed to delete key %#llx\n", (unsigned long long)nodes[i].qb.key);
+				return 0;
+			}
+			eb64_delete(&nodes[i].eb);
+			count--;
+		} else {
+			x = rnd_key(t, nbkeys);
+			nodes[i].qb.key = nodes[i].eb.key = x;
+			e = eb64_insert(&eb, &nodes[i].eb);
+			q = qb64_insert(&qb, &nodes[i].qb);
+			if ((q == &nodes[i].qb) != (e == &nodes[i].eb) || q->key != x) {
+				printf("qb64: insert mismatch on key %#llx\n", (unsigned long long)x);
+				return 0;
+			}
+			count += e == &nodes[i].eb;
+		}
+
+		x = xorshift(&rnd) & 1 ? rnd_key(t, nbkeys) : nodes[xorshift(&rnd) % nbkeys].eb.key + (int)(xorshift(&rnd) % 3) - 1;
+		q = qb64_lookup(&qb, x);
+		e = eb64_lookup(&eb, x);
+		if (!q != !e || (q && q->key != e->key))
+			goto fail;
+		q = qb64_lookup_le(&qb, x);
+		e = eb64_lookup_le(&eb, x);
+		if (!q != !e || (q && q->key != e->key))
+			goto fail;
+		q = qb64_lookup_ge(&qb, x);
+		e = eb64_lookup_ge(&eb, x);
+		if (!q != !e || (q && q->key != e->key))
+			goto fail;
+		if (q && (!!qb64_next(q) != !!eb64_next(e) || (qb64_next(q) && qb64_next(q)->key != eb64_next(e)->key) ||
+			  !!qb64_prev(q) != !!eb64_prev(e) || (qb64_prev(q) && qb64_prev(q)->key != eb64_prev(e)->key)))
+			goto fail;
+		q = qb64_first(&qb);
+		e = eb64_first(&eb);
+		if (!q != !e || (q && (q->key != e->key || qb64_last(&qb)->key != eb64_last(&eb)->key)))
+			goto fail;
+
+		if ((r & 1023) == 0 && !check_tree(&qb, QB_KT_U64, count))
+			return 0;
+	}
+	if (!check_tree(&qb, QB_KT_U64, count))
+		return 0;
+	free(nodes);
+	return 1;
+ fail:
+	printf("qb64: workload %d: lookup mismatch on key %#llx\n", t, (unsigned long long)x);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int nbkeys = 10000, rounds = 300000;
+	int t;
+
+	if (argc > 1)
+		nbkeys = atoi(argv[1]);
+	if (argc > 2)
+		rounds = atoi(argv[2]);
+
+	for (t = 0; t < 3; t++) {
+		if (!test32(t, nbkeys, rounds) || !test32(t, 3, rounds / 100) ||
+		    !test64(t, nbkeys, rounds) || !test64(t, 3, rounds / 100))
+			return 1;
+	}
+	return 0;
+}
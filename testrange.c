@@ -0,0 +1,208 @@
+/*
+ * ebtree key range test - 2026
+ *
+ * Usage: testrange [#keys] [#rounds]
+ *
+ * Fills eb32 and eb64 trees accepting duplicates or not with keys spread over
+ * the whole key space, over a small range, or close to 0 and ~0, then walks
+ * random key ranges with *_range_first/next() and moves them to another tree
+ * using *_delete_range(). Ranges are random, empty (min above max or between
+ * keys), single keys, and full or half key spaces. The cursor must visit, and
+ * the output tree must contain, exactly the nodes in range in the tree order,
+ * duplicates included, while the other nodes must remain in the tree. The
+ * parent pointers of both trees are checked as well. The moved nodes are then
+ * partly inserted back.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "eb32tree.h"
+#include "eb64tree.h"
+#include "testutil.h"
+
+enum { EB32, EB64, TYPES };
+
+static const char *names[TYPES] = { "eb32", "eb64" };
+
+struct slot {
+	union {
+		struct eb32_node e32;
+		struct eb64_node e64;
+	} u;
+	unsigned int seq;
+};
+
+static int cur_type;
+
+/* returns a random key for <type> and distribution <dist> */
+static u64 rnd_key(int type, int dist)
+{
+	u64 k = rnd64();
+
+	if (dist == 1)
+		k %= 50;
+	else if (dist == 2)
+		k = (k & 1) ? k % 16 : ~0ULL - k % 16;
+	return type == EB32 ? (u32)k : k;
+}
+
+static u64 get_key(const struct slot *s)
+{
+	return cur_type == EB32 ? s->u.e32.key : s->u.e64.key;
+}
+
+/* sorts nodes by key then insertion order, which is the tree order */
+static int cmp_slot(const void *a, const void *b)
+{
+	const struct slot *sa = *(struct slot * const *)a, *sb = *(struct slot * const *)b;
+	u64 ka = get_key(sa), kb = get_key(sb);
+
+	if (ka != kb)
+		return ka < kb ? -1 : 1;
+	return (sa->seq > sb->seq) - (sa->seq < sb->seq);
+}
+
+/* compares the walk of tree <root> with the <nb> nodes of <exp> */
+static int same_walk(struct eb_root *root, struct slot **exp, int nb)
+{
+	struct eb_node *n;
+	int i = 0;
+
+	if (check_root(root) != nb)
+		return 0;
+	for (n = eb_first(root); n; n = eb_next(n), i++) {
+		if (i >= nb || n != &exp[i]->u.e32.node)
+			return 0;
+	}
+	return i == nb;
+}
+
+static int test(int type, int nbkeys, int rounds, int dist, int uniq)
+{
+	struct slot *nodes = calloc(nbkeys, sizeof(*nodes));
+	struct slot **in = calloc(nbkeys, sizeof(*in));
+	struct slot **out = calloc(nbkeys, sizeof(*out));
+	struct eb_root root = uniq ? EB_ROOT_UNIQUE : EB_ROOT;
+	struct eb_root moved;
+	struct eb_node *n, *ret;
+	unsigned int seq = 0;
+	int r, i, nbin, nbout;
+	u64 min, max, k;
+
+	cur_type = type;
+	for (r = 0; r < rounds; r++) {
+		/* fill the tree with the unlinked nodes, or part of them */
+		for (i = 0; i < nbkeys; i++) {
+			if (nodes[i].u.e32.node.leaf_p || (xorshift(&rnd) & 3) == 0)
+				continue;
+			if (type == EB32) {
+				nodes[i].u.e32.key = rnd_key(type, dist);
+				ret = &eb32_insert(&root, &nodes[i].u.e32)->node;
+			} else {
+				nodes[i].u.e64.key = rnd_key(type, dist);
+				ret = &eb64_insert(&root, &nodes[i].u.e64)->node;
+			}
+			if (ret == &nodes[i].u.e32.node)
+				nodes[i].seq = seq++;
+		}
+
+		min = rnd_key(type, dist);
+		max = rnd_key(type, dist);
+		/* random (maybe reversed), single key, full space, from 0, up to
+		 * ~0, empty or full after a wrap, or ordered random.
+		 */
+		switch (xorshift(&rnd) % 8) {
+		case 0: break;
+		case 1: max = min; break;
+		case 2: min = 0; max = type == EB32 ? ~0U : ~0ULL; break;
+		case 3: min = 0; break;
+		case 4: max = type == EB32 ? ~0U : ~0ULL; break;
+		case 5: min = type == EB32 ? (u32)(max + 1) : max + 1; break;
+		default:
+			if (min > max) {
+				k = min; min = max; max = k;
+			}
+		}
+
+		/* the nodes expected to stay and to be moved, in tree order */
+		nbin = nbout = 0;
+		for (i = 0; i < nbkeys; i++) {
+			if (!nodes[i].u.e32.node.leaf_p)
+				continue;
+			k = get_key(&nodes[i]);
+			if (k >= min && k <= max)
+				out[nbout++] = &nodes[i];
+			else
+				in[nbin++] = &nodes[i];
+		}
+		qsort(in, nbin, sizeof(*in), cmp_slot);
+		qsort(out, nbout, sizeof(*out), cmp_slot);
+
+		/* the range cursor must visit the nodes to be moved */
+		i = 0;
+		if (type == EB32) {
+			struct eb32_node *c;
+
+			for (c = eb32_range_first(&root, min, max); c; c = eb32_range_next(c, max), i++)
+				if (i >= nbout || c != &out[i]->u.e32)
+					break;
+			if (c)
+				i = -1;
+		} else {
+			struct eb64_node *c;
+
+			for (c = eb64_range_first(&root, min, max); c; c = eb64_range_next(c, max), i++)
+				if (i >= nbout || c != &out[i]->u.e64)
+					break;
+			if (c)
+				i = -1;
+		}
+		if (i != nbout) {
+			printf("%s: range cursor mismatch on [%#llx, %#llx] (dist=%d uniq=%d)\n",
+			       names[type], (unsigned long long)min, (unsigned long long)max, dist, uniq);
+			return 0;
+		}
+
+		moved = EB_ROOT;
+		if (type == EB32)
+			eb32_delete_range(&root, min, max, &moved);
+		else
+			eb64_delete_range(&root, min, max, &moved);
+
+		if (!same_walk(&moved, out, nbout) || !same_walk(&root, in, nbin)) {
+			printf("%s: delete_range mismatch on [%#llx, %#llx], %d nodes in range, %d outside (dist=%d uniq=%d)\n",
+			       names[type], (unsigned long long)min, (unsigned long long)max, nbout, nbin, dist, uniq);
+			return 0;
+		}
+
+		/* unlink the moved nodes, which will be inserted back later */
+		while ((n = eb_pick_first(&moved)) != NULL)
+			;
+	}
+	free(out);
+	free(in);
+	free(nodes);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int nbkeys = 1000, rounds = 2000;
+	int type, dist, uniq;
+
+	if (argc > 1)
+		nbkeys = atoi(argv[1]);
+	if (argc > 2)
+		rounds = atoi(argv[2]);
+
+	for (type = 0; type < TYPES; type++) {
+		for (dist = 0; dist < 3; dist++) {
+			for (uniq = 0; uniq < 2; uniq++) {
+				if (!test(type, nbkeys, rounds, dist, uniq) || !test(type, 1, 100, dist, uniq))
+					return 1;
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * ebtree stress test for lockless readers running concurrently with a single
+ * writer using eb32_insert() and eb_delete_rcu() - 2026
+ *
+ * Usage: testrcu [#keys] [seconds per run] [max reader threads]
+ *
+ * Even keys are inserted first and never removed, so readers must always find
+ * them. Odd keys are continuously inserted and removed by the writer. Each run
+ * reports the total read throughput for 1, 2, 4... reader threads.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "eb32tree.h"
+#include "testutil.h"
+
+#define MAX_READERS 256
+
+/* one per reader, odd while the reader is visiting the tree */
+struct reader {
+	unsigned long seq;
+	unsigned long reads;
+	unsigned int rnd;
+	int id;
+} ALIGNED(64);
+
+struct eb_root root = EB_ROOT;
+struct reader readers[MAX_READERS];
+struct eb32_node *nodes;
+int nbkeys, nbreaders;
+volatile int running, failed;
+
+/* waits for all readers currently visiting the tree to leave it */
+static void wait_readers(struct eb_rcu *rcu)
+{
+	unsigned long seq;
+	int i;
+
+	(void)rcu;
+	for (i = 0; i < nbreaders; i++) {
+		seq = __atomic_load_n(&readers[i].seq, __ATOMIC_ACQUIRE);
+		if (!(seq & 1))
+			continue;
+		while (__atomic_load_n(&readers[i].seq, __ATOMIC_ACQUIRE) == seq)
+			sched_yield();
+	}
+}
+
+/* the writer immediately reuses removed nodes, so it waits for the readers */
+static void reclaim_node(struct eb_rcu *rcu, struct eb_node *node)
+{
+	rcu->sync(rcu);
+	node->leaf_p = NULL;
+}
+
+static void *reader(void *arg)
+{
+	struct reader *r = arg;
+	struct eb32_node *node;
+	unsigned long reads = 0;
+	u32 key, prev;
+	int i;
+
+	while (running) {
+		__atomic_store_n(&r->seq, r->seq + 1, __ATOMIC_SEQ_CST);
+
+		key = (xorshift(&r->rnd) % nbkeys) & ~1U;
+		node = eb32_lookup(&root, key);
+		if (!node || node->key != key) {
+			printf("reader %d: stable key %u not found\n", r->id, key);
+			failed = 1;
+		}
+
+		key = (xorshift(&r->rnd) % nbkeys) | 1;
+		node = eb32_lookup(&root, key);
+		if (node && node->key != key) {
+			printf("reader %d: lookup(%u) returned %u\n", r->id, key, node->key);
+			failed = 1;
+		}
+
+		/* short ordered walk */
+		node = eb32_lookup_ge(&root, key);
+		for (i = 0; node && i < 4; i++) {
+			prev = node->key;
+			node = eb32_next(node);
+			if (node && node->key < prev) {
+				printf("reader %d: walk went back from %u to %u\n", r->id, prev, node->key);
+				failed = 1;
+			}
+		}
+
+		__atomic_store_n(&r->seq, r->seq + 1, __ATOMIC_RELEASE);
+		reads += 3;
+	}
+	r->reads = reads;
+	return NULL;
+}
+
+static void *writer(void *arg)
+{
+	struct eb_rcu rcu = { .sync = wait_readers, .reclaim = reclaim_node };
+	unsigned int rnd = 0x12345678;
+	unsigned long *ops = arg;
+	int i;
+
+	while (running) {
+		i = (xorshift(&rnd) % nbkeys) | 1;
+		if (i >= nbkeys)
+			continue;
+		if (nodes[i].node.leaf_p)
+			eb_delete_rcu(&nodes[i].node, &rcu);
+		else
+			eb32_insert(&root, &nodes[i]);
+		(*ops)++;
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t wthr, rthr[MAX_READERS];
+	unsigned long wops, total;
+	struct timeval beg, end;
+	double secs, base = 0;
+	int duration = 1, maxreaders;
+	int i;
+
+	nbkeys = (argc > 1) ? atoi(argv[1]) : 100000;
+	duration = (argc > 2) ? atoi(argv[2]) : 1;
+	maxreaders = (argc > 3) ? atoi(argv[3]) : sysconf(_SC_NPROCESSORS_ONLN) - 1;
+
+	if (nbkeys < 2)
+		nbkeys = 2;
+	if (maxreaders < 1)
+		maxreaders = 1;
+	if (maxreaders > MAX_READERS)
+		maxreaders = MAX_READERS;
+
+	nodes = calloc(nbkeys, sizeof(*nodes));
+	for (i = 0; i < nbkeys; i++) {
+		nodes[i].key = i;
+		if (!(i & 1))
+			eb32_insert(&root, &nodes[i]);
+	}
+
+	printf("# readers  reads/s  per-reader  scaling  writes/s\n");
+	for (nbreaders = 1; nbreaders <= maxreaders; nbreaders *= 2) {
+		running = 1;
+		wops = 0;
+		gettimeofday(&beg, NULL);
+		for (i = 0; i < nbreaders; i++) {
+			memset(&readers[i], 0, sizeof(readers[i]));
+			readers[i].id = i;
+			readers[i].rnd = 0x9e3779b9 * (i + 1);
+			pthread_create(&rthr[i], NULL, reader, &readers[i]);
+		}
+		pthread_create(&wthr, NULL, writer, &wops);
+		sleep(duration);
+		running = 0;
+		pthread_join(wthr, NULL);
+		total = 0;
+		for (i = 0; i < nbreaders; i++) {
+			pthread_join(rthr[i], NULL);
+			total += readers[i].reads;
+		}
+		gettimeofday(&end, NULL);
+
+		secs = (end.tv_sec - beg.tv_sec) + (end.tv_usec - beg.tv_usec) / 1000000.0;
+		if (nbreaders == 1)
+			base = total / secs;
+		printf("%9d %8.0f %11.0f %8.2f %9.0f\n",
+		       nbreaders, total / secs, total / secs / nbreaders,
+		       total / secs / base, wops / secs);
+
+		if (failed)
+			return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,363 @@
+/*
+ * ebtree relative trees test - 2026
+ *
+ * Usage: testrel [#rounds]
+ *
+ * Randomly inserts and deletes ebmd32/ebsd32, ebmd64/ebsd64 and ebmdb/ebsdb
+ * nodes, the latter with fixed size binary keys and with strings, into trees
+ * accepting duplicates or not. The root and all the nodes are allocated in a
+ * single area which is small enough for 16-bit offsets. Each insert, lookup
+ * and lookup_le/ge is checked against a linear scan of the nodes, which also
+ * tells which duplicate must be returned : the oldest one for lookup and
+ * lookup_ge, and the most recent one for lookup_le. The trees are periodically
+ * walked in both directions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ebr32tree.h"
+#include "ebr64tree.h"
+#include "ebrmbtree.h"
+#include "ebrsttree.h"
+#include "testutil.h"
+
+/* the nodes and their root must be within +/- 32 kB for ebs trees */
+#define NB_REL 900
+
+enum { MD32, SD32, MD64, SD64, MDB, SDB, MDS, SDS, TYPES };
+
+static const char *names[TYPES] = {
+	"ebmd32", "ebsd32", "ebmd64", "ebsd64", "ebmdb", "ebsdb", "ebmds", "ebsds",
+};
+
+/* ebmdb/ebsdb keys immediately follow the node */
+struct mdbk {
+	struct ebmdb_node n;
+	char k[8];
+};
+
+struct sdbk {
+	struct ebsdb_node n;
+	char k[8];
+};
+
+/* all node types start with their ebm_node or ebs_node */
+struct slot {
+	union {
+		struct ebmd32_node md32;
+		struct ebsd32_node sd32;
+		struct ebmd64_node md64;
+		struct ebsd64_node sd64;
+		struct mdbk mdb;
+		struct sdbk sdb;
+	} u;
+};
+
+struct area {
+	union {
+		struct ebm_root m;
+		struct ebs_root s;
+	} root;
+	struct slot nodes[NB_REL];
+};
+
+/* reference keys and insertion sequence of each node, plus the probe key at
+ * index NB_REL.
+ */
+static u64 keys[NB_REL + 1];
+static char strs[NB_REL + 1][8];
+static unsigned int seqs[NB_REL];
+static unsigned int seq;
+
+static inline int is_small(int type)
+{
+	return type & 1;
+}
+
+static inline int is_str(int type)
+{
+	return type >= MDS;
+}
+
+/* Returns a random key for <type>, either over the whole key space, or in a
+ * small range around zero in order to get duplicates and keys close to 0 and
+ * to ~0.
+ */
+static u64 rnd_key(int type, int dups)
+{
+	u64 k = rnd64();
+
+	if (is_str(type))
+		return dups ? k % 33 : k % 10000000;
+	if (dups)
+		k = (s64)(int)(xorshift(&rnd) % 33) - 16;
+	if (type <= SD32)
+		k = (u32)k;
+	return k;
+}
+
+/* sets the reference key <k> of node or probe <i> for <type> */
+static void set_ref(int type, int i, u64 k)
+{
+	keys[i] = k;
+	if (is_str(type))
+		snprintf(strs[i], sizeof(strs[i]), "%u", (unsigned int)k);
+}
+
+/* writes the big endian representation of <k> into <p> */
+static void put_be64(char *p, u64 k)
+{
+	int i;
+
+	for (i = 7; i >= 0; i--, k >>= 8)
+		p[i] = k;
+}
+
+/* compares the keys of nodes or probe <i> and <j> in the tree order */
+static int cmp(int type, int i, int j)
+{
+	if (is_str(type))
+		return strcmp(strs[i], strs[j]);
+	return keys[i] < keys[j] ? -1 : keys[i] > keys[j];
+}
+
+static int linked(struct area *a, int type, int i)
+{
+	if (is_small(type))
+		return !!a->nodes[i].u.sd32.node.leaf_p;
+	return !!a->nodes[i].u.md32.node.leaf_p;
+}
+
+/* returns the index of node <node>, or -1 for NULL */
+static int idx(struct area *a, const void *node)
+{
+	return node ? (const struct slot *)node - a->nodes : -1;
+}
+
+/* inserts node <i> whose reference key was set, and returns the index of the
+ * node returned by the insert function.
+ */
+static int rel_insert(struct area *a, int type, int i)
+{
+	struct slot *s = &a->nodes[i];
+
+	switch (type) {
+	case MD32: s->u.md32.key = keys[i]; return idx(a, ebmd32_insert(&a->root.m, &s->u.md32));
+	case SD32: s->u.sd32.key = keys[i]; return idx(a, ebsd32_insert(&a->root.s, &s->u.sd32));
+	case MD64: s->u.md64.key = keys[i]; return idx(a, ebmd64_insert(&a->root.m, &s->u.md64));
+	case SD64: s->u.sd64.key = keys[i]; return idx(a, ebsd64_insert(&a->root.s, &s->u.sd64));
+	case MDB:  put_be64(s->u.mdb.k, keys[i]); return idx(a, ebmdb_insert(&a->root.m, &s->u.mdb.n, 8));
+	case SDB:  put_be64(s->u.sdb.k, keys[i]); return idx(a, ebsdb_insert(&a->root.s, &s->u.sdb.n, 8));
+	case MDS:
+		memcpy(s->u.mdb.k, strs[i], sizeof(strs[i]));
+		return idx(a, ebmdb_insert(&a->root.m, &s->u.mdb.n, strlen(strs[i]) + 1));
+	default:
+		memcpy(s->u.sdb.k, strs[i], sizeof(strs[i]));
+		return idx(a, ebsdb_insert(&a->root.s, &s->u.sdb.n, strlen(strs[i]) + 1));
+	}
+}
+
+static void rel_delete(struct area *a, int type, int i)
+{
+	if (is_small(type))
+		ebs_delete(&a->nodes[i].u.sd32.node);
+	else
+		ebm_delete(&a->nodes[i].u.md32.node);
+}
+
+/* looks the probe key up using lookup (op 0), lookup_le (op 1) or lookup_ge
+ * (op 2), the latter two only for integer keys, and returns the node's index.
+ */
+static int rel_lookup(struct area *a, int type, int op)
+{
+	u64 x = keys[NB_REL];
+	char be[8];
+
+	switch (type) {
+	case MD32:
+		return idx(a, op == 0 ? ebmd32_lookup(&a->root.m, x) :
+			   op == 1 ? ebmd32_lookup_le(&a->root.m, x) : ebmd32_lookup_ge(&a->root.m, x));
+	case SD32:
+		return idx(a, op == 0 ? ebsd32_lookup(&a->root.s, x) :
+			   op == 1 ? ebsd32_lookup_le(&a->root.s, x) : ebsd32_lookup_ge(&a->root.s, x));
+	case MD64:
+		return idx(a, op == 0 ? ebmd64_lookup(&a->root.m, x) :
+			   op == 1 ? ebmd64_lookup_le(&a->root.m, x) : ebmd64_lookup_ge(&a->root.m, x));
+	case SD64:
+		return idx(a, op == 0 ? ebsd64_lookup(&a->root.s, x) :
+			   op == 1 ? ebsd64_lookup_le(&a->root.s, x) : ebsd64_lookup_ge(&a->root.s, x));
+	case MDB:
+		put_be64(be, x);
+		return idx(a, ebmdb_lookup(&a->root.m, be, 8));
+	case SDB:
+		put_be64(be, x);
+		return idx(a, ebsdb_lookup(&a->root.s, be, 8));
+	case MDS:
+		return idx(a, ebmds_lookup(&a->root.m, strs[NB_REL]));
+	default:
+		return idx(a, ebsds_lookup(&a->root.s, strs[NB_REL]));
+	}
+}
+
+static int rel_first(struct area *a, int type)
+{
+	return is_small(type) ? idx(a, ebs_first(&a->root.s)) : idx(a, ebm_first(&a->root.m));
+}
+
+static int rel_last(struct area *a, int type)
+{
+	return is_small(type) ? idx(a, ebs_last(&a->root.s)) : idx(a, ebm_last(&a->root.m));
+}
+
+static int rel_next(struct area *a, int type, int i)
+{
+	return is_small(type) ? idx(a, ebs_next(&a->nodes[i].u.sd32.node)) : idx(a, ebm_next(&a->nodes[i].u.md32.node));
+}
+
+static int rel_prev(struct area *a, int type, int i)
+{
+	return is_small(type) ? idx(a, ebs_prev(&a->nodes[i].u.sd32.node)) : idx(a, ebm_prev(&a->nodes[i].u.md32.node));
+}
+
+/* Scans all linked nodes and fills <exp> with the indexes of the nodes which
+ * lookup, lookup_le and lookup_ge must return for the probe key, or -1.
+ */
+static void scan(struct area *a, int type, int exp[3])
+{
+	int i, c, d;
+
+	exp[0] = exp[1] = exp[2] = -1;
+	for (i = 0; i < NB_REL; i++) {
+		if (!linked(a, type, i))
+			continue;
+		c = cmp(type, i, NB_REL);
+		if (c == 0 && (exp[0] < 0 || seqs[i] < seqs[exp[0]]))
+			exp[0] = i;
+		if (c <= 0 && (exp[1] < 0 || (d = cmp(type, i, exp[1])) > 0 || (d == 0 && seqs[i] > seqs[exp[1]])))
+			exp[1] = i;
+		if (c >= 0 && (exp[2] < 0 || (d = cmp(type, i, exp[2])) < 0 || (d == 0 && seqs[i] < seqs[exp[2]])))
+			exp[2] = i;
+	}
+}
+
+/* walks the tree in both directions and checks the order of the keys and of
+ * the duplicates, and the number of nodes.
+ */
+static int walk(struct area *a, int type, unsigned int total)
+{
+	unsigned int seen = 0;
+	int i, p = -1, c;
+
+	for (i = rel_first(a, type); i >= 0; p = i, i = rel_next(a, type, i), seen++) {
+		if (p >= 0 && ((c = cmp(type, p, i)) > 0 || (c == 0 && seqs[p] > seqs[i]))) {
+			printf("%s: keys out of order\n", names[type]);
+			return 0;
+		}
+	}
+	if (seen != total || p != rel_last(a, type)) {
+		printf("%s: walked %u keys out of %u\n", names[type], seen, total);
+		return 0;
+	}
+	for (i = p; i >= 0; i = rel_prev(a, type, i))
+		seen--;
+	if (seen) {
+		printf("%s: reverse walk found %u keys less\n", names[type], seen);
+		return 0;
+	}
+	return 1;
+}
+
+static int test(int type, int rounds, int dups, int uniq)
+{
+	struct area *a = calloc(1, sizeof(*a));
+	unsigned int total = 0;
+	int exp[3];
+	int r, i, ret, op;
+
+	if (uniq) {
+		if (is_small(type))
+			a->root.s = EBS_ROOT_UNIQUE;
+		else
+			a->root.m = EBM_ROOT_UNIQUE;
+	}
+
+	for (r = 0; r < rounds; r++) {
+		i = xorshift(&rnd) % NB_REL;
+		if (linked(a, type, i)) {
+			rel_delete(a, type, i);
+			if (linked(a, type, i)) {
+				printf("%s: node still linked after delete\n", names[type]);
+				return 0;
+			}
+			total--;
+		} else {
+			set_ref(type, NB_REL, rnd_key(type, dups));
+			scan(a, type, exp);
+			set_ref(type, i, keys[NB_REL]);
+			ret = rel_insert(a, type, i);
+			if (ret != ((uniq && exp[0] >= 0) ? exp[0] : i)) {
+				printf("%s: insert returned node %d instead of %d (dups=%d uniq=%d)\n",
+				       names[type], ret, (uniq && exp[0] >= 0) ? exp[0] : i, dups, uniq);
+				return 0;
+			}
+			if (ret == i) {
+				seqs[i] = seq++;
+				total++;
+			}
+		}
+
+		if (xorshift(&rnd) & 1)
+			set_ref(type, NB_REL, keys[xorshift(&rnd) % NB_REL]);
+		else
+			set_ref(type, NB_REL, rnd_key(type, dups));
+		scan(a, type, exp);
+		for (op = 0; op < (type < MDB ? 3 : 1); op++) {
+			ret = rel_lookup(a, type, op);
+			if (ret != exp[op]) {
+				printf("%s: lookup op %d returned node %d instead of %d (dups=%d uniq=%d)\n",
+				       names[type], op, ret, exp[op], dups, uniq);
+				return 0;
+			}
+		}
+
+		if (((r & 1023) == 0 || r == rounds - 1) && !walk(a, type, total))
+			return 0;
+	}
+
+	for (i = 0; i < NB_REL; i++) {
+		if (linked(a, type, i))
+			rel_delete(a, type, i);
+	}
+	if (is_small(type) ? !ebs_is_empty(&a->root.s) : !ebm_is_empty(&a->root.m)) {
+		printf("%s: tree not empty after deleting all nodes\n", names[type]);
+		return 0;
+	}
+	free(a);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int rounds = 20000;
+	int type, dups, uniq;
+
+	if (argc > 1)
+		rounds = atoi(argv[1]);
+
+	if (sizeof(struct area) >= 32768) {
+		printf("area too large for 16-bit offsets\n");
+		return 1;
+	}
+
+	for (type = 0; type < TYPES; type++) {
+		for (uniq = 0; uniq < 2; uniq++) {
+			for (dups = 0; dups < 2; dups++) {
+				if (!test(type, rounds, dups, uniq))
+					return 1;
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * ebtree requeue test - 2026
+ *
+ * Usage: testrequeue [#keys] [#rounds]
+ *
+ * Randomly requeues eb32, eb64 and ebmb nodes, queued or not, in trees
+ * accepting duplicates or not, to the same key, to a neighbouring key or one
+ * differing only by a low bit (which are often updated in place), to a random
+ * key (often in another subtree), or to the key of another node (thus into a
+ * duplicate tree or onto an existing key). The returned node must be the one
+ * an insert would return, and the requeued node must be found between its
+ * neighbours in the tree order, which is the key order then the requeue order
+ * for duplicates, except when the key did not change, in which case the node
+ * must stay in place. The whole tree is periodically walked and its parent
+ * pointers checked.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "eb32tree.h"
+#include "eb64tree.h"
+#include "ebmbtree.h"
+#include "testutil.h"
+
+enum { EB32, EB64, EBMB, TYPES };
+
+static const char *names[TYPES] = { "eb32", "eb64", "ebmb" };
+
+/* all node types start with their eb_node, ebmb keys follow the node */
+struct slot {
+	union {
+		struct eb32_node e32;
+		struct eb64_node e64;
+		struct {
+			struct ebmb_node n;
+			unsigned char k[4];
+		} mb;
+	} u;
+	unsigned int seq;
+};
+
+static int cur_type;
+
+static u64 rnd_key(int dups)
+{
+	u64 k = rnd64();
+
+	if (dups)
+		k %= 64;
+	return cur_type == EB64 ? k : (u32)k;
+}
+
+static u64 get_key(const struct slot *s)
+{
+	const unsigned char *p = s->u.mb.k;
+
+	switch (cur_type) {
+	case EB32: return s->u.e32.key;
+	case EB64: return s->u.e64.key;
+	default:   return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+	}
+}
+
+static struct slot *requeue(struct eb_root *root, struct slot *s, u64 k)
+{
+	unsigned char be[4];
+
+	switch (cur_type) {
+	case EB32: return (struct slot *)eb32_requeue(root, &s->u.e32, k);
+	case EB64: return (struct slot *)eb64_requeue(root, &s->u.e64, k);
+	default:
+		be[0] = k >> 24; be[1] = k >> 16; be[2] = k >> 8; be[3] = k;
+		return (struct slot *)ebmb_requeue(root, &s->u.mb.n, be, 4);
+	}
+}
+
+/* compares the position of nodes <a> and <b> in the tree order */
+static int cmp_slot(const struct slot *a, const struct slot *b)
+{
+	u64 ka = get_key(a), kb = get_key(b);
+
+	if (ka != kb)
+		return ka < kb ? -1 : 1;
+	return (a->seq > b->seq) - (a->seq < b->seq);
+}
+
+static int test(int type, int nbkeys, int rounds, int dups, int uniq)
+{
+	struct slot *nodes = calloc(nbkeys, sizeof(*nodes));
+	struct eb_root root = uniq ? EB_ROOT_UNIQUE : EB_ROOT;
+	struct slot *s, *o, *exp, *ret, *prev, *next;
+	struct eb_node *n, *p;
+	unsigned int seq = 0, total = 0, seen;
+	int r, i, was_linked;
+	u64 k, x;
+
+	cur_type = type;
+	for (r = 0; r < rounds; r++) {
+		s = &nodes[xorshift(&rnd) % nbkeys];
+		o = &nodes[xorshift(&rnd) % nbkeys];
+		k = get_key(s);
+		was_linked = !!s->u.e32.node.leaf_p;
+
+		switch (xorshift(&rnd) % 6) {
+		case 0:  x = k; break;
+		case 1:  x = k + 1 + xorshift(&rnd) % 3; break;
+		case 2:  x = k - 1 - xorshift(&rnd) % 3; break;
+		case 3:  x = k ^ (1ULL << (xorshift(&rnd) % 4)); break;
+		case 4:  x = rnd_key(dups); break;
+		default: x = o->u.e32.node.leaf_p ? get_key(o) : rnd_key(dups); break;
+		}
+		if (type != EB64)
+			x = (u32)x;
+
+		/* a unique tree returns the node holding this key, if any */
+		exp = s;
+		if (uniq && !(was_linked && x == k)) {
+			for (i = 0; i < nbkeys; i++) {
+				if (&nodes[i] != s && nodes[i].u.e32.node.leaf_p && get_key(&nodes[i]) == x)
+					exp = &nodes[i];
+			}
+		}
+
+		prev = next = NULL;
+		if (was_linked) {
+			prev = (struct slot *)eb_prev(&s->u.e32.node);
+			next = (struct slot *)eb_next(&s->u.e32.node);
+		}
+
+		ret = requeue(&root, s, x);
+		if (ret != exp || get_key(s) != x || !s->u.e32.node.leaf_p != (exp != s)) {
+			printf("%s: requeue from %#llx to %#llx returned the wrong node or state (dups=%d uniq=%d)\n",
+			       names[type], (unsigned long long)k, (unsigned long long)x, dups, uniq);
+			return 0;
+		}
+		total += (!was_linked && exp == s) - (was_linked && exp != s);
+
+		if (was_linked && x == k) {
+			/* the node must not have moved */
+			if ((struct slot *)eb_prev(&s->u.e32.node) != prev ||
+			    (struct slot *)eb_next(&s->u.e32.node) != next) {
+				printf("%s: requeue to the same key %#llx moved the node (dups=%d uniq=%d)\n",
+				       names[type], (unsigned long long)x, dups, uniq);
+				return 0;
+			}
+		}
+		else if (exp == s) {
+			s->seq = seq++;
+			prev = (struct slot *)eb_prev(&s->u.e32.node);
+			next = (struct slot *)eb_next(&s->u.e32.node);
+			if ((prev && cmp_slot(prev, s) >= 0) || (next && cmp_slot(s, next) >= 0)) {
+				printf("%s: requeue from %#llx to %#llx misplaced the node (dups=%d uniq=%d)\n",
+				       names[type], (unsigned long long)k, (unsigned long long)x, dups, uniq);
+				return 0;
+			}
+		}
+
+		if ((r & 63) == 0 || r == rounds - 1) {
+			seen = 0;
+			for (p = NULL, n = eb_first(&root); n; p = n, n = eb_next(n), seen++) {
+				if (p && cmp_slot((struct slot *)p, (struct slot *)n) >= 0) {
+					printf("%s: keys out of order\n", names[type]);
+					return 0;
+				}
+			}
+			if (seen != total || check_root(&root) != (int)total) {
+				printf("%s: walked %u keys out of %u, or broken links\n", names[type], seen, total);
+				return 0;
+			}
+		}
+	}
+	free(nodes);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int nbkeys = 500, rounds = 200000;
+	int type, dups, uniq;
+
+	if (argc > 1)
+		nbkeys = atoi(argv[1]);
+	if (argc > 2)
+		rounds = atoi(argv[2]);
+
+	for (type = 0; type < TYPES; type++) {
+		for (uniq = 0; uniq < 2; uniq++) {
+			for (dups = 0; dups < 2; dups++) {
+				if (!test(type, nbkeys, rounds, dups, uniq))
+					return 1;
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * ebtree thread-scaling test for sharded eb32 roots - 2026
+ *
+ * Usage: testshard [#keys] [seconds per run] [max threads] [shard bits]
+ *
+ * Each thread owns a slice of the nodes. It continuously moves one of them to
+ * a new random key using delete+insert, and looks up another one which it must
+ * find. Each run reports the total throughput for 1, 2, 4... threads, first
+ * with a single shard, which is equivalent to a tree protected by one lock,
+ * then with 2^bits shards. The ordered walk over all shards is checked after
+ * each run.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "ebshard.h"
+#include "testutil.h"
+
+#define MAX_THREADS 256
+#define MAX_BITS    12
+
+struct worker {
+	unsigned long ops;
+	unsigned int rnd;
+	int id;
+} ALIGNED(64);
+
+struct ebshard shards[1 << MAX_BITS];
+struct ebshard_root sr;
+struct worker workers[MAX_THREADS];
+struct eb32_node *nodes;
+int nbkeys, nbthreads;
+volatile int running, failed;
+
+static void *worker(void *arg)
+{
+	struct worker *w = arg;
+	int slice = nbkeys / nbthreads;
+	struct eb32_node *node, *mine = nodes + w->id * slice;
+	unsigned long ops = 0;
+	int i;
+
+	while (running) {
+		i = xorshift(&w->rnd) % slice;
+		eb32sh_delete(&sr, &mine[i]);
+		mine[i].key = xorshift(&w->rnd);
+		eb32sh_insert(&sr, &mine[i]);
+
+		i = xorshift(&w->rnd) % slice;
+		node = eb32sh_lookup(&sr, mine[i].key);
+		if (!node || node->key != mine[i].key) {
+			printf("thread %d: key %u not found\n", w->id, mine[i].key);
+			failed = 1;
+		}
+		ops += 2;
+	}
+	w->ops = ops;
+	return NULL;
+}
+
+/* checks that all nodes are found in order when walking over the shards */
+static int check_walk(void)
+{
+	struct eb32_node *node, *prev = NULL;
+	int count = 0;
+
+	for (node = eb32sh_first(&sr); node; prev = node, node = eb32sh_next(&sr, node)) {
+		if (prev && node->key < prev->key) {
+			printf("walk went back from %u to %u\n", prev->key, node->key);
+			return 0;
+		}
+		count++;
+	}
+	if (count != nbkeys) {
+		printf("walk found %d nodes instead of %d\n", count, nbkeys);
+		return 0;
+	}
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t thr[MAX_THREADS];
+	struct timeval beg, end;
+	unsigned long total;
+	double secs, base;
+	int duration, maxthreads, bits, pass;
+	unsigned int rnd = 0x12345678;
+	int i;
+
+	nbkeys = (argc > 1) ? atoi(argv[1]) : 100000;
+	duration = (argc > 2) ? atoi(argv[2]) : 1;
+	maxthreads = (argc > 3) ? atoi(argv[3]) : sysconf(_SC_NPROCESSORS_ONLN);
+	bits = (argc > 4) ? atoi(argv[4]) : 6;
+
+	if (maxthreads < 1)
+		maxthreads = 1;
+	if (maxthreads > MAX_THREADS)
+		maxthreads = MAX_THREADS;
+	if (nbkeys < maxthreads)
+		nbkeys = maxthreads;
+	if (bits < 0 || bits > MAX_BITS)
+		bits = MAX_BITS;
+
+	nodes = calloc(nbkeys, sizeof(*nodes));
+
+	printf("# shards  threads  ops/s  per-thread  scaling\n");
+	for (pass = 0; pass < 2; pass++) {
+		ebshard_init(&sr, shards, pass ? bits : 0, 0);
+		for (i = 0; i < nbkeys; i++) {
+			nodes[i].node.leaf_p = NULL;
+			nodes[i].key = xorshift(&rnd);
+			eb32sh_insert(&sr, &nodes[i]);
+		}
+
+		base = 0;
+		for (nbthreads = 1; nbthreads <= maxthreads; nbthreads *= 2) {
+			running = 1;
+			gettimeofday(&beg, NULL);
+			for (i = 0; i < nbthreads; i++) {
+				workers[i].ops = 0;
+				workers[i].id = i;
+				workers[i].rnd = 0x9e3779b9 * (i + 1);
+				pthread_create(&thr[i], NULL, worker, &workers[i]);
+			}
+			sleep(duration);
+			running = 0;
+			total = 0;
+			for (i = 0; i < nbthreads; i++) {
+				pthread_join(thr[i], NULL);
+				total += workers[i].ops;
+			}
+			gettimeofday(&end, NULL);
+
+			secs = (end.tv_sec - beg.tv_sec) + (end.tv_usec - beg.tv_usec) / 1000000.0;
+			if (nbthreads == 1)
+				base = total / secs;
+			printf("%8u %8d %9.0f %11.0f %8.2f\n",
+			       ebshard_count(&sr), nbthreads, total / secs,
+			       total / secs / nbthreads, total / secs / base);
+
+			if (failed || !check_walk())
+				return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,401 @@
+/*
+ * ebtree 16 and 8-bit trees test - 2026
+ *
+ * Usage: testsmall [#keys] [#rounds]
+ *
+ * Randomly inserts and deletes eb16 and eb8 nodes, with signed and unsigned
+ * keys, and ebmd16 and ebsd16 nodes, into trees accepting duplicates or not.
+ * Since the key space is small, the number of occurrences of each key is
+ * simply counted, and the lookup, lookup_le/ge, first/last functions are
+ * checked against these counters. The trees are periodically walked to check that the keys are
+ * sorted and that nodes are all there.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "eb16tree.h"
+#include "eb8tree.h"
+#include "ebr16tree.h"
+#include "testutil.h"
+
+/* the ebsd16 nodes and their root must be within +/- 32 kB */
+#define NB_SMALL 2000
+
+struct small {
+	struct ebs_root root;
+	struct ebsd16_node nodes[NB_SMALL];
+};
+
+struct medium {
+	struct ebm_root root;
+	struct ebmd16_node nodes[NB_SMALL];
+};
+
+static unsigned int count[65536];
+
+/* Returns a random key of <bits> bits, either over the whole key space or
+ * within a small range in order to get duplicates.
+ */
+static unsigned int rnd_key(int bits, int dups)
+{
+	unsigned int r = xorshift(&rnd);
+
+	if (dups)
+		r = (r % 33) - 16;
+	return r & ((1U << bits) - 1);
+}
+
+/* Returns the index in count[] of key <k> of <bits> bits, which is the key
+ * itself for unsigned keys, or the key with its sign bit flipped for signed
+ * ones, so that the indexes follow the key order in both cases.
+ */
+static unsigned int idx(unsigned int k, int bits, int sgn)
+{
+	return sgn ? k ^ (1U << (bits - 1)) : k;
+}
+
+/* Returns the index of the lowest key present at or above index <i> if <dir>
+ * is positive, or at or below <i> if <dir> is negative, or -1 if none.
+ */
+static int scan(int i, int dir, int bits)
+{
+	for (; i >= 0 && i < (1 << bits); i += dir) {
+		if (count[i])
+			return i;
+	}
+	return -1;
+}
+
+static int test16(int nbkeys, int rounds, int sgn, int dups, int uniq)
+{
+	struct eb16_node *nodes = calloc(nbkeys, sizeof(*nodes));
+	struct eb_root root = uniq ? EB_ROOT_UNIQUE : EB_ROOT;
+	struct eb16_node *n, *ret;
+	unsigned int total = 0, seen;
+	int r, i, j;
+	u16 x;
+
+	for (r = 0; r < rounds; r++) {
+		i = xorshift(&rnd) % nbkeys;
+		if (nodes[i].node.leaf_p) {
+			count[idx(nodes[i].key, 16, sgn)]--;
+			total--;
+			eb16_delete(&nodes[i]);
+		} else {
+			nodes[i].key = rnd_key(16, dups);
+			ret = sgn ? eb16i_insert(&root, &nodes[i]) : eb16_insert(&root, &nodes[i]);
+			if (ret != &nodes[i] && (!uniq || !count[idx(nodes[i].key, 16, sgn)] || ret->key != nodes[i].key)) {
+				printf("eb16: insert failure on key %#x\n", nodes[i].key);
+				return 0;
+			}
+			if (ret == &nodes[i]) {
+				count[idx(nodes[i].key, 16, sgn)]++;
+				total++;
+			}
+		}
+
+		x = rnd_key(16, dups);
+		i = idx(x, 16, sgn);
+		n = sgn ? eb16i_lookup(&root, x) : eb16_lookup(&root, x);
+		if (!n != !count[i] || (n && (n->key != x || (eb16_prev(n) && eb16_prev(n)->key == x))))
+			goto fail;
+
+		if (!sgn) {
+			j = scan(i, -1, 16);
+			n = eb16_lookup_le(&root, x);
+			if ((j < 0) != !n || (n && (n->key != j || (eb16_next(n) && eb16_next(n)->key == j))))
+				goto fail;
+			j = scan(i, 1, 16);
+			n = eb16_lookup_ge(&root, x);
+			if ((j < 0) != !n || (n && (n->key != j || (eb16_prev(n) && eb16_prev(n)->key == j))))
+				goto fail;
+		}
+
+		if ((r & 1023) == 0 || r == rounds - 1) {
+			seen = 0;
+			j = -1;
+			for (n = eb16_first(&root); n; n = eb16_next(n)) {
+				if ((int)idx(n->key, 16, sgn) < j) {
+					printf("eb16: keys out of order\n");
+					return 0;
+				}
+				j = idx(n->key, 16, sgn);
+				seen++;
+			}
+			if (seen != total ||
+			    (total && (idx(eb16_first(&root)->key, 16, sgn) != (unsigned int)scan(0, 1, 16) ||
+				       idx(eb16_last(&root)->key, 16, sgn) != (unsigned int)scan(65535, -1, 16)))) {
+				printf("eb16: walked %u keys out of %u\n", seen, total);
+				return 0;
+			}
+		}
+	}
+
+	for (i = 0; i < nbkeys; i++) {
+		if (nodes[i].node.leaf_p)
+			count[idx(nodes[i].key, 16, sgn)]--;
+	}
+	free(nodes);
+	return 1;
+ fail:
+	printf("eb16: lookup mismatch on key %#x (sgn=%d dups=%d uniq=%d)\n", x, sgn, dups, uniq);
+	return 0;
+}
+
+static int test8(int nbkeys, int rounds, int sgn, int uniq)
+{
+	struct eb8_node *nodes = calloc(nbkeys, sizeof(*nodes));
+	struct eb_root root = uniq ? EB_ROOT_UNIQUE : EB_ROOT;
+	struct eb8_node *n, *ret;
+	unsigned int total = 0, seen;
+	int r, i, j;
+	u8 x;
+
+	for (r = 0; r < rounds; r++) {
+		i = xorshift(&rnd) % nbkeys;
+		if (nodes[i].node.leaf_p) {
+			count[idx(nodes[i].key, 8, sgn)]--;
+			total--;
+			eb8_delete(&nodes[i]);
+		} else {
+			nodes[i].key = rnd_key(8, 0);
+			ret = sgn ? eb8i_insert(&root, &nodes[i]) : eb8_insert(&root, &nodes[i]);
+			if (ret != &nodes[i] && (!uniq || !count[idx(nodes[i].key, 8, sgn)] || ret->key != nodes[i].key)) {
+				printf("eb8: insert failure on key %#x\n", nodes[i].key);
+				return 0;
+			}
+			if (ret == &nodes[i]) {
+				count[idx(nodes[i].key, 8, sgn)]++;
+				total++;
+			}
+		}
+
+		x = rnd_key(8, 0);
+		i = idx(x, 8, sgn);
+		n = sgn ? eb8i_lookup(&root, x) : eb8_lookup(&root, x);
+		if (!n != !count[i] || (n && (n->key != x || (eb8_prev(n) && eb8_prev(n)->key == x))))
+			goto fail;
+
+		if (!sgn) {
+			j = scan(i, -1, 8);
+			n = eb8_lookup_le(&root, x);
+			if ((j < 0) != !n || (n && (n->key != j || (eb8_next(n) && eb8_next(n)->key == j))))
+				goto fail;
+			j = scan(i, 1, 8);
+			n = eb8_lookup_ge(&root, x);
+			if ((j < 0) != !n || (n && (n->key != j || (eb8_prev(n) && eb8_prev(n)->key == j))))
+				goto fail;
+		}
+
+		if ((r & 1023) == 0 || r == rounds - 1) {
+			seen = 0;
+			j = -1;
+			for (n = eb8_first(&root); n; n = eb8_next(n)) {
+				if ((int)idx(n->key, 8, sgn) < j) {
+					printf("eb8: keys out of order\n");
+					return 0;
+				}
+				j = idx(n->key, 8, sgn);
+				seen++;
+			}
+			if (seen != total ||
+			    (total && (idx(eb8_first(&root)->key, 8, sgn) != (unsigned int)scan(0, 1, 8) ||
+				       idx(eb8_last(&root)->key, 8, sgn) != (unsigned int)scan(255, -1, 8)))) {
+				printf("eb8: walked %u keys out of %u\n", seen, total);
+				return 0;
+			}
+		}
+	}
+
+	for (i = 0; i < nbkeys; i++) {
+		if (nodes[i].node.leaf_p)
+			count[idx(nodes[i].key, 8, sgn)]--;
+	}
+	free(nodes);
+	return 1;
+ fail:
+	printf("eb8: lookup mismatch on key %#x (sgn=%d uniq=%d)\n", x, sgn, uniq);
+	return 0;
+}
+
+static int testmd16(int rounds, int dups, int uniq)
+{
+	struct medium *s = calloc(1, sizeof(*s));
+	struct ebmd16_node *n, *ret;
+	unsigned int total = 0, seen;
+	int r, i, j;
+	u16 x;
+
+	s->root = uniq ? EBM_ROOT_UNIQUE : EBM_ROOT;
+	for (r = 0; r < rounds; r++) {
+		i = xorshift(&rnd) % NB_SMALL;
+		if (s->nodes[i].node.leaf_p) {
+			count[s->nodes[i].key]--;
+			total--;
+			ebmd16_delete(&s->nodes[i]);
+			if (s->nodes[i].node.leaf_p) {
+				printf("ebmd16: node still linked after delete\n");
+				return 0;
+			}
+		} else {
+			s->nodes[i].key = rnd_key(16, dups);
+			ret = ebmd16_insert(&s->root, &s->nodes[i]);
+			if (ret != &s->nodes[i] && (!uniq || !count[s->nodes[i].key] || ret->key != s->nodes[i].key)) {
+				printf("ebmd16: insert failure on key %#x\n", s->nodes[i].key);
+				return 0;
+			}
+			if (ret == &s->nodes[i]) {
+				count[s->nodes[i].key]++;
+				total++;
+			}
+		}
+
+		x = rnd_key(16, dups);
+		n = ebmd16_lookup(&s->root, x);
+		if (!n != !count[x] || (n && (n->key != x || (ebmd16_prev(n) && ebmd16_prev(n)->key == x))))
+			goto fail;
+		j = scan(x, -1, 16);
+		n = ebmd16_lookup_le(&s->root, x);
+		if ((j < 0) != !n || (n && (n->key != j || (ebmd16_next(n) && ebmd16_next(n)->key == j))))
+			goto fail;
+		j = scan(x, 1, 16);
+		n = ebmd16_lookup_ge(&s->root, x);
+		if ((j < 0) != !n || (n && (n->key != j || (ebmd16_prev(n) && ebmd16_prev(n)->key == j))))
+			goto fail;
+
+		if ((r & 1023) == 0 || r == rounds - 1) {
+			seen = 0;
+			j = -1;
+			for (n = ebmd16_first(&s->root); n; n = ebmd16_next(n)) {
+				if (n->key < j) {
+					printf("ebmd16: keys out of order\n");
+					return 0;
+				}
+				j = n->key;
+				seen++;
+			}
+			if (seen != total ||
+			    (total && (ebmd16_first(&s->root)->key != scan(0, 1, 16) ||
+				       ebmd16_last(&s->root)->key != scan(65535, -1, 16)))) {
+				printf("ebmd16: walked %u keys out of %u\n", seen, total);
+				return 0;
+			}
+		}
+	}
+
+	for (i = 0; i < NB_SMALL; i++) {
+		if (s->nodes[i].node.leaf_p)
+			count[s->nodes[i].key]--;
+	}
+	free(s);
+	return 1;
+ fail:
+	printf("ebmd16: lookup mismatch on key %#x (dups=%d uniq=%d)\n", x, dups, uniq);
+	return 0;
+}
+
+static int testsd16(int rounds, int dups, int uniq)
+{
+	struct small *s = calloc(1, sizeof(*s));
+	struct ebsd16_node *n, *ret;
+	unsigned int total = 0, seen;
+	int r, i, j;
+	u16 x;
+
+	s->root = uniq ? EBS_ROOT_UNIQUE : EBS_ROOT;
+	for (r = 0; r < rounds; r++) {
+		i = xorshift(&rnd) % NB_SMALL;
+		if (s->nodes[i].node.leaf_p) {
+			count[s->nodes[i].key]--;
+			total--;
+			ebsd16_delete(&s->nodes[i]);
+			if (s->nodes[i].node.leaf_p) {
+				printf("ebsd16: node still linked after delete\n");
+				return 0;
+			}
+		} else {
+			s->nodes[i].key = rnd_key(16, dups);
+			ret = ebsd16_insert(&s->root, &s->nodes[i]);
+			if (ret != &s->nodes[i] && (!uniq || !count[s->nodes[i].key] || ret->key != s->nodes[i].key)) {
+				printf("ebsd16: insert failure on key %#x\n", s->nodes[i].key);
+				return 0;
+			}
+			if (ret == &s->nodes[i]) {
+				count[s->nodes[i].key]++;
+				total++;
+			}
+		}
+
+		x = rnd_key(16, dups);
+		n = ebsd16_lookup(&s->root, x);
+		if (!n != !count[x] || (n && (n->key != x || (ebsd16_prev(n) && ebsd16_prev(n)->key == x))))
+			goto fail;
+		j = scan(x, -1, 16);
+		n = ebsd16_lookup_le(&s->root, x);
+		if ((j < 0) != !n || (n && (n->key != j || (ebsd16_next(n) && ebsd16_next(n)->key == j))))
+			goto fail;
+		j = scan(x, 1, 16);
+		n = ebsd16_lookup_ge(&s->root, x);
+		if ((j < 0) != !n || (n && (n->key != j || (ebsd16_prev(n) && ebsd16_prev(n)->key == j))))
+			goto fail;
+
+		if ((r & 1023) == 0 || r == rounds - 1) {
+			seen = 0;
+			j = -1;
+			for (n = ebsd16_first(&s->root); n; n = ebsd16_next(n)) {
+				if (n->key < j) {
+					printf("ebsd16: keys out of order\n");
+					return 0;
+				}
+				j = n->key;
+				seen++;
+			}
+			if (seen != total ||
+			    (total && (ebsd16_first(&s->root)->key != scan(0, 1, 16) ||
+				       ebsd16_last(&s->root)->key != scan(65535, -1, 16)))) {
+				printf("ebsd16: walked %u keys out of %u\n", seen, total);
+				return 0;
+			}
+		}
+	}
+
+	for (i = 0; i < NB_SMALL; i++) {
+		if (s->nodes[i].node.leaf_p)
+			count[s->nodes[i].key]--;
+	}
+	free(s);
+	return 1;
+ fail:
+	printf("ebsd16: lookup mismatch on key %#x (dups=%d uniq=%d)\n", x, dups, uniq);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int nbkeys = 5000, rounds = 200000;
+	int sgn, dups, uniq;
+
+	if (argc > 1)
+		nbkeys = atoi(argv[1]);
+	if (argc > 2)
+		rounds = atoi(argv[2]);
+
+	for (sgn = 0; sgn < 2; sgn++) {
+		for (uniq = 0; uniq < 2; uniq++) {
+			for (dups = 0; dups < 2; dups++) {
+				if (!test16(nbkeys, rounds, sgn, dups, uniq))
+					return 1;
+			}
+			if (!test8(nbkeys / 10 + 1, rounds, sgn, uniq))
+				return 1;
+		}
+	}
+	for (uniq = 0; uniq < 2; uniq++) {
+		for (dups = 0; dups < 2; dups++) {
+			if (!testmd16(rounds, dups, uniq) || !testsd16(rounds, dups, uniq))
+				return 1;
+		}
+	}
+	return 0;
+}
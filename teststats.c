@@ -0,0 +1,128 @@
+/*
+ * ebtree statistics test - 2026
+ *
+ * Usage: teststats [#keys] [#samples]
+ *
+ * Fills eb32 trees with random, clustered and duplicate keys, and checks the
+ * exact statistics against those computed by walking the tree in order and
+ * climbing from each leaf up to the root. It then prints the estimates made
+ * by the sampler from the number of descents, which must be close to the
+ * exact counts.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "eb32tree.h"
+#include "ebstats.h"
+#include "testutil.h"
+
+/* returns the number of node parts between leaf <node> and the root */
+static unsigned int leaf_depth(struct eb_node *node)
+{
+	eb_troot_t *up = node->leaf_p;
+	unsigned int depth = 0;
+
+	while (eb_clrtag(eb_untag(up, eb_gettag(up))->b[EB_RGHT])) {
+		depth++;
+		up = eb_root_to_node(eb_untag(up, eb_gettag(up)))->node_p;
+	}
+	return depth;
+}
+
+/* checks <st> against the stats computed the slow way on <root> */
+static int check(struct eb_root *root, const struct eb_stats *st)
+{
+	unsigned long long leaves = 0, keys = 0, dup_trees = 0, dup_leaves = 0, sum = 0;
+	unsigned int max = 0, depth, run = 0;
+	struct eb32_node *node, *next;
+
+	for (node = eb32_first(root); node; node = next) {
+		next = eb32_next(node);
+		depth = leaf_depth(&node->node);
+		leaves++;
+		sum += depth;
+		if (depth > max)
+			max = depth;
+		run++;
+		if (!next || next->key != node->key) {
+			keys++;
+			if (run > 1) {
+				dup_trees++;
+				dup_leaves += run;
+			}
+			run = 0;
+		}
+	}
+
+	if (st->leaves != leaves || st->nodes != (leaves ? leaves - 1 : 0) ||
+	    st->keys != keys || st->dup_trees != dup_trees ||
+	    st->dup_leaves != dup_leaves || st->depth_sum != sum ||
+	    st->max_depth != max) {
+		printf("mismatch: leaves=%llu/%llu keys=%llu/%llu dups=%llu/%llu dup_leaves=%llu/%llu depth=%llu/%llu max=%u/%u\n",
+		       st->leaves, leaves, st->keys, keys, st->dup_trees, dup_trees,
+		       st->dup_leaves, dup_leaves, st->depth_sum, sum, st->max_depth, max);
+		return 0;
+	}
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	static const char *names[] = { "random", "clustered", "dups" };
+	struct eb32_node *nodes;
+	struct eb_sampler smp;
+	struct eb_stats st, est;
+	struct eb_root root;
+	int nbkeys = 100000, samples = 10000;
+	int t, i;
+
+	if (argc > 1)
+		nbkeys = atoi(argv[1]);
+	if (argc > 2)
+		samples = atoi(argv[2]);
+
+	nodes = calloc(nbkeys, sizeof(*nodes));
+
+	printf("# workload leaves   nodes     distinct  dups     dup_leaves avg_depth max_depth\n");
+	for (t = 0; t < 3; t++) {
+		root = EB_ROOT;
+		for (i = 0; i < nbkeys; i++) {
+			if (t == 0)
+				nodes[i].key = xorshift(&rnd);
+			else if (t == 1)
+				nodes[i].key = (i & 63) ? nodes[i - 1].key + 1 : xorshift(&rnd);
+			else
+				nodes[i].key = xorshift(&rnd) % (nbkeys / 100 + 1);
+			eb32_insert(&root, &nodes[i]);
+		}
+
+		eb_stats(&root, &st);
+		if (!check(&root, &st))
+			return 1;
+
+		eb_sampler_init(&smp, t + 1);
+		eb_stats_sample(&root, &smp, samples);
+		eb_sampler_stats(&smp, &est);
+
+		printf("%-10s exact   %-9llu %-9llu %-9llu %-8llu %-10llu %-9.2f %u\n",
+		       names[t], st.leaves, st.nodes, st.keys, st.dup_trees,
+		       st.dup_leaves, eb_stats_avg_depth(&st), st.max_depth);
+		printf("%-10s sampled %-9llu %-9llu %-9llu %-8llu %-10llu %-9.2f %u\n",
+		       names[t], est.leaves, est.nodes, est.keys, est.dup_trees,
+		       est.dup_leaves, eb_stats_avg_depth(&est), est.max_depth);
+
+		/* the estimates are noisy but may not be off by more than 25% */
+		if (est.leaves < st.leaves * 3 / 4 || est.leaves > st.leaves * 5 / 4) {
+			printf("%s: estimated %llu leaves instead of %llu\n", names[t], est.leaves, st.leaves);
+			return 1;
+		}
+	}
+
+	/* the empty tree */
+	root = EB_ROOT;
+	eb_stats(&root, &st);
+	if (!check(&root, &st))
+		return 1;
+	return 0;
+}
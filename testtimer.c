@@ -0,0 +1,196 @@
+/*
+ * ebtree timer queue test - 2026
+ *
+ * Usage: testtimer [#timers] [#rounds]
+ *
+ * Makes the date advance by small random steps from a few thousand ticks
+ * before the 32-bit wrap to well after it, while timers are randomly armed,
+ * re-armed (in place or not) and cancelled, with expiration dates spread on
+ * both sides of the wrap, many timers expiring at the same date, and a few far
+ * away in the past or the future. At each step, ebtimer_first() and
+ * ebtimer_next_expiry() are checked against a linear scan, then, except at
+ * some steps to let expired timers accumulate, ebtimer_run_expired() must run
+ * exactly the expired timers in expiration order, the ones expiring at the
+ * same date in the order they were armed. The callback re-arms some of them
+ * in the future.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ebtimer.h"
+#include "testutil.h"
+
+struct timer {
+	struct eb32_node node;
+	unsigned int seq;
+};
+
+static unsigned int seq;
+static u32 now;
+
+/* the timers run by the last ebtimer_run_expired() call */
+static struct timer **ran;
+static unsigned int nbran;
+static int ran_armed;
+
+/* Returns a random date around <now>, mostly in the near future, often
+ * shared, and sometimes up to 2^30 ticks away in the past or the future.
+ */
+static u32 rnd_tick(void)
+{
+	unsigned int r = xorshift(&rnd);
+
+	if (r % 8 == 0)
+		return now + (int)(xorshift(&rnd) - (1U << 31)) / 2;
+	if (r & 1)
+		return now + (r >> 1) % 64 - 8;
+	return now + (r >> 1) % 4000 - 500;
+}
+
+/* Returns <0, 0 or >0 if timer <a> expires before, with or after timer <b>,
+ * relative to <now>, like the timer queue orders them.
+ */
+static int cmp_timer(const struct timer *a, const struct timer *b)
+{
+	u32 ka = a->node.key - (now - EBTIMER_LOOK_BACK);
+	u32 kb = b->node.key - (now - EBTIMER_LOOK_BACK);
+
+	if (ka != kb)
+		return ka < kb ? -1 : 1;
+	return (a->seq > b->seq) - (a->seq < b->seq);
+}
+
+static int qcmp_timer(const void *a, const void *b)
+{
+	return cmp_timer(*(struct timer * const *)a, *(struct timer * const *)b);
+}
+
+static void run(struct eb_root *root, struct eb32_node *node)
+{
+	struct timer *t = container_of(node, struct timer, node);
+
+	if (ebtimer_is_armed(node))
+		ran_armed = 1;
+	ran[nbran++] = t;
+
+	/* re-arm some timers in the future */
+	if ((xorshift(&rnd) & 3) == 0) {
+		ebtimer_arm(root, node, now + 1 + xorshift(&rnd) % 1000);
+		t->seq = seq++;
+	}
+}
+
+static int test(int nbtimers, int rounds)
+{
+	struct timer *timers = calloc(nbtimers, sizeof(*timers));
+	struct timer **exp = calloc(nbtimers, sizeof(*exp));
+	struct eb_root root = EB_ROOT;
+	struct timer *t, *first;
+	struct eb32_node *node;
+	unsigned int nbexp, done;
+	int r, i, ret, moved;
+	u32 tick;
+
+	ran = calloc(nbtimers * 2, sizeof(*ran));
+	now = 0U - 3000;
+
+	for (r = 0; r < rounds; r++) {
+		/* arm, re-arm or cancel a few timers */
+		for (i = 0; i < 8; i++) {
+			t = &timers[xorshift(&rnd) % nbtimers];
+			switch (xorshift(&rnd) % 4) {
+			case 0:
+				if (ebtimer_is_armed(&t->node)) {
+					ebtimer_cancel(&t->node);
+					continue;
+				}
+				ebtimer_arm(&root, &t->node, rnd_tick());
+				t->seq = seq++;
+				continue;
+			case 1:
+				/* small change, likely in place */
+				tick = ebtimer_is_armed(&t->node) ? t->node.key + (xorshift(&rnd) % 5) - 2 : rnd_tick();
+				break;
+			default:
+				tick = rnd_tick();
+				break;
+			}
+
+			/* re-arming at the same date leaves the timer in place */
+			moved = !ebtimer_is_armed(&t->node) || t->node.key != tick;
+			ebtimer_rearm(&root, &t->node, tick);
+			if (t->node.key != tick || !ebtimer_is_armed(&t->node)) {
+				printf("timer re-armed at %#x instead of %#x\n", t->node.key, tick);
+				return 0;
+			}
+			if (moved)
+				t->seq = seq++;
+		}
+
+		now += xorshift(&rnd) % 64;
+
+		/* the first timer and the expired ones, in expiration order */
+		first = NULL;
+		nbexp = 0;
+		for (i = 0; i < nbtimers; i++) {
+			t = &timers[i];
+			if (!ebtimer_is_armed(&t->node))
+				continue;
+			if (!first || cmp_timer(t, first) < 0)
+				first = t;
+			if (ebtimer_is_expired(t->node.key, now))
+				exp[nbexp++] = t;
+		}
+		qsort(exp, nbexp, sizeof(*exp), qcmp_timer);
+
+		node = ebtimer_first(&root, now);
+		ret = ebtimer_next_expiry(&root, now, &tick);
+		if (node != (first ? &first->node : NULL) || ret != !!first || (first && tick != first->node.key)) {
+			printf("wrong first timer at %#x: %#x instead of %#x\n", now,
+			       node ? node->key : 0, first ? first->node.key : 0);
+			return 0;
+		}
+
+		/* let expired timers accumulate from time to time */
+		if ((r & 3) == 3)
+			continue;
+
+		nbran = 0;
+		ran_armed = 0;
+		done = ebtimer_run_expired(&root, now, run);
+		if (ran_armed || done != nbran || nbran != nbexp) {
+			printf("ran %u/%u timers out of %u at %#x\n", done, nbran, nbexp, now);
+			return 0;
+		}
+		for (i = 0; i < (int)nbexp; i++) {
+			if (ran[i] != exp[i]) {
+				printf("timer %d ran out of order at %#x: %#x instead of %#x\n",
+				       i, now, ran[i]->node.key, exp[i]->node.key);
+				return 0;
+			}
+		}
+		if (ebtimer_pick_expired(&root, now)) {
+			printf("expired timer left at %#x\n", now);
+			return 0;
+		}
+	}
+	free(ran);
+	free(exp);
+	free(timers);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int nbtimers = 1000, rounds = 20000;
+
+	if (argc > 1)
+		nbtimers = atoi(argv[1]);
+	if (argc > 2)
+		rounds = atoi(argv[2]);
+
+	if (!test(nbtimers, rounds))
+		return 1;
+	return 0;
+}
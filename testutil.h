@@ -0,0 +1,61 @@
+/*
+ * ebtree test helpers - 2026
+ *
+ * Random numbers and tree structure checks shared by the test programs. The
+ * generator always starts from the same seed so that failures reproduce.
+ * Threaded tests keep one state per thread and only use xorshift().
+ */
+
+#ifndef _TESTUTIL_H
+#define _TESTUTIL_H
+
+#include "ebtree.h"
+
+static unsigned int rnd __attribute__((unused)) = 0x12345678;
+
+/* returns the next value of the xorshift generator whose state is <x> */
+static inline unsigned int xorshift(unsigned int *x)
+{
+	*x ^= *x << 13;
+	*x ^= *x >> 17;
+	*x ^= *x << 5;
+	return *x;
+}
+
+/* returns a 64-bit random value */
+static inline unsigned long long rnd64(void)
+{
+	return ((unsigned long long)xorshift(&rnd) << 32) + xorshift(&rnd);
+}
+
+/* Checks the parent pointers of the subtree <troot> designated from <up>.
+ * Returns the number of leaves, or -1 on error.
+ */
+static inline int check_links(eb_troot_t *troot, eb_troot_t *up)
+{
+	struct eb_node *n;
+	int l, r;
+
+	if (!troot)
+		return 0;
+	if (eb_gettag(troot) == EB_LEAF) {
+		n = container_of(eb_untag(troot, EB_LEAF), struct eb_node, branches);
+		return n->leaf_p == up ? 1 : -1;
+	}
+	n = container_of(eb_untag(troot, EB_NODE), struct eb_node, branches);
+	if (n->node_p != up)
+		return -1;
+	l = check_links(n->branches.b[EB_LEFT], eb_dotag(&n->branches, EB_LEFT));
+	r = check_links(n->branches.b[EB_RGHT], eb_dotag(&n->branches, EB_RGHT));
+	return (l < 0 || r < 0) ? -1 : l + r;
+}
+
+/* Returns the number of leaves of tree <root>, or -1 if a parent pointer is
+ * wrong.
+ */
+static inline int check_root(struct eb_root *root)
+{
+	return check_links(root->b[EB_LEFT], eb_dotag(root, EB_LEFT));
+}
+
+#endif /* _TESTUTIL_H */